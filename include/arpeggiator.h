@@ -0,0 +1,90 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_ARPEGGIATOR_H
+#define MIDIMAGIC_ARPEGGIATOR_H
+
+#include "common.h"
+
+namespace midimagic {
+    // Turns the held notes of a port group into a sequence stepped by MIDI
+    // clock. The held notes live in a 128 bit bitmap, finding the next note
+    // up or down takes a count leading/trailing zeros on at most four words.
+    class arpeggiator {
+    public:
+        enum arp_mode : u8 {
+            OFF = 0,
+            UP,
+            DOWN,
+            UP_DOWN,
+            RANDOM,
+            AS_PLAYED,
+            _MODE_COUNT_
+        };
+
+        // notes remembered in playing order for RANDOM and AS_PLAYED
+        static const u8 k_max_played_notes = 12;
+
+        arpeggiator();
+        arpeggiator(const arpeggiator&) = delete;
+        ~arpeggiator();
+
+        void set_mode(const arp_mode mode);
+        const arp_mode get_mode() const;
+        // clock ticks per step, 24 per quarter note
+        void set_division(const u8 division);
+        const u8 get_division() const;
+
+        void note_on(const u8 note, const u8 velocity);
+        void note_off(const u8 note);
+        // advance one clock tick, end_note and start_note are 255 if nothing is to be done
+        void tick(u8& end_note, u8& start_note);
+        // velocity of the last played note, used for every step
+        const u8 get_velocity() const;
+        // restart the sequence from the first step, returns the sounding note to end or 255
+        const u8 restart();
+        // forget all held notes, returns the sounding note to end or 255
+        const u8 clear();
+
+    private:
+        // next held note above/below note, 255 starts from the bottom/top, 255 if there is none
+        const u8 next_above(const u8 note) const;
+        const u8 next_below(const u8 note) const;
+        const u8 next_step();
+
+        u32 m_held[4];
+        u8 m_held_count;
+        u8 m_played[k_max_played_notes];
+        u8 m_played_count;
+        u8 m_play_index;
+        arp_mode m_mode;
+        u8 m_division;
+        u8 m_tick;
+        u8 m_current; // last stepped note
+        u8 m_sounding; // note with open gate
+        u8 m_velocity;
+        bool m_ascending;
+    };
+
+    const char* arp_mode2name(arpeggiator::arp_mode mode);
+} // namespace midimagic
+
+#endif // MIDIMAGIC_ARPEGGIATOR_H
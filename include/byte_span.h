@@ -0,0 +1,107 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_BYTE_SPAN_H
+#define MIDIMAGIC_BYTE_SPAN_H
+
+#include <memory>
+#include "common.h"
+
+namespace midimagic {
+    // Non-owning read-only view on a byte buffer,
+    // reads outside of the buffer return 0
+    class byte_span {
+    public:
+        byte_span(const u8* data, const u16 size)
+            : m_data(data)
+            , m_size(size) {
+        };
+
+        const u8 read(const u16 addr) const {
+            if (addr >= m_size) {
+                return 0;
+            }
+            return m_data[addr];
+        };
+
+        // read 2 byte value, MSB from addr, LSB from addr + 1
+        const u16 read_2byte(const u16 addr) const {
+            return (read(addr) << 8) + read(addr + 1);
+        };
+
+        const bool contains(const u16 addr, const u16 length) const {
+            return (addr <= m_size) && (length <= m_size - addr);
+        };
+
+        const u8* data() const {
+            return m_data;
+        };
+
+        const u16 size() const {
+            return m_size;
+        };
+
+    private:
+        const u8* m_data;
+        u16 m_size;
+    };
+
+    // Owning fixed size byte buffer, writes outside of the buffer are ignored
+    class byte_buffer {
+    public:
+        explicit byte_buffer(const u16 size)
+            : m_data(new u8[size]())
+            , m_size(size) {
+        };
+        byte_buffer() = delete;
+        byte_buffer(const byte_buffer&) = delete;
+
+        void write(const u16 addr, const u8 data) {
+            if (addr < m_size) {
+                m_data[addr] = data;
+            }
+        };
+
+        // write 2 byte value, MSB at addr, LSB at addr + 1
+        void write_2byte(const u16 addr, const u16 data) {
+            write(addr, (u8) ((data >> 8) & 0xff));
+            write(addr + 1, (u8) (data & 0xff));
+        };
+
+        u8* data() {
+            return m_data.get();
+        };
+
+        const u16 size() const {
+            return m_size;
+        };
+
+        const byte_span span() const {
+            return byte_span(m_data.get(), m_size);
+        };
+
+    private:
+        std::unique_ptr<u8[]> m_data;
+        u16 m_size;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_BYTE_SPAN_H
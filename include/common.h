@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2020 Lukas Jünger                                                *
+ * Copyright 2020, 2026 Lukas Jünger                                         *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -26,8 +26,10 @@
 namespace midimagic {
     typedef uint8_t u8;
     typedef uint16_t u16;
+    typedef uint32_t u32;
     typedef int8_t i8;
     typedef int16_t i16;
+    typedef int32_t i32;
 
 }
 #endif //TYPES_H
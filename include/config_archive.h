@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022, 2024 Adrian Krause                                         *
+ * Copyright 2022, 2024, 2026 Adrian Krause                                  *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -25,15 +25,18 @@
 #include "common.h"
 #include "system_config.h"
 #include "hardware_config.h"
-#include "microwire_eeprom.h"
+#include "eeprom_device.h"
+#include "byte_span.h"
+#include "crc16.h"
 #include "midi_types.h"
 #include "output.h"
 
 namespace midimagic {
     class config_archive {
     public:
-        config_archive();
-        config_archive(const struct system_config system_state);
+        explicit config_archive(eeprom_device& eeprom);
+        config_archive(eeprom_device& eeprom, const struct preset_config& presets);
+        config_archive() = delete;
         ~config_archive();
         config_archive(const config_archive&) = delete;
 
@@ -48,21 +51,102 @@ namespace midimagic {
             ILLEGAL_ADDRESS_ON_READ,
             ILLEGAL_CONFIG_BASE_ADDRESS,
             UNKNOWN_CONFIG_TYPE_ON_READ,
-            CONFIG_TOO_BIG
+            CONFIG_TOO_BIG,
+            CRC_MISMATCH,
+            WRITE_IN_PROGRESS
         };
 
-        // copy external system_state into class member
-        void readin(const struct system_config system_state);
-        // return current saved system state
-        const struct system_config spellout() const;
-        // deserialise archive into system_state struct
+        // copy external presets into class member
+        void readin(const struct preset_config& presets);
+        // return current saved presets
+        const struct preset_config& spellout() const;
+        // presets to be filled in place, all presets together are too big for a spare copy
+        struct preset_config& get_presets();
+        // read the preset bundle of the newest valid slot into RAM once
+        // and deserialise it into the presets struct, a single archive
+        // from before presets existed becomes the first preset
         const operation_result loadon();
-        // serialise system_state member into eeprom
+        // serialise all presets into a RAM image and commit it to the
+        // inactive slot, programming only the bytes differing from the
+        // current eeprom contents, blocks until the commit is done
         const operation_result writeout();
+        // serialise all presets and prepare the commit, returns
+        // WRITE_IN_PROGRESS if writeout_step() has to finish the job
+        const operation_result begin_writeout();
+        // compare up to k_commit_chunk bytes and start at most one program
+        // cycle, never waits for the eeprom; returns WRITE_IN_PROGRESS until
+        // the slot is committed
+        const operation_result writeout_step();
+        // drop the commit in progress, the target slot stays invalid;
+        // returns false while a program cycle is still running
+        const bool abort_writeout();
+        // share of the commit compared or written in percent
+        const u8 get_writeout_progress() const;
+        // bytes programmed and bytes left untouched by the last writeout
+        const u16 get_bytes_written() const;
+        const u16 get_bytes_skipped() const;
+        // size of the last loaded or written image in bytes
+        const u16 get_archive_size() const;
+
+        // SysEx dump: find the newest valid slot, read_dump() then streams
+        // its image straight from the eeprom, get_archive_size() is its size
+        const operation_result begin_dump();
+        const u16 read_dump(const u16 offset, u8* buffer, const u16 length) const;
+        // SysEx restore: the image arrives in chunks which restore_step()
+        // programs straight into the inactive slot, one byte per call until
+        // it returns SUCCESS. finish_restore() checks the image like a load,
+        // its WRITE_IN_PROGRESS hands the slot header to writeout_step().
+        // abort_writeout() drops a restore as well.
+        const operation_result begin_restore(const u16 image_size);
+        const operation_result restore_step(const u8* data, const u16 offset, const u16 length);
+        const operation_result finish_restore();
+
+        // bit packing of version 3, shared with archive_parser_v3
+        // clock rates are stored as 6 * 2^code, as offered by the port view
+        static const u8 pack_clock_rate(const u8 clock_rate);
+        static const u8 unpack_clock_rate(const u8 code);
+        // bits 0...7 NOTE_OFF to PARAMETER, bits 8...15 system messages 0xf8 to 0xff
+        static const u16 pack_input_types(const input_type_list& input_types);
+        static const input_type_list unpack_input_types(const u16 mask);
+        // LEB128 style, 7 bits per byte starting with the lowest, MSB set on all but the last byte
+        static const u16 varint_size(u16 value);
 
     private:
-        #define RUNNING_VERSION 2
+        #define RUNNING_VERSION 3
         #define MAGIC 0x4d4d // "MM"
+        #define SLOT_MAGIC 0x4d53 // "MS"
+        #define SLOT_COUNT 2
+        #define PRESET_BUNDLE_MAGIC 0x4d42 // "MB"
+        #define PRESET_BUNDLE_VERSION 1
+
+        // The eeprom is split into SLOT_COUNT equally sized slots, each one
+        // holding a slot header followed by an archive. A save goes to the
+        // slot not holding the newest valid archive and writes the sequence
+        // number last, the CRC covers sequence number and archive.
+        enum slot_header_field : u16 {
+            SLOT_MAGIC0 = 0,
+            SLOT_MAGIC1,
+            SLOT_CRC0,
+            SLOT_CRC1,
+            SLOT_SEQUENCE0,
+            SLOT_SEQUENCE1,
+            SLOT_HEADER_SIZE
+        };
+
+        // A slot holds a preset bundle: the bundle header followed by one
+        // complete archive per preset. Magic, version and size sit at the
+        // same offsets as in the archive header.
+        enum preset_bundle_field : u16 {
+            BUNDLE_MAGIC0 = 0,
+            BUNDLE_MAGIC1,
+            BUNDLE_VERSION,
+            BUNDLE_SIZE0,
+            BUNDLE_SIZE1,
+            BUNDLE_CONTROL_CHANNEL,
+            BUNDLE_PRESET_COUNT,
+            BUNDLE_ACTIVE_PRESET,
+            BUNDLE_HEADER_SIZE
+        };
 
         enum static_header_field : u16 {
             MAGIC0 = 0,
@@ -75,55 +159,165 @@ namespace midimagic {
             FIRST_CONFIG_BASE_ADDR
         };
 
-        enum port_config_field : u16 {
-            PORT_NUMBER = 0,
-            CLOCK_RATE,
-            VELOCITY,
-            CLOCK_MODE
+        // Version 3 archives hold a stream of records after the static
+        // header instead of the address table, every record is a type byte,
+        // the payload length as varint and the payload. Unknown record types
+        // and payload bytes beyond the known fields are skipped on read.
+        enum record_stream_field : u16 {
+            FIRST_RECORD = static_header_field::PORT_CONFIG_COUNT
         };
 
-        enum portgroup_config_field : u16 {
-            DEMUX_TYPE = 0,
-            MIDI_CHANNEL,
-            CC_NUMBER,
-            TRANSPOSE,
-            INPUT_TYPE_COUNT,
-            OUTPUT_PORTS, // 1 byte bitfield [Port0(MSB),...,Port7(LSB)]
-            FIRST_VARIABLE
+        enum record_type : u8 {
+            PORT_RECORD = 0,
+            PORTGROUP_RECORD,
+            MODULATION_RECORD, // only written for ports running a modulation source
+            QUANTIZER_RECORD, // only written for ports quantizing to a scale
+            VELOCITY_RECORD // only written for ports with another than the linear velocity curve
         };
 
-        enum config_type {
-            OUTPUT_PORT_CONFIG = 0,
-            PORTGROUP_CONFIG
+        enum port_record_field : u16 {
+            RECORD_PORT_NUMBER = 0,
+            RECORD_PORT_SETTINGS, // [velocity(MSB), 3 bit clock mode, 4 bit clock rate code]
+            PORT_RECORD_SIZE
         };
 
-        // generate header in the eeprom from system_state, return size
-        u16 generate_archive_header();
-        // read header to return base address of configuration at index, return 0 on failure
-        u16 get_address_to(config_type type, u8 index);
-        // serialise config struct and write to eeprom, return size
-        u16 serialise(struct output_port_config config, u16 base_addr);
-        u16 serialise(struct port_group_config config, u16 base_addr);
+        enum modulation_record_field : u16 {
+            RECORD_MOD_PORT_NUMBER = 0,
+            RECORD_MOD_TYPE_SHAPE, // [4 bit source type, 4 bit LFO shape]
+            RECORD_MOD_RATE,
+            RECORD_MOD_SYNC,
+            RECORD_MOD_DEPTH,
+            RECORD_MOD_ATTACK,
+            RECORD_MOD_DECAY,
+            RECORD_MOD_SUSTAIN,
+            RECORD_MOD_RELEASE,
+            RECORD_MOD_TRIGGER_GROUP, // position of the triggering portgroup in the archive counted from 1, 0 for none
+            MODULATION_RECORD_SIZE
+        };
+
+        enum quantizer_record_field : u16 {
+            RECORD_QUANT_PORT_NUMBER = 0,
+            RECORD_QUANT_SCALE, // [trigger(MSB), 3 bit unused, 4 bit scale type]
+            RECORD_QUANT_ROOT,
+            RECORD_QUANT_MASK0, // 2 byte user scale degree mask
+            RECORD_QUANT_MASK1,
+            QUANTIZER_RECORD_SIZE
+        };
 
-        struct system_config m_system_state;
-        microwire_eeprom m_eeprom;
-        const u16 k_port_config_size = 4;
-        const u16 k_fixed_portgroup_config_size = 6;
+        enum velocity_record_field : u16 {
+            RECORD_VEL_PORT_NUMBER = 0,
+            RECORD_VEL_CURVE,
+            RECORD_VEL_FIXED_LEVEL,
+            RECORD_VEL_POINT0, // k_user_curve_points levels of the user curve
+            VELOCITY_RECORD_SIZE = RECORD_VEL_POINT0 + k_user_curve_points
+        };
+
+        enum portgroup_record_field : u16 {
+            RECORD_DEMUX_CHANNEL = 0, // [pressure to companion(MSB), MPE, 2 bit demux type, 4 bit MIDI channel - 1]
+            RECORD_CC_NUMBER,
+            RECORD_TRANSPOSE,
+            RECORD_OUTPUT_PORTS, // 1 byte bitfield [Port0(MSB),...,Port7(LSB)]
+            RECORD_INPUT_TYPES0, // 2 byte bitmask, see pack_input_types()
+            RECORD_INPUT_TYPES1,
+            PORTGROUP_RECORD_SIZE,
+            // only written for port groups listening to NRPN or arpeggiating
+            RECORD_NRPN0 = PORTGROUP_RECORD_SIZE,
+            RECORD_NRPN1,
+            PORTGROUP_NRPN_RECORD_SIZE,
+            // only written for arpeggiating port groups
+            RECORD_ARP_MODE = PORTGROUP_NRPN_RECORD_SIZE,
+            RECORD_ARP_DIVISION,
+            PORTGROUP_ARP_RECORD_SIZE,
+            // only written for MPE port groups
+            RECORD_MPE_MEMBERS = PORTGROUP_ARP_RECORD_SIZE,
+            RECORD_MPE_TIMBRE,
+            PORTGROUP_MPE_RECORD_SIZE
+        };
+
+        const u16 get_slot_base(const u8 slot) const;
+        const u16 get_slot_size() const;
+        // find the slot with the newest archive passing the CRC check and read its archive
+        const operation_result read_newest_slot(u8& slot, u16& sequence, std::unique_ptr<byte_buffer>& image) const;
+        // read the archive or preset bundle starting at base_addr into image, checking the static header
+        const operation_result read_archive(const u16 base_addr, const u16 limit, std::unique_ptr<byte_buffer>& image) const;
+        // deserialise a preset bundle or a single archive image into the presets
+        const operation_result parse_image(const byte_span& image);
+        // deserialise the archive image into config
+        const operation_result parse_archive(const byte_span& archive, struct system_config& config);
+        // size of the serialised presets in bytes
+        const u16 calculate_bundle_size() const;
+        // size of the serialised config in bytes
+        const u16 calculate_archive_size(const struct system_config& config) const;
+        // serialise config into the image sized by calculate_archive_size
+        const operation_result serialise_archive(const struct system_config& config, byte_buffer& image);
+        // serialise config struct as record into the image, return record size
+        u16 serialise(const struct output_port_config& config, u16 base_addr, byte_buffer& image);
+        u16 serialise(const struct port_group_config& config, u16 base_addr, byte_buffer& image);
+        // port_groups resolves the envelope trigger to its position in the archive
+        u16 serialise_modulation(const struct output_port_config& config, const port_group_config_list& port_groups,
+                                 u16 base_addr, byte_buffer& image);
+        u16 serialise_quantizer(const struct output_port_config& config, u16 base_addr, byte_buffer& image);
+        u16 serialise_velocity_curve(const struct output_port_config& config, u16 base_addr, byte_buffer& image);
+        static const u16 portgroup_payload_size(const struct port_group_config& config);
+        // write type and payload length of a record, return header size
+        u16 write_record_header(const record_type type, const u16 payload_size, u16 base_addr, byte_buffer& image);
+
+        // slot and sequence number for the next commit, returns true and the
+        // archive of the newest slot in active_image if there is a valid one
+        const bool find_target_slot(u8& target_slot, u16& sequence, std::unique_ptr<byte_buffer>& active_image) const;
+        // slot header and archive for writeout_step()
+        void prepare_commit(const byte_span& image, const u8 target_slot, const u16 sequence);
+        // offset in the slot of the byte at position in the commit order:
+        // archive, magic and CRC first, the sequence number commits the slot
+        const u16 get_commit_offset(const u16 position) const;
+
+        struct preset_config m_presets;
+        eeprom_device& m_eeprom;
+        u16 m_archive_size;
+        u16 m_bytes_written;
+        u16 m_bytes_skipped;
+        // slot header and archive of the commit in progress
+        std::unique_ptr<byte_buffer> m_commit_image;
+        u16 m_commit_base;
+        u16 m_commit_position;
+        static const u16 k_commit_chunk = 16;
+        // archive in the eeprom of a SysEx dump or restore
+        u16 m_transfer_base;
+        u8 m_restore_slot;
+        u16 m_restore_sequence;
+        bool m_restoring;
         u8 m_running_portgroup_id;
     };
 
     class archive_parser {
     public:
-        explicit archive_parser(microwire_eeprom& eeprom);
+        // parses the archive image in archive, no EEPROM access
+        explicit archive_parser(const byte_span& archive);
         archive_parser() = delete;
         archive_parser(const archive_parser&) = delete;
         virtual ~archive_parser();
 
         virtual const config_archive::operation_result parse() = 0;
         virtual std::unique_ptr<const struct system_config> get_config() const;
+        const u16 get_archive_size() const;
 
     protected:
 
+        // A slot holds a preset bundle: the bundle header followed by one
+        // complete archive per preset. Magic, version and size sit at the
+        // same offsets as in the archive header.
+        enum preset_bundle_field : u16 {
+            BUNDLE_MAGIC0 = 0,
+            BUNDLE_MAGIC1,
+            BUNDLE_VERSION,
+            BUNDLE_SIZE0,
+            BUNDLE_SIZE1,
+            BUNDLE_CONTROL_CHANNEL,
+            BUNDLE_PRESET_COUNT,
+            BUNDLE_ACTIVE_PRESET,
+            BUNDLE_HEADER_SIZE
+        };
+
         enum static_header_field : u16 {
             MAGIC0 = 0,
             MAGIC1,
@@ -150,16 +344,16 @@ namespace midimagic {
         virtual const struct output_port_config deserialise_port(const u16 base_addr) const = 0;
         virtual const struct port_group_config deserialise_portgroup(const u16 base_addr, const u8 pg_id) const = 0;
 
-        const microwire_eeprom& k_eeprom;
+        const byte_span k_archive;
         u16 m_archive_size;
-        std::vector<u16> m_port_config_addrs;
-        std::vector<u16> m_portgroup_config_addrs;
+        fixed_vector<u16, k_max_output_ports> m_port_config_addrs;
+        fixed_vector<u16, k_max_port_groups> m_portgroup_config_addrs;
         struct system_config m_system_config;
     };
 
     class archive_parser_v1 : public archive_parser {
     public:
-        explicit archive_parser_v1(microwire_eeprom& eeprom);
+        explicit archive_parser_v1(const byte_span& archive);
         archive_parser_v1() = delete;
         archive_parser_v1(const archive_parser_v1&) = delete;
         virtual ~archive_parser_v1();
@@ -181,18 +375,29 @@ namespace midimagic {
         virtual const u8 read_port_number(const u16 base_addr) const;
         virtual const u8 read_port_clock_rate(const u16 base_addr) const;
         virtual const bool read_port_velocity(const u16 base_addr) const;
+        virtual const modulation_settings read_port_modulation(const u16 base_addr) const;
+        virtual const quantizer_settings read_port_quantizer(const u16 base_addr) const;
+        virtual const velocity_settings read_port_velocity_curve(const u16 base_addr) const;
 
         virtual const demux_type read_portgroup_demux(const u16 base_addr) const;
         virtual const u8 read_portgroup_chan(const u16 base_addr) const;
         virtual const u8 read_portgroup_cc(const u16 base_addr) const;
         virtual const i8 read_portgroup_transpose(const u16 base_addr) const;
-        virtual const std::vector<midi_message::message_type> read_portgroup_msg_types(const u16 base_addr) const;
-        virtual const std::vector<u8> read_portgroup_ports(const u16 base_addr) const;
+        virtual const input_type_list read_portgroup_msg_types(const u16 base_addr) const;
+        virtual const port_number_list read_portgroup_ports(const u16 base_addr) const;
+        // not stored before archive version 3
+        virtual const bool read_portgroup_pressure_to_companion(const u16 base_addr) const;
+        virtual const bool read_portgroup_mpe(const u16 base_addr) const;
+        virtual const u8 read_portgroup_mpe_members(const u16 base_addr) const;
+        virtual const u8 read_portgroup_mpe_timbre(const u16 base_addr) const;
+        virtual const u16 read_portgroup_nrpn(const u16 base_addr) const;
+        virtual const arpeggiator::arp_mode read_portgroup_arp_mode(const u16 base_addr) const;
+        virtual const u8 read_portgroup_arp_division(const u16 base_addr) const;
     };
 
     class archive_parser_v2 : public archive_parser_v1 {
     public:
-        explicit archive_parser_v2(microwire_eeprom& eeprom);
+        explicit archive_parser_v2(const byte_span& archive);
         archive_parser_v2() = delete;
         archive_parser_v2(const archive_parser_v2&) = delete;
         virtual ~archive_parser_v2();
@@ -212,5 +417,121 @@ namespace midimagic {
         // new port property added in version 2
         virtual const output_port::clock_mode read_port_clock_mode(const u16 base_addr) const;
     };
+
+    class archive_parser_v3 : public archive_parser_v2 {
+    public:
+        explicit archive_parser_v3(const byte_span& archive);
+        archive_parser_v3() = delete;
+        archive_parser_v3(const archive_parser_v3&) = delete;
+        virtual ~archive_parser_v3();
+
+    protected:
+
+        enum record_stream_field : u16 {
+            FIRST_RECORD = static_header_field::PORT_CONFIG_COUNT
+        };
+
+        enum record_type : u8 {
+            PORT_RECORD = 0,
+            PORTGROUP_RECORD,
+            MODULATION_RECORD,
+            QUANTIZER_RECORD,
+            VELOCITY_RECORD
+        };
+
+        enum port_record_field : u16 {
+            RECORD_PORT_NUMBER = 0,
+            RECORD_PORT_SETTINGS,
+            PORT_RECORD_SIZE
+        };
+
+        enum modulation_record_field : u16 {
+            RECORD_MOD_PORT_NUMBER = 0,
+            RECORD_MOD_TYPE_SHAPE,
+            RECORD_MOD_RATE,
+            RECORD_MOD_SYNC,
+            RECORD_MOD_DEPTH,
+            RECORD_MOD_ATTACK,
+            RECORD_MOD_DECAY,
+            RECORD_MOD_SUSTAIN,
+            RECORD_MOD_RELEASE,
+            RECORD_MOD_TRIGGER_GROUP,
+            MODULATION_RECORD_SIZE
+        };
+
+        enum quantizer_record_field : u16 {
+            RECORD_QUANT_PORT_NUMBER = 0,
+            RECORD_QUANT_SCALE,
+            RECORD_QUANT_ROOT,
+            RECORD_QUANT_MASK0,
+            RECORD_QUANT_MASK1,
+            QUANTIZER_RECORD_SIZE
+        };
+
+        enum velocity_record_field : u16 {
+            RECORD_VEL_PORT_NUMBER = 0,
+            RECORD_VEL_CURVE,
+            RECORD_VEL_FIXED_LEVEL,
+            RECORD_VEL_POINT0,
+            VELOCITY_RECORD_SIZE = RECORD_VEL_POINT0 + k_user_curve_points
+        };
+
+        enum portgroup_record_field : u16 {
+            RECORD_DEMUX_CHANNEL = 0,
+            RECORD_CC_NUMBER,
+            RECORD_TRANSPOSE,
+            RECORD_OUTPUT_PORTS,
+            RECORD_INPUT_TYPES0,
+            RECORD_INPUT_TYPES1,
+            PORTGROUP_RECORD_SIZE,
+            RECORD_NRPN0 = PORTGROUP_RECORD_SIZE,
+            RECORD_NRPN1,
+            PORTGROUP_NRPN_RECORD_SIZE,
+            RECORD_ARP_MODE = PORTGROUP_NRPN_RECORD_SIZE,
+            RECORD_ARP_DIVISION,
+            PORTGROUP_ARP_RECORD_SIZE,
+            RECORD_MPE_MEMBERS = PORTGROUP_ARP_RECORD_SIZE,
+            RECORD_MPE_TIMBRE,
+            PORTGROUP_MPE_RECORD_SIZE
+        };
+
+        // walks the record stream and collects the payload addresses
+        virtual const config_archive::operation_result read_header() override;
+        // reads a varint at addr and moves addr behind it, false if it runs out of the archive
+        const bool read_varint(u16& addr, u16& value) const;
+
+        virtual const u8 read_port_number(const u16 base_addr) const override;
+        virtual const u8 read_port_clock_rate(const u16 base_addr) const override;
+        virtual const bool read_port_velocity(const u16 base_addr) const override;
+        virtual const output_port::clock_mode read_port_clock_mode(const u16 base_addr) const override;
+        virtual const modulation_settings read_port_modulation(const u16 base_addr) const override;
+        virtual const quantizer_settings read_port_quantizer(const u16 base_addr) const override;
+        virtual const velocity_settings read_port_velocity_curve(const u16 base_addr) const override;
+
+        virtual const demux_type read_portgroup_demux(const u16 base_addr) const override;
+        virtual const u8 read_portgroup_chan(const u16 base_addr) const override;
+        virtual const u8 read_portgroup_cc(const u16 base_addr) const override;
+        virtual const i8 read_portgroup_transpose(const u16 base_addr) const override;
+        virtual const input_type_list read_portgroup_msg_types(const u16 base_addr) const override;
+        virtual const port_number_list read_portgroup_ports(const u16 base_addr) const override;
+        virtual const bool read_portgroup_pressure_to_companion(const u16 base_addr) const override;
+        virtual const bool read_portgroup_mpe(const u16 base_addr) const override;
+        virtual const u8 read_portgroup_mpe_members(const u16 base_addr) const override;
+        virtual const u8 read_portgroup_mpe_timbre(const u16 base_addr) const override;
+        virtual const u16 read_portgroup_nrpn(const u16 base_addr) const override;
+        virtual const arpeggiator::arp_mode read_portgroup_arp_mode(const u16 base_addr) const override;
+        virtual const u8 read_portgroup_arp_division(const u16 base_addr) const override;
+        // payload size of the port group record at base_addr, 0 if there is none
+        const u16 read_portgroup_payload_size(const u16 base_addr) const;
+
+        // payload sizes in the order of m_portgroup_config_addrs, later fields are optional
+        fixed_vector<u16, k_max_port_groups> m_portgroup_payload_sizes;
+        // payload addresses of the modulation records
+        fixed_vector<u16, k_max_output_ports> m_modulation_addrs;
+        // payload addresses of the quantizer records
+        fixed_vector<u16, k_max_output_ports> m_quantizer_addrs;
+        // payload addresses of the velocity curve records
+        fixed_vector<u16, k_max_output_ports> m_velocity_addrs;
+    };
 } // namespace midimagic
 #endif // MIDIMAGIC_CONFIG_ARCHIVE_H
\ No newline at end of file
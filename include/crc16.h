@@ -0,0 +1,43 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_CRC16_H
+#define MIDIMAGIC_CRC16_H
+
+#include "common.h"
+
+namespace midimagic {
+    // CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff), fed incrementally
+    class crc16 {
+    public:
+        crc16();
+        ~crc16();
+
+        void update(const u8 data);
+        void update(const u8* data, const u16 length);
+        const u16 value() const;
+
+    private:
+        u16 m_crc;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_CRC16_H
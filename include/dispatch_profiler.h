@@ -0,0 +1,106 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_DISPATCH_PROFILER_H
+#define MIDIMAGIC_DISPATCH_PROFILER_H
+
+#include "common.h"
+#include "midi_types.h"
+#ifndef DWT
+#include <chrono>
+#endif
+
+namespace midimagic {
+    // Worst case dispatch time per message type, always on. The time of
+    // every message is taken from the DWT cycle counter (72 per us), the
+    // longest one of each type is kept together with the message and the
+    // port groups it met, so the case can be rebuilt with the host tools.
+    // Host builds count nanoseconds instead of cycles.
+    class dispatch_profiler {
+    public:
+        enum type_slot : u8 {
+            // NOTE_OFF ... PITCH_BEND take the slots 0 ... 6
+            CLOCK_SLOT = 7,
+            START_SLOT,
+            CONTINUE_SLOT,
+            STOP_SLOT,
+            _SLOT_COUNT_
+        };
+
+        struct worst_case {
+            u32 cycles; // 0 if no message of the type was seen
+            u32 count; // messages of the type since boot
+            // the message that took longest
+            midi_message::message_type type;
+            u8 channel;
+            u8 data0;
+            u8 data1;
+            u8 groups; // port groups of the active preset at the time
+            u8 routed_groups; // port groups the message was sent to
+        };
+
+        dispatch_profiler();
+        dispatch_profiler(const dispatch_profiler&) = delete;
+        ~dispatch_profiler();
+
+        static inline const u32 now() {
+#ifdef DWT
+            return DWT->CYCCNT;
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        // returns true if it was the longest message of its type so far,
+        // the caller adds the port groups then by set_shape()
+        inline const bool record(const midi_message& m, const u32 cycles) {
+            worst_case& slot = m_slots[type2slot(m.type)];
+            slot.count++;
+            if (cycles <= slot.cycles) {
+                return false;
+            }
+            slot.cycles = cycles;
+            slot.channel = m.channel;
+            slot.data0 = m.data0;
+            slot.data1 = m.data1;
+            return true;
+        }
+        void set_shape(const midi_message::message_type type, const u8 groups, const u8 routed_groups);
+
+        // copies up to max_count slots to out, longest first, skipping types never seen,
+        // returns copied count
+        const u8 top_offenders(worst_case* out, const u8 max_count) const;
+
+        static inline const u8 type2slot(const midi_message::message_type type) {
+            if (type < midi_message::message_type::SYSTEM_MESSAGE) {
+                return (type - midi_message::message_type::NOTE_OFF) & 0x07;
+            }
+            return (type == midi_message::message_type::CLOCK) ? type_slot::CLOCK_SLOT
+                                                                : (type - midi_message::message_type::START + type_slot::START_SLOT);
+        }
+
+    private:
+        worst_case m_slots[type_slot::_SLOT_COUNT_];
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_DISPATCH_PROFILER_H
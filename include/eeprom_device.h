@@ -0,0 +1,57 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_EEPROM_DEVICE_H
+#define MIDIMAGIC_EEPROM_DEVICE_H
+
+#include "common.h"
+
+namespace midimagic {
+    // Byte addressed EEPROM as seen by config_archive, implemented by the
+    // microwire driver on the target and by an in-memory stand-in on the host
+    class eeprom_device {
+    public:
+        eeprom_device() {};
+        eeprom_device(const eeprom_device&) = delete;
+        virtual ~eeprom_device() {};
+
+        // blocks for the whole program cycle
+        virtual void write(const u16 addr, const u8 data) = 0;
+        // start programming one byte and return without waiting for the
+        // program cycle, no other access is allowed until write_ready()
+        virtual void start_write(const u16 addr, const u8 data) = 0;
+        // non-blocking poll, true once the last started program cycle has finished
+        virtual const bool write_ready() = 0;
+        // write 2 byte value, MSB at addr, LSB at addr + 1:
+        virtual void write_2byte(const u16 addr, const u16 data) = 0;
+        virtual const u8 read(const u16 addr) const = 0;
+        // read 2 byte value, MSB from addr, LSB from addr + 1
+        virtual const u16 read_2byte(const u16 addr) const = 0;
+        // read length bytes starting at addr into buffer, returns the number of bytes read
+        virtual const u16 read_sequence(const u16 addr, u8* buffer, const u16 length) const = 0;
+        virtual void enable_write() = 0;
+        virtual void disable_write() = 0;
+        // size in bytes
+        virtual const u16 get_size() const = 0;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_EEPROM_DEVICE_H
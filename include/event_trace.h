@@ -0,0 +1,142 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_EVENT_TRACE_H
+#define MIDIMAGIC_EVENT_TRACE_H
+
+#include "common.h"
+#include "dispatch_profiler.h"
+#include "irq_guard.h"
+
+#ifndef MIDIMAGIC_EVENT_TRACE_RECORDS
+#define MIDIMAGIC_EVENT_TRACE_RECORDS 128
+#endif
+#ifndef MIDIMAGIC_EVENT_TRACE_SLOW_US
+#define MIDIMAGIC_EVENT_TRACE_SLOW_US 500
+#endif
+
+namespace midimagic {
+    // Ring of the latest events with their cycle counter time, built with
+    // -D MIDIMAGIC_EVENT_TRACE only, otherwise every call is empty and the
+    // ring takes no RAM. A trigger (UART error, full receive buffer,
+    // allocation on the MIDI path, dispatch slower than
+    // MIDIMAGIC_EVENT_TRACE_SLOW_US) lets another quarter of the ring fill
+    // up and freezes it then, so the ring holds what led to the trigger and
+    // what followed. The frozen ring is read out via SysEx and printed by
+    // tools/host/trace_decode.cpp, release() starts recording again.
+    class event_trace {
+    public:
+        enum event : u8 {
+            MIDI_IN = 1, // arg status byte, value data bytes
+            ROUTE, // arg port group id, value message type
+            DAC_WRITE, // arg port, value level
+            GATE, // arg port, value pin level
+            MENU_ACTION, // arg kind and subkind, value first data
+            EEPROM_READ, // arg length, value address
+            EEPROM_WRITE, // arg data, value address
+            TRIGGER, // arg trigger_reason, value detail
+            _EVENT_COUNT_
+        };
+
+        enum trigger_reason : u8 {
+            UART_ERROR = 0, // detail HAL error code
+            BUFFER_OVERFLOW, // detail bytes in the receive buffer
+            RUNTIME_ALLOCATION,
+            SLOW_DISPATCH // detail time in us
+        };
+
+        struct trace_record {
+            u32 time; // cycle counter, wraps around after a minute
+            event id;
+            u8 arg;
+            u16 value;
+        };
+        static_assert(sizeof(trace_record) == 8, "trace records are sent as 8 bytes");
+
+#ifdef MIDIMAGIC_EVENT_TRACE
+        static const bool k_enabled = true;
+#else
+        static const bool k_enabled = false;
+#endif
+        static const u16 k_records = MIDIMAGIC_EVENT_TRACE_RECORDS;
+        static const u16 k_post_trigger_records = k_records / 4;
+        static_assert(k_records && !(k_records & (k_records - 1)), "trace records must be a power of 2");
+
+        // takes the processor clock for the slow dispatch trigger, called from setup()
+        static void begin();
+
+        static inline void record(const event id, const u8 arg, const u16 value) {
+#ifdef MIDIMAGIC_EVENT_TRACE
+            // DAC writes and gate edges also come from the control rate interrupt
+            irq_guard guard;
+            if (s_frozen) {
+                return;
+            }
+            trace_record& r = s_ring[s_head & (k_records - 1)];
+            r.time = dispatch_profiler::now();
+            r.id = id;
+            r.arg = arg;
+            r.value = value;
+            s_head++;
+            if (s_post_trigger && !--s_post_trigger) {
+                s_frozen = true;
+            }
+#endif
+        }
+
+        static inline void record_message(const midi_message& m) {
+            const u8 status = (m.type > midi_message::message_type::SYSTEM_MESSAGE) ? m.type : (m.type << 4) | ((m.channel - 1) & 0x0f);
+            record(event::MIDI_IN, status, (m.data0 << 8) | m.data1);
+        }
+
+        static inline void check_dispatch(const u32 cycles) {
+#ifdef MIDIMAGIC_EVENT_TRACE
+            if (cycles > s_slow_dispatch_cycles) {
+                const u32 us = cycles / s_cycles_per_us;
+                trigger(trigger_reason::SLOW_DISPATCH, (us > UINT16_MAX) ? UINT16_MAX : us);
+            }
+#endif
+        }
+
+        static void trigger(const trigger_reason reason, const u16 detail);
+        // stops recording at once, for reading the ring
+        static void freeze();
+        // clears the ring and records again
+        static void release();
+        static const bool is_frozen();
+        static const u16 get_cycles_per_us();
+        // records in the ring, read() counts from the oldest
+        static const u16 get_record_count();
+        static const trace_record read(const u16 index);
+
+    private:
+#ifdef MIDIMAGIC_EVENT_TRACE
+        static trace_record s_ring[k_records];
+        static u32 s_head;
+        static u16 s_post_trigger;
+        static volatile bool s_frozen;
+        static u32 s_slow_dispatch_cycles;
+        static u16 s_cycles_per_us;
+#endif
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_EVENT_TRACE_H
@@ -0,0 +1,158 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef MIDIMAGIC_FIXED_VECTOR_H
+#define MIDIMAGIC_FIXED_VECTOR_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace midimagic {
+    // Vector-like container with a compile-time capacity and inline storage.
+    // Never allocates, push_back/emplace_back return false if the capacity is exhausted.
+    template <typename T, std::size_t N>
+    class fixed_vector {
+    public:
+        typedef T value_type;
+        typedef T* iterator;
+        typedef const T* const_iterator;
+        typedef std::size_t size_type;
+
+        fixed_vector()
+            : m_size(0) {
+            // nothing to do
+        }
+
+        fixed_vector(std::initializer_list<T> init)
+            : m_size(0) {
+            for (auto& element: init) {
+                push_back(element);
+            }
+        }
+
+        fixed_vector(const fixed_vector& other)
+            : m_size(0) {
+            for (auto& element: other) {
+                push_back(element);
+            }
+        }
+
+        fixed_vector& operator=(const fixed_vector& other) {
+            if (this != &other) {
+                clear();
+                for (auto& element: other) {
+                    push_back(element);
+                }
+            }
+            return *this;
+        }
+
+        ~fixed_vector() {
+            clear();
+        }
+
+        iterator begin() { return data(); }
+        iterator end() { return data() + m_size; }
+        const_iterator begin() const { return data(); }
+        const_iterator end() const { return data() + m_size; }
+
+        T* data() { return reinterpret_cast<T*>(m_storage); }
+        const T* data() const { return reinterpret_cast<const T*>(m_storage); }
+
+        size_type size() const { return m_size; }
+        constexpr size_type capacity() const { return N; }
+        bool empty() const { return m_size == 0; }
+        bool full() const { return m_size == N; }
+        // capacity is fixed, kept for drop-in compatibility with std::vector
+        void reserve(size_type) {}
+
+        T& operator[](size_type index) { return data()[index]; }
+        const T& operator[](size_type index) const { return data()[index]; }
+
+        T& at(size_type index) {
+            if (index >= m_size) {
+                __builtin_trap();
+            }
+            return data()[index];
+        }
+
+        const T& at(size_type index) const {
+            if (index >= m_size) {
+                __builtin_trap();
+            }
+            return data()[index];
+        }
+
+        T& front() { return data()[0]; }
+        const T& front() const { return data()[0]; }
+        T& back() { return data()[m_size - 1]; }
+        const T& back() const { return data()[m_size - 1]; }
+
+        bool push_back(const T& value) {
+            if (m_size >= N) {
+                return false;
+            }
+            new (data() + m_size) T(value);
+            m_size++;
+            return true;
+        }
+
+        template <typename... Args>
+        bool emplace_back(Args&&... args) {
+            if (m_size >= N) {
+                return false;
+            }
+            new (data() + m_size) T(std::forward<Args>(args)...);
+            m_size++;
+            return true;
+        }
+
+        void pop_back() {
+            if (m_size) {
+                m_size--;
+                data()[m_size].~T();
+            }
+        }
+
+        iterator erase(const_iterator pos) {
+            iterator it = begin() + (pos - begin());
+            for (iterator next = it + 1; next != end(); ++next) {
+                *(next - 1) = std::move(*next);
+            }
+            pop_back();
+            return it;
+        }
+
+        void clear() {
+            while (m_size) {
+                pop_back();
+            }
+        }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage[N];
+        size_type m_size;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_FIXED_VECTOR_H
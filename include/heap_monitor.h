@@ -0,0 +1,72 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef MIDIMAGIC_HEAP_MONITOR_H
+#define MIDIMAGIC_HEAP_MONITOR_H
+
+#include "common.h"
+
+namespace midimagic {
+    // Counts heap usage via the malloc/free wrappers (-Wl,--wrap=...) and
+    // optionally traps on allocations on the MIDI path after boot
+    // (build flag MIDIMAGIC_TRAP_RUNTIME_ALLOC).
+    class heap_monitor {
+    public:
+        struct heap_stats {
+            u32 allocations;
+            u32 frees;
+            u32 live_blocks;
+            u32 peak_live_blocks;
+            u32 runtime_allocations; // allocations on the MIDI path after boot
+            u32 heap_high_water; // bytes claimed from the system by the allocator
+            u32 heap_in_use;
+            u32 free_bytes;
+            u32 free_blocks;
+        };
+
+        // marks the end of setup(), allocations are unexpected from here on
+        static void mark_boot_complete();
+        static const bool boot_complete();
+        static const heap_stats get_stats();
+
+        // guards a real-time section (MIDI input processing) for its lifetime
+        class realtime_section {
+        public:
+            realtime_section();
+            realtime_section(const realtime_section&) = delete;
+            ~realtime_section();
+        };
+
+        // called from the allocator wrappers only
+        static void count_allocation(const void* block);
+        static void count_free(const void* block);
+
+    private:
+        static volatile u32 s_allocations;
+        static volatile u32 s_frees;
+        static volatile u32 s_live_blocks;
+        static volatile u32 s_peak_live_blocks;
+        static volatile u32 s_runtime_allocations;
+        static volatile u8 s_realtime_depth;
+        static volatile bool s_boot_complete;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_HEAP_MONITOR_H
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022 Adrian Krause                                               *
+ * Copyright 2022, 2026 Adrian Krause                                        *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -29,18 +29,46 @@
 #include "ad57x4.h"
 #include "midi_types.h"
 #include "config_archive.h"
+#include "eeprom_device.h"
 
 namespace midimagic {
     class inventory {
     public:
+        struct storage_stats {
+            u32 last_load_us; // duration of the last archive load (read and parse)
+            u16 last_load_bytes; // archive size of the last successful load
+            config_archive::operation_result last_load_result;
+            u32 last_save_us; // duration of the last save including the background steps
+            u16 last_save_written; // bytes programmed by the last save
+            u16 last_save_skipped; // bytes already matching the eeprom contents
+            config_archive::operation_result last_save_result;
+        };
+
+        struct reconfig_stats {
+            u32 last_apply_us; // duration of the last apply_config
+            u8 groups_kept; // port groups already matching the new config
+            u8 groups_changed; // port groups changed in place, their notes are released
+            u8 groups_created;
+            u8 groups_removed;
+            u8 ports_changed; // output ports with differing settings
+        };
+
+        struct preset_stats {
+            u32 last_switch_us; // duration of the last preset switch
+            u32 max_switch_us; // longest preset switch since boot
+            u16 switch_count;
+        };
+
         inventory(std::shared_ptr<group_dispatcher> gd,
                   std::shared_ptr<menu_action_queue> menu_q,
                   ad57x4 &dac0,
-                  ad57x4 &dac1);
+                  ad57x4 &dac1,
+                  eeprom_device &eeprom);
         inventory(std::shared_ptr<group_dispatcher> gd,
                   std::shared_ptr<menu_action_queue> menu_q,
                   ad57x4 &dac0,
                   ad57x4 &dac1,
+                  eeprom_device &eeprom,
                   const struct system_config& init_config);
         inventory() = delete;
         inventory(const inventory&) = delete;
@@ -50,9 +78,43 @@ namespace midimagic {
         std::shared_ptr<group_dispatcher> get_group_dispatcher(); // returns pointer to the system port group dispatcher
         std::shared_ptr<menu_action_queue> get_menu_queue();
 
-        void apply_config(const struct system_config& new_config); // setup system as in new_config
+        // setup the active preset as in new_config, only port groups and ports
+        // differing from it are touched, the others keep their notes and clocks
+        void apply_config(const struct system_config& new_config);
+        const reconfig_stats& get_reconfig_stats() const;
+        void apply_presets(const struct preset_config& new_presets); // setup all presets, then switch to the active one
+        // cancels a running save
         config_archive::operation_result load_config_from_eeprom();
+        // starts a background save of the system state, returns WRITE_IN_PROGRESS
+        // if run_save_step() has to finish it
         config_archive::operation_result save_system_state();
+        // advance a running save by at most one byte, called from loop() between MIDI messages
+        void run_save_step();
+        const bool is_saving() const;
+        // progress of the running save in percent
+        const u8 get_save_progress() const;
+        // drop a running save, the newest valid slot stays as it is
+        void cancel_save();
+        // a SysEx transfer holds the eeprom, loading and saving answer
+        // WRITE_IN_PROGRESS meanwhile; fails while a save or transfer runs
+        const bool lock_storage();
+        void unlock_storage();
+        // restarts a running save with the new state, called after every change of the setup
+        void mark_config_changed();
+        const storage_stats& get_storage_stats() const;
+
+        // switch to the prebuilt port groups and port settings of preset,
+        // held notes are released first
+        void select_preset(const u8 preset);
+        const u8 get_active_preset() const;
+        // replace preset with a copy of the active preset
+        void copy_preset(const u8 preset);
+        // 0 turns Program Change switching off
+        void set_control_channel(const u8 channel);
+        const u8 get_control_channel() const;
+        // returns true if the message was meant for preset switching
+        const bool handle_program_change(const u8 channel, const u8 program);
+        const preset_stats& get_preset_stats() const;
 
         const u8 port_number2digital_pin[8] {
             hw_setup.ports.dpin_port0,
@@ -69,23 +131,53 @@ namespace midimagic {
         std::shared_ptr<group_dispatcher> m_group_dispatcher;
         std::shared_ptr<menu_action_queue> m_menu_q;
         ad57x4 &m_dac0, &m_dac1;
+        eeprom_device &m_eeprom;
         struct system_config m_system_config;
-        std::vector<std::shared_ptr<output_port>> m_system_ports;
+        output_port_list m_system_ports;
+        storage_stats m_storage_stats;
+        // port settings of every preset, the active entry is refreshed on switching away
+        port_config_list m_preset_ports[k_max_presets];
+        u8 m_control_channel;
+        preset_stats m_preset_stats;
+        reconfig_stats m_reconfig_stats;
+        // save in progress and whether it needs to start over
+        std::unique_ptr<config_archive> m_pending_save;
+        bool m_save_restart;
+        u32 m_save_start;
+        bool m_storage_locked;
 
-        // destroys all port groups and deletes from system_config
-        void flush();
+        // true if pg already works as config describes
+        const bool port_group_matches(const port_group& pg, const struct port_group_config& config) const;
+        // change pg in place to config, held notes of pg are released
+        void update_port_group(port_group& pg, const struct port_group_config& config);
         // creates new system_config from currrent system state
-        std::unique_ptr<const struct system_config> gather_system_state() const;
+        const struct system_config gather_system_state() const;
+        // creates new system_config from the state of preset
+        const struct system_config gather_preset_state(const u8 preset) const;
+        // creates the port configs from the current output port settings
+        const port_config_list gather_port_state() const;
+        // fills presets from current system state
+        void gather_presets(struct preset_config& presets) const;
+        // snapshot the system state and start the commit
+        void begin_save();
+        void finish_save(const config_archive::operation_result result);
+        // exchange port groups and port settings, no release or timing
+        void activate_preset(const u8 preset);
+        void apply_port_configs(const port_config_list& port_configs);
 
         // creates output_port in m_system_ports
         void spawn_port(const u8 config_port_number);
-        // creates new port group from system_config, returns new id
-        const u8 spawn_port_group(std::vector<struct port_group_config>::iterator config_pg_it);
+        // creates all hardware output ports
+        void spawn_all_ports();
+        // creates new port group from system_config, returns new id or 0 if the port group limit is reached
+        const u8 spawn_port_group(port_group_config_list::iterator config_pg_it);
+        // id of the group built for the config group config_pg_id of m_system_config, 0 if there is none
+        const u8 runtime_group_id(const u8 config_pg_id, const u8* group_ids) const;
 
-        std::vector<struct port_group_config>::iterator config_pg_it_by_id(u8 config_pg_id);
-        std::vector<struct output_port_config>::iterator config_port_it_by_number(u8 config_port_number);
-        const std::vector<std::unique_ptr<port_group>>::const_iterator system_pg_it_by_id(const u8 system_pg_id) const;
-        const std::vector<std::shared_ptr<output_port>>::const_iterator system_port_it_by_number(const u8 system_port_number) const;
+        port_group_config_list::iterator config_pg_it_by_id(u8 config_pg_id);
+        port_config_list::iterator config_port_it_by_number(u8 config_port_number);
+        const port_group_list::const_iterator system_pg_it_by_id(const u8 system_pg_id) const;
+        const output_port_list::const_iterator system_port_it_by_number(const u8 system_port_number) const;
         const bool port_exists(const u8 port_number) const;
         const struct system_config sanitise_config(const struct system_config in_config) const;
     };
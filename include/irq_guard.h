@@ -0,0 +1,48 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_IRQ_GUARD_H
+#define MIDIMAGIC_IRQ_GUARD_H
+
+#include "common.h"
+
+namespace midimagic {
+    // Masks all interrupts for the lifetime of the guard. Guards nest, only
+    // the outermost one unmasks again, so it is safe to use inside an ISR.
+    class irq_guard {
+    public:
+        irq_guard()
+            : m_primask(__get_PRIMASK()) {
+            __disable_irq();
+        }
+        irq_guard(const irq_guard&) = delete;
+        ~irq_guard() {
+            if (!m_primask) {
+                __enable_irq();
+            }
+        }
+
+    private:
+        const u32 m_primask;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_IRQ_GUARD_H
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021-2024 Lukas Jünger and Adrian Krause                         *
+ * Copyright 2021-2024, 2026 Lukas Jünger and Adrian Krause                  *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -32,6 +32,8 @@
 #include "port_group.h"
 #include "inventory.h"
 #include "menu_interface.h"
+#include "heap_monitor.h"
+#include "midi_input_stats.h"
 
 namespace midimagic {
     class menu_state;
@@ -46,6 +48,8 @@ namespace midimagic {
         virtual ~menu_view();
 
         virtual void notify(const menu_action &a) = 0;
+        // called after a preset switch, the port groups of the old preset are parked
+        virtual void preset_changed();
 
     protected:
         DisplaySSD1306_128x64_I2C &m_display;
@@ -64,6 +68,7 @@ namespace midimagic {
         virtual ~port_view();
 
         virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
 
     protected:
         const u8 m_port_number;
@@ -72,7 +77,7 @@ namespace midimagic {
         void parse_draw_clock_mode(const output_port::clock_mode clock_mode, const u8 x, const u8 y) const;
 
     private:
-        const char *m_menu_items[4];
+        const char *m_menu_items[7];
         const NanoRect m_port_menu_dimensions;
         std::unique_ptr<LcdGfxMenu> m_port_menu;
     };
@@ -109,6 +114,116 @@ namespace midimagic {
         output_port::clock_mode m_clock_mode;
     };
 
+    class config_port_modulation_view : public port_view {
+    public:
+        enum modulation_item {
+            TYPE = 0,
+            SHAPE,
+            RATE,
+            SYNC,
+            ATTACK,
+            DECAY,
+            SUSTAIN,
+            RELEASE,
+            DEPTH,
+            TRIGGER,
+            _ITEM_COUNT_
+        };
+
+        explicit config_port_modulation_view(u8 port_number,
+                                             DisplaySSD1306_128x64_I2C &d,
+                                             std::shared_ptr<menu_state> menu_state,
+                                             std::shared_ptr<inventory> invent);
+        config_port_modulation_view() = delete;
+        config_port_modulation_view(const config_port_modulation_view&) = delete;
+        virtual ~config_port_modulation_view();
+
+        virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
+
+    private:
+        static const u8 k_max_visible_items = 7;
+        const char *k_item_names[modulation_item::_ITEM_COUNT_];
+        modulation_settings m_settings;
+        // position in the items shown for the current source type
+        u8 m_item;
+        bool m_editing;
+
+        // items used by the source type, returns their count
+        const u8 get_visible_items(u8 (&items)[k_max_visible_items]) const;
+        void change_value(const modulation_item item, const i8 direction);
+        static const u8 step_value(const u8 value, const i8 step, const u8 min, const u8 max);
+        void draw_item(const modulation_item item, const u8 y, const bool selected) const;
+        // position of the trigger group in the port groups of the active preset counted from 1, 0 for none
+        const u8 get_trigger_position() const;
+    };
+
+    class config_port_quantizer_view : public port_view {
+    public:
+        enum quantizer_item {
+            SCALE = 0,
+            ROOT,
+            TRIGGER,
+            MASK, // only for the user scale
+            _ITEM_COUNT_
+        };
+
+        explicit config_port_quantizer_view(u8 port_number,
+                                            DisplaySSD1306_128x64_I2C &d,
+                                            std::shared_ptr<menu_state> menu_state,
+                                            std::shared_ptr<inventory> invent);
+        config_port_quantizer_view() = delete;
+        config_port_quantizer_view(const config_port_quantizer_view&) = delete;
+        virtual ~config_port_quantizer_view();
+
+        virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
+
+    private:
+        const char *k_root_names[12];
+        quantizer_settings m_settings;
+        u8 m_item;
+        bool m_editing;
+        // degree selected while editing the user scale
+        u8 m_degree;
+
+        const u8 get_item_count() const;
+        void change_value(const i8 direction);
+        void apply();
+    };
+
+    class config_port_velocity_view : public port_view {
+    public:
+        enum velocity_item {
+            CURVE = 0,
+            LEVEL, // fixed level or level of the selected user point
+            POINT, // only for the user curve
+            _ITEM_COUNT_
+        };
+
+        explicit config_port_velocity_view(u8 port_number,
+                                           DisplaySSD1306_128x64_I2C &d,
+                                           std::shared_ptr<menu_state> menu_state,
+                                           std::shared_ptr<inventory> invent);
+        config_port_velocity_view() = delete;
+        config_port_velocity_view(const config_port_velocity_view&) = delete;
+        virtual ~config_port_velocity_view();
+
+        virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
+
+    private:
+        velocity_settings m_settings;
+        u8 m_item;
+        bool m_editing;
+        // user curve point shown and edited
+        u8 m_point;
+
+        const u8 get_item_count() const;
+        void change_value(const i8 direction);
+        void draw_curve() const;
+    };
+
     class over_view : public menu_view {
     public:
         over_view(DisplaySSD1306_128x64_I2C &d,
@@ -149,11 +264,135 @@ namespace midimagic {
         virtual void notify(const menu_action &a) override;
 
     private:
-        const char *m_menu_items[4];
+        const char *m_menu_items[7];
         const NanoRect m_setup_menu_dimensions;
         std::unique_ptr<LcdGfxMenu> setup_menu;
     };
 
+    class diagnostics_view : public menu_view {
+    public:
+        enum diagnostics_page {
+            HEAP = 0,
+            STORAGE,
+            RECONFIG,
+            LOOPER,
+            MODULATION,
+            WCET,
+            MIDI_INPUT,
+            _PAGE_COUNT_
+        };
+
+        diagnostics_view(DisplaySSD1306_128x64_I2C &d,
+                         std::shared_ptr<menu_state> menu_state,
+                         std::shared_ptr<inventory> invent);
+        diagnostics_view(const diagnostics_view&) = delete;
+        virtual ~diagnostics_view();
+
+        virtual void notify(const menu_action &a) override;
+
+    private:
+        u8 m_page;
+
+        void draw_heap_page() const;
+        void draw_storage_page() const;
+        void draw_reconfig_page() const;
+        void draw_looper_page() const;
+        void draw_modulation_page() const;
+        void draw_wcet_page() const;
+        void draw_input_page() const;
+        void draw_value(const u8 y, const char *label, const int value) const;
+    };
+
+    class presets_view : public menu_view {
+    public:
+        enum presets_item {
+            ACTIVE = 0,
+            CONTROL_CHANNEL,
+            COPY_TARGET,
+            _ITEM_COUNT_
+        };
+
+        presets_view(DisplaySSD1306_128x64_I2C &d,
+                     std::shared_ptr<menu_state> menu_state,
+                     std::shared_ptr<inventory> invent);
+        presets_view(const presets_view&) = delete;
+        virtual ~presets_view();
+
+        virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
+
+    private:
+        u8 m_item;
+        bool m_editing;
+        u8 m_copy_target;
+
+        void change_value(const i8 direction);
+        void draw_item(const u8 item, const u8 y, const char *label) const;
+    };
+
+    class save_view : public menu_view {
+    public:
+        save_view(DisplaySSD1306_128x64_I2C &d,
+                  std::shared_ptr<menu_state> menu_state,
+                  std::shared_ptr<inventory> invent);
+        save_view(const save_view&) = delete;
+        virtual ~save_view();
+
+        virtual void notify(const menu_action &a) override;
+
+    private:
+        static const u16 k_progress_refresh_ms = 100;
+        static const int k_poll_update = 1;
+
+        std::shared_ptr<menu_action_queue> m_menu_q;
+        bool m_poll_queued;
+        u32 m_last_draw;
+
+        void poll();
+        void draw_progress() const;
+        void draw_result() const;
+    };
+
+    class midi_monitor_view : public menu_view {
+    public:
+        enum monitor_page {
+            MESSAGES = 0,
+            RATES,
+            _PAGE_COUNT_
+        };
+
+        midi_monitor_view(DisplaySSD1306_128x64_I2C &d,
+                          std::shared_ptr<menu_state> menu_state,
+                          std::shared_ptr<inventory> invent);
+        midi_monitor_view(const midi_monitor_view&) = delete;
+        virtual ~midi_monitor_view();
+
+        virtual void notify(const menu_action &a) override;
+
+    private:
+        static const u8 k_message_rows = 7;
+        static const u16 k_message_refresh_ms = 250;
+        static const u16 k_rate_refresh_ms = 1000;
+        static const int k_poll_update = 1;
+
+        const midi_monitor& m_monitor;
+        std::shared_ptr<menu_action_queue> m_menu_q;
+        u8 m_page;
+        bool m_paused;
+        bool m_poll_queued;
+        u32 m_last_draw;
+        u32 m_last_write_count;
+        u32 m_rate_time;
+        u32 m_last_counts[midi_monitor::k_channel_slots];
+        u32 m_rates[midi_monitor::k_channel_slots];
+
+        void poll();
+        const bool redraw_due(const u32 now) const;
+        void update_rates(const u32 now);
+        void draw_messages();
+        void draw_rates() const;
+    };
+
     class portgroup_view : public menu_view {
     public:
         enum menu_layer {
@@ -170,15 +409,16 @@ namespace midimagic {
         portgroup_view(DisplaySSD1306_128x64_I2C &d,
                        std::shared_ptr<menu_state> menu_state,
                        std::shared_ptr<inventory> invent,
-                       const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                       const port_group_list::const_iterator group_it);
         portgroup_view(const portgroup_view&) = delete;
         virtual ~portgroup_view();
 
         virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
 
     protected:
         const group_dispatcher& m_group_dispatcher;
-        const std::vector<std::unique_ptr<port_group>>::const_iterator m_cur_group_it;
+        const port_group_list::const_iterator m_cur_group_it;
         port_group& m_port_group;
         menu_pane m_current_pane_selection;
 
@@ -199,7 +439,7 @@ namespace midimagic {
         config_portgroup_view(DisplaySSD1306_128x64_I2C &d,
                               std::shared_ptr<menu_state> menu_state,
                               std::shared_ptr<inventory> invent,
-                              const std::vector<std::unique_ptr<port_group>>::const_iterator group_it,
+                              const port_group_list::const_iterator group_it,
                               const menu_pane io_switch);
         config_portgroup_view(const config_portgroup_view&) = delete;
         virtual ~config_portgroup_view();
@@ -207,8 +447,8 @@ namespace midimagic {
         virtual void notify(const menu_action &a) override;
     private:
         const menu_pane m_io_switch;
-        const char *m_ins_config_menu_items[6];
-        const char *m_outs_config_menu_items[5];
+        const char *m_ins_config_menu_items[7];
+        const char *m_outs_config_menu_items[8];
         const NanoRect m_config_menu_dimensions;
         std::unique_ptr<LcdGfxMenu> config_menu;
     };
@@ -218,7 +458,7 @@ namespace midimagic {
         config_portgroup_ch_view(DisplaySSD1306_128x64_I2C &d,
                                  std::shared_ptr<menu_state> menu_state,
                                  std::shared_ptr<inventory> invent,
-                                 const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                 const port_group_list::const_iterator group_it);
         config_portgroup_ch_view(const config_portgroup_ch_view&) = delete;
         virtual ~config_portgroup_ch_view();
 
@@ -232,7 +472,7 @@ namespace midimagic {
         config_portgroup_demux_view(DisplaySSD1306_128x64_I2C &d,
                                  std::shared_ptr<menu_state> menu_state,
                                  std::shared_ptr<inventory> invent,
-                                 const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                 const port_group_list::const_iterator group_it);
         config_portgroup_demux_view(const config_portgroup_demux_view&) = delete;
         virtual ~config_portgroup_demux_view();
 
@@ -246,7 +486,7 @@ namespace midimagic {
         config_portgroup_add_msg_view(DisplaySSD1306_128x64_I2C &d,
                                       std::shared_ptr<menu_state> menu_state,
                                       std::shared_ptr<inventory> invent,
-                                      const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                      const port_group_list::const_iterator group_it);
         config_portgroup_add_msg_view(const config_portgroup_add_msg_view&) = delete;
         virtual ~config_portgroup_add_msg_view();
 
@@ -262,7 +502,7 @@ namespace midimagic {
         config_portgroup_cc_msg_view(DisplaySSD1306_128x64_I2C &d,
                                      std::shared_ptr<menu_state> menu_state,
                                      std::shared_ptr<inventory> invent,
-                                     const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                     const port_group_list::const_iterator group_it);
         config_portgroup_cc_msg_view(const config_portgroup_cc_msg_view&) = delete;
         virtual ~config_portgroup_cc_msg_view();
 
@@ -271,12 +511,29 @@ namespace midimagic {
         u8 m_cc_number;
     };
 
+    class config_portgroup_nrpn_view : public portgroup_view {
+    public:
+        config_portgroup_nrpn_view(DisplaySSD1306_128x64_I2C &d,
+                                   std::shared_ptr<menu_state> menu_state,
+                                   std::shared_ptr<inventory> invent,
+                                   const port_group_list::const_iterator group_it);
+        config_portgroup_nrpn_view(const config_portgroup_nrpn_view&) = delete;
+        virtual ~config_portgroup_nrpn_view();
+
+        virtual void notify(const menu_action &a) override;
+    private:
+        // selected like on the wire, MSB first
+        u8 m_nrpn_msb;
+        u8 m_nrpn_lsb;
+        bool m_editing_lsb;
+    };
+
     class config_portgroup_learn_msg_view : public portgroup_view {
     public:
         config_portgroup_learn_msg_view(DisplaySSD1306_128x64_I2C &d,
                                         std::shared_ptr<menu_state> menu_state,
                                         std::shared_ptr<inventory> invent,
-                                        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                        const port_group_list::const_iterator group_it);
         config_portgroup_learn_msg_view(const config_portgroup_learn_msg_view&) = delete;
         virtual ~config_portgroup_learn_msg_view();
 
@@ -295,13 +552,13 @@ namespace midimagic {
         config_portgroup_rem_msg_view(DisplaySSD1306_128x64_I2C &d,
                                       std::shared_ptr<menu_state> menu_state,
                                       std::shared_ptr<inventory> invent,
-                                      const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                      const port_group_list::const_iterator group_it);
         config_portgroup_rem_msg_view(const config_portgroup_rem_msg_view&) = delete;
         virtual ~config_portgroup_rem_msg_view();
 
         virtual void notify(const menu_action &a) override;
     private:
-        const std::vector<midi_message::message_type>& m_msg_types;
+        const input_type_list& m_msg_types;
         char** m_msg_names;
         const NanoRect k_message_menu_dimensions;
         std::unique_ptr<LcdGfxMenu> m_message_menu;
@@ -312,7 +569,7 @@ namespace midimagic {
         config_portgroup_add_port_view(DisplaySSD1306_128x64_I2C &d,
                                       std::shared_ptr<menu_state> menu_state,
                                       std::shared_ptr<inventory> invent,
-                                      const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                      const port_group_list::const_iterator group_it);
         config_portgroup_add_port_view(const config_portgroup_add_port_view&) = delete;
         virtual ~config_portgroup_add_port_view();
 
@@ -326,13 +583,13 @@ namespace midimagic {
         config_portgroup_rem_port_view(DisplaySSD1306_128x64_I2C &d,
                                       std::shared_ptr<menu_state> menu_state,
                                       std::shared_ptr<inventory> invent,
-                                      const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                      const port_group_list::const_iterator group_it);
         config_portgroup_rem_port_view(const config_portgroup_rem_port_view&) = delete;
         virtual ~config_portgroup_rem_port_view();
 
         virtual void notify(const menu_action &a) override;
     private:
-        std::vector<u8> m_port_numbers;
+        port_number_list m_port_numbers;
         u8 m_port_selection;
     };
 
@@ -341,7 +598,7 @@ namespace midimagic {
         config_portgroup_transpose_view(DisplaySSD1306_128x64_I2C &d,
                                         std::shared_ptr<menu_state> menu_state,
                                         std::shared_ptr<inventory> invent,
-                                        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it);
+                                        const port_group_list::const_iterator group_it);
         config_portgroup_transpose_view(const config_portgroup_transpose_view&) = delete;
         virtual ~config_portgroup_transpose_view();
 
@@ -350,6 +607,95 @@ namespace midimagic {
         i8 m_transpose_offset;
     };
 
+    class config_portgroup_mpe_view : public portgroup_view {
+    public:
+        enum mpe_item {
+            MPE_OFF = 0,
+            LOWER_ZONE,
+            UPPER_ZONE,
+            _ITEM_COUNT_
+        };
+
+        config_portgroup_mpe_view(DisplaySSD1306_128x64_I2C &d,
+                                  std::shared_ptr<menu_state> menu_state,
+                                  std::shared_ptr<inventory> invent,
+                                  const port_group_list::const_iterator group_it);
+        config_portgroup_mpe_view(const config_portgroup_mpe_view&) = delete;
+        virtual ~config_portgroup_mpe_view();
+
+        virtual void notify(const menu_action &a) override;
+    private:
+        u8 m_item;
+        // member channel count of the zone, edited after choosing the zone
+        u8 m_members;
+        bool m_editing_members;
+        // timbre port offset, edited after the member count
+        u8 m_timbre;
+        bool m_editing_timbre;
+    };
+
+    class config_portgroup_pressure_view : public portgroup_view {
+    public:
+        config_portgroup_pressure_view(DisplaySSD1306_128x64_I2C &d,
+                                       std::shared_ptr<menu_state> menu_state,
+                                       std::shared_ptr<inventory> invent,
+                                       const port_group_list::const_iterator group_it);
+        config_portgroup_pressure_view(const config_portgroup_pressure_view&) = delete;
+        virtual ~config_portgroup_pressure_view();
+
+        virtual void notify(const menu_action &a) override;
+    private:
+        bool m_to_companion;
+    };
+
+    class config_portgroup_arp_view : public portgroup_view {
+    public:
+        config_portgroup_arp_view(DisplaySSD1306_128x64_I2C &d,
+                                  std::shared_ptr<menu_state> menu_state,
+                                  std::shared_ptr<inventory> invent,
+                                  const port_group_list::const_iterator group_it);
+        config_portgroup_arp_view(const config_portgroup_arp_view&) = delete;
+        virtual ~config_portgroup_arp_view();
+
+        virtual void notify(const menu_action &a) override;
+    private:
+        static const u8 k_division_count = 8;
+        // clock ticks per step and their note values
+        const u8 k_divisions[k_division_count];
+        const char *k_division_names[k_division_count];
+        u8 m_mode;
+        u8 m_division_index;
+        bool m_editing_division;
+    };
+
+    class config_portgroup_looper_view : public portgroup_view {
+    public:
+        enum looper_item {
+            RECORD = 0,
+            PLAY,
+            STOP,
+            QUANTIZE,
+            REMOVE,
+            _ITEM_COUNT_
+        };
+
+        config_portgroup_looper_view(DisplaySSD1306_128x64_I2C &d,
+                                     std::shared_ptr<menu_state> menu_state,
+                                     std::shared_ptr<inventory> invent,
+                                     const port_group_list::const_iterator group_it);
+        config_portgroup_looper_view(const config_portgroup_looper_view&) = delete;
+        virtual ~config_portgroup_looper_view();
+
+        virtual void notify(const menu_action &a) override;
+    private:
+        const char *k_item_names[looper_item::_ITEM_COUNT_];
+        const char *k_state_names[pattern_looper::looper_state::_STATE_COUNT_];
+        u8 m_item;
+        // quantisation offered when recording, in clock ticks
+        u8 m_quantize;
+        bool m_pool_empty;
+    };
+
     class add_portgroup_view : public menu_view {
     public:
         add_portgroup_view(DisplaySSD1306_128x64_I2C &d,
@@ -359,6 +705,7 @@ namespace midimagic {
         virtual ~add_portgroup_view();
 
         virtual void notify(const menu_action &a) override;
+        virtual void preset_changed() override;
     private:
         group_dispatcher& m_group_dispatcher;
         demux_type m_demux;
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021 Adrian Krause                                               *
+ * Copyright 2021, 2026 Adrian Krause                                        *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -22,11 +22,15 @@
 #ifndef MENU_ACTION_QUEUE_H
 #define MENU_ACTION_QUEUE_H
 
-#include <queue>
 #include <memory>
+#include <type_traits>
 #include "menu_interface.h"
 #include "common.h"
 
+#ifndef MIDIMAGIC_MENU_ACTION_QUEUE_SIZE
+#define MIDIMAGIC_MENU_ACTION_QUEUE_SIZE 32
+#endif
+
 namespace midimagic {
     class menu_action_queue {
     public:
@@ -35,11 +39,18 @@ namespace midimagic {
         menu_action_queue(const menu_action_queue&) = delete;
         ~menu_action_queue();
 
+        // actions are dropped if the queue is full
         void add_menu_action(const menu_action& a);
         void exec_next_action();
 
     private:
-        std::queue<menu_action> m_action_queue;
+        static const u8 k_queue_size = MIDIMAGIC_MENU_ACTION_QUEUE_SIZE;
+
+        // fixed ring, filled from the MIDI path and the rotary ISRs
+        typename std::aligned_storage<sizeof(menu_action), alignof(menu_action)>::type m_action_queue[k_queue_size];
+        volatile u8 m_head;
+        volatile u8 m_tail;
+        volatile u8 m_count;
         std::shared_ptr<menu_interface> m_menu;
     };
 
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021 Lukas Jünger and Adrian Krause                              *
+ * Copyright 2021, 2026 Lukas Jünger and Adrian Krause                       *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -28,6 +28,7 @@ namespace midimagic {
             UPDATE,
             PORT_ACTIVITY,
             ROT_ACTIVITY,
+            PRESET_CHANGE,
         };
         enum subkind {
             NO_SUB,
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022, 2024 Adrian Krause                                         *
+ * Copyright 2022, 2024, 2026 Adrian Krause                                  *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -24,9 +24,16 @@
 
 #include <Arduino.h>
 #include "common.h"
+#include "eeprom_device.h"
+
+// delay loop iterations per clock half period, about 4 cycles each
+// on the Cortex-M3 @ 72 MHz, the 93Cxx needs at least 250 ns
+#ifndef MIDIMAGIC_EEPROM_HALF_PERIOD_LOOPS
+#define MIDIMAGIC_EEPROM_HALF_PERIOD_LOOPS 6
+#endif
 
 namespace midimagic {
-    class microwire_eeprom {
+    class microwire_eeprom : public eeprom_device {
     public:
         enum eeprom_size : u16 {
             S1Kb = 128,
@@ -38,32 +45,52 @@ namespace midimagic {
         explicit microwire_eeprom(const u8 mosi, const u8 miso, const u8 clk, const u8 cs, const eeprom_size size);
         microwire_eeprom() = delete;
         microwire_eeprom(const microwire_eeprom&) = delete;
-        ~microwire_eeprom();
+        virtual ~microwire_eeprom();
 
-        void write(const u16 addr, const u8 data);
+        virtual void write(const u16 addr, const u8 data) override;
+        virtual void start_write(const u16 addr, const u8 data) override;
+        // chip select stays high during the program cycle so DO shows the ready status
+        virtual const bool write_ready() override;
         // write 2 byte value, MSB at addr, LSB at addr + 1:
-        void write_2byte(const u16 addr, const u16 data);
-        const u8 read(const u16 addr) const;
+        virtual void write_2byte(const u16 addr, const u16 data) override;
+        virtual const u8 read(const u16 addr) const override;
         // read 2 byte value, MSB from addr, LSB from addr + 1
-        const u16 read_2byte(const u16 addr) const;
-        void enable_write();
-        void disable_write();
-        const eeprom_size get_size() const;
+        virtual const u16 read_2byte(const u16 addr) const override;
+        // sequential read of length bytes starting at addr in one transaction,
+        // returns the number of bytes read
+        virtual const u16 read_sequence(const u16 addr, u8* buffer, const u16 length) const override;
+        virtual void enable_write() override;
+        virtual void disable_write() override;
+        virtual const u16 get_size() const override;
 
     private:
-        const u8 k_mosi;
-        const u8 k_miso;
-        const u8 k_clk;
-        const u8 k_cs;
+        // pins are driven through the GPIO registers directly,
+        // digitalWrite/digitalRead cost more than a whole clock period
+        struct gpio_pin {
+            GPIO_TypeDef* port;
+            u32 mask;
+        };
+
+        const gpio_pin k_mosi;
+        const gpio_pin k_miso;
+        const gpio_pin k_clk;
+        const gpio_pin k_cs;
         const eeprom_size k_eeprom_size;
         u8 k_address_lenght;
         bool m_write_enabled;
+        bool m_write_pending;
+
+        static const gpio_pin make_pin(const u8 pin);
+        static inline void set_pin(const gpio_pin& pin, const bool level);
+        static inline const bool get_pin(const gpio_pin& pin);
+        static inline void half_period();
 
-        void wait_for_ready() const;
         void clear_ready() const;
         void send_preamble() const;
         void send_startbit() const;
+        void send_opcode(const u8 opcode) const;
         bool send_address(const u16 addr) const;
+        const u8 receive_byte() const;
         void cycle_clock() const;
     };
 } // namespace midimagic
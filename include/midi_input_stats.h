@@ -0,0 +1,142 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef MIDIMAGIC_MIDI_INPUT_STATS_H
+#define MIDIMAGIC_MIDI_INPUT_STATS_H
+
+#include "common.h"
+
+namespace midimagic {
+    // Counts what arrives at the MIDI input: bytes and messages read by the
+    // MIDI library, UART errors and receive buffer overflows. The core's
+    // UART interrupt clears the error flags without telling anyone, so
+    // hook_uart_interrupt() puts a handler in front of it that reads them
+    // first. The driver drops bytes on a full buffer without a trace, so a
+    // buffer found full counts as an overflow.
+    class midi_input_stats {
+    public:
+        // 31250 baud with start and stop bit
+        static const u16 k_max_bytes_per_second = 3125;
+#ifdef SERIAL_RX_BUFFER_SIZE
+        static const u16 k_rx_buffer_size = SERIAL_RX_BUFFER_SIZE;
+#else
+        static const u16 k_rx_buffer_size = 64;
+#endif
+
+        struct input_stats {
+            u32 bytes;
+            u32 messages;
+            u32 overruns; // byte lost in the UART, the interrupt came too late
+            u32 framing_errors; // missing stop bit, bad cable or wrong baud rate
+            u32 noise_errors;
+            u32 buffer_overflows; // receive buffer found full, loop() too slow
+            u16 buffer_high_water;
+            // over the last full second
+            u16 bytes_per_second;
+            u16 messages_per_second;
+            u16 errors_per_second; // UART errors and buffer overflows
+            u16 peak_bytes_per_second;
+            // input bandwidth used against k_max_bytes_per_second
+            u16 load_permille;
+            u16 peak_load_permille;
+        };
+
+        // called by counting_serial
+        static void count_byte();
+        static void check_buffer(const u16 available);
+        // called per message returned by the MIDI library
+        static void count_message();
+        // called from the UART interrupt with the status register holding an error flag
+        static void count_uart_error(const u32 status);
+        // moves the vector table to RAM and routes the MIDI UART interrupt
+        // through the error check, called once from setup()
+        static void hook_uart_interrupt();
+        // closes the rate window once a second, called from loop()
+        static void update(const u32 now_ms);
+        static const input_stats get_stats();
+
+    private:
+        static volatile u32 s_bytes;
+        static volatile u32 s_messages;
+        static volatile u32 s_overruns;
+        static volatile u32 s_framing_errors;
+        static volatile u32 s_noise_errors;
+        static u32 s_buffer_overflows;
+        static u16 s_buffer_high_water;
+        static bool s_buffer_full;
+        // counters at the start of the rate window
+        static u32 s_window_start_ms;
+        static u32 s_window_bytes;
+        static u32 s_window_messages;
+        static u32 s_window_errors;
+        static u16 s_bytes_per_second;
+        static u16 s_messages_per_second;
+        static u16 s_errors_per_second;
+        static u16 s_peak_bytes_per_second;
+
+        static const u32 get_error_count();
+
+        // system exceptions plus the interrupts of the largest F103, VTOR
+        // wants the table aligned to its size rounded up to a power of 2
+        static const u16 k_vector_count = 128;
+        alignas(k_vector_count * 4) static u32 s_ram_vectors[k_vector_count];
+        static void (*s_core_uart_handler)();
+        // takes the place of the core's handler of USART1, the UART of Serial1
+        static void uart_interrupt();
+    };
+
+    // Serial port for midi::MidiInterface counting the bytes read and
+    // watching the fill level of the receive buffer.
+    template<class serial_port>
+    class counting_serial {
+    public:
+        counting_serial(serial_port& port)
+            : m_port(port) {
+            // nothing to do
+        }
+
+        void begin(const unsigned long baud_rate) {
+            m_port.begin(baud_rate);
+        }
+
+        int available() {
+            const int available = m_port.available();
+            midi_input_stats::check_buffer(available);
+            return available;
+        }
+
+        int read() {
+            const int data = m_port.read();
+            if (data >= 0) {
+                midi_input_stats::count_byte();
+            }
+            return data;
+        }
+
+        void write(const u8 data) {
+            m_port.write(data);
+        }
+
+    private:
+        serial_port& m_port;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_MIDI_INPUT_STATS_H
@@ -0,0 +1,72 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_MIDI_MONITOR_H
+#define MIDIMAGIC_MIDI_MONITOR_H
+
+#include "common.h"
+#include "midi_types.h"
+
+#ifndef MIDIMAGIC_MIDI_MONITOR_SIZE
+#define MIDIMAGIC_MIDI_MONITOR_SIZE 16
+#endif
+
+namespace midimagic {
+    // Lossy record of the incoming MIDI messages for the monitor view.
+    // The dispatch path never waits on a reader, old entries are overwritten
+    // when the ring is full.
+    class midi_monitor {
+    public:
+        struct entry {
+            u32 timestamp; // millis() at arrival
+            midi_message::message_type type;
+            u8 channel;
+            u8 data0;
+            u8 data1;
+        };
+
+        static const u8 k_size = MIDIMAGIC_MIDI_MONITOR_SIZE;
+        static const u8 k_system_slot = 16; // channel slot for system messages
+        static const u8 k_channel_slots = 17;
+
+        midi_monitor();
+        midi_monitor(const midi_monitor&) = delete;
+        ~midi_monitor();
+
+        // called from the dispatch path
+        void record(const midi_message& m);
+        // copy up to max_count newest entries to out, newest first, returns copied count
+        const u8 snapshot(entry* out, const u8 max_count) const;
+        // messages received on a channel slot since boot, clock ticks included
+        const u32 get_channel_count(const u8 slot) const;
+        // entries ever written to the ring
+        const u32 get_write_count() const;
+
+    private:
+        static_assert((k_size & (k_size - 1)) == 0, "MIDIMAGIC_MIDI_MONITOR_SIZE must be a power of 2");
+
+        entry m_ring[k_size];
+        volatile u32 m_write_count;
+        volatile u32 m_channel_counts[k_channel_slots];
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_MIDI_MONITOR_H
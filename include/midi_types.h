@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022 Lukas Jünger and Adrian Krause                              *
+ * Copyright 2022, 2026 Lukas Jünger and Adrian Krause                        *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -23,11 +23,13 @@
 #define MIDIMAGIC_MIDI_TYPES_H
 
 #include "common.h"
+#include "fixed_vector.h"
+#include "system_limits.h"
 
 namespace midimagic {
 
 struct midi_message {
-    enum message_type {
+    enum message_type : u8 {
         NOTE_OFF = 0x8,
         NOTE_ON,
         POLY_KEY_PRESSURE,
@@ -35,6 +37,7 @@ struct midi_message {
         PROGRAM_CHANGE,
         CHANNEL_PRESSURE,
         PITCH_BEND,
+        PARAMETER = 0xf, // decoded NRPN data entry, no status byte of its own; data0 value MSB, data1 value LSB
         SYSTEM_MESSAGE = 0xf0, // start of system message types, no actual type associated
         CLOCK = 0xf8,
         START = 0xfa,
@@ -62,6 +65,8 @@ struct midi_message {
     };
 };
 
+typedef fixed_vector<midi_message::message_type, k_max_input_types> input_type_list;
+
 static const char *midi_message_type_names[] = {
     "Note Off",
     "Note On",
@@ -70,7 +75,8 @@ static const char *midi_message_type_names[] = {
     "Progr Chg",
     "Chan Press",
     "Pitch Bend",
-    "Clock"
+    "Clock",
+    "NRPN"
 };
 
 static const char *midi_message_type_long_names[] = {
@@ -81,7 +87,18 @@ static const char *midi_message_type_long_names[] = {
     "Program Change",
     "Channel Pressure",
     "Pitch Bend",
-    "Timing Clock"
+    "Timing Clock",
+    "NRPN"
+};
+
+static const char *midi_message_type_short_names[] = {
+    "NOff",
+    "NOn",
+    "PKPr",
+    "CC",
+    "PC",
+    "ChPr",
+    "PB"
 };
 
 static const char* midi_msgtype2name(const midi_message::message_type type) {
@@ -89,11 +106,33 @@ static const char* midi_msgtype2name(const midi_message::message_type type) {
         return midi_message_type_names[type - 0x8];
     } else if (type == midi_message::message_type::CLOCK) {
         return midi_message_type_names[7];
+    } else if (type == midi_message::message_type::PARAMETER) {
+        return midi_message_type_names[8];
     } else {
         return "unknown type";
     }
 };
 
+static const char* midi_msgtype2shortname(const midi_message::message_type type) {
+    switch (type) {
+        case midi_message::message_type::CLOCK :
+            return "Clk";
+        case midi_message::message_type::START :
+            return "Strt";
+        case midi_message::message_type::CONTINUE :
+            return "Cont";
+        case midi_message::message_type::STOP :
+            return "Stop";
+        case midi_message::message_type::PARAMETER :
+            return "NRPN";
+        default :
+            if (type >= midi_message::message_type::NOTE_OFF && type <= midi_message::message_type::PITCH_BEND) {
+                return midi_message_type_short_names[type - 0x8];
+            }
+            return "?";
+    }
+};
+
 } // namespace midimagic
 
 #endif //MIDIMAGIC_MIDI_TYPES_H
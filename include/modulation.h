@@ -0,0 +1,163 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_MODULATION_H
+#define MIDIMAGIC_MODULATION_H
+
+#include "common.h"
+#include "system_limits.h"
+
+// Rate of the timer interrupt rendering the modulation sources in Hz
+#ifndef MIDIMAGIC_CONTROL_RATE
+#define MIDIMAGIC_CONTROL_RATE 1000
+#endif
+
+namespace midimagic {
+    class output_port;
+
+    enum modulation_type : u8 {
+        NO_MODULATION = 0,
+        LFO,
+        AD_ENVELOPE, // attack and decay, runs through on every Note On
+        ADSR_ENVELOPE,
+        _MODULATION_TYPE_COUNT_
+    };
+
+    enum lfo_shape : u8 {
+        SINE = 0,
+        TRIANGLE,
+        SAW,
+        SQUARE,
+        SAMPLE_HOLD,
+        _LFO_SHAPE_COUNT_
+    };
+
+    // modulation source driving the DAC of an output port
+    struct modulation_settings {
+        modulation_type type = modulation_type::NO_MODULATION;
+        lfo_shape shape = lfo_shape::SINE;
+        u8 rate = 10; // free running LFO rate in 0.1 Hz
+        u8 sync_ticks = 0; // LFO cycle in MIDI clock ticks, 0 runs free
+        u8 depth = 127; // output level, 127 spans the full DAC range
+        u8 attack = 1; // envelope times in 10 ms
+        u8 decay = 20;
+        u8 sustain = 96; // 0...127
+        u8 release = 30;
+        u8 trigger_group = 0; // id of the port group whose notes trigger the envelope, 0 for none
+    };
+
+    const bool operator==(const modulation_settings& a, const modulation_settings& b);
+    const bool operator!=(const modulation_settings& a, const modulation_settings& b);
+    const char* modulation_type2name(const modulation_type type);
+    const char* lfo_shape2name(const lfo_shape shape);
+
+    // Renders LFOs and envelopes into the DACs of output ports from the
+    // control rate timer interrupt. Every output port can run one source,
+    // the kernels work on fixed-point phases and levels with a sine table,
+    // the DAC is only written if the level changed. Settings and MIDI
+    // events come in from the main loop with interrupts masked.
+    class modulation_engine {
+    public:
+        struct load_stats {
+            u8 active_sources;
+            u16 load_permille; // share of the CPU time spent rendering over the last second
+            u16 source_ns; // rendering time per source and control period
+            u16 max_render_us; // longest rendering since boot
+        };
+
+        static const u16 k_control_rate = MIDIMAGIC_CONTROL_RATE;
+
+        modulation_engine();
+        modulation_engine(const modulation_engine&) = delete;
+        ~modulation_engine();
+
+        // the ports live as long as the inventory, no ownership
+        void bind_port(const u8 port_number, output_port* port);
+        // port bound to port_number, nullptr if none
+        output_port* get_port(const u8 port_number) const;
+        void configure(const u8 port_number, const modulation_settings& settings);
+        const modulation_settings& get_settings(const u8 port_number) const;
+
+        // a port group started or ended a note on its ports, arpeggiator and looper included
+        void note_on(const u8 group_id);
+        void note_off(const u8 group_id);
+        // the port group ended all of its notes at once or is gone
+        void release_group(const u8 group_id);
+        // MIDI clock ticks keep synced LFOs in phase, Start restarts them
+        void clock();
+        void start();
+
+        // called by the control rate timer interrupt
+        void render();
+        const load_stats get_stats() const;
+
+    private:
+        enum envelope_stage : u8 {
+            IDLE = 0,
+            ATTACK,
+            DECAY,
+            SUSTAIN,
+            RELEASE
+        };
+
+        struct source_state {
+            u32 phase;
+            u32 increment; // phase step per control period
+            u32 level; // envelope level, k_envelope_max is full scale
+            u32 attack_step;
+            u32 decay_step;
+            u32 release_step;
+            u32 sustain_level;
+            i16 sample; // held value of SAMPLE_HOLD
+            i16 last_output;
+            envelope_stage stage;
+        };
+
+        static const u32 k_envelope_max = 0x7fff0000;
+
+        // level of port's source for this control period
+        const i16 render_lfo(source_state& state, const modulation_settings& settings);
+        const i16 render_envelope(source_state& state, const modulation_settings& settings);
+        // envelope step per control period covering full scale in time_10ms
+        static const u32 envelope_step(const u8 time_10ms);
+        void update_increment(const u8 port_number);
+        // true if port's source is an envelope triggered by the port group
+        const bool triggered_by(const u8 port_number, const u8 group_id) const;
+        void release_envelope(const u8 port_number);
+
+        modulation_settings m_settings[k_max_output_ports];
+        source_state m_states[k_max_output_ports];
+        output_port* m_ports[k_max_output_ports];
+        u8 m_held_notes[k_max_output_ports]; // notes held in the trigger group of each source
+        u32 m_random;
+        // control periods since the last MIDI clock tick and between the last two
+        volatile u16 m_clock_samples;
+        u16 m_clock_period;
+        u32 m_clock_ticks;
+        // load measurement, published once per second
+        u32 m_busy_us;
+        u16 m_render_count;
+        u32 m_source_renders;
+        load_stats m_stats;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_MODULATION_H
@@ -0,0 +1,90 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef MIDIMAGIC_OBJECT_POOL_H
+#define MIDIMAGIC_OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace midimagic {
+    // Statically sized storage for up to N objects of type T.
+    // create() returns nullptr if all slots are taken.
+    template <typename T, std::size_t N>
+    class object_pool {
+    public:
+        object_pool()
+            : m_used{} {
+            // nothing to do
+        }
+        object_pool(const object_pool&) = delete;
+
+        ~object_pool() {
+            for (std::size_t i = 0; i < N; i++) {
+                if (m_used[i]) {
+                    slot(i)->~T();
+                }
+            }
+        }
+
+        template <typename... Args>
+        T* create(Args&&... args) {
+            for (std::size_t i = 0; i < N; i++) {
+                if (!m_used[i]) {
+                    m_used[i] = true;
+                    return new (slot(i)) T(std::forward<Args>(args)...);
+                }
+            }
+            return nullptr;
+        }
+
+        void destroy(T* object) {
+            for (std::size_t i = 0; i < N; i++) {
+                if (m_used[i] && slot(i) == object) {
+                    object->~T();
+                    m_used[i] = false;
+                    return;
+                }
+            }
+        }
+
+        std::size_t in_use() const {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < N; i++) {
+                if (m_used[i]) {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+    private:
+        T* slot(std::size_t index) {
+            return reinterpret_cast<T*>(&m_slots[index]);
+        }
+
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_slots[N];
+        bool m_used[N];
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_OBJECT_POOL_H
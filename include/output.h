@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021, 2024 Lukas Jünger and Adrian Krause                        *
+ * Copyright 2021, 2024, 2026 Lukas Jünger and Adrian Krause                  *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -23,9 +23,13 @@
 #define MIDIMAGIC_OUTPUT_H
 
 #include "common.h"
+#include "midi_types.h"
 #include "menu_action_queue.h"
-#include <vector>
-#include <queue>
+#include "fixed_vector.h"
+#include "system_limits.h"
+#include "modulation.h"
+#include "quantizer.h"
+#include "velocity_curve.h"
 #include <memory>
 
 namespace midimagic {
@@ -35,8 +39,10 @@ namespace midimagic {
         FIFO
     };
 
-    class midi_message;
     class ad57x4;
+    class output_port;
+
+    typedef fixed_vector<std::shared_ptr<output_port>, k_max_output_ports> output_port_list;
 
     demux_type& operator++(demux_type& dt);
     demux_type& operator--(demux_type& dt);
@@ -65,6 +71,15 @@ namespace midimagic {
         bool is_note(midi_message &msg);
         void set_note(midi_message &note_on_msg);
         const u8 get_note() const;
+        // bend the held note by offset (136 per halftone), only adds to the stored note level
+        void set_bend(const i16 offset);
+        // raw DAC level for the modulation sources, called from the control rate interrupt
+        void set_level(const i16 level);
+        // a running modulation source owns the DAC, notes and controllers then only drive the gate
+        void set_modulated(const bool modulated);
+        const bool get_modulated() const;
+        // ends a running quantizer trigger, called from the control rate interrupt
+        void run_trigger();
         void end_note();
         const u8 get_digital_pin() const;
         const u8 get_port_number() const;
@@ -75,18 +90,41 @@ namespace midimagic {
         const bool get_velocity_switch() const;
         void set_clock_mode(const clock_mode cm);
         const clock_mode get_clock_mode() const;
+        // port receiving the poly pressure CV of this port's notes if a port group asks for it
+        void set_companion(output_port* companion);
+        output_port* get_companion() const;
+        // scale continuous values snap to, applies to controllers and pressure
+        void set_quantizer(const quantizer_settings& settings);
+        const quantizer_settings& get_quantizer() const;
+        // curve from Note On velocity to the DAC level in velocity mode
+        void set_velocity_curve(const velocity_settings& settings);
+        const velocity_settings& get_velocity_curve() const;
 
     private:
+        // length of the quantizer trigger in control periods, 5 ms
+        static const u8 k_trigger_periods = (MIDIMAGIC_CONTROL_RATE >= 200) ? MIDIMAGIC_CONTROL_RATE / 200 : 1;
+
+        // DAC level of offset added to the held note, or of offset alone without one
+        const i16 bend_level(const i16 offset) const;
+
         u8 m_digital_pin;
         u8 m_dac_channel;
         ad57x4 &m_dac;
         u8 m_current_note;
+        i16 m_note_level; // pitch of m_current_note relative to C4, 136 per halftone
         u8 m_clock_count;
         u8 m_clock_rate; // number of clock messages at which counter gets reset, 24 per quarter note
         bool m_output_velocity;
         clock_mode m_clock_mode;
         std::shared_ptr<menu_action_queue> m_menu;
         u8 m_port_number;
+        // the ports live as long as the inventory, no ownership
+        output_port* m_companion;
+        scale_quantizer m_quantizer;
+        velocity_curve m_velocity_curve;
+        u8 m_quantized_note; // last note put out by the quantizer, 255 if none
+        volatile u8 m_trigger_count; // control periods until the trigger ends
+        volatile bool m_modulated;
     };
 
     class output_demux {
@@ -100,13 +138,52 @@ namespace midimagic {
         virtual void add_output(std::shared_ptr<output_port> p);
         virtual void remove_output(u8 port_number);
         virtual void remove_note(midi_message& msg);
-        const std::vector<std::shared_ptr<output_port>>& get_output() const;
+        // end the notes on all ports and forget the held notes
+        void release_notes();
+        // route poly pressure only to the ports holding msg's note,
+        // or to their companion ports
+        void set_pressure(midi_message& msg, const bool to_companion);
+
+        // Voice handling for callers keeping their own channel to voice table,
+        // a voice is the port mask of the positions in get_output() playing it.
+        // add_note() returning the ports that took msg
+        const u8 start_voice(midi_message& msg);
+        // end msg on the ports of port_mask still playing it
+        void end_voice(const u8 port_mask, midi_message& msg);
+        void set_voice_bend(const u8 port_mask, const i16 offset);
+        // unipolar value on the voice ports or their companions
+        void set_voice_expression(const u8 port_mask, const u8 value, const bool to_companion);
+        const output_port_list& get_output() const;
         const demux_type get_type() const;
     protected:
         bool set_note(midi_message &msg);
-        std::vector<std::shared_ptr<output_port>> m_ports;
-        std::vector<midi_message> m_msgs;
+        // set msg on the port at position in m_ports and keep the note index up to date
+        void assign_note(const u8 position, midi_message& msg);
+        output_port_list m_ports;
+        // ports assigned a note since start_voice() began
+        u8 m_assigned_mask;
+        // at most one held note per port
+        fixed_vector<midi_message, k_max_output_ports> m_msgs;
         const demux_type m_type;
+    private:
+        // Note to port index: open addressing with linear probing, the
+        // port mask holds the positions in m_ports playing the note. At most
+        // one note per port is held, so the table never gets more than half full.
+        struct note_slot {
+            u8 note; // 255 if empty
+            u8 port_mask;
+        };
+        static const u8 k_note_index_size = 2 * k_max_output_ports;
+        note_slot m_note_index[k_note_index_size];
+
+        // slot of note or k_note_index_size if not held
+        const u8 find_note_slot(const u8 note) const;
+        void index_note(const u8 note, const u8 position);
+        void unindex_note(const u8 note, const u8 position);
+        // empties slot and moves the following entries of its probe run up
+        void clear_note_slot(u8 slot);
+        // positions shift when a port is removed
+        void rebuild_note_index();
     };
 
     class random_output_demux : public output_demux {
@@ -0,0 +1,94 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_PARAMETER_DECODER_H
+#define MIDIMAGIC_PARAMETER_DECODER_H
+
+#include "common.h"
+#include "midi_types.h"
+
+namespace midimagic {
+    // Per channel RPN/NRPN state machine fed with every Control Change.
+    // A lookup table sorts out the controllers taking part, all others
+    // leave after a single table read.
+    class parameter_decoder {
+    public:
+        enum parameter_kind : u8 {
+            NONE = 0,
+            RPN,
+            NRPN
+        };
+
+        struct parameter_event {
+            u8 channel;
+            u16 number; // 14 bit parameter number
+            u16 value; // 14 bit data value
+        };
+
+        // default pitch bend range of 2 halftones, 136 steps per halftone
+        static const u16 k_default_bend_range = 272;
+
+        parameter_decoder();
+        parameter_decoder(const parameter_decoder&) = delete;
+        ~parameter_decoder();
+
+        // true if m completed a data entry for a selected NRPN, RPNs are handled here
+        const bool decode(const midi_message& m, parameter_event& event);
+        // bend range of channel (1...16) in output port steps, default_range until RPN 0 was received
+        const u16 get_bend_range(const u8 channel, const u16 default_range) const;
+        // offset in output port steps of a 14 bit signed bend value
+        static const i16 scale_bend(const i16 bend_value, const u16 bend_range);
+
+    private:
+        enum controller_role : u8 {
+            PASS = 0,
+            DATA_MSB, // CC 6
+            DATA_LSB, // CC 38
+            DATA_INCREMENT, // CC 96
+            DATA_DECREMENT, // CC 97
+            NRPN_LSB, // CC 98
+            NRPN_MSB, // CC 99
+            RPN_LSB, // CC 100
+            RPN_MSB // CC 101
+        };
+
+        struct channel_state {
+            parameter_kind kind;
+            u8 number_msb;
+            u8 number_lsb;
+            u8 value_msb;
+            u8 value_lsb;
+        };
+
+        static const u8 k_controller_roles[128];
+        // RPN 127/127 deselects the parameter
+        static const u16 k_null_parameter = 0x3fff;
+
+        channel_state m_channels[16];
+        u16 m_bend_ranges[16];
+        u16 m_bend_range_set; // bit per channel
+
+        // applies the value of the selected parameter, true for an NRPN to route
+        const bool complete(const u8 ch_index, parameter_event& event);
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_PARAMETER_DECODER_H
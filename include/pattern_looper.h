@@ -0,0 +1,99 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_PATTERN_LOOPER_H
+#define MIDIMAGIC_PATTERN_LOOPER_H
+
+#include "common.h"
+#include "system_limits.h"
+
+namespace midimagic {
+    // Records note events of a port group quantised to MIDI clock ticks and
+    // plays them back in a loop. The events are kept sorted by tick, so a
+    // tick without events costs a single compare during playback.
+    class pattern_looper {
+    public:
+        struct event {
+            u16 tick;
+            u8 note;
+            u8 velocity; // 0 ends the note
+        };
+
+        enum looper_state : u8 {
+            EMPTY = 0,
+            ARMED, // recording starts with the next clock tick
+            RECORDING,
+            PLAYING,
+            STOPPED,
+            _STATE_COUNT_
+        };
+
+        // 16 bars at 24 ticks per quarter note
+        static const u16 k_max_ticks = 16 * 96;
+
+        pattern_looper();
+        pattern_looper(const pattern_looper&) = delete;
+        ~pattern_looper();
+
+        // drop the pattern and record a new one from the next clock tick
+        void arm();
+        // end a recording and play the pattern from its start with the next clock tick
+        void play();
+        // stop playback, the pattern is kept
+        void stop();
+        void clear();
+        const looper_state get_state() const;
+        // recorded events are moved to the closest multiple of quantize ticks, 1 to 24
+        void set_quantize(const u8 quantize);
+        const u8 get_quantize() const;
+        const u8 get_event_count() const;
+        // pattern length in clock ticks, whole quarter notes
+        const u16 get_length() const;
+
+        // store a note event at the current tick while recording
+        void record(const u8 note, const u8 velocity);
+        // advance one clock tick, the events to play are [first, last), empty if equal
+        void tick(const event*& first, const event*& last);
+        // play from the start of the pattern with the next clock tick
+        void restart();
+        // takes one of the notes played back and not yet ended, false if there is none
+        const bool pop_sounding(u8& note);
+
+    private:
+        void set_bit(u32 (&bitmap)[4], const u8 note, const bool value);
+        const bool get_bit(const u32 (&bitmap)[4], const u8 note) const;
+        // ends notes held at the end of a recording and wraps events quantised to its end
+        void close_recording();
+
+        event m_events[k_max_looper_events];
+        u8 m_event_count;
+        u8 m_cursor; // next event to play
+        u16 m_tick;
+        u16 m_length;
+        looper_state m_state;
+        u8 m_quantize;
+        u8 m_recording_held_count;
+        u32 m_recording_held[4];
+        u32 m_sounding[4];
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_PATTERN_LOOPER_H
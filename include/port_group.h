@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021 Adrian Krause                                               *
+ * Copyright 2021, 2026 Adrian Krause                                        *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -22,42 +22,26 @@
 #ifndef MIDIMAGIC_PORT_GROUP_H
 #define MIDIMAGIC_PORT_GROUP_H
 
-#include <vector>
+#include <type_traits>
 #include "output.h"
 #include "midi_types.h"
+#include "fixed_vector.h"
+#include "object_pool.h"
+#include "system_limits.h"
+#include "midi_monitor.h"
+#include "parameter_decoder.h"
+#include "arpeggiator.h"
+#include "pattern_looper.h"
+#include "modulation.h"
+#include "dispatch_profiler.h"
+#include "event_trace.h"
 
 namespace midimagic {
 
-    class port_group;
-
-    class group_dispatcher {
-    public:
-        group_dispatcher();
-        group_dispatcher(const group_dispatcher&) = delete;
-        ~group_dispatcher();
-
-        void add_port_group(const demux_type dt, const u8 channel);
-        void remove_port_group(const u8 id);
-        const std::vector<std::unique_ptr<port_group>>& get_port_groups() const;
-
-        void add_message(midi_message& m);
-        void activate_capture_mode();
-        const bool got_capture() const;
-        const midi_message get_capture() const;
-    private:
-        std::vector<std::unique_ptr<port_group>> m_port_groups;
-        u8 m_last_group_id;
-        bool m_capture_mode, m_capture_ready;
-        midi_message m_captured_message;
-
-        void sieve(midi_message& m);
-        const u8 get_next_id();
-    };
-
     class port_group {
     public:
-        explicit port_group(const u8 id, const demux_type dt, const u8 channel);
-        port_group(port_group&&) = default;
+        explicit port_group(const u8 id, const demux_type dt, const u8 channel,
+                            const parameter_decoder& parameters, modulation_engine& modulation);
         port_group() = delete;
         port_group(const port_group&) = delete;
         ~port_group();
@@ -66,9 +50,29 @@ namespace midimagic {
         const output_demux& get_demux() const;
         void set_midi_channel(const u8 ch);
         const u8 get_midi_channel() const;
+        // MPE mode, the MIDI channel is the master channel of the zone:
+        // a lower zone (master 1) has the member channels above it,
+        // an upper zone (master 16) the ones below. Other channels can't
+        // be masters, MPE stays off there. Channel pressure of a voice goes
+        // to the companions of its ports, so MPE turns pressure to companion on.
+        void set_mpe(const bool mpe);
+        const bool get_mpe() const;
+        static const bool is_mpe_master(const u8 channel);
+        // member channels of the zone, 1...15
+        void set_mpe_members(const u8 members);
+        const u8 get_mpe_members() const;
+        // MPE timbre, the configured controller of a member channel, goes to the
+        // port offset port numbers above each voice port, counting round after
+        // the last port, 0 drops it. Offset 4 is the companion carrying the
+        // pressure, set_mpe_timbre() refuses it.
+        void set_mpe_timbre(const u8 offset);
+        const u8 get_mpe_timbre() const;
+        static const bool is_mpe_timbre(const u8 offset);
+        // true for the MIDI channel or, in MPE mode, every channel of the zone
+        const bool listens_on(const u8 channel) const;
         void add_midi_input(const midi_message::message_type input_type);
         void remove_msg_type(const midi_message::message_type input_type);
-        const std::vector<midi_message::message_type>& get_msg_types() const;
+        const input_type_list& get_msg_types() const;
         const bool has_msg_type(const midi_message::message_type msg_type) const;
 
         void add_port(std::shared_ptr<output_port> port);
@@ -76,20 +80,137 @@ namespace midimagic {
         const u8 get_id() const;
         void set_cc(const u8 cc_number);
         const u8 get_cc() const;
+        // CC number as stored by set_cc(), LSB controllers 32...63 map to their MSB
+        static const u8 normalise_cc(const u8 cc_number);
         void set_transpose(const i8 transpose_offset);
         const i8 get_transpose() const;
+        // send poly pressure to the companions of the ports playing the note instead of the ports themselves,
+        // can't be turned off in MPE mode
+        void set_pressure_to_companion(const bool to_companion);
+        const bool get_pressure_to_companion() const;
+        // NRPN routed to the ports as 14 bit CV when listening to PARAMETER
+        void set_nrpn(const u16 nrpn_number);
+        const u16 get_nrpn() const;
+        // arpeggiate the held notes on MIDI clock instead of playing them, not used in MPE mode
+        void set_arp_mode(const arpeggiator::arp_mode mode);
+        const arpeggiator::arp_mode get_arp_mode() const;
+        // clock ticks per arpeggiator step, 24 per quarter note
+        void set_arp_division(const u8 division);
+        const u8 get_arp_division() const;
+        // pattern looper taken from the group_dispatcher's pool, nullptr if there is none
+        void set_looper(pattern_looper* looper);
+        pattern_looper* get_looper() const;
+        // end the notes played back by the looper
+        void end_looper_notes();
+        // true if the group needs MIDI clock, either as input or for the arpeggiator or looper
+        const bool wants_clock() const;
 
         void send_input(midi_message& m);
+        // end all notes held by the assigned ports
+        void release_notes();
     private:
         midi_message parse_cc(midi_message& m);
+        // returns the bend scaled to output port steps with the channel's bend range, data0 MSB, data1 LSB
+        midi_message parse_pitch_bend(midi_message& m) const;
+        void send_mpe_input(midi_message& m);
+        // master and member bend of channel in output port steps
+        const i16 mpe_bend_offset(const u8 channel) const;
+        void clear_mpe_voices();
+        // unipolar timbre value on the timbre ports of the voice ports in port_mask
+        void set_mpe_voice_timbre(const u8 port_mask, const u8 value);
+        void send_arp_input(midi_message& m);
+        void end_arp_note(const u8 note);
+        void send_looper_input(midi_message& m);
+        // play or end a note on the demux and tell the envelopes triggered by this group
+        void start_note(midi_message& m);
+        void end_note(midi_message& m);
 
-        std::unique_ptr<output_demux> m_demux;
-        std::vector<midi_message::message_type> m_input_types;
+        // the demux lives in place, switching types never touches the heap
+        typename std::aligned_union<0, random_output_demux,
+                                       identic_output_demux,
+                                       fifo_output_demux>::type m_demux_storage;
+        output_demux* m_demux;
+        input_type_list m_input_types;
         u8 m_input_channel;
         u8 m_cc_number;
         u8 m_cc_MSB_value;
         i8 m_transpose_offset;
+        bool m_pressure_to_companion;
+        u16 m_nrpn_number;
+        const parameter_decoder& m_parameters;
+        modulation_engine& m_modulation;
+        bool m_mpe;
+        u8 m_mpe_members;
+        u8 m_mpe_timbre;
+        // MPE channel to voice table, index is MIDI channel - 1
+        u8 m_mpe_voice_ports[16];
+        i16 m_mpe_bend[16];
+        arpeggiator m_arp;
+        pattern_looper* m_looper;
         const u8 k_id;
     };
+
+    typedef fixed_vector<port_group*, k_max_port_groups> port_group_list;
+
+    class group_dispatcher {
+    public:
+        group_dispatcher();
+        group_dispatcher(const group_dispatcher&) = delete;
+        ~group_dispatcher();
+
+        // returns false if the port group limit is reached
+        const bool add_port_group(const demux_type dt, const u8 channel);
+        void remove_port_group(const u8 id);
+        // port groups of the active preset
+        const port_group_list& get_port_groups() const;
+
+        // Every preset keeps its own prebuilt port groups, only the active
+        // preset is dispatched. Switching just exchanges the group lists.
+        void select_preset(const u8 preset);
+        const u8 get_active_preset() const;
+        const port_group_list& get_preset_port_groups(const u8 preset) const;
+        // end all notes held by the port groups of the active preset
+        void release_notes();
+        // destroys the port groups of all presets
+        void remove_all_port_groups();
+        // gives pg a pattern looper from the pool, false if none is left
+        const bool attach_looper(port_group& pg);
+        void detach_looper(port_group& pg);
+        const u8 get_loopers_in_use() const;
+
+        void add_message(midi_message& m);
+        void activate_capture_mode();
+        const bool got_capture() const;
+        const midi_message get_capture() const;
+        const midi_monitor& get_monitor() const;
+        // LFOs and envelopes of the output ports, rendered by the control rate timer
+        modulation_engine& get_modulation();
+        // longest dispatch of every message type
+        dispatch_profiler& get_profiler();
+    private:
+        object_pool<port_group, k_port_group_pool_size> m_port_group_pool;
+        object_pool<pattern_looper, k_looper_pool_size> m_looper_pool;
+        port_group_list m_port_groups;
+        port_group_list m_parked_port_groups[k_max_presets];
+        u8 m_active_preset;
+        u8 m_last_group_id;
+        bool m_capture_mode, m_capture_ready;
+        midi_message m_captured_message;
+        midi_monitor m_monitor;
+        modulation_engine m_modulation;
+        dispatch_profiler m_profiler;
+
+        parameter_decoder m_parameters;
+
+        void dispatch(midi_message& m);
+        void sieve(midi_message& m);
+        // port groups m is sent to by sieve()
+        const u8 count_routed_groups(const midi_message& m) const;
+        // clock of the modulation sources, the port groups trigger the envelopes
+        void feed_modulation(midi_message& m);
+        // route a decoded NRPN to the port groups listening to it
+        void sieve_parameter(const parameter_decoder::parameter_event& event);
+        const u8 get_next_id();
+    };
 } // namespace midimagic
-#endif // MIDIMAGIC_PORT_GROUP_H
\ No newline at end of file
+#endif // MIDIMAGIC_PORT_GROUP_H
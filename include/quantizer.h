@@ -0,0 +1,74 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_QUANTIZER_H
+#define MIDIMAGIC_QUANTIZER_H
+
+#include "common.h"
+
+namespace midimagic {
+    enum scale_type : u8 {
+        NO_SCALE = 0, // continuous values pass unquantized
+        CHROMATIC,
+        MAJOR,
+        MINOR,
+        PENTATONIC,
+        USER_SCALE,
+        _SCALE_TYPE_COUNT_
+    };
+
+    struct quantizer_settings {
+        scale_type scale = scale_type::NO_SCALE;
+        u8 root = 0; // pitch class of the scale's first degree, 0 = C
+        u16 user_mask = 0xfff; // bit n set allows the degree n halftones above root
+        bool trigger = false; // pulse the gate when the quantized note changes
+    };
+
+    const bool operator==(const quantizer_settings& a, const quantizer_settings& b);
+    const bool operator!=(const quantizer_settings& a, const quantizer_settings& b);
+    const char* scale_type2name(const scale_type scale);
+
+    // Snaps 7 bit controller and pressure values to the notes of a scale.
+    // The value is read as a note number like the key of a Note On, the
+    // table holding the nearest scale note for each of them is rebuilt when
+    // the settings change so quantizing is a single lookup.
+    class scale_quantizer {
+    public:
+        scale_quantizer();
+        scale_quantizer(const scale_quantizer&) = delete;
+        ~scale_quantizer();
+
+        void set_settings(const quantizer_settings& settings);
+        const quantizer_settings& get_settings() const;
+        const bool is_active() const;
+        const u8 quantize(const u8 value) const;
+        // degree mask of the scale, relative to its root
+        static const u16 scale_mask(const scale_type scale, const u16 user_mask);
+
+    private:
+        quantizer_settings m_settings;
+        u8 m_table[128];
+
+        void build_table();
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_QUANTIZER_H
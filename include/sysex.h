@@ -0,0 +1,193 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_SYSEX_H
+#define MIDIMAGIC_SYSEX_H
+
+#include <memory>
+#include "common.h"
+#include "config_archive.h"
+#include "eeprom_device.h"
+#include "inventory.h"
+#include "midi_input_stats.h"
+#include "event_trace.h"
+
+namespace midimagic {
+    // SysEx backup and restore of the stored presets. The preset bundle of
+    // the newest eeprom slot is sent in chunks of k_chunk_size bytes, read
+    // from the eeprom one chunk at a time. A restore programs every chunk
+    // into the inactive slot as it arrives and commits the slot after
+    // checking the whole image, nothing but one chunk is held in RAM.
+    //
+    // Frame: F0 7D 4D <device> <command> <arguments> F7
+    //   7D is the manufacturer ID for non-commercial use, 4D is 'M'.
+    //   device is the control channel - 1, 0 without control channel;
+    //   requests to 7F reach every unit.
+    //
+    // Host to unit, every restore message is answered with ACK or NAK,
+    // a dump request only with NAK if it fails:
+    //   DUMP_REQUEST                  send the whole dump
+    //   DUMP_REQUEST  chunk(2)        send this chunk again
+    //   RESTORE_BEGIN size(3)
+    //   RESTORE_CHUNK chunk(2) data checksum
+    //   RESTORE_END                   ACK once the restored setup is active
+    //   STATS_REQUEST                 send the MIDI input statistics
+    //   TRACE_REQUEST                 freeze the event trace and send it
+    //   TRACE_RELEASE                 clear the event trace and record again, ACK
+    // Unit to host:
+    //   DUMP_BEGIN    size(3) chunk count(2)
+    //   DUMP_CHUNK    chunk(2) data checksum
+    //   DUMP_END
+    //   STATS_REPLY   bytes(5) messages(5) overruns(5) framing errors(5)
+    //                 noise errors(5) buffer overflows(5) buffer high water(2)
+    //                 bytes/s(2) messages/s(2) errors/s(2) peak bytes/s(2)
+    //                 load(2) peak load(2), load in 1/1000 of 31.25 kbaud
+    //   TRACE_BEGIN   record count(2) cycles per us(2)
+    //   TRACE_CHUNK   chunk(2) data checksum, k_chunk_size / 8 records, oldest first
+    //   TRACE_END
+    //   ACK           command chunk(2)
+    //   NAK           command chunk(2) reason
+    //
+    // A trace record is time(4) event arg value(2), least significant byte
+    // first (see event_trace.h). Firmware built without the event trace
+    // answers TRACE_REQUEST with NAK NO_TRACE.
+    //
+    // Numbers are sent in 7 bit groups, most significant first. Data is
+    // 8 to 7 bit packed: every group of up to 7 bytes is preceded by a byte
+    // holding their MSBs, bit 0 for the first byte. The checksum makes the
+    // sum of chunk number, data and checksum bytes a multiple of 128.
+    class sysex_transfer {
+    public:
+        // sends one message without F0 and F7
+        typedef void (*sysex_sender)(const u8* data, const u16 length);
+
+        enum command : u8 {
+            DUMP_REQUEST = 0x01,
+            RESTORE_BEGIN,
+            RESTORE_CHUNK,
+            RESTORE_END,
+            STATS_REQUEST,
+            TRACE_REQUEST,
+            TRACE_RELEASE,
+            DUMP_BEGIN = 0x11,
+            DUMP_CHUNK,
+            DUMP_END,
+            STATS_REPLY,
+            TRACE_BEGIN,
+            TRACE_CHUNK,
+            TRACE_END,
+            ACK = 0x7e,
+            NAK
+        };
+
+        // reasons of a NAK besides the config_archive::operation_result values
+        enum nak_reason : u8 {
+            BAD_CHECKSUM = 0x20,
+            BAD_CHUNK, // out of order or with wrong length
+            BUSY, // a save or another transfer holds the eeprom
+            NOT_RESTORING,
+            NO_TRACE
+        };
+
+        static const u8 k_manufacturer_id = 0x7d;
+        static const u8 k_model_id = 0x4d;
+        static const u8 k_all_devices = 0x7f;
+        static const u16 k_chunk_size = 32;
+        // an unfinished restore is dropped after this long without a message
+        static const u32 k_restore_timeout_ms = 2000;
+
+        sysex_transfer(std::shared_ptr<inventory> invent, eeprom_device& eeprom, sysex_sender sender);
+        sysex_transfer() = delete;
+        sysex_transfer(const sysex_transfer&) = delete;
+        ~sysex_transfer();
+
+        // called from the SysEx handler with F0 and F7, only copies the message
+        void handle_message(const u8* data, const u16 length);
+        // handle a received message, send the next dump chunk or program
+        // at most one byte of a restore, called from loop()
+        void run_step();
+        const bool is_active() const;
+
+        // 8 to 7 bit packing, return the output length
+        static const u16 encode(const u8* data, const u16 length, u8* out);
+        static const u16 decode(const u8* data, const u16 length, u8* out, const u16 max_length);
+        static const u16 get_encoded_size(const u16 length);
+
+    private:
+        enum transfer_state {
+            IDLE,
+            DUMPING,
+            RESTORING,
+            COMMITTING,
+            TRACING
+        };
+
+        enum frame_field : u8 {
+            FRAME_START = 0,
+            FRAME_MANUFACTURER,
+            FRAME_MODEL,
+            FRAME_DEVICE,
+            FRAME_COMMAND,
+            FRAME_ARGUMENTS
+        };
+
+        // largest message: frame, chunk number, packed chunk, checksum, F7
+        static const u16 k_max_message = FRAME_ARGUMENTS + 2 + ((k_chunk_size + 6) / 7) * 8 + 2;
+        static const u16 k_stats_size = 6 * 5 + 7 * 2;
+        static_assert(FRAME_ARGUMENTS + k_stats_size <= k_max_message, "statistics reply too long");
+
+        void process_request();
+        void start_dump(const bool single_chunk, const u16 chunk);
+        void start_restore(const u16 size);
+        void receive_chunk(const u16 chunk, const u8* data, const u16 length);
+        void finish_restore();
+        void send_chunk(const u16 chunk);
+        void send_input_stats();
+        void start_trace_dump();
+        void send_trace_chunk(const u16 chunk);
+        // chunk number, packed data and checksum
+        void send_data(const command cmd, const u16 chunk, const u8* data, const u16 length);
+        void send_reply(const command cmd, const command answered, const u16 chunk, const u8 reason = 0);
+        // frame without F0 and F7 around the arguments
+        void send_message(const command cmd, const u8* arguments, const u16 length);
+        // drop the transfer and release the eeprom
+        void end_transfer();
+        const u8 get_device_id() const;
+        const u16 get_chunk_count() const;
+        const u16 get_trace_chunk_count() const;
+
+        std::shared_ptr<inventory> m_inventory;
+        eeprom_device& m_eeprom;
+        sysex_sender m_sender;
+        std::unique_ptr<config_archive> m_archive;
+        transfer_state m_state;
+        // last received message, handled by run_step()
+        u8 m_request[k_max_message];
+        u16 m_request_length;
+        u8 m_chunk[k_chunk_size];
+        u16 m_chunk_length;
+        bool m_chunk_pending;
+        u16 m_next_chunk;
+        u32 m_last_message;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_SYSEX_H
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022, 2024 Adrian Krause                                         *
+ * Copyright 2022, 2024, 2026 Adrian Krause                                   *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -24,7 +24,11 @@
 
 #include "common.h"
 #include "output.h"
+#include "arpeggiator.h"
+#include "modulation.h"
 #include "midi_types.h"
+#include "fixed_vector.h"
+#include "system_limits.h"
 
 namespace midimagic {
 
@@ -33,21 +37,44 @@ namespace midimagic {
         u8 clock_rate = 24;
         bool velocity_output = false;
         output_port::clock_mode clock_mode = output_port::clock_mode::SYNC;
+        modulation_settings modulation;
+        quantizer_settings quantizer;
+        velocity_settings velocity_curve;
     };
 
+    typedef fixed_vector<u8, k_max_output_ports> port_number_list;
+
     struct port_group_config {
         u8 id;
         demux_type demux = demux_type::RANDOM;
         u8 midi_channel = 0;
         u8 cont_controller_number = 0;
         i8 transpose_offset = 0;
-        std::vector<midi_message::message_type> input_types;
-        std::vector<u8> output_port_numbers;
+        input_type_list input_types;
+        port_number_list output_port_numbers;
+        bool pressure_to_companion = false; // poly pressure CV on the companion ports
+        bool mpe = false; // midi_channel is the master channel of an MPE zone, 1 or 16
+        u8 mpe_members = 15; // member channels of the zone next to the master channel, 1...15
+        u8 mpe_timbre = 0; // MPE timbre CV this many ports above the voice port, 0 off, never 4
+        u16 nrpn_number = 0; // NRPN routed when listening to PARAMETER
+        arpeggiator::arp_mode arp_mode = arpeggiator::arp_mode::OFF;
+        u8 arp_division = 6; // MIDI clock ticks per arpeggiator step
     };
 
+    typedef fixed_vector<struct output_port_config, k_max_output_ports> port_config_list;
+    typedef fixed_vector<struct port_group_config, k_max_port_groups> port_group_config_list;
+
     struct system_config {
-        std::vector<struct output_port_config> system_ports;
-        std::vector<struct port_group_config> system_port_groups;
+        port_config_list system_ports;
+        port_group_config_list system_port_groups;
+    };
+
+    typedef fixed_vector<struct system_config, k_max_presets> preset_config_list;
+
+    struct preset_config {
+        u8 control_channel = 0; // channel for Program Change preset switching, 0 = off
+        u8 active_preset = 0;
+        preset_config_list presets;
     };
 } // namespace midimagic
 
@@ -0,0 +1,67 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef MIDIMAGIC_SYSTEM_LIMITS_H
+#define MIDIMAGIC_SYSTEM_LIMITS_H
+
+#include "common.h"
+
+// Compile-time limits of the statically sized runtime containers,
+// may be overridden via build flags
+#ifndef MIDIMAGIC_MAX_PORT_GROUPS
+#define MIDIMAGIC_MAX_PORT_GROUPS 16
+#endif
+
+#ifndef MIDIMAGIC_MAX_PRESETS
+#define MIDIMAGIC_MAX_PRESETS 4
+#endif
+
+#ifndef MIDIMAGIC_PORT_GROUP_POOL_SIZE
+#define MIDIMAGIC_PORT_GROUP_POOL_SIZE 24
+#endif
+
+#ifndef MIDIMAGIC_LOOPER_POOL_SIZE
+#define MIDIMAGIC_LOOPER_POOL_SIZE 2
+#endif
+
+#ifndef MIDIMAGIC_LOOPER_EVENTS
+#define MIDIMAGIC_LOOPER_EVENTS 96
+#endif
+
+namespace midimagic {
+    // number of physical output ports
+    const u8 k_max_output_ports = 8;
+    // number of port groups of a single preset
+    const u8 k_max_port_groups = MIDIMAGIC_MAX_PORT_GROUPS;
+    // number of presets kept ready for Program Change switching
+    const u8 k_max_presets = MIDIMAGIC_MAX_PRESETS;
+    // number of port groups of all presets together
+    const u8 k_port_group_pool_size = MIDIMAGIC_PORT_GROUP_POOL_SIZE;
+    // number of distinct message types a port group can listen to, all the
+    // input type mask of the archive can hold: Note Off ... NRPN, Clock,
+    // Start, Continue and Stop
+    const u8 k_max_input_types = 12;
+    // number of pattern loopers shared by the port groups of all presets
+    const u8 k_looper_pool_size = MIDIMAGIC_LOOPER_POOL_SIZE;
+    // note events a single looper pattern can hold
+    const u8 k_max_looper_events = MIDIMAGIC_LOOPER_EVENTS;
+} // namespace midimagic
+
+#endif // MIDIMAGIC_SYSTEM_LIMITS_H
@@ -0,0 +1,70 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_VELOCITY_CURVE_H
+#define MIDIMAGIC_VELOCITY_CURVE_H
+
+#include "common.h"
+
+namespace midimagic {
+    enum curve_type : u8 {
+        LINEAR_CURVE = 0,
+        EXPONENTIAL_CURVE,
+        LOGARITHMIC_CURVE,
+        FIXED_CURVE, // fixed_level whatever the velocity
+        USER_CURVE,
+        _CURVE_TYPE_COUNT_
+    };
+
+    // points of the user curve at velocity 0, 16, ..., 112 and 127
+    const u8 k_user_curve_points = 9;
+
+    struct velocity_settings {
+        curve_type curve = curve_type::LINEAR_CURVE;
+        u8 fixed_level = 100; // 0...127
+        u8 user_points[k_user_curve_points] = {0, 16, 32, 48, 64, 80, 96, 112, 127};
+    };
+
+    const bool operator==(const velocity_settings& a, const velocity_settings& b);
+    const bool operator!=(const velocity_settings& a, const velocity_settings& b);
+    const char* curve_type2name(const curve_type curve);
+
+    // Maps Note On velocities to DAC levels between 0 V and the +5 V end of
+    // the DAC range. The linear, exponential and logarithmic curves are
+    // precomputed tables in flash, the user curve is interpolated between
+    // its points so a port needs no table of its own in RAM.
+    class velocity_curve {
+    public:
+        velocity_curve();
+        velocity_curve(const velocity_curve&) = delete;
+        ~velocity_curve();
+
+        void set_settings(const velocity_settings& settings);
+        const velocity_settings& get_settings() const;
+        const i16 level(const u8 velocity) const;
+
+    private:
+        velocity_settings m_settings;
+        const u16 *m_table; // table of the curve, nullptr for the user curve
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_VELOCITY_CURVE_H
@@ -20,6 +20,7 @@
  ******************************************************************************/
 
 #include "ad57x4.h"
+#include "irq_guard.h"
 #define REG_OUTPUT_RANGE_MASK 0x08
 #define REG_POWER_CTRL_MASK   0x10
 
@@ -54,6 +55,8 @@ void ad57x4::set_level(u16 level, u8 channel) {
 }
 
 void ad57x4::send(u8 (&data)[3]) {
+    // both DACs share the bus with the modulation interrupt
+    irq_guard guard;
     m_spi.transfer(m_sync, data[0], SPI_CONTINUE);
     m_spi.transfer16(m_sync, data[1] << 8 | data[2], SPI_LAST);
 }
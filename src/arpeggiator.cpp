@@ -0,0 +1,243 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "arpeggiator.h"
+#include <cstdlib>
+
+namespace midimagic {
+    const char *arp_mode_names[] = {
+        "Off",
+        "Up",
+        "Down",
+        "Up/Down",
+        "Random",
+        "As played"
+    };
+
+    const char* arp_mode2name(arpeggiator::arp_mode mode) {
+        return arp_mode_names[mode];
+    }
+
+    arpeggiator::arpeggiator()
+        : m_held{}
+        , m_held_count(0)
+        , m_played{}
+        , m_played_count(0)
+        , m_play_index(0)
+        , m_mode(arp_mode::OFF)
+        , m_division(6)
+        , m_tick(0)
+        , m_current(255)
+        , m_sounding(255)
+        , m_velocity(100)
+        , m_ascending(true) {
+        // nothing to do
+    }
+
+    arpeggiator::~arpeggiator() {
+        // nothing to do
+    }
+
+    void arpeggiator::set_mode(const arp_mode mode) {
+        m_mode = (mode < arp_mode::_MODE_COUNT_) ? mode : arp_mode::OFF;
+    }
+
+    const arpeggiator::arp_mode arpeggiator::get_mode() const {
+        return m_mode;
+    }
+
+    void arpeggiator::set_division(const u8 division) {
+        // the gate closes after half of the step
+        m_division = (division < 2) ? 2 : division;
+        if (m_tick >= m_division) {
+            m_tick = 0;
+        }
+    }
+
+    const u8 arpeggiator::get_division() const {
+        return m_division;
+    }
+
+    void arpeggiator::note_on(const u8 note, const u8 velocity) {
+        const u8 n = note & 0x7f;
+        const u32 bit = 1u << (n & 31);
+        m_velocity = velocity;
+        if (m_held[n >> 5] & bit) {
+            return;
+        }
+        m_held[n >> 5] |= bit;
+        m_held_count++;
+        if (m_played_count < k_max_played_notes) {
+            m_played[m_played_count++] = n;
+        }
+    }
+
+    void arpeggiator::note_off(const u8 note) {
+        const u8 n = note & 0x7f;
+        const u32 bit = 1u << (n & 31);
+        if (!(m_held[n >> 5] & bit)) {
+            return;
+        }
+        m_held[n >> 5] &= ~bit;
+        m_held_count--;
+        for (u8 i = 0; i < m_played_count; i++) {
+            if (m_played[i] == n) {
+                for (u8 j = i + 1; j < m_played_count; j++) {
+                    m_played[j - 1] = m_played[j];
+                }
+                m_played_count--;
+                // keep the following note up next
+                if (i <= m_play_index) {
+                    m_play_index = m_play_index ? m_play_index - 1 : (m_played_count ? m_played_count - 1 : 0);
+                }
+                break;
+            }
+        }
+    }
+
+    void arpeggiator::tick(u8& end_note, u8& start_note) {
+        end_note = 255;
+        start_note = 255;
+        if (m_mode == arp_mode::OFF) {
+            return;
+        }
+        if (m_tick == 0) {
+            end_note = m_sounding;
+            m_sounding = next_step();
+            start_note = m_sounding;
+        } else if (m_tick == (m_division >> 1)) {
+            end_note = m_sounding;
+            m_sounding = 255;
+        }
+        if (++m_tick >= m_division) {
+            m_tick = 0;
+        }
+    }
+
+    const u8 arpeggiator::get_velocity() const {
+        return m_velocity;
+    }
+
+    const u8 arpeggiator::restart() {
+        const u8 sounding = m_sounding;
+        m_sounding = 255;
+        m_current = 255;
+        m_tick = 0;
+        m_ascending = true;
+        m_play_index = 0;
+        return sounding;
+    }
+
+    const u8 arpeggiator::clear() {
+        for (auto &word: m_held) {
+            word = 0;
+        }
+        m_held_count = 0;
+        m_played_count = 0;
+        return restart();
+    }
+
+    const u8 arpeggiator::next_above(const u8 note) const {
+        const u8 start = (note == 255) ? 0 : note + 1;
+        if (start > 127) {
+            return 255;
+        }
+        u8 word = start >> 5;
+        u32 bits = m_held[word] & (~0u << (start & 31));
+        while (!bits) {
+            if (++word == 4) {
+                return 255;
+            }
+            bits = m_held[word];
+        }
+        return (word << 5) + __builtin_ctz(bits);
+    }
+
+    const u8 arpeggiator::next_below(const u8 note) const {
+        if (note == 0) {
+            return 255;
+        }
+        const u8 start = (note == 255) ? 127 : note - 1;
+        u8 word = start >> 5;
+        u32 bits = m_held[word] & (~0u >> (31 - (start & 31)));
+        while (!bits) {
+            if (word-- == 0) {
+                return 255;
+            }
+            bits = m_held[word];
+        }
+        return (word << 5) + 31 - __builtin_clz(bits);
+    }
+
+    const u8 arpeggiator::next_step() {
+        if (!m_held_count) {
+            m_current = 255;
+            return 255;
+        }
+        u8 note = 255;
+        switch (m_mode) {
+            case arp_mode::UP :
+                note = next_above(m_current);
+                if (note == 255) {
+                    note = next_above(255);
+                }
+                break;
+            case arp_mode::DOWN :
+                note = next_below(m_current);
+                if (note == 255) {
+                    note = next_below(255);
+                }
+                break;
+            case arp_mode::UP_DOWN :
+                note = m_ascending ? next_above(m_current) : next_below(m_current);
+                if (note == 255) {
+                    // turn around at the ends, a single note just repeats
+                    m_ascending = !m_ascending;
+                    note = m_ascending ? next_above(m_current) : next_below(m_current);
+                    if (note == 255) {
+                        note = m_ascending ? next_above(255) : next_below(255);
+                    }
+                }
+                break;
+            case arp_mode::RANDOM :
+                if (m_played_count) {
+                    note = m_played[std::rand() % m_played_count];
+                } else {
+                    note = next_above(255);
+                }
+                break;
+            case arp_mode::AS_PLAYED :
+                if (m_played_count) {
+                    // a restarted sequence begins with the first played note
+                    m_play_index = (m_current == 255) ? 0 : (m_play_index + 1) % m_played_count;
+                    note = m_played[m_play_index];
+                } else {
+                    note = next_above(255);
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+        m_current = note;
+        return note;
+    }
+} // namespace midimagic
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022-2024 Adrian Krause                                          *
+ * Copyright 2022-2024, 2026 Adrian Krause                                   *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -20,47 +20,230 @@
  ******************************************************************************/
 
 #include "config_archive.h"
+#include <string.h>
 
 namespace midimagic {
-    config_archive::config_archive()
-        : m_eeprom(hw_setup.eeprom.mosi, hw_setup.eeprom.miso, hw_setup.eeprom.clk, hw_setup.eeprom.cs, hw_setup.eeprom.size)
+    config_archive::config_archive(eeprom_device& eeprom)
+        : m_eeprom(eeprom)
+        , m_archive_size(0)
+        , m_bytes_written(0)
+        , m_bytes_skipped(0)
+        , m_commit_base(0)
+        , m_commit_position(0)
+        , m_transfer_base(0)
+        , m_restore_slot(0)
+        , m_restore_sequence(0)
+        , m_restoring(false)
         , m_running_portgroup_id(0) {
         // nothing to do
     }
 
-    config_archive::config_archive(const struct system_config system_state)
-        : m_eeprom(hw_setup.eeprom.mosi, hw_setup.eeprom.miso, hw_setup.eeprom.clk, hw_setup.eeprom.cs, hw_setup.eeprom.size)
+    config_archive::config_archive(eeprom_device& eeprom, const struct preset_config& presets)
+        : m_eeprom(eeprom)
+        , m_archive_size(0)
+        , m_bytes_written(0)
+        , m_bytes_skipped(0)
+        , m_commit_base(0)
+        , m_commit_position(0)
+        , m_transfer_base(0)
+        , m_restore_slot(0)
+        , m_restore_sequence(0)
+        , m_restoring(false)
         , m_running_portgroup_id(0) {
-        readin(system_state);
+        readin(presets);
     }
 
     config_archive::~config_archive() {
         // nothing to do
     }
 
-    void config_archive::readin(const struct system_config system_state) {
-        m_system_state = system_state;
+    void config_archive::readin(const struct preset_config& presets) {
+        m_presets = presets;
     }
 
-    const struct system_config config_archive::spellout() const {
-        return m_system_state;
+    const struct preset_config& config_archive::spellout() const {
+        return m_presets;
+    }
+
+    struct preset_config& config_archive::get_presets() {
+        return m_presets;
     }
 
     const config_archive::operation_result config_archive::loadon() {
-        // check for magic
-        if (m_eeprom.read_2byte(static_header_field::MAGIC0) != MAGIC) {
+        u8 slot;
+        u16 sequence;
+        std::unique_ptr<byte_buffer> image;
+        auto result = read_newest_slot(slot, sequence, image);
+        if (result != operation_result::SUCCESS) {
+            // archives written before the slot layout sit at address 0 without slot header,
+            // keep a slot CRC error if there is no such archive either
+            auto legacy_result = read_archive(0, m_eeprom.get_size(), image);
+            if (legacy_result != operation_result::SUCCESS) {
+                return (result == operation_result::CRC_MISMATCH) ? result : legacy_result;
+            }
+        }
+        return parse_image(image->span());
+    }
+
+    const config_archive::operation_result config_archive::read_newest_slot(u8& slot,
+                                                                            u16& sequence,
+                                                                            std::unique_ptr<byte_buffer>& image) const {
+        // fetch all slot headers first, only the archives of candidates get read
+        u8 headers[SLOT_COUNT][slot_header_field::SLOT_HEADER_SIZE];
+        bool candidate[SLOT_COUNT];
+        for (u8 s = 0; s < SLOT_COUNT; s++) {
+            m_eeprom.read_sequence(get_slot_base(s), headers[s], slot_header_field::SLOT_HEADER_SIZE);
+            candidate[s] = (byte_span(headers[s], slot_header_field::SLOT_HEADER_SIZE).read_2byte(slot_header_field::SLOT_MAGIC0) == SLOT_MAGIC);
+        }
+
+        auto result = operation_result::NO_ARCHIVE_FOUND;
+        while (true) {
+            // newest remaining candidate, sequence numbers may wrap around
+            bool found = false;
+            u8 newest = 0;
+            u16 newest_sequence = 0;
+            for (u8 s = 0; s < SLOT_COUNT; s++) {
+                if (!candidate[s]) {
+                    continue;
+                }
+                const u16 s_sequence = byte_span(headers[s], slot_header_field::SLOT_HEADER_SIZE).read_2byte(slot_header_field::SLOT_SEQUENCE0);
+                if (!found || ((i16) (s_sequence - newest_sequence)) > 0) {
+                    found = true;
+                    newest = s;
+                    newest_sequence = s_sequence;
+                }
+            }
+            if (!found) {
+                return result;
+            }
+            candidate[newest] = false;
+
+            result = read_archive(get_slot_base(newest) + slot_header_field::SLOT_HEADER_SIZE,
+                                  get_slot_size() - slot_header_field::SLOT_HEADER_SIZE,
+                                  image);
+            if (result != operation_result::SUCCESS) {
+                continue;
+            }
+
+            // check the CRC over sequence number and archive on the RAM image, no second read
+            crc16 crc;
+            crc.update(&headers[newest][slot_header_field::SLOT_SEQUENCE0], 2);
+            crc.update(image->data(), image->size());
+            if (crc.value() != byte_span(headers[newest], slot_header_field::SLOT_HEADER_SIZE).read_2byte(slot_header_field::SLOT_CRC0)) {
+                result = operation_result::CRC_MISMATCH;
+                continue;
+            }
+
+            slot = newest;
+            sequence = newest_sequence;
+            return operation_result::SUCCESS;
+        }
+    }
+
+    const config_archive::operation_result config_archive::read_archive(const u16 base_addr,
+                                                                        const u16 limit,
+                                                                        std::unique_ptr<byte_buffer>& image) const {
+        // fetch the static header in one transaction
+        u8 header[static_header_field::FIRST_CONFIG_BASE_ADDR];
+        m_eeprom.read_sequence(base_addr + static_header_field::MAGIC0, header, sizeof(header));
+        const byte_span header_span(header, sizeof(header));
+
+        // check for magic, a preset bundle shares the magic, version and size offsets
+        const u16 magic = header_span.read_2byte(static_header_field::MAGIC0);
+        const u8 version = header_span.read(static_header_field::VERSION);
+        u16 min_size;
+        if (magic == MAGIC) {
+            if (version < 1 || version > RUNNING_VERSION) {
+                return operation_result::VERSION_UNKNOWN;
+            }
+            min_size = (version < 3) ? (u16) static_header_field::FIRST_CONFIG_BASE_ADDR : (u16) record_stream_field::FIRST_RECORD;
+        } else if (magic == PRESET_BUNDLE_MAGIC) {
+            if (version != PRESET_BUNDLE_VERSION) {
+                return operation_result::VERSION_UNKNOWN;
+            }
+            min_size = preset_bundle_field::BUNDLE_HEADER_SIZE;
+        } else {
             // no joy, abort
             return operation_result::NO_ARCHIVE_FOUND;
         }
 
+        const u16 archive_size = header_span.read_2byte(static_header_field::SIZE0);
+        if (archive_size < min_size) {
+            return operation_result::ARCHIVE_EMPTY;
+        }
+        if (archive_size > limit) {
+            return operation_result::SIZE_MISMATCH;
+        }
+
+        // pull the whole archive into RAM, the parsers work on this image only
+        image = std::make_unique<byte_buffer>(archive_size);
+        if (m_eeprom.read_sequence(base_addr, image->data(), archive_size) != archive_size) {
+            return operation_result::SIZE_MISMATCH;
+        }
+        return operation_result::SUCCESS;
+    }
+
+    const config_archive::operation_result config_archive::parse_image(const byte_span& image) {
+        m_presets.presets.clear();
+        m_presets.control_channel = 0;
+        m_presets.active_preset = 0;
+
+        if (image.read_2byte(preset_bundle_field::BUNDLE_MAGIC0) != PRESET_BUNDLE_MAGIC) {
+            // single archive as written before presets existed, it becomes the first preset
+            m_presets.presets.emplace_back();
+            return parse_archive(image, m_presets.presets.back());
+        }
+
+        const u8 preset_count = image.read(preset_bundle_field::BUNDLE_PRESET_COUNT);
+        if (!preset_count) {
+            return operation_result::ARCHIVE_EMPTY;
+        }
+        if (preset_count > k_max_presets) {
+            return operation_result::CONFIG_TOO_BIG;
+        }
+        const u8 control_channel = image.read(preset_bundle_field::BUNDLE_CONTROL_CHANNEL);
+        const u8 active_preset = image.read(preset_bundle_field::BUNDLE_ACTIVE_PRESET);
+        m_presets.control_channel = (control_channel > 16) ? 0 : control_channel;
+        m_presets.active_preset = (active_preset < preset_count) ? active_preset : 0;
+
+        // the archives follow the bundle header back to back, each one carries its own size
+        u16 archive_addr = preset_bundle_field::BUNDLE_HEADER_SIZE;
+        for (u8 preset = 0; preset < preset_count; preset++) {
+            // the parsers check the rest of the archive header
+            if (!image.contains(archive_addr, record_stream_field::FIRST_RECORD)) {
+                return operation_result::CORRUPT_HEADER;
+            }
+            const byte_span archive_header(image.data() + archive_addr, image.size() - archive_addr);
+            const u16 archive_size = archive_header.read_2byte(static_header_field::SIZE0);
+            if (archive_header.read_2byte(static_header_field::MAGIC0) != MAGIC
+                || archive_size < record_stream_field::FIRST_RECORD
+                || !image.contains(archive_addr, archive_size)) {
+                return operation_result::CORRUPT_HEADER;
+            }
+            m_presets.presets.emplace_back();
+            auto result = parse_archive(byte_span(image.data() + archive_addr, archive_size), m_presets.presets.back());
+            if (result != operation_result::SUCCESS) {
+                return result;
+            }
+            archive_addr += archive_size;
+        }
+        m_archive_size = image.size();
+        return operation_result::SUCCESS;
+    }
+
+    const config_archive::operation_result config_archive::parse_archive(const byte_span& archive,
+                                                                         struct system_config& config) {
         // check version and parse archive
         std::unique_ptr<archive_parser> parser;
-        switch (m_eeprom.read(static_header_field::VERSION)) {
+        switch (archive.read(static_header_field::VERSION)) {
             case 1 :
-                parser = std::make_unique<archive_parser_v1>(m_eeprom);
+                parser = std::make_unique<archive_parser_v1>(archive);
                 break;
             case 2 :
-                parser = std::make_unique<archive_parser_v2>(m_eeprom);
+                parser = std::make_unique<archive_parser_v2>(archive);
+                break;
+            case 3 :
+                parser = std::make_unique<archive_parser_v3>(archive);
                 break;
             default :
                 return operation_result::VERSION_UNKNOWN;
@@ -70,164 +253,600 @@ namespace midimagic {
         auto result = parser->parse();
 
         if (result == operation_result::SUCCESS) {
-            m_system_state = std::move(*(parser->get_config().release()));
+            config = *(parser->get_config());
+            m_archive_size = parser->get_archive_size();
         }
         return result;
     }
 
+    const u16 config_archive::get_slot_base(const u8 slot) const {
+        return slot * get_slot_size();
+    }
+
+    const u16 config_archive::get_slot_size() const {
+        return m_eeprom.get_size() / SLOT_COUNT;
+    }
+
+    const u16 config_archive::get_archive_size() const {
+        return m_archive_size;
+    }
+
     const config_archive::operation_result config_archive::writeout() {
-        m_eeprom.enable_write();
+        auto result = begin_writeout();
+        while (result == operation_result::WRITE_IN_PROGRESS) {
+            result = writeout_step();
+        }
+        return result;
+    }
 
-        u16 header_size = generate_archive_header();
+    const config_archive::operation_result config_archive::begin_writeout() {
+        m_bytes_written = 0;
+        m_bytes_skipped = 0;
+        m_commit_image.reset();
+        m_commit_position = 0;
 
-        // check if config fits
-        if (m_eeprom.read_2byte(static_header_field::SIZE0) > hw_setup.eeprom.size) {
-            m_eeprom.disable_write();
+        if (m_presets.presets.empty()) {
+            return operation_result::ARCHIVE_EMPTY;
+        }
+
+        // check if the presets fit
+        const u16 archive_size = calculate_bundle_size();
+        if (archive_size > get_slot_size() - slot_header_field::SLOT_HEADER_SIZE) {
             return operation_result::CONFIG_TOO_BIG;
         }
 
-        u16 return_config_size;
+        byte_buffer image(archive_size);
+        image.write_2byte(preset_bundle_field::BUNDLE_MAGIC0, PRESET_BUNDLE_MAGIC);
+        image.write(preset_bundle_field::BUNDLE_VERSION, PRESET_BUNDLE_VERSION);
+        image.write_2byte(preset_bundle_field::BUNDLE_SIZE0, archive_size);
+        image.write(preset_bundle_field::BUNDLE_CONTROL_CHANNEL, m_presets.control_channel);
+        image.write(preset_bundle_field::BUNDLE_PRESET_COUNT, m_presets.presets.size());
+        image.write(preset_bundle_field::BUNDLE_ACTIVE_PRESET, m_presets.active_preset);
 
-        for (u8 index = 0; index < m_system_state.system_ports.size(); index++) {
-            u16 next_address = get_address_to(config_type::OUTPUT_PORT_CONFIG, index);
-            if (next_address) {
-                return_config_size = serialise(m_system_state.system_ports.at(index), next_address);
-            } else {
-                m_eeprom.disable_write();
-                return operation_result::ILLEGAL_ADDRESS_ON_WRITE;
+        u16 preset_addr = preset_bundle_field::BUNDLE_HEADER_SIZE;
+        for (auto &config: m_presets.presets) {
+            byte_buffer preset_image(calculate_archive_size(config));
+            auto result = serialise_archive(config, preset_image);
+            if (result != operation_result::SUCCESS) {
+                return result;
             }
-            if (!return_config_size) {
-                m_eeprom.disable_write();
-                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            memcpy(image.data() + preset_addr, preset_image.data(), preset_image.size());
+            preset_addr += preset_image.size();
+        }
+
+        u8 target_slot;
+        u16 sequence;
+        std::unique_ptr<byte_buffer> active_image;
+        if (find_target_slot(target_slot, sequence, active_image)
+            && active_image->size() == archive_size
+            && !memcmp(active_image->data(), image.data(), archive_size)) {
+            // nothing changed, keep the active slot
+            m_bytes_skipped = archive_size;
+            m_archive_size = archive_size;
+            return operation_result::SUCCESS;
+        }
+
+        m_archive_size = archive_size;
+        prepare_commit(image.span(), target_slot, sequence);
+        m_eeprom.enable_write();
+        return operation_result::WRITE_IN_PROGRESS;
+    }
+
+    const bool config_archive::find_target_slot(u8& target_slot,
+                                                u16& sequence,
+                                                std::unique_ptr<byte_buffer>& active_image) const {
+        // without a valid slot start with the second one so an
+        // archive from before the slot layout survives until the commit
+        u8 active_slot;
+        const bool has_active = (read_newest_slot(active_slot, sequence, active_image) == operation_result::SUCCESS);
+        target_slot = has_active ? (active_slot + 1) % SLOT_COUNT : 1;
+        sequence = has_active ? sequence + 1 : 1;
+        return has_active;
+    }
+
+    void config_archive::prepare_commit(const byte_span& image, const u8 target_slot, const u16 sequence) {
+        // slot header and archive go into one image, committed step by step
+        m_commit_image = std::make_unique<byte_buffer>(slot_header_field::SLOT_HEADER_SIZE + image.size());
+        m_commit_base = get_slot_base(target_slot);
+        m_commit_position = 0;
+        memcpy(m_commit_image->data() + slot_header_field::SLOT_HEADER_SIZE, image.data(), image.size());
+        m_commit_image->write_2byte(slot_header_field::SLOT_MAGIC0, SLOT_MAGIC);
+        m_commit_image->write_2byte(slot_header_field::SLOT_SEQUENCE0, sequence);
+        crc16 crc;
+        crc.update(m_commit_image->data() + slot_header_field::SLOT_SEQUENCE0, 2);
+        crc.update(image.data(), image.size());
+        m_commit_image->write_2byte(slot_header_field::SLOT_CRC0, crc.value());
+    }
+
+    const config_archive::operation_result config_archive::begin_dump() {
+        u8 slot;
+        u16 sequence;
+        std::unique_ptr<byte_buffer> image;
+        // the RAM image only serves the CRC check, the chunks come from the eeprom
+        auto result = read_newest_slot(slot, sequence, image);
+        if (result != operation_result::SUCCESS) {
+            return result;
+        }
+        m_transfer_base = get_slot_base(slot) + slot_header_field::SLOT_HEADER_SIZE;
+        m_archive_size = image->size();
+        return operation_result::SUCCESS;
+    }
+
+    const u16 config_archive::read_dump(const u16 offset, u8* buffer, const u16 length) const {
+        if (offset >= m_archive_size) {
+            return 0;
+        }
+        const u16 read_length = (length > m_archive_size - offset) ? m_archive_size - offset : length;
+        return m_eeprom.read_sequence(m_transfer_base + offset, buffer, read_length);
+    }
+
+    const config_archive::operation_result config_archive::begin_restore(const u16 image_size) {
+        m_bytes_written = 0;
+        m_bytes_skipped = 0;
+        m_commit_image.reset();
+        if (image_size < preset_bundle_field::BUNDLE_HEADER_SIZE) {
+            return operation_result::ARCHIVE_EMPTY;
+        }
+        if (image_size > get_slot_size() - slot_header_field::SLOT_HEADER_SIZE) {
+            return operation_result::CONFIG_TOO_BIG;
+        }
+
+        std::unique_ptr<byte_buffer> active_image;
+        find_target_slot(m_restore_slot, m_restore_sequence, active_image);
+        // the old slot header stays until finish_restore(), its CRC won't match the new contents
+        m_transfer_base = get_slot_base(m_restore_slot) + slot_header_field::SLOT_HEADER_SIZE;
+        m_archive_size = image_size;
+        m_commit_position = 0;
+        m_restoring = true;
+        m_eeprom.enable_write();
+        return operation_result::SUCCESS;
+    }
+
+    const config_archive::operation_result config_archive::restore_step(const u8* data,
+                                                                        const u16 offset,
+                                                                        const u16 length) {
+        if (!m_restoring || offset != m_commit_position
+            || offset >= m_archive_size || length > m_archive_size - offset) {
+            return operation_result::ILLEGAL_ADDRESS_ON_WRITE;
+        }
+        if (!m_eeprom.write_ready()) {
+            return operation_result::WRITE_IN_PROGRESS;
+        }
+
+        // same as writeout_step(), at most one program cycle per call
+        for (u16 chunk = 0; chunk < length; chunk += k_commit_chunk) {
+            const u16 chunk_length = (length - chunk > k_commit_chunk) ? k_commit_chunk : length - chunk;
+            u8 current[k_commit_chunk];
+            m_eeprom.read_sequence(m_transfer_base + offset + chunk, current, chunk_length);
+            for (u16 i = 0; i < chunk_length; i++) {
+                if (current[i] != data[chunk + i]) {
+                    // compared again on the next call, the byte reads back once programmed
+                    m_eeprom.start_write(m_transfer_base + offset + chunk + i, data[chunk + i]);
+                    m_bytes_written++;
+                    return operation_result::WRITE_IN_PROGRESS;
+                }
             }
         }
+        m_commit_position += length;
+        return operation_result::SUCCESS;
+    }
+
+    const config_archive::operation_result config_archive::finish_restore() {
+        if (!m_restoring || m_commit_position != m_archive_size) {
+            return operation_result::SIZE_MISMATCH;
+        }
+        if (!m_eeprom.write_ready()) {
+            return operation_result::WRITE_IN_PROGRESS;
+        }
+        m_restoring = false;
+
+        // check the received image like a load before it becomes the newest slot
+        std::unique_ptr<byte_buffer> image;
+        auto result = read_archive(m_transfer_base, m_archive_size, image);
+        if (result == operation_result::SUCCESS && image->size() != m_archive_size) {
+            result = operation_result::SIZE_MISMATCH;
+        }
+        if (result == operation_result::SUCCESS) {
+            result = parse_image(image->span());
+        }
+        if (result != operation_result::SUCCESS) {
+            m_eeprom.disable_write();
+            return result;
+        }
+
+        // the body matches already, writeout_step() only programs the slot header
+        m_bytes_skipped = 0;
+        prepare_commit(image->span(), m_restore_slot, m_restore_sequence);
+        return operation_result::WRITE_IN_PROGRESS;
+    }
+
+    const config_archive::operation_result config_archive::writeout_step() {
+        if (!m_commit_image) {
+            return operation_result::SUCCESS;
+        }
+        if (!m_eeprom.write_ready()) {
+            return operation_result::WRITE_IN_PROGRESS;
+        }
 
-        for (u8 index = 0; index < m_system_state.system_port_groups.size(); index++) {
-            u16 next_address = get_address_to(config_type::PORTGROUP_CONFIG, index);
-            if (next_address) {
-                return_config_size = serialise(m_system_state.system_port_groups.at(index), next_address);
+        const u16 commit_size = m_commit_image->size();
+        if (m_commit_position < commit_size) {
+            // compare a chunk in one sequential read, it must not cross
+            // the border between archive, magic and CRC, and sequence number
+            const u16 archive_size = commit_size - slot_header_field::SLOT_HEADER_SIZE;
+            u16 chunk_end;
+            if (m_commit_position < archive_size) {
+                chunk_end = archive_size;
+            } else if (m_commit_position < archive_size + slot_header_field::SLOT_SEQUENCE0) {
+                chunk_end = archive_size + slot_header_field::SLOT_SEQUENCE0;
             } else {
-                m_eeprom.disable_write();
-                return operation_result::ILLEGAL_ADDRESS_ON_WRITE;
+                chunk_end = commit_size;
             }
-            if (!return_config_size) {
-                m_eeprom.disable_write();
-                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            const u16 chunk_length = (chunk_end - m_commit_position > k_commit_chunk) ? k_commit_chunk : chunk_end - m_commit_position;
+            const u16 chunk_offset = get_commit_offset(m_commit_position);
+            u8 current[k_commit_chunk];
+            m_eeprom.read_sequence(m_commit_base + chunk_offset, current, chunk_length);
+
+            // every programmed byte costs a full program cycle, leave matching bytes alone
+            for (u16 i = 0; i < chunk_length; i++) {
+                const u8 data = m_commit_image->span().read(chunk_offset + i);
+                if (current[i] != data) {
+                    m_eeprom.start_write(m_commit_base + chunk_offset + i, data);
+                    m_bytes_written++;
+                    m_commit_position += i + 1;
+                    return operation_result::WRITE_IN_PROGRESS;
+                }
+                m_bytes_skipped++;
+            }
+            m_commit_position += chunk_length;
+            if (m_commit_position < commit_size) {
+                return operation_result::WRITE_IN_PROGRESS;
             }
         }
+
         m_eeprom.disable_write();
+        m_commit_image.reset();
         return operation_result::SUCCESS;
     }
 
-    u16 config_archive::generate_archive_header() {
-        // write magic
-        m_eeprom.write_2byte(static_header_field::MAGIC0, MAGIC);
-        // write version
-        m_eeprom.write(static_header_field::VERSION, RUNNING_VERSION);
+    const bool config_archive::abort_writeout() {
+        if (!m_commit_image && !m_restoring) {
+            return true;
+        }
+        if (!m_eeprom.write_ready()) {
+            return false;
+        }
+        m_eeprom.disable_write();
+        m_commit_image.reset();
+        m_restoring = false;
+        return true;
+    }
+
+    const u8 config_archive::get_writeout_progress() const {
+        if (!m_commit_image) {
+            return 100;
+        }
+        return (100 * (u32) m_commit_position) / m_commit_image->size();
+    }
+
+    const u16 config_archive::get_commit_offset(const u16 position) const {
+        const u16 archive_size = m_commit_image->size() - slot_header_field::SLOT_HEADER_SIZE;
+        if (position < archive_size) {
+            return slot_header_field::SLOT_HEADER_SIZE + position;
+        }
+        return position - archive_size;
+    }
 
-        // write config counts
-        u8 port_config_count = m_system_state.system_ports.size();
-        u8 portgroup_config_count = m_system_state.system_port_groups.size();
-        m_eeprom.write(static_header_field::PORT_CONFIG_COUNT, port_config_count);
-        m_eeprom.write(static_header_field::PORTGROUP_CONFIG_COUNT, portgroup_config_count);
+    const u16 config_archive::get_bytes_written() const {
+        return m_bytes_written;
+    }
 
-        // calculate addresses
-        u16 header_size = static_header_field::FIRST_CONFIG_BASE_ADDR + (2 * port_config_count) + (2 * portgroup_config_count);
-        u16 running_config_base_addr = header_size;
-        u16 running_header_field_addr = static_header_field::FIRST_CONFIG_BASE_ADDR;
+    const u16 config_archive::get_bytes_skipped() const {
+        return m_bytes_skipped;
+    }
 
-        // write port config addresses
-        for (u8 i = 0; i < port_config_count; i++) {
-            m_eeprom.write_2byte(running_header_field_addr, running_config_base_addr);
-            running_config_base_addr += k_port_config_size;
-            running_header_field_addr += 2;
+    const u16 config_archive::calculate_bundle_size() const {
+        u16 bundle_size = preset_bundle_field::BUNDLE_HEADER_SIZE;
+        for (auto &config: m_presets.presets) {
+            bundle_size += calculate_archive_size(config);
         }
+        return bundle_size;
+    }
 
-        // write portgroup config addresses
-        for (auto &pg_config: m_system_state.system_port_groups) {
-            m_eeprom.write_2byte(running_header_field_addr, running_config_base_addr);
-            running_config_base_addr += k_fixed_portgroup_config_size + (pg_config.input_types.size());
-            running_header_field_addr += 2;
+    const u16 config_archive::calculate_archive_size(const struct system_config& config) const {
+        u16 archive_size = record_stream_field::FIRST_RECORD;
+        archive_size += (1 + varint_size(port_record_field::PORT_RECORD_SIZE) + port_record_field::PORT_RECORD_SIZE)
+                      * config.system_ports.size();
+        for (auto &port_config: config.system_ports) {
+            if (port_config.modulation.type != modulation_type::NO_MODULATION) {
+                archive_size += 1 + varint_size(modulation_record_field::MODULATION_RECORD_SIZE)
+                              + modulation_record_field::MODULATION_RECORD_SIZE;
+            }
+            if (port_config.quantizer.scale != scale_type::NO_SCALE) {
+                archive_size += 1 + varint_size(quantizer_record_field::QUANTIZER_RECORD_SIZE)
+                              + quantizer_record_field::QUANTIZER_RECORD_SIZE;
+            }
+            if (port_config.velocity_curve.curve != curve_type::LINEAR_CURVE) {
+                archive_size += 1 + varint_size(velocity_record_field::VELOCITY_RECORD_SIZE)
+                              + velocity_record_field::VELOCITY_RECORD_SIZE;
+            }
+        }
+        for (auto &pg_config: config.system_port_groups) {
+            const u16 payload_size = portgroup_payload_size(pg_config);
+            archive_size += 1 + varint_size(payload_size) + payload_size;
         }
+        return archive_size;
+    }
 
-        // write total size
-        // running_config_base_addr points to the next free cell after the last config which is also the size of the whole archive
-        m_eeprom.write_2byte(static_header_field::SIZE0, running_config_base_addr);
+    const config_archive::operation_result config_archive::serialise_archive(const struct system_config& config,
+                                                                             byte_buffer& image) {
+        // write magic, version and total size
+        image.write_2byte(static_header_field::MAGIC0, MAGIC);
+        image.write(static_header_field::VERSION, RUNNING_VERSION);
+        image.write_2byte(static_header_field::SIZE0, image.size());
 
-        return header_size;
+        u16 running_record_addr = record_stream_field::FIRST_RECORD;
+        u16 return_record_size;
+
+        for (auto &port_config: config.system_ports) {
+            return_record_size = serialise(port_config, running_record_addr, image);
+            if (!return_record_size) {
+                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            }
+            running_record_addr += return_record_size;
+        }
+
+        for (auto &port_config: config.system_ports) {
+            if (port_config.modulation.type == modulation_type::NO_MODULATION) {
+                continue;
+            }
+            return_record_size = serialise_modulation(port_config, config.system_port_groups, running_record_addr, image);
+            if (!return_record_size) {
+                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            }
+            running_record_addr += return_record_size;
+        }
+
+        for (auto &port_config: config.system_ports) {
+            if (port_config.quantizer.scale == scale_type::NO_SCALE) {
+                continue;
+            }
+            return_record_size = serialise_quantizer(port_config, running_record_addr, image);
+            if (!return_record_size) {
+                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            }
+            running_record_addr += return_record_size;
+        }
+
+        for (auto &port_config: config.system_ports) {
+            if (port_config.velocity_curve.curve == curve_type::LINEAR_CURVE) {
+                continue;
+            }
+            return_record_size = serialise_velocity_curve(port_config, running_record_addr, image);
+            if (!return_record_size) {
+                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            }
+            running_record_addr += return_record_size;
+        }
+
+        for (auto &pg_config: config.system_port_groups) {
+            return_record_size = serialise(pg_config, running_record_addr, image);
+            if (!return_record_size) {
+                return operation_result::ILLEGAL_CONFIG_BASE_ADDRESS;
+            }
+            running_record_addr += return_record_size;
+        }
+
+        // the records must fill the image exactly
+        if (running_record_addr != image.size()) {
+            return operation_result::ILLEGAL_ADDRESS_ON_WRITE;
+        }
+        return operation_result::SUCCESS;
     }
 
-    u16 config_archive::get_address_to(config_type type, u8 index) {
-        u8 port_config_count = m_eeprom.read(static_header_field::PORT_CONFIG_COUNT);
-        u8 portgroup_config_count = m_eeprom.read(static_header_field::PORTGROUP_CONFIG_COUNT);
-        u16 out_addr = 0;
-        u16 header_field_addr = 0;
-        switch (type) {
-            case config_type::OUTPUT_PORT_CONFIG :
-                if (index >= port_config_count) {
-                    return out_addr;
-                }
-                header_field_addr = static_header_field::FIRST_CONFIG_BASE_ADDR + (index * 2);
-                break;
-            case config_type::PORTGROUP_CONFIG :
-                if (index >= portgroup_config_count) {
-                    return out_addr;
-                }
-                header_field_addr = static_header_field::FIRST_CONFIG_BASE_ADDR + (port_config_count * 2) + (index * 2);
-                break;
-            default :
-                return out_addr;
+    u16 config_archive::serialise(const struct output_port_config& config, u16 base_addr, byte_buffer& image) {
+        if (base_addr < record_stream_field::FIRST_RECORD) {
+            // illegal address, would overwrite the header, nope out...
+            return 0;
+        }
+        const u16 header_size = write_record_header(record_type::PORT_RECORD, port_record_field::PORT_RECORD_SIZE, base_addr, image);
+        base_addr += header_size;
+
+        u8 settings = pack_clock_rate(config.clock_rate);
+        settings |= (config.clock_mode & 0x7) << 4;
+        if (config.velocity_output) {
+            settings |= 0x80;
+        }
+        image.write(base_addr + port_record_field::RECORD_PORT_NUMBER, config.port_number);
+        image.write(base_addr + port_record_field::RECORD_PORT_SETTINGS, settings);
+        return header_size + port_record_field::PORT_RECORD_SIZE;
+    }
+
+    u16 config_archive::serialise_modulation(const struct output_port_config& config, const port_group_config_list& port_groups,
+                                             u16 base_addr, byte_buffer& image) {
+        if (base_addr < record_stream_field::FIRST_RECORD) {
+            // illegal address, would overwrite the header, nope out...
+            return 0;
+        }
+        const u16 header_size = write_record_header(record_type::MODULATION_RECORD,
+                                                    modulation_record_field::MODULATION_RECORD_SIZE, base_addr, image);
+        base_addr += header_size;
+
+        const modulation_settings& mod = config.modulation;
+        image.write(base_addr + modulation_record_field::RECORD_MOD_PORT_NUMBER, config.port_number);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_TYPE_SHAPE, (mod.type << 4) | (mod.shape & 0xf));
+        image.write(base_addr + modulation_record_field::RECORD_MOD_RATE, mod.rate);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_SYNC, mod.sync_ticks);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_DEPTH, mod.depth);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_ATTACK, mod.attack);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_DECAY, mod.decay);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_SUSTAIN, mod.sustain);
+        image.write(base_addr + modulation_record_field::RECORD_MOD_RELEASE, mod.release);
+        // group ids only live until the next boot, the parsers number the portgroups by their position
+        u8 trigger_position = 0;
+        for (u8 position = 0; mod.trigger_group && position < port_groups.size(); position++) {
+            if (port_groups[position].id == mod.trigger_group) {
+                trigger_position = position + 1;
                 break;
+            }
         }
-        out_addr = m_eeprom.read_2byte(header_field_addr);
-        return out_addr;
+        image.write(base_addr + modulation_record_field::RECORD_MOD_TRIGGER_GROUP, trigger_position);
+        return header_size + modulation_record_field::MODULATION_RECORD_SIZE;
     }
 
-    u16 config_archive::serialise(struct output_port_config config, u16 base_addr) {
-        if (base_addr < static_header_field::FIRST_CONFIG_BASE_ADDR + 2) {
-            // illegal address, no configs exist in this case, nope out...
+    u16 config_archive::serialise_quantizer(const struct output_port_config& config, u16 base_addr, byte_buffer& image) {
+        if (base_addr < record_stream_field::FIRST_RECORD) {
+            // illegal address, would overwrite the header, nope out...
             return 0;
         }
-        m_eeprom.write(base_addr + port_config_field::PORT_NUMBER, config.port_number);
-        m_eeprom.write(base_addr + port_config_field::CLOCK_RATE, config.clock_rate);
-        m_eeprom.write(base_addr + port_config_field::VELOCITY, config.velocity_output);
-        m_eeprom.write(base_addr + port_config_field::CLOCK_MODE, config.clock_mode);
-        return k_port_config_size;
+        const u16 header_size = write_record_header(record_type::QUANTIZER_RECORD,
+                                                    quantizer_record_field::QUANTIZER_RECORD_SIZE, base_addr, image);
+        base_addr += header_size;
+
+        const quantizer_settings& quant = config.quantizer;
+        image.write(base_addr + quantizer_record_field::RECORD_QUANT_PORT_NUMBER, config.port_number);
+        image.write(base_addr + quantizer_record_field::RECORD_QUANT_SCALE, (quant.trigger ? 0x80 : 0) | (quant.scale & 0xf));
+        image.write(base_addr + quantizer_record_field::RECORD_QUANT_ROOT, quant.root);
+        image.write_2byte(base_addr + quantizer_record_field::RECORD_QUANT_MASK0, quant.user_mask);
+        return header_size + quantizer_record_field::QUANTIZER_RECORD_SIZE;
     }
 
-    u16 config_archive::serialise(struct port_group_config config, u16 base_addr) {
-        if (base_addr < static_header_field::FIRST_CONFIG_BASE_ADDR + 2) {
-            // illegal address, no configs exist in this case, nope out...
+    u16 config_archive::serialise_velocity_curve(const struct output_port_config& config, u16 base_addr, byte_buffer& image) {
+        if (base_addr < record_stream_field::FIRST_RECORD) {
+            // illegal address, would overwrite the header, nope out...
             return 0;
         }
-        u16 configuration_size = k_fixed_portgroup_config_size;
+        const u16 header_size = write_record_header(record_type::VELOCITY_RECORD,
+                                                    velocity_record_field::VELOCITY_RECORD_SIZE, base_addr, image);
+        base_addr += header_size;
 
-        m_eeprom.write(base_addr + portgroup_config_field::DEMUX_TYPE, config.demux);
-        m_eeprom.write(base_addr + portgroup_config_field::MIDI_CHANNEL, config.midi_channel);
-        m_eeprom.write(base_addr + portgroup_config_field::CC_NUMBER, config.cont_controller_number);
-        if (config.transpose_offset < 0) {
-            m_eeprom.write(base_addr + portgroup_config_field::TRANSPOSE, (u8) (0x80 | (config.transpose_offset & 0x7f)));
-        } else {
-            m_eeprom.write(base_addr + portgroup_config_field::TRANSPOSE, config.transpose_offset);
+        const velocity_settings& vel = config.velocity_curve;
+        image.write(base_addr + velocity_record_field::RECORD_VEL_PORT_NUMBER, config.port_number);
+        image.write(base_addr + velocity_record_field::RECORD_VEL_CURVE, vel.curve);
+        image.write(base_addr + velocity_record_field::RECORD_VEL_FIXED_LEVEL, vel.fixed_level);
+        for (u8 point = 0; point < k_user_curve_points; point++) {
+            image.write(base_addr + velocity_record_field::RECORD_VEL_POINT0 + point, vel.user_points[point]);
+        }
+        return header_size + velocity_record_field::VELOCITY_RECORD_SIZE;
+    }
+
+    u16 config_archive::serialise(const struct port_group_config& config, u16 base_addr, byte_buffer& image) {
+        if (base_addr < record_stream_field::FIRST_RECORD) {
+            // illegal address, would overwrite the header, nope out...
+            return 0;
         }
-        m_eeprom.write(base_addr + portgroup_config_field::INPUT_TYPE_COUNT, config.input_types.size());
+        const u16 payload_size = portgroup_payload_size(config);
+        const u16 header_size = write_record_header(record_type::PORTGROUP_RECORD, payload_size, base_addr, image);
+        base_addr += header_size;
+
+        image.write(base_addr + portgroup_record_field::RECORD_DEMUX_CHANNEL,
+                    (config.pressure_to_companion ? 0x80 : 0) | (config.mpe ? 0x40 : 0) | ((config.demux & 0x3) << 4) | ((config.midi_channel - 1) & 0xf));
+        image.write(base_addr + portgroup_record_field::RECORD_CC_NUMBER, config.cont_controller_number);
+        // two's complement
+        image.write(base_addr + portgroup_record_field::RECORD_TRANSPOSE, (u8) config.transpose_offset);
 
         u8 port_bitfield = 0;
         for (auto &port_number: config.output_port_numbers) {
             port_bitfield |= 0x80 >> port_number;
         }
-        m_eeprom.write(base_addr + portgroup_config_field::OUTPUT_PORTS, port_bitfield);
+        image.write(base_addr + portgroup_record_field::RECORD_OUTPUT_PORTS, port_bitfield);
+        image.write_2byte(base_addr + portgroup_record_field::RECORD_INPUT_TYPES0, pack_input_types(config.input_types));
+        if (payload_size >= portgroup_record_field::PORTGROUP_NRPN_RECORD_SIZE) {
+            image.write_2byte(base_addr + portgroup_record_field::RECORD_NRPN0, config.nrpn_number);
+        }
+        if (payload_size >= portgroup_record_field::PORTGROUP_ARP_RECORD_SIZE) {
+            image.write(base_addr + portgroup_record_field::RECORD_ARP_MODE, config.arp_mode);
+            image.write(base_addr + portgroup_record_field::RECORD_ARP_DIVISION, config.arp_division);
+        }
+        if (payload_size >= portgroup_record_field::PORTGROUP_MPE_RECORD_SIZE) {
+            image.write(base_addr + portgroup_record_field::RECORD_MPE_MEMBERS, config.mpe_members);
+            image.write(base_addr + portgroup_record_field::RECORD_MPE_TIMBRE, config.mpe_timbre);
+        }
 
+        return header_size + payload_size;
+    }
+
+    const u16 config_archive::portgroup_payload_size(const struct port_group_config& config) {
+        if (config.mpe) {
+            return portgroup_record_field::PORTGROUP_MPE_RECORD_SIZE;
+        }
+        if (config.arp_mode != arpeggiator::arp_mode::OFF) {
+            return portgroup_record_field::PORTGROUP_ARP_RECORD_SIZE;
+        }
         for (auto &input_type: config.input_types) {
-            m_eeprom.write(base_addr + configuration_size, input_type);
-            configuration_size++;
+            if (input_type == midi_message::PARAMETER) {
+                return portgroup_record_field::PORTGROUP_NRPN_RECORD_SIZE;
+            }
         }
+        return portgroup_record_field::PORTGROUP_RECORD_SIZE;
+    }
 
-        return configuration_size;
+    u16 config_archive::write_record_header(const record_type type, const u16 payload_size, u16 base_addr, byte_buffer& image) {
+        u16 header_size = 0;
+        image.write(base_addr + header_size++, type);
+        u16 value = payload_size;
+        while (value > 0x7f) {
+            image.write(base_addr + header_size++, 0x80 | (value & 0x7f));
+            value >>= 7;
+        }
+        image.write(base_addr + header_size++, value);
+        return header_size;
+    }
+
+    const u8 config_archive::pack_clock_rate(const u8 clock_rate) {
+        // nearest of 6, 12, 24, 48 and 96
+        u8 code = 0;
+        while (code < 4 && clock_rate > (9 << code)) {
+            code++;
+        }
+        return code;
     }
 
-    archive_parser::archive_parser(microwire_eeprom& eeprom)
-        : k_eeprom(eeprom)
+    const u8 config_archive::unpack_clock_rate(const u8 code) {
+        if (code > 4) {
+            return 24;
+        }
+        return 6 << code;
+    }
+
+    const u16 config_archive::pack_input_types(const input_type_list& input_types) {
+        u16 mask = 0;
+        for (auto &input_type: input_types) {
+            if (input_type >= midi_message::NOTE_OFF && input_type <= midi_message::PARAMETER) {
+                mask |= 1 << (input_type - midi_message::NOTE_OFF);
+            } else if (input_type >= midi_message::CLOCK) {
+                mask |= 1 << (input_type - midi_message::CLOCK + 8);
+            }
+        }
+        return mask;
+    }
+
+    const input_type_list config_archive::unpack_input_types(const u16 mask) {
+        input_type_list input_types;
+        for (u8 bit = 0; bit < 16; bit++) {
+            if (!(mask & (1 << bit))) {
+                continue;
+            }
+            const u8 input_type = (bit < 8) ? midi_message::NOTE_OFF + bit : midi_message::CLOCK + bit - 8;
+            // message type value must be in range of enum type
+            if (input_type <= midi_message::PARAMETER || input_type == midi_message::CLOCK
+                || (input_type >= midi_message::START && input_type <= midi_message::STOP)) {
+                input_types.push_back(static_cast<midi_message::message_type>(input_type));
+            }
+        }
+        return input_types;
+    }
+
+    const u16 config_archive::varint_size(u16 value) {
+        u16 size = 1;
+        while (value > 0x7f) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    archive_parser::archive_parser(const byte_span& archive)
+        : k_archive(archive)
         , m_archive_size(0) {
         // nothing to do
     }
@@ -240,34 +859,37 @@ namespace midimagic {
         return std::make_unique<const struct system_config>(m_system_config);
     }
 
+    const u16 archive_parser::get_archive_size() const {
+        return m_archive_size;
+    }
+
     const config_archive::operation_result archive_parser::read_header() {
         // get stored size
-        m_archive_size = k_eeprom.read_2byte(static_header_field::SIZE0);
+        m_archive_size = k_archive.read_2byte(static_header_field::SIZE0);
         if (m_archive_size < static_header_field::FIRST_CONFIG_BASE_ADDR) {
             return config_archive::operation_result::ARCHIVE_EMPTY;
         }
-        if (m_archive_size > hw_setup.eeprom.size) {
+        if (m_archive_size > k_archive.size()) {
             return config_archive::operation_result::SIZE_MISMATCH;
         }
 
         // get config counts
-        u8 port_config_count = k_eeprom.read(static_header_field::PORT_CONFIG_COUNT);
-        u8 portgroup_config_count = k_eeprom.read(static_header_field::PORTGROUP_CONFIG_COUNT);
+        u8 port_config_count = k_archive.read(static_header_field::PORT_CONFIG_COUNT);
+        u8 portgroup_config_count = k_archive.read(static_header_field::PORTGROUP_CONFIG_COUNT);
         if (!port_config_count && !portgroup_config_count) {
             return config_archive::operation_result::CORRUPT_HEADER;
         }
-        m_port_config_addrs.reserve(port_config_count);
-        m_portgroup_config_addrs.reserve(portgroup_config_count);
-
-        m_system_config.system_ports.reserve(port_config_count);
-        m_system_config.system_port_groups.reserve(portgroup_config_count);
+        // counts must fit the fixed capacity of the system config
+        if (port_config_count > k_max_output_ports || portgroup_config_count > k_max_port_groups) {
+            return config_archive::operation_result::CONFIG_TOO_BIG;
+        }
 
         // read out config base addresses
         for (u16 port_config_pointer = static_header_field::FIRST_CONFIG_BASE_ADDR;
             port_config_pointer < static_header_field::FIRST_CONFIG_BASE_ADDR + (port_config_count * 2); port_config_pointer += 2)
             {
-            auto config_base_addr = k_eeprom.read_2byte(port_config_pointer);
-            if (config_base_addr < port_config_pointer) {
+            auto config_base_addr = k_archive.read_2byte(port_config_pointer);
+            if (config_base_addr < port_config_pointer || config_base_addr >= m_archive_size) {
                 // illegal address, nope out and
                 // return bad address failure
                 return config_archive::operation_result::ILLEGAL_ADDRESS_ON_READ;
@@ -279,8 +901,8 @@ namespace midimagic {
             portgroup_config_pointer < static_header_field::FIRST_CONFIG_BASE_ADDR + ((port_config_count + portgroup_config_count) * 2);
             portgroup_config_pointer += 2)
             {
-            auto config_base_addr = k_eeprom.read_2byte(portgroup_config_pointer);
-            if (config_base_addr < portgroup_config_pointer) {
+            auto config_base_addr = k_archive.read_2byte(portgroup_config_pointer);
+            if (config_base_addr < portgroup_config_pointer || config_base_addr >= m_archive_size) {
                 // illegal address, nope out and
                 // return bad address failure
                 return config_archive::operation_result::ILLEGAL_ADDRESS_ON_READ;
@@ -291,8 +913,8 @@ namespace midimagic {
         return config_archive::operation_result::SUCCESS;
     }
 
-    archive_parser_v1::archive_parser_v1(microwire_eeprom& eeprom)
-        : archive_parser(eeprom) {
+    archive_parser_v1::archive_parser_v1(const byte_span& archive)
+        : archive_parser(archive) {
         // nothing to do
     }
 
@@ -336,62 +958,87 @@ namespace midimagic {
             .cont_controller_number {read_portgroup_cc(base_addr)},
             .transpose_offset {read_portgroup_transpose(base_addr)},
             .input_types {read_portgroup_msg_types(base_addr)},
-            .output_port_numbers {read_portgroup_ports(base_addr)}
+            .output_port_numbers {read_portgroup_ports(base_addr)},
+            .pressure_to_companion {read_portgroup_pressure_to_companion(base_addr)},
+            .mpe {read_portgroup_mpe(base_addr)},
+            .mpe_members {read_portgroup_mpe_members(base_addr)},
+            .mpe_timbre {read_portgroup_mpe_timbre(base_addr)},
+            .nrpn_number {read_portgroup_nrpn(base_addr)},
+            .arp_mode {read_portgroup_arp_mode(base_addr)},
+            .arp_division {read_portgroup_arp_division(base_addr)}
         };
         return pg_config;
     }
 
     const u8 archive_parser_v1::read_port_number(const u16 base_addr) const {
-        return k_eeprom.read(base_addr + port_config_field::PORT_NUMBER);
+        return k_archive.read(base_addr + port_config_field::PORT_NUMBER);
     }
 
     const u8 archive_parser_v1::read_port_clock_rate(const u16 base_addr) const {
-        return k_eeprom.read(base_addr + port_config_field::CLOCK_RATE);
+        return k_archive.read(base_addr + port_config_field::CLOCK_RATE);
     }
 
     const bool archive_parser_v1::read_port_velocity(const u16 base_addr) const {
-        return k_eeprom.read(base_addr + port_config_field::VELOCITY);
+        return k_archive.read(base_addr + port_config_field::VELOCITY);
+    }
+
+    const modulation_settings archive_parser_v1::read_port_modulation(const u16 base_addr) const {
+        return modulation_settings{};
+    }
+
+    const quantizer_settings archive_parser_v1::read_port_quantizer(const u16 base_addr) const {
+        return quantizer_settings{};
+    }
+
+    const velocity_settings archive_parser_v1::read_port_velocity_curve(const u16 base_addr) const {
+        return velocity_settings{};
     }
 
     const demux_type archive_parser_v1::read_portgroup_demux(const u16 base_addr) const {
+        const u8 demux = k_archive.read(base_addr + portgroup_config_field::DEMUX_TYPE);
         // demux type value must be in range of enum type
-        if (k_eeprom.read(base_addr + portgroup_config_field::DEMUX_TYPE) <= demux_type::FIFO) {
-            return static_cast<const demux_type>(k_eeprom.read(base_addr + portgroup_config_field::DEMUX_TYPE));
+        if (demux <= demux_type::FIFO) {
+            return static_cast<const demux_type>(demux);
         } else {
             return demux_type::RANDOM;
         }
     }
 
     const u8 archive_parser_v1::read_portgroup_chan(const u16 base_addr) const {
-        return k_eeprom.read(base_addr + portgroup_config_field::MIDI_CHANNEL);
+        return k_archive.read(base_addr + portgroup_config_field::MIDI_CHANNEL);
     }
 
     const u8 archive_parser_v1::read_portgroup_cc(const u16 base_addr) const {
-        return k_eeprom.read(base_addr + portgroup_config_field::CC_NUMBER);
+        return k_archive.read(base_addr + portgroup_config_field::CC_NUMBER);
     }
 
     const i8 archive_parser_v1::read_portgroup_transpose(const u16 base_addr) const {
-        auto transpose_value = k_eeprom.read(base_addr + portgroup_config_field::TRANSPOSE);
+        auto transpose_value = k_archive.read(base_addr + portgroup_config_field::TRANSPOSE);
         if (transpose_value >> 7) {
-            // if signage bit is set store as negative value
-            return (-1) * ((i8) (transpose_value & 0x7f));
+            // serialise() stores negative values in two's complement
+            return (i8) (transpose_value & 0x7f) - 0x80;
         } else {
             return transpose_value;
         }
     }
 
-    const std::vector<midi_message::message_type> archive_parser_v1::read_portgroup_msg_types(const u16 base_addr) const {
-        const u8 midi_input_count = k_eeprom.read(base_addr + portgroup_config_field::INPUT_TYPE_COUNT);
+    const input_type_list archive_parser_v1::read_portgroup_msg_types(const u16 base_addr) const {
+        const u8 midi_input_count = k_archive.read(base_addr + portgroup_config_field::INPUT_TYPE_COUNT);
 
-        std::vector<midi_message::message_type> msg_types;
-        msg_types.reserve(midi_input_count);
+        input_type_list msg_types;
 
-        for (u16 midi_input_field = base_addr + portgroup_config_field::FIRST_VARIABLE;
-            midi_input_field < (base_addr + portgroup_config_field::FIRST_VARIABLE + midi_input_count);
-            midi_input_field++) {
-            auto msg_type = k_eeprom.read(midi_input_field);
+        // the stored count is not trusted, stay inside the archive
+        const u32 first_input_field = (u32) base_addr + portgroup_config_field::FIRST_VARIABLE;
+        u32 end_input_field = first_input_field + midi_input_count;
+        if (end_input_field > m_archive_size) {
+            end_input_field = m_archive_size;
+        }
+        for (u32 midi_input_field = first_input_field; midi_input_field < end_input_field; midi_input_field++) {
+            auto msg_type = k_archive.read(midi_input_field);
             // message type value must be in range of enum type
-            if (msg_type > midi_message::STOP) {
+            if (msg_type < midi_message::NOTE_OFF
+                || (msg_type > midi_message::PITCH_BEND && msg_type != midi_message::CLOCK && msg_type < midi_message::START)
+                || msg_type > midi_message::STOP) {
                 continue;
             }
             msg_types.push_back(static_cast<midi_message::message_type>(msg_type));
@@ -399,11 +1046,10 @@ namespace midimagic {
         return msg_types;
     }
 
-    const std::vector<u8> archive_parser_v1::read_portgroup_ports(const u16 base_addr) const {
-        std::vector<u8> output_port_numbers;
-        output_port_numbers.reserve(8);
+    const port_number_list archive_parser_v1::read_portgroup_ports(const u16 base_addr) const {
+        port_number_list output_port_numbers;
 
-        u8 outport_bitfield = k_eeprom.read(base_addr + portgroup_config_field::OUTPUT_PORTS);
+        u8 outport_bitfield = k_archive.read(base_addr + portgroup_config_field::OUTPUT_PORTS);
         for (u8 outport = 0; outport < 8; outport++) {
             if (outport_bitfield & 0x80) {
                 output_port_numbers.push_back(outport);
@@ -413,8 +1059,36 @@ namespace midimagic {
         return output_port_numbers;
     }
 
-    archive_parser_v2::archive_parser_v2(microwire_eeprom& eeprom)
-        : archive_parser_v1(eeprom) {
+    const bool archive_parser_v1::read_portgroup_pressure_to_companion(const u16 base_addr) const {
+        return false;
+    }
+
+    const bool archive_parser_v1::read_portgroup_mpe(const u16 base_addr) const {
+        return false;
+    }
+
+    const u8 archive_parser_v1::read_portgroup_mpe_members(const u16 base_addr) const {
+        return 15;
+    }
+
+    const u8 archive_parser_v1::read_portgroup_mpe_timbre(const u16 base_addr) const {
+        return 0;
+    }
+
+    const u16 archive_parser_v1::read_portgroup_nrpn(const u16 base_addr) const {
+        return 0;
+    }
+
+    const arpeggiator::arp_mode archive_parser_v1::read_portgroup_arp_mode(const u16 base_addr) const {
+        return arpeggiator::arp_mode::OFF;
+    }
+
+    const u8 archive_parser_v1::read_portgroup_arp_division(const u16 base_addr) const {
+        return 6;
+    }
+
+    archive_parser_v2::archive_parser_v2(const byte_span& archive)
+        : archive_parser_v1(archive) {
         // nothing to do
     }
 
@@ -427,13 +1101,16 @@ namespace midimagic {
             .port_number {read_port_number(base_addr)},
             .clock_rate {read_port_clock_rate(base_addr)},
             .velocity_output {read_port_velocity(base_addr)},
-            .clock_mode {read_port_clock_mode(base_addr)}
+            .clock_mode {read_port_clock_mode(base_addr)},
+            .modulation {read_port_modulation(base_addr)},
+            .quantizer {read_port_quantizer(base_addr)},
+            .velocity_curve {read_port_velocity_curve(base_addr)}
         };
         return port_config;
     }
 
     const output_port::clock_mode archive_parser_v2::read_port_clock_mode(const u16 base_addr) const {
-        auto clock_mode = k_eeprom.read(base_addr + archive_parser_v2::port_config_field::CLOCK_MODE);
+        auto clock_mode = k_archive.read(base_addr + archive_parser_v2::port_config_field::CLOCK_MODE);
 
         if (clock_mode > output_port::clock_mode::SIGNAL_TRIGGER_STOP) {
             return output_port::clock_mode::SYNC;
@@ -441,4 +1118,299 @@ namespace midimagic {
             return static_cast<const output_port::clock_mode>(clock_mode);
         }
     }
+
+    archive_parser_v3::archive_parser_v3(const byte_span& archive)
+        : archive_parser_v2(archive) {
+        // nothing to do
+    }
+
+    archive_parser_v3::~archive_parser_v3() {
+        // nothing to do
+    }
+
+    const config_archive::operation_result archive_parser_v3::read_header() {
+        // get stored size
+        m_archive_size = k_archive.read_2byte(static_header_field::SIZE0);
+        if (m_archive_size < record_stream_field::FIRST_RECORD) {
+            return config_archive::operation_result::ARCHIVE_EMPTY;
+        }
+        if (m_archive_size > k_archive.size()) {
+            return config_archive::operation_result::SIZE_MISMATCH;
+        }
+
+        u16 record_addr = record_stream_field::FIRST_RECORD;
+        while (record_addr < m_archive_size) {
+            const u8 type = k_archive.read(record_addr++);
+            u16 payload_size;
+            if (!read_varint(record_addr, payload_size) || payload_size > m_archive_size - record_addr) {
+                // record runs out of the archive
+                return config_archive::operation_result::ILLEGAL_ADDRESS_ON_READ;
+            }
+            switch (type) {
+                case record_type::PORT_RECORD :
+                    if (payload_size < port_record_field::PORT_RECORD_SIZE) {
+                        return config_archive::operation_result::CORRUPT_HEADER;
+                    }
+                    // counts must fit the fixed capacity of the system config
+                    if (!m_port_config_addrs.push_back(record_addr)) {
+                        return config_archive::operation_result::CONFIG_TOO_BIG;
+                    }
+                    break;
+                case record_type::PORTGROUP_RECORD :
+                    if (payload_size < portgroup_record_field::PORTGROUP_RECORD_SIZE) {
+                        return config_archive::operation_result::CORRUPT_HEADER;
+                    }
+                    if (!m_portgroup_config_addrs.push_back(record_addr)) {
+                        return config_archive::operation_result::CONFIG_TOO_BIG;
+                    }
+                    m_portgroup_payload_sizes.push_back(payload_size);
+                    break;
+                case record_type::MODULATION_RECORD :
+                    if (payload_size < modulation_record_field::MODULATION_RECORD_SIZE) {
+                        return config_archive::operation_result::CORRUPT_HEADER;
+                    }
+                    if (!m_modulation_addrs.push_back(record_addr)) {
+                        return config_archive::operation_result::CONFIG_TOO_BIG;
+                    }
+                    break;
+                case record_type::QUANTIZER_RECORD :
+                    if (payload_size < quantizer_record_field::QUANTIZER_RECORD_SIZE) {
+                        return config_archive::operation_result::CORRUPT_HEADER;
+                    }
+                    if (!m_quantizer_addrs.push_back(record_addr)) {
+                        return config_archive::operation_result::CONFIG_TOO_BIG;
+                    }
+                    break;
+                case record_type::VELOCITY_RECORD :
+                    if (payload_size < velocity_record_field::VELOCITY_RECORD_SIZE) {
+                        return config_archive::operation_result::CORRUPT_HEADER;
+                    }
+                    if (!m_velocity_addrs.push_back(record_addr)) {
+                        return config_archive::operation_result::CONFIG_TOO_BIG;
+                    }
+                    break;
+                default :
+                    // record type of a later version, skip it
+                    break;
+            }
+            record_addr += payload_size;
+        }
+
+        if (m_port_config_addrs.empty() && m_portgroup_config_addrs.empty()) {
+            return config_archive::operation_result::CORRUPT_HEADER;
+        }
+        return config_archive::operation_result::SUCCESS;
+    }
+
+    const bool archive_parser_v3::read_varint(u16& addr, u16& value) const {
+        value = 0;
+        // at most 3 bytes for 16 bit
+        for (u8 shift = 0; shift < 21; shift += 7) {
+            if (addr >= m_archive_size) {
+                return false;
+            }
+            const u8 data = k_archive.read(addr++);
+            value |= (u16) (data & 0x7f) << shift;
+            if (!(data & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const u8 archive_parser_v3::read_port_number(const u16 base_addr) const {
+        return k_archive.read(base_addr + port_record_field::RECORD_PORT_NUMBER);
+    }
+
+    const u8 archive_parser_v3::read_port_clock_rate(const u16 base_addr) const {
+        return config_archive::unpack_clock_rate(k_archive.read(base_addr + port_record_field::RECORD_PORT_SETTINGS) & 0xf);
+    }
+
+    const bool archive_parser_v3::read_port_velocity(const u16 base_addr) const {
+        return k_archive.read(base_addr + port_record_field::RECORD_PORT_SETTINGS) >> 7;
+    }
+
+    const output_port::clock_mode archive_parser_v3::read_port_clock_mode(const u16 base_addr) const {
+        auto clock_mode = (k_archive.read(base_addr + port_record_field::RECORD_PORT_SETTINGS) >> 4) & 0x7;
+
+        if (clock_mode > output_port::clock_mode::SIGNAL_TRIGGER_STOP) {
+            return output_port::clock_mode::SYNC;
+        } else {
+            return static_cast<const output_port::clock_mode>(clock_mode);
+        }
+    }
+
+    const modulation_settings archive_parser_v3::read_port_modulation(const u16 base_addr) const {
+        modulation_settings settings;
+        const u8 port_number = read_port_number(base_addr);
+        for (auto &mod_addr: m_modulation_addrs) {
+            if (k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_PORT_NUMBER) != port_number) {
+                continue;
+            }
+            const u8 type_shape = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_TYPE_SHAPE);
+            // values must be in range of the enum types
+            if ((type_shape >> 4) < modulation_type::_MODULATION_TYPE_COUNT_) {
+                settings.type = static_cast<modulation_type>(type_shape >> 4);
+            }
+            if ((type_shape & 0xf) < lfo_shape::_LFO_SHAPE_COUNT_) {
+                settings.shape = static_cast<lfo_shape>(type_shape & 0xf);
+            }
+            settings.rate = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_RATE);
+            settings.sync_ticks = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_SYNC);
+            settings.depth = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_DEPTH) & 0x7f;
+            settings.attack = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_ATTACK);
+            settings.decay = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_DECAY);
+            settings.sustain = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_SUSTAIN) & 0x7f;
+            settings.release = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_RELEASE);
+            // the position is the id deserialise_portgroup() hands out
+            const u8 trigger_group = k_archive.read(mod_addr + modulation_record_field::RECORD_MOD_TRIGGER_GROUP);
+            if (trigger_group <= k_max_port_groups) {
+                settings.trigger_group = trigger_group;
+            }
+            break;
+        }
+        return settings;
+    }
+
+    const quantizer_settings archive_parser_v3::read_port_quantizer(const u16 base_addr) const {
+        quantizer_settings settings;
+        const u8 port_number = read_port_number(base_addr);
+        for (auto &quant_addr: m_quantizer_addrs) {
+            if (k_archive.read(quant_addr + quantizer_record_field::RECORD_QUANT_PORT_NUMBER) != port_number) {
+                continue;
+            }
+            const u8 scale = k_archive.read(quant_addr + quantizer_record_field::RECORD_QUANT_SCALE);
+            // scale type value must be in range of enum type
+            if ((scale & 0xf) < scale_type::_SCALE_TYPE_COUNT_) {
+                settings.scale = static_cast<scale_type>(scale & 0xf);
+            }
+            settings.trigger = scale & 0x80;
+            settings.root = k_archive.read(quant_addr + quantizer_record_field::RECORD_QUANT_ROOT) % 12;
+            settings.user_mask = k_archive.read_2byte(quant_addr + quantizer_record_field::RECORD_QUANT_MASK0) & 0xfff;
+            break;
+        }
+        return settings;
+    }
+
+    const velocity_settings archive_parser_v3::read_port_velocity_curve(const u16 base_addr) const {
+        velocity_settings settings;
+        const u8 port_number = read_port_number(base_addr);
+        for (auto &vel_addr: m_velocity_addrs) {
+            if (k_archive.read(vel_addr + velocity_record_field::RECORD_VEL_PORT_NUMBER) != port_number) {
+                continue;
+            }
+            const u8 curve = k_archive.read(vel_addr + velocity_record_field::RECORD_VEL_CURVE);
+            // curve type value must be in range of enum type
+            if (curve < curve_type::_CURVE_TYPE_COUNT_) {
+                settings.curve = static_cast<curve_type>(curve);
+            }
+            settings.fixed_level = k_archive.read(vel_addr + velocity_record_field::RECORD_VEL_FIXED_LEVEL) & 0x7f;
+            for (u8 point = 0; point < k_user_curve_points; point++) {
+                settings.user_points[point] = k_archive.read(vel_addr + velocity_record_field::RECORD_VEL_POINT0 + point) & 0x7f;
+            }
+            break;
+        }
+        return settings;
+    }
+
+    const demux_type archive_parser_v3::read_portgroup_demux(const u16 base_addr) const {
+        const u8 demux = (k_archive.read(base_addr + portgroup_record_field::RECORD_DEMUX_CHANNEL) >> 4) & 0x3;
+        // demux type value must be in range of enum type
+        if (demux <= demux_type::FIFO) {
+            return static_cast<const demux_type>(demux);
+        } else {
+            return demux_type::RANDOM;
+        }
+    }
+
+    const u8 archive_parser_v3::read_portgroup_chan(const u16 base_addr) const {
+        return (k_archive.read(base_addr + portgroup_record_field::RECORD_DEMUX_CHANNEL) & 0xf) + 1;
+    }
+
+    const u8 archive_parser_v3::read_portgroup_cc(const u16 base_addr) const {
+        return k_archive.read(base_addr + portgroup_record_field::RECORD_CC_NUMBER);
+    }
+
+    const i8 archive_parser_v3::read_portgroup_transpose(const u16 base_addr) const {
+        return (i8) k_archive.read(base_addr + portgroup_record_field::RECORD_TRANSPOSE);
+    }
+
+    const bool archive_parser_v3::read_portgroup_pressure_to_companion(const u16 base_addr) const {
+        return k_archive.read(base_addr + portgroup_record_field::RECORD_DEMUX_CHANNEL) & 0x80;
+    }
+
+    const bool archive_parser_v3::read_portgroup_mpe(const u16 base_addr) const {
+        return k_archive.read(base_addr + portgroup_record_field::RECORD_DEMUX_CHANNEL) & 0x40;
+    }
+
+    const u8 archive_parser_v3::read_portgroup_mpe_members(const u16 base_addr) const {
+        if (read_portgroup_payload_size(base_addr) >= portgroup_record_field::PORTGROUP_MPE_RECORD_SIZE) {
+            const u8 members = k_archive.read(base_addr + portgroup_record_field::RECORD_MPE_MEMBERS);
+            if (members >= 1 && members <= 15) {
+                return members;
+            }
+        }
+        return 15;
+    }
+
+    const u8 archive_parser_v3::read_portgroup_mpe_timbre(const u16 base_addr) const {
+        if (read_portgroup_payload_size(base_addr) >= portgroup_record_field::PORTGROUP_MPE_RECORD_SIZE) {
+            const u8 offset = k_archive.read(base_addr + portgroup_record_field::RECORD_MPE_TIMBRE);
+            // offset 4 is the companion taking the pressure
+            if ((offset < k_max_output_ports) && (offset != 4)) {
+                return offset;
+            }
+        }
+        return 0;
+    }
+
+    const u16 archive_parser_v3::read_portgroup_nrpn(const u16 base_addr) const {
+        if (read_portgroup_payload_size(base_addr) >= portgroup_record_field::PORTGROUP_NRPN_RECORD_SIZE) {
+            return k_archive.read_2byte(base_addr + portgroup_record_field::RECORD_NRPN0) & 0x3fff;
+        }
+        return 0;
+    }
+
+    const arpeggiator::arp_mode archive_parser_v3::read_portgroup_arp_mode(const u16 base_addr) const {
+        if (read_portgroup_payload_size(base_addr) >= portgroup_record_field::PORTGROUP_ARP_RECORD_SIZE) {
+            const u8 mode = k_archive.read(base_addr + portgroup_record_field::RECORD_ARP_MODE);
+            if (mode < arpeggiator::arp_mode::_MODE_COUNT_) {
+                return (arpeggiator::arp_mode) mode;
+            }
+        }
+        return arpeggiator::arp_mode::OFF;
+    }
+
+    const u8 archive_parser_v3::read_portgroup_arp_division(const u16 base_addr) const {
+        if (read_portgroup_payload_size(base_addr) >= portgroup_record_field::PORTGROUP_ARP_RECORD_SIZE) {
+            return k_archive.read(base_addr + portgroup_record_field::RECORD_ARP_DIVISION);
+        }
+        return 6;
+    }
+
+    const u16 archive_parser_v3::read_portgroup_payload_size(const u16 base_addr) const {
+        for (u8 i = 0; i < m_portgroup_config_addrs.size(); i++) {
+            if (m_portgroup_config_addrs[i] == base_addr) {
+                return m_portgroup_payload_sizes[i];
+            }
+        }
+        return 0;
+    }
+
+    const input_type_list archive_parser_v3::read_portgroup_msg_types(const u16 base_addr) const {
+        return config_archive::unpack_input_types(k_archive.read_2byte(base_addr + portgroup_record_field::RECORD_INPUT_TYPES0));
+    }
+
+    const port_number_list archive_parser_v3::read_portgroup_ports(const u16 base_addr) const {
+        port_number_list output_port_numbers;
+
+        u8 outport_bitfield = k_archive.read(base_addr + portgroup_record_field::RECORD_OUTPUT_PORTS);
+        for (u8 outport = 0; outport < 8; outport++) {
+            if (outport_bitfield & 0x80) {
+                output_port_numbers.push_back(outport);
+            }
+            outport_bitfield <<= 1;
+        }
+        return output_port_numbers;
+    }
 } // namespace midimagic
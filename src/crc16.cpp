@@ -0,0 +1,54 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "crc16.h"
+
+namespace midimagic {
+    // remainders for a single nibble, two lookups per byte keep the table at 32 bytes
+    static const u16 crc16_nibble_table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+        0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+    };
+
+    crc16::crc16()
+        : m_crc(0xffff) {
+        // nothing to do
+    }
+
+    crc16::~crc16() {
+        // nothing to do
+    }
+
+    void crc16::update(const u8 data) {
+        m_crc = (m_crc << 4) ^ crc16_nibble_table[(m_crc >> 12) ^ (data >> 4)];
+        m_crc = (m_crc << 4) ^ crc16_nibble_table[(m_crc >> 12) ^ (data & 0x0f)];
+    }
+
+    void crc16::update(const u8* data, const u16 length) {
+        for (u16 i = 0; i < length; i++) {
+            update(data[i]);
+        }
+    }
+
+    const u16 crc16::value() const {
+        return m_crc;
+    }
+} // namespace midimagic
@@ -0,0 +1,85 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "dispatch_profiler.h"
+
+namespace midimagic {
+    dispatch_profiler::dispatch_profiler()
+        : m_slots{} {
+        const midi_message::message_type slot_types[type_slot::_SLOT_COUNT_] = {
+            midi_message::NOTE_OFF,
+            midi_message::NOTE_ON,
+            midi_message::POLY_KEY_PRESSURE,
+            midi_message::CONTROL_CHANGE,
+            midi_message::PROGRAM_CHANGE,
+            midi_message::CHANNEL_PRESSURE,
+            midi_message::PITCH_BEND,
+            midi_message::CLOCK,
+            midi_message::START,
+            midi_message::CONTINUE,
+            midi_message::STOP
+        };
+        for (u8 slot = 0; slot < type_slot::_SLOT_COUNT_; slot++) {
+            m_slots[slot].type = slot_types[slot];
+        }
+#ifdef DWT
+        // the cycle counter runs without a debugger attached once trace is enabled
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    }
+
+    dispatch_profiler::~dispatch_profiler() {
+        // nothing to do
+    }
+
+    void dispatch_profiler::set_shape(const midi_message::message_type type, const u8 groups, const u8 routed_groups) {
+        worst_case& slot = m_slots[type2slot(type)];
+        slot.groups = groups;
+        slot.routed_groups = routed_groups;
+    }
+
+    const u8 dispatch_profiler::top_offenders(worst_case* out, const u8 max_count) const {
+        u8 count = 0;
+        for (auto &slot: m_slots) {
+            if (!slot.count) {
+                continue;
+            }
+            // insertion into the sorted output, drops the shortest on overflow
+            u8 position = count;
+            while (position && out[position - 1].cycles < slot.cycles) {
+                if (position < max_count) {
+                    out[position] = out[position - 1];
+                }
+                position--;
+            }
+            if (position < max_count) {
+                out[position] = slot;
+                if (count < max_count) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
+} // namespace midimagic
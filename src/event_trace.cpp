@@ -0,0 +1,109 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "event_trace.h"
+
+namespace midimagic {
+#ifdef MIDIMAGIC_EVENT_TRACE
+    event_trace::trace_record event_trace::s_ring[k_records];
+    u32 event_trace::s_head = 0;
+    u16 event_trace::s_post_trigger = 0;
+    volatile bool event_trace::s_frozen = false;
+    u32 event_trace::s_slow_dispatch_cycles = UINT32_MAX;
+    u16 event_trace::s_cycles_per_us = 1;
+#endif
+
+    void event_trace::begin() {
+#ifdef MIDIMAGIC_EVENT_TRACE
+#ifdef DWT
+        s_cycles_per_us = SystemCoreClock / 1000000;
+#else
+        // host builds count nanoseconds
+        s_cycles_per_us = 1000;
+#endif
+        s_slow_dispatch_cycles = MIDIMAGIC_EVENT_TRACE_SLOW_US * s_cycles_per_us;
+#endif
+    }
+
+    void event_trace::trigger(const trigger_reason reason, const u16 detail) {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        irq_guard guard;
+        if (s_frozen) {
+            return;
+        }
+        // a trigger while the ring fills up only shows in the trace
+        const bool armed = s_post_trigger;
+        record(event::TRIGGER, reason, detail);
+        if (!armed) {
+            s_post_trigger = k_post_trigger_records;
+        }
+#endif
+    }
+
+    void event_trace::freeze() {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        s_frozen = true;
+#endif
+    }
+
+    void event_trace::release() {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        irq_guard guard;
+        s_head = 0;
+        s_post_trigger = 0;
+        s_frozen = false;
+#endif
+    }
+
+    const bool event_trace::is_frozen() {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        return s_frozen;
+#else
+        return false;
+#endif
+    }
+
+    const u16 event_trace::get_cycles_per_us() {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        return s_cycles_per_us;
+#else
+        return 0;
+#endif
+    }
+
+    const u16 event_trace::get_record_count() {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        return (s_head < k_records) ? s_head : k_records;
+#else
+        return 0;
+#endif
+    }
+
+    const event_trace::trace_record event_trace::read(const u16 index) {
+#ifdef MIDIMAGIC_EVENT_TRACE
+        // the oldest record is overwritten next
+        const u32 oldest = (s_head < k_records) ? 0 : s_head;
+        return s_ring[(oldest + index) & (k_records - 1)];
+#else
+        return trace_record {0, event::TRIGGER, 0, 0};
+#endif
+    }
+} // namespace midimagic
@@ -0,0 +1,128 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+#include "heap_monitor.h"
+#include <malloc.h>
+#include "event_trace.h"
+
+namespace midimagic {
+    volatile u32 heap_monitor::s_allocations = 0;
+    volatile u32 heap_monitor::s_frees = 0;
+    volatile u32 heap_monitor::s_live_blocks = 0;
+    volatile u32 heap_monitor::s_peak_live_blocks = 0;
+    volatile u32 heap_monitor::s_runtime_allocations = 0;
+    volatile u8 heap_monitor::s_realtime_depth = 0;
+    volatile bool heap_monitor::s_boot_complete = false;
+
+    void heap_monitor::mark_boot_complete() {
+        s_boot_complete = true;
+    }
+
+    const bool heap_monitor::boot_complete() {
+        return s_boot_complete;
+    }
+
+    const heap_monitor::heap_stats heap_monitor::get_stats() {
+        // mallinfo walks the free list, keep it out of the allocation path
+        struct mallinfo info = mallinfo();
+        const heap_stats stats {
+            .allocations {s_allocations},
+            .frees {s_frees},
+            .live_blocks {s_live_blocks},
+            .peak_live_blocks {s_peak_live_blocks},
+            .runtime_allocations {s_runtime_allocations},
+            .heap_high_water {static_cast<u32>(info.arena)},
+            .heap_in_use {static_cast<u32>(info.uordblks)},
+            .free_bytes {static_cast<u32>(info.fordblks)},
+            .free_blocks {static_cast<u32>(info.ordblks)}
+        };
+        return stats;
+    }
+
+    heap_monitor::realtime_section::realtime_section() {
+        s_realtime_depth++;
+    }
+
+    heap_monitor::realtime_section::~realtime_section() {
+        s_realtime_depth--;
+    }
+
+    void heap_monitor::count_allocation(const void* block) {
+        s_allocations++;
+        if (s_boot_complete && s_realtime_depth) {
+#ifdef MIDIMAGIC_TRAP_RUNTIME_ALLOC
+            __builtin_trap();
+#endif
+            s_runtime_allocations++;
+            event_trace::trigger(event_trace::trigger_reason::RUNTIME_ALLOCATION, 0);
+        }
+        if (block) {
+            s_live_blocks++;
+            if (s_live_blocks > s_peak_live_blocks) {
+                s_peak_live_blocks = s_live_blocks;
+            }
+        }
+    }
+
+    void heap_monitor::count_free(const void* block) {
+        if (block) {
+            s_frees++;
+            s_live_blocks--;
+        }
+    }
+} // namespace midimagic
+
+// Allocator hooks, the linker redirects all malloc/free calls here
+// (see build_flags in platformio.ini)
+extern "C" {
+    void* __real_malloc(size_t size);
+    void __real_free(void* block);
+    void* __real_realloc(void* block, size_t size);
+    void* __real_calloc(size_t count, size_t size);
+
+    void* __wrap_malloc(size_t size) {
+        void* block = __real_malloc(size);
+        midimagic::heap_monitor::count_allocation(block);
+        return block;
+    }
+
+    void __wrap_free(void* block) {
+        midimagic::heap_monitor::count_free(block);
+        __real_free(block);
+    }
+
+    void* __wrap_realloc(void* block, size_t size) {
+        void* new_block = __real_realloc(block, size);
+        if (size) {
+            midimagic::heap_monitor::count_allocation(new_block);
+        }
+        if (new_block || !size) {
+            // the old block is released unless the reallocation failed
+            midimagic::heap_monitor::count_free(block);
+        }
+        return new_block;
+    }
+
+    void* __wrap_calloc(size_t count, size_t size) {
+        void* block = __real_calloc(count, size);
+        midimagic::heap_monitor::count_allocation(block);
+        return block;
+    }
+}
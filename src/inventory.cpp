@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022-2024 Adrian Krause                                          *
+ * Copyright 2022-2024, 2026 Adrian Krause                                   *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -25,23 +25,50 @@ namespace midimagic {
     inventory::inventory(std::shared_ptr<group_dispatcher> gd,
                         std::shared_ptr<menu_action_queue> menu_q,
                         ad57x4 &dac0,
-                        ad57x4 &dac1)
+                        ad57x4 &dac1,
+                        eeprom_device &eeprom)
         : m_group_dispatcher(gd)
         , m_menu_q(menu_q)
         , m_dac0(dac0)
-        , m_dac1(dac1) {
-        // nothing to do
+        , m_dac1(dac1)
+        , m_eeprom(eeprom)
+        , m_storage_stats{0, 0, config_archive::operation_result::NO_ARCHIVE_FOUND,
+                          0, 0, 0, config_archive::operation_result::SUCCESS}
+        , m_control_channel(0)
+        , m_preset_stats{0, 0, 0}
+        , m_reconfig_stats{0, 0, 0, 0, 0, 0}
+        , m_save_restart(false)
+        , m_save_start(0)
+        , m_storage_locked(false) {
+        spawn_all_ports();
+        for (auto &port_configs: m_preset_ports) {
+            port_configs = gather_port_state();
+        }
     }
 
     inventory::inventory(std::shared_ptr<group_dispatcher> gd,
                         std::shared_ptr<menu_action_queue> menu_q,
                         ad57x4 &dac0,
                         ad57x4 &dac1,
+                        eeprom_device &eeprom,
                         const struct system_config& init_config)
         : m_group_dispatcher(gd)
         , m_menu_q(menu_q)
         , m_dac0(dac0)
-        , m_dac1(dac1) {
+        , m_dac1(dac1)
+        , m_eeprom(eeprom)
+        , m_storage_stats{0, 0, config_archive::operation_result::NO_ARCHIVE_FOUND,
+                          0, 0, 0, config_archive::operation_result::SUCCESS}
+        , m_control_channel(0)
+        , m_preset_stats{0, 0, 0}
+        , m_reconfig_stats{0, 0, 0, 0, 0, 0}
+        , m_save_restart(false)
+        , m_save_start(0)
+        , m_storage_locked(false) {
+        spawn_all_ports();
+        for (auto &port_configs: m_preset_ports) {
+            port_configs = gather_port_state();
+        }
         apply_config(init_config);
     }
 
@@ -68,77 +95,456 @@ namespace midimagic {
     }
 
     void inventory::apply_config(const struct system_config& new_config) {
-
-        flush();
-        // overwrite old system_config with new_config
+        const u32 apply_start = micros();
+        mark_config_changed();
         m_system_config = sanitise_config(new_config);
-        // setup output ports
-        std::shared_ptr<output_port> system_port;
+        m_reconfig_stats.groups_kept = 0;
+        m_reconfig_stats.groups_changed = 0;
+        m_reconfig_stats.groups_created = 0;
+        m_reconfig_stats.groups_removed = 0;
+        m_reconfig_stats.ports_changed = 0;
+
+        // Diff the port groups: groups already matching a config are left
+        // alone, the remaining ones are paired up with the remaining configs
+        // in order and changed in place. Leftover groups are removed,
+        // leftover configs get new groups.
+        auto& port_groups = m_group_dispatcher->get_port_groups();
+        bool group_claimed[k_max_port_groups] = {};
+        bool config_applied[k_max_port_groups] = {};
+        // id of the group applying each config
+        u8 group_ids[k_max_port_groups] = {};
+        const u8 config_count = m_system_config.system_port_groups.size();
+        for (u8 c = 0; c < config_count; c++) {
+            for (u8 g = 0; g < port_groups.size(); g++) {
+                if (!group_claimed[g] && port_group_matches(*port_groups[g], m_system_config.system_port_groups[c])) {
+                    group_claimed[g] = true;
+                    config_applied[c] = true;
+                    group_ids[c] = port_groups[g]->get_id();
+                    m_reconfig_stats.groups_kept++;
+                    break;
+                }
+            }
+        }
+        for (u8 c = 0; c < config_count; c++) {
+            if (config_applied[c]) {
+                continue;
+            }
+            for (u8 g = 0; g < port_groups.size(); g++) {
+                if (!group_claimed[g]) {
+                    update_port_group(*port_groups[g], m_system_config.system_port_groups[c]);
+                    group_claimed[g] = true;
+                    config_applied[c] = true;
+                    group_ids[c] = port_groups[g]->get_id();
+                    m_reconfig_stats.groups_changed++;
+                    break;
+                }
+            }
+        }
+
+        // removing shifts the list, collect the ids first
+        u8 removed_ids[k_max_port_groups];
+        u8 removed_count = 0;
+        for (u8 g = 0; g < port_groups.size(); g++) {
+            if (!group_claimed[g]) {
+                // no note may hang on the ports of a removed group
+                port_groups[g]->release_notes();
+                removed_ids[removed_count++] = port_groups[g]->get_id();
+            }
+        }
+        for (u8 r = 0; r < removed_count; r++) {
+            m_group_dispatcher->remove_port_group(removed_ids[r]);
+            m_reconfig_stats.groups_removed++;
+        }
+
+        for (u8 c = 0; c < config_count; c++) {
+            if (!config_applied[c]) {
+                group_ids[c] = spawn_port_group(m_system_config.system_port_groups.begin() + c);
+            }
+        }
+        m_reconfig_stats.groups_created = port_groups.size() - m_reconfig_stats.groups_kept - m_reconfig_stats.groups_changed;
+
+        // setup output ports once the groups exist, settings are only written if they differ so clock counters keep running
         for (auto &port_config: m_system_config.system_ports) {
-            system_port = get_output_port(port_config.port_number);
-            system_port->set_clock_rate(port_config.clock_rate);
+            auto system_port = get_output_port(port_config.port_number);
+            bool port_changed = false;
+            if (system_port->get_clock_rate() != port_config.clock_rate) {
+                system_port->set_clock_rate(port_config.clock_rate);
+                port_changed = true;
+            }
             if (system_port->get_velocity_switch() != port_config.velocity_output) {
                 system_port->set_velocity_switch();
+                port_changed = true;
+            }
+            if (system_port->get_clock_mode() != port_config.clock_mode) {
+                system_port->set_clock_mode(port_config.clock_mode);
+                port_changed = true;
+            }
+            if (system_port->get_velocity_curve() != port_config.velocity_curve) {
+                system_port->set_velocity_curve(port_config.velocity_curve);
+                port_changed = true;
+            }
+            if (system_port->get_quantizer() != port_config.quantizer) {
+                system_port->set_quantizer(port_config.quantizer);
+                port_changed = true;
+            }
+            // the envelope trigger names a group of the config, the engine needs the id of the group built for it
+            modulation_settings modulation_config = port_config.modulation;
+            modulation_config.trigger_group = runtime_group_id(modulation_config.trigger_group, group_ids);
+            auto& modulation = m_group_dispatcher->get_modulation();
+            if (modulation.get_settings(port_config.port_number) != modulation_config) {
+                modulation.configure(port_config.port_number, modulation_config);
+                port_changed = true;
+            }
+            if (port_changed) {
+                m_reconfig_stats.ports_changed++;
             }
-            system_port->set_clock_mode(port_config.clock_mode);
         }
-        // setup port groups
-        for (auto &pg_config: m_system_config.system_port_groups) {
-            u8 new_pg_id = spawn_port_group(config_pg_it_by_id(pg_config.id));
+        m_reconfig_stats.last_apply_us = micros() - apply_start;
+    }
+
+    void inventory::apply_presets(const struct preset_config& new_presets) {
+        const u8 active_preset = m_group_dispatcher->get_active_preset();
+        // build the port groups of every preset up front, switching only exchanges them later;
+        // the groups of every preset are diffed against the new config, unchanged groups keep their notes
+        for (u8 preset = 0; preset < k_max_presets; preset++) {
+            activate_preset(preset);
+            if (preset < new_presets.presets.size()) {
+                apply_config(new_presets.presets.at(preset));
+            } else {
+                apply_config(system_config());
+            }
+            m_preset_ports[preset] = gather_port_state();
         }
+        m_control_channel = new_presets.control_channel;
+        if (new_presets.active_preset != active_preset) {
+            // notes of the preset switched away from must not hang
+            activate_preset(active_preset);
+            m_group_dispatcher->release_notes();
+        }
+        activate_preset(new_presets.active_preset);
     }
 
     config_archive::operation_result inventory::load_config_from_eeprom() {
-        config_archive eeprom_config;
-        config_archive::operation_result load_result = eeprom_config.loadon();
+        if (m_storage_locked) {
+            return config_archive::operation_result::WRITE_IN_PROGRESS;
+        }
+        // the eeprom can't be read during a program cycle, the loaded state replaces the saved one anyway
+        cancel_save();
+        // all presets together are too big for the stack
+        auto eeprom_config = std::make_unique<config_archive>(m_eeprom);
+        const u32 load_start = micros();
+        config_archive::operation_result load_result = eeprom_config->loadon();
+        m_storage_stats.last_load_us = micros() - load_start;
+        m_storage_stats.last_load_result = load_result;
         if (load_result == config_archive::operation_result::SUCCESS) {
-            apply_config(eeprom_config.spellout());
+            m_storage_stats.last_load_bytes = eeprom_config->get_archive_size();
+            apply_presets(eeprom_config->spellout());
         }
         return load_result;
     }
 
     config_archive::operation_result inventory::save_system_state() {
-        auto system_state = gather_system_state();
-        config_archive new_eeprom_config(*system_state);
-        return new_eeprom_config.writeout();
+        m_save_start = micros();
+        if (m_storage_locked) {
+            // shown by the save view like a cancelled save
+            m_storage_stats.last_save_result = config_archive::operation_result::WRITE_IN_PROGRESS;
+            return m_storage_stats.last_save_result;
+        }
+        if (m_pending_save) {
+            // saving again while a save runs takes the current state
+            mark_config_changed();
+            return config_archive::operation_result::WRITE_IN_PROGRESS;
+        }
+        // all presets together are too big for the stack
+        m_pending_save = std::make_unique<config_archive>(m_eeprom);
+        begin_save();
+        return m_storage_stats.last_save_result;
+    }
+
+    void inventory::run_save_step() {
+        if (!m_pending_save) {
+            return;
+        }
+        if (m_save_restart) {
+            // the target slot only becomes valid with its sequence number written last,
+            // dropping the commit after any finished byte is safe
+            if (!m_pending_save->abort_writeout()) {
+                return;
+            }
+            begin_save();
+            return;
+        }
+        auto result = m_pending_save->writeout_step();
+        if (result != config_archive::operation_result::WRITE_IN_PROGRESS) {
+            finish_save(result);
+        }
+    }
+
+    const bool inventory::is_saving() const {
+        return static_cast<bool>(m_pending_save);
+    }
+
+    const u8 inventory::get_save_progress() const {
+        if (!m_pending_save) {
+            return 100;
+        }
+        return m_pending_save->get_writeout_progress();
+    }
+
+    void inventory::cancel_save() {
+        if (!m_pending_save) {
+            return;
+        }
+        while (!m_pending_save->abort_writeout()) {
+            // at most one program cycle
+        }
+        finish_save(config_archive::operation_result::WRITE_IN_PROGRESS);
+    }
+
+    const bool inventory::lock_storage() {
+        if (m_pending_save || m_storage_locked) {
+            return false;
+        }
+        m_storage_locked = true;
+        return true;
+    }
+
+    void inventory::unlock_storage() {
+        m_storage_locked = false;
     }
 
-    void inventory::flush() {
-        auto& pg_vector = m_group_dispatcher->get_port_groups();
-        while (!pg_vector.empty()) {
-            m_group_dispatcher->remove_port_group((pg_vector.back())->get_id());
+    void inventory::mark_config_changed() {
+        if (m_pending_save) {
+            m_save_restart = true;
         }
-        m_system_config.system_port_groups.clear();
     }
 
-    std::unique_ptr<const struct system_config> inventory::gather_system_state() const {
+    void inventory::begin_save() {
+        m_save_restart = false;
+        gather_presets(m_pending_save->get_presets());
+        auto result = m_pending_save->begin_writeout();
+        m_storage_stats.last_save_result = result;
+        if (result != config_archive::operation_result::WRITE_IN_PROGRESS) {
+            finish_save(result);
+        }
+    }
+
+    void inventory::finish_save(const config_archive::operation_result result) {
+        m_storage_stats.last_save_us = micros() - m_save_start;
+        m_storage_stats.last_save_written = m_pending_save->get_bytes_written();
+        m_storage_stats.last_save_skipped = m_pending_save->get_bytes_skipped();
+        m_storage_stats.last_save_result = result;
+        m_pending_save.reset();
+        m_save_restart = false;
+    }
+
+    const inventory::storage_stats& inventory::get_storage_stats() const {
+        return m_storage_stats;
+    }
+
+    void inventory::select_preset(const u8 preset) {
+        if (preset >= k_max_presets || preset == m_group_dispatcher->get_active_preset()) {
+            return;
+        }
+        const u32 switch_start = micros();
+        mark_config_changed();
+        // no note may hang on a port the new preset does not drive
+        m_group_dispatcher->release_notes();
+        activate_preset(preset);
+        m_preset_stats.last_switch_us = micros() - switch_start;
+        if (m_preset_stats.last_switch_us > m_preset_stats.max_switch_us) {
+            m_preset_stats.max_switch_us = m_preset_stats.last_switch_us;
+        }
+        m_preset_stats.switch_count++;
+        // views may refer to port groups of the old preset
+        menu_action a(menu_action::kind::PRESET_CHANGE, menu_action::subkind::NO_SUB, preset);
+        m_menu_q->add_menu_action(a);
+    }
+
+    const u8 inventory::get_active_preset() const {
+        return m_group_dispatcher->get_active_preset();
+    }
+
+    void inventory::copy_preset(const u8 preset) {
+        const u8 active_preset = m_group_dispatcher->get_active_preset();
+        if (preset >= k_max_presets || preset == active_preset) {
+            return;
+        }
+        const struct system_config active_config = gather_system_state();
+        activate_preset(preset);
+        apply_config(active_config);
+        m_preset_ports[preset] = gather_port_state();
+        activate_preset(active_preset);
+    }
+
+    void inventory::set_control_channel(const u8 channel) {
+        mark_config_changed();
+        m_control_channel = (channel > 16) ? 0 : channel;
+    }
+
+    const u8 inventory::get_control_channel() const {
+        return m_control_channel;
+    }
+
+    const bool inventory::handle_program_change(const u8 channel, const u8 program) {
+        if (!m_control_channel || channel != m_control_channel) {
+            return false;
+        }
+        // programs beyond the preset count are ignored on the control channel
+        select_preset(program);
+        return true;
+    }
+
+    const inventory::reconfig_stats& inventory::get_reconfig_stats() const {
+        return m_reconfig_stats;
+    }
+
+    const inventory::preset_stats& inventory::get_preset_stats() const {
+        return m_preset_stats;
+    }
+
+    void inventory::activate_preset(const u8 preset) {
+        if (preset >= k_max_presets) {
+            return;
+        }
+        m_preset_ports[m_group_dispatcher->get_active_preset()] = gather_port_state();
+        m_group_dispatcher->select_preset(preset);
+        apply_port_configs(m_preset_ports[preset]);
+    }
+
+    void inventory::apply_port_configs(const port_config_list& port_configs) {
+        for (auto &port_config: port_configs) {
+            for (auto &system_port: m_system_ports) {
+                if (system_port->get_port_number() != port_config.port_number) {
+                    continue;
+                }
+                system_port->set_clock_rate(port_config.clock_rate);
+                if (system_port->get_velocity_switch() != port_config.velocity_output) {
+                    system_port->set_velocity_switch();
+                }
+                system_port->set_clock_mode(port_config.clock_mode);
+                system_port->set_quantizer(port_config.quantizer);
+                system_port->set_velocity_curve(port_config.velocity_curve);
+                m_group_dispatcher->get_modulation().configure(port_config.port_number, port_config.modulation);
+            }
+        }
+    }
+
+    const bool inventory::port_group_matches(const port_group& pg, const struct port_group_config& config) const {
+        if (pg.get_demux().get_type() != config.demux
+            || pg.get_midi_channel() != config.midi_channel
+            || pg.get_cc() != port_group::normalise_cc(config.cont_controller_number)
+            || pg.get_transpose() != config.transpose_offset
+            || pg.get_pressure_to_companion() != config.pressure_to_companion
+            || pg.get_mpe() != config.mpe
+            || pg.get_mpe_members() != config.mpe_members
+            || pg.get_mpe_timbre() != config.mpe_timbre
+            || pg.get_nrpn() != config.nrpn_number
+            || pg.get_arp_mode() != config.arp_mode
+            || pg.get_arp_division() != config.arp_division) {
+            return false;
+        }
+        // input types and ports in any order
+        if (pg.get_msg_types().size() != config.input_types.size()) {
+            return false;
+        }
+        for (auto &msg_type: config.input_types) {
+            if (!pg.has_msg_type(msg_type)) {
+                return false;
+            }
+        }
+        auto& ports = pg.get_demux().get_output();
+        if (ports.size() != config.output_port_numbers.size()) {
+            return false;
+        }
+        for (auto &port_number: config.output_port_numbers) {
+            bool found = false;
+            for (auto &port: ports) {
+                if (port->get_port_number() == port_number) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void inventory::update_port_group(port_group& pg, const struct port_group_config& config) {
+        // a changed channel, transpose, input or demux would strand held notes without their Note Off
+        pg.release_notes();
+        if (pg.get_demux().get_type() != config.demux) {
+            pg.set_demux(config.demux);
+        }
+        pg.set_midi_channel(config.midi_channel);
+        pg.set_cc(config.cont_controller_number);
+        pg.set_transpose(config.transpose_offset);
+        pg.set_pressure_to_companion(config.pressure_to_companion);
+        pg.set_mpe(config.mpe);
+        pg.set_mpe_members(config.mpe_members);
+        pg.set_mpe_timbre(config.mpe_timbre);
+        pg.set_nrpn(config.nrpn_number);
+        pg.set_arp_mode(config.arp_mode);
+        pg.set_arp_division(config.arp_division);
+
+        // copy, the list shrinks while removing
+        const input_type_list current_types = pg.get_msg_types();
+        for (auto &msg_type: current_types) {
+            pg.remove_msg_type(msg_type);
+        }
+        for (auto &msg_type: config.input_types) {
+            pg.add_midi_input(msg_type);
+        }
+
+        const output_port_list current_ports = pg.get_demux().get_output();
+        for (auto &port: current_ports) {
+            pg.remove_port(port->get_port_number());
+        }
+        for (auto &port_number: config.output_port_numbers) {
+            for (auto &system_port: m_system_ports) {
+                if (system_port->get_port_number() == port_number) {
+                    pg.add_port(system_port);
+                }
+            }
+        }
+    }
+
+    const struct system_config inventory::gather_system_state() const {
+        return gather_preset_state(m_group_dispatcher->get_active_preset());
+    }
+
+    const struct system_config inventory::gather_preset_state(const u8 preset) const {
         struct system_config current_state;
 
-        // generate output_port_configs
-        for (auto& port: m_system_ports) {
-            const struct output_port_config current_port {
-                .port_number {port->get_port_number()},
-                .clock_rate {port->get_clock_rate()},
-                .velocity_output {port->get_velocity_switch()},
-                .clock_mode {port->get_clock_mode()}
-            };
-            current_state.system_ports.push_back(std::move(current_port));
+        // generate output_port_configs, parked presets keep theirs in m_preset_ports
+        if (preset == m_group_dispatcher->get_active_preset()) {
+            current_state.system_ports = gather_port_state();
+        } else {
+            current_state.system_ports = m_preset_ports[preset];
         }
 
         // generate port_group_configs
-        auto& port_groups = m_group_dispatcher->get_port_groups();
+        auto& port_groups = m_group_dispatcher->get_preset_port_groups(preset);
         for (auto& port_group: port_groups) {
             struct port_group_config current_pg {
             .id {port_group->get_id()},
             .demux {port_group->get_demux().get_type()},
             .midi_channel {port_group->get_midi_channel()},
             .cont_controller_number {port_group->get_cc()},
-            .transpose_offset {port_group->get_transpose()}
+            .transpose_offset {port_group->get_transpose()},
+            .pressure_to_companion {port_group->get_pressure_to_companion()},
+            .mpe {port_group->get_mpe()},
+            .mpe_members {port_group->get_mpe_members()},
+            .mpe_timbre {port_group->get_mpe_timbre()},
+            .nrpn_number {port_group->get_nrpn()},
+            .arp_mode {port_group->get_arp_mode()},
+            .arp_division {port_group->get_arp_division()}
             };
 
-            // the message input types vector can just be copied
-            current_pg.input_types.reserve(port_group->get_msg_types().size());
-            std::copy(port_group->get_msg_types().begin(), port_group->get_msg_types().end(), std::back_inserter(current_pg.input_types));
+            // the message input types list can just be copied
+            current_pg.input_types = port_group->get_msg_types();
 
             // the output_port ids must be read out of the objects directly
             auto& ports_vector = port_group->get_demux().get_output();
@@ -149,7 +555,33 @@ namespace midimagic {
             current_state.system_port_groups.push_back(std::move(current_pg));
         }
 
-        return std::make_unique<const struct system_config>(current_state);
+        return current_state;
+    }
+
+    const port_config_list inventory::gather_port_state() const {
+        port_config_list port_configs;
+        for (auto& port: m_system_ports) {
+            const struct output_port_config current_port {
+                .port_number {port->get_port_number()},
+                .clock_rate {port->get_clock_rate()},
+                .velocity_output {port->get_velocity_switch()},
+                .clock_mode {port->get_clock_mode()},
+                .modulation {m_group_dispatcher->get_modulation().get_settings(port->get_port_number())},
+                .quantizer {port->get_quantizer()},
+                .velocity_curve {port->get_velocity_curve()}
+            };
+            port_configs.push_back(std::move(current_port));
+        }
+        return port_configs;
+    }
+
+    void inventory::gather_presets(struct preset_config& presets) const {
+        presets.control_channel = m_control_channel;
+        presets.active_preset = m_group_dispatcher->get_active_preset();
+        presets.presets.clear();
+        for (u8 preset = 0; preset < k_max_presets; preset++) {
+            presets.presets.push_back(gather_preset_state(preset));
+        }
     }
 
     void inventory::spawn_port(const u8 config_port_number) {
@@ -173,13 +605,36 @@ namespace midimagic {
         }
     }
 
-    const u8 inventory::spawn_port_group(std::vector<struct port_group_config>::iterator config_pg_it) {
-        m_group_dispatcher->add_port_group(config_pg_it->demux, config_pg_it->midi_channel);
+    void inventory::spawn_all_ports() {
+        // all ports exist from boot on so no allocation happens at runtime
+        for (u8 port_number = 0; port_number < k_max_output_ports; port_number++) {
+            if (!port_exists(port_number)) {
+                spawn_port(port_number);
+            }
+        }
+        // ports n and n + 4 share the DAC channel number on the two DACs and are companions
+        for (auto &port: m_system_ports) {
+            port->set_companion(get_output_port(port->get_port_number() ^ 4).get());
+            m_group_dispatcher->get_modulation().bind_port(port->get_port_number(), port.get());
+        }
+    }
+
+    const u8 inventory::spawn_port_group(port_group_config_list::iterator config_pg_it) {
+        if (!m_group_dispatcher->add_port_group(config_pg_it->demux, config_pg_it->midi_channel)) {
+            return 0;
+        }
         auto& new_pg = (m_group_dispatcher->get_port_groups()).back();
         // set cc number
         new_pg->set_cc(config_pg_it->cont_controller_number);
         // set transpose
         new_pg->set_transpose(config_pg_it->transpose_offset);
+        new_pg->set_pressure_to_companion(config_pg_it->pressure_to_companion);
+        new_pg->set_mpe(config_pg_it->mpe);
+        new_pg->set_mpe_members(config_pg_it->mpe_members);
+        new_pg->set_mpe_timbre(config_pg_it->mpe_timbre);
+        new_pg->set_nrpn(config_pg_it->nrpn_number);
+        new_pg->set_arp_mode(config_pg_it->arp_mode);
+        new_pg->set_arp_division(config_pg_it->arp_division);
         // add the midi inputs
         for (auto &msg_type: config_pg_it->input_types) {
             new_pg->add_midi_input(msg_type);
@@ -195,7 +650,20 @@ namespace midimagic {
         return new_pg->get_id();
     }
 
-    std::vector<struct port_group_config>::iterator inventory::config_pg_it_by_id(u8 config_pg_id) {
+    const u8 inventory::runtime_group_id(const u8 config_pg_id, const u8* group_ids) const {
+        if (!config_pg_id) {
+            return 0;
+        }
+        for (u8 c = 0; c < m_system_config.system_port_groups.size(); c++) {
+            if (m_system_config.system_port_groups[c].id == config_pg_id) {
+                return group_ids[c];
+            }
+        }
+        // no such group in the config
+        return 0;
+    }
+
+    port_group_config_list::iterator inventory::config_pg_it_by_id(u8 config_pg_id) {
         for (auto it = m_system_config.system_port_groups.begin();
             it != m_system_config.system_port_groups.end(); ) {
             if (it->id == config_pg_id) {
@@ -205,7 +673,7 @@ namespace midimagic {
         }
     }
 
-    std::vector<struct output_port_config>::iterator inventory::config_port_it_by_number(u8 config_port_number) {
+    port_config_list::iterator inventory::config_port_it_by_number(u8 config_port_number) {
         for (auto it = m_system_config.system_ports.begin();
             it != m_system_config.system_ports.end(); ) {
             if (it->port_number == config_port_number) {
@@ -217,7 +685,7 @@ namespace midimagic {
 
 
 
-    const std::vector<std::unique_ptr<port_group>>::const_iterator inventory::system_pg_it_by_id(const u8 system_pg_id) const {
+    const port_group_list::const_iterator inventory::system_pg_it_by_id(const u8 system_pg_id) const {
         for (auto it = m_group_dispatcher->get_port_groups().begin();
             it != m_group_dispatcher->get_port_groups().end(); ) {
             if ((*it)->get_id() == system_pg_id) {
@@ -227,7 +695,7 @@ namespace midimagic {
         }
     }
 
-    const std::vector<std::shared_ptr<output_port>>::const_iterator inventory::system_port_it_by_number(const u8 system_port_number) const {
+    const output_port_list::const_iterator inventory::system_port_it_by_number(const u8 system_port_number) const {
         for (auto it = m_system_ports.begin(); it != m_system_ports.end(); ) {
             if ((*it)->get_port_number() == system_port_number) {
                 return it;
@@ -305,6 +773,20 @@ namespace midimagic {
             if (it->cont_controller_number > 127) {
                 out_config.system_port_groups.back().cont_controller_number = 127;
             }
+            // MPE zones have their master on channel 1 or 16 and 1...15 members
+            if (!port_group::is_mpe_master(out_config.system_port_groups.back().midi_channel)) {
+                out_config.system_port_groups.back().mpe = false;
+            }
+            if ((it->mpe_members < 1) || (it->mpe_members > 15)) {
+                out_config.system_port_groups.back().mpe_members = 15;
+            }
+            // MPE pressure always goes to the companions, timbre never
+            if (out_config.system_port_groups.back().mpe) {
+                out_config.system_port_groups.back().pressure_to_companion = true;
+            }
+            if (!port_group::is_mpe_timbre(it->mpe_timbre)) {
+                out_config.system_port_groups.back().mpe_timbre = 0;
+            }
 
             ++it;
         }
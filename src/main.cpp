@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022,2023 Lukas Jünger and Adrian Krause                         *
+ * Copyright 2022,2023, 2026 Lukas Jünger and Adrian Krause                  *
  *                                                                            *
  * This program is free software: you can redistribute it and/or modify it    *
  * under the terms of the GNU Lesser General Public License as published by   *
@@ -24,6 +24,7 @@
 #include "common.h"
 #include "hardware_config.h"
 #include "ad57x4.h"
+#include "microwire_eeprom.h"
 #include "midi_types.h"
 #include "output.h"
 #include "menu.h"
@@ -32,6 +33,10 @@
 #include "bitmaps.h"
 #include "port_group.h"
 #include "inventory.h"
+#include "sysex.h"
+#include "heap_monitor.h"
+#include "midi_input_stats.h"
+#include "event_trace.h"
 
 namespace midimagic {
 
@@ -40,13 +45,22 @@ namespace midimagic {
     ad57x4 dac0(spi1, hw_setup.dac.cs0);
     ad57x4 dac1(spi1, hw_setup.dac.cs1);
 
-    midi::MidiInterface<HardwareSerial> MIDI((HardwareSerial&)Serial1);
+    counting_serial<HardwareSerial> midi_serial((HardwareSerial&)Serial1);
+    midi::MidiInterface<counting_serial<HardwareSerial>> MIDI(midi_serial);
 
     std::shared_ptr<group_dispatcher> port_master(new group_dispatcher);
     std::shared_ptr<menu_state> menu(new menu_state);
     std::shared_ptr<menu_action_queue> action_queue(new menu_action_queue(menu));
 
-    std::shared_ptr<inventory> invent(new inventory(port_master, action_queue, dac0, dac1));
+    microwire_eeprom eeprom(hw_setup.eeprom.mosi, hw_setup.eeprom.miso, hw_setup.eeprom.clk, hw_setup.eeprom.cs, hw_setup.eeprom.size);
+
+    std::shared_ptr<inventory> invent(new inventory(port_master, action_queue, dac0, dac1, eeprom));
+
+    void send_sysex(const u8* data, const u16 length) {
+        MIDI.sendSysEx(length, data);
+    }
+
+    std::shared_ptr<sysex_transfer> sysex(new sysex_transfer(invent, eeprom, send_sysex));
 
     rotary rot(hw_setup.rotary.dat, hw_setup.rotary.swi, action_queue);
 
@@ -58,6 +72,9 @@ namespace midimagic {
                                               .frequency = 0 };
 
     DisplaySSD1306_128x64_I2C display(-1, display_config);
+
+    // renders the modulation sources at the control rate
+    HardwareTimer control_timer(TIM3);
 };
 
 void handleNoteOn(byte midi_channel, byte midi_note, byte midi_velo) {
@@ -87,7 +104,9 @@ void handleControlChange(byte midi_channel, byte midi_control_number, byte value
 void handleProgramChange(byte midi_channel, byte midi_program_number) {
     using namespace midimagic;
     midi_message msg(midi_message::PROGRAM_CHANGE, midi_channel, midi_program_number, 0);
+    // recorded by the monitor in any case, switches the preset on the control channel
     port_master->add_message(msg);
+    invent->handle_program_change(midi_channel, midi_program_number);
 }
 
 void handleAfterTouchChannel(byte midi_channel, byte pressure) {
@@ -136,6 +155,11 @@ void handleStop() {
     port_master->add_message(msg);
 }
 
+void handleSystemExclusive(byte* array, unsigned size) {
+    using namespace midimagic;
+    sysex->handle_message(array, size);
+}
+
 void rot_clk_isr() {
     using namespace midimagic;
     rot.signal_clk();
@@ -146,6 +170,11 @@ void rot_sw_isr() {
     rot.signal_sw();
 }
 
+void control_rate_isr() {
+    using namespace midimagic;
+    port_master->get_modulation().render();
+}
+
 void setup() {
     using namespace midimagic;
     // Prepare interrupt pins
@@ -174,7 +203,10 @@ void setup() {
     MIDI.setHandleStart(handleStart);
     MIDI.setHandleContinue(handleContinue);
     MIDI.setHandleStop(handleStop);
+    MIDI.setHandleSystemExclusive(handleSystemExclusive);
     MIDI.begin(MIDI_CHANNEL_OMNI);
+    // count the UART errors the core's interrupt handler swallows
+    midi_input_stats::hook_uart_interrupt();
 
     // Set up interrupts
     attachInterrupt(digitalPinToInterrupt(hw_setup.rotary.clk), rot_clk_isr, FALLING);
@@ -208,10 +240,30 @@ void setup() {
     // Show menu
     auto v = std::make_shared<over_view>(display, menu, invent);
     menu->register_view(v);
+
+    // Start the modulation sources of the loaded config
+    control_timer.setOverflow(modulation_engine::k_control_rate, HERTZ_FORMAT);
+    control_timer.attachInterrupt(control_rate_isr);
+    control_timer.resume();
+
+    // From here on every allocation on the MIDI path is counted as runtime allocation
+    heap_monitor::mark_boot_complete();
+    event_trace::begin();
 }
 
 void loop() {
     using namespace midimagic;
-    MIDI.read();
+    {
+        heap_monitor::realtime_section rt;
+        // handle all pending messages before the slow work
+        while (MIDI.read()) {
+            midi_input_stats::count_message();
+        }
+    }
+    midi_input_stats::update(millis());
+    // a running save programs at most one EEPROM byte per pass
+    invent->run_save_step();
+    // likewise a SysEx restore, a dump sends one chunk per pass
+    sysex->run_step();
     action_queue->exec_next_action();
 }
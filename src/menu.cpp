@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021-2024 Lukas Jünger and Adrian Krause                         *
+ * Copyright 2021-2024, 2026 Lukas Jünger and Adrian Krause                  *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -48,6 +48,10 @@ namespace midimagic {
         // nothing to do
     }
 
+    void menu_view::preset_changed() {
+        // nothing to do
+    }
+
     port_view::port_view(u8 port_number,
                        DisplaySSD1306_128x64_I2C &d,
                        std::shared_ptr<menu_state> menu_state,
@@ -58,7 +62,10 @@ namespace midimagic {
         , m_menu_items{"Switch Note/Velocit",
                        "Change Clock Rate",
                        "Resync Clock",
-                       "Change Clock Mode"}
+                       "Change Clock Mode",
+                       "Modulation",
+                       "Quantizer",
+                       "Velocity Curve"}
         , m_port_menu_dimensions{NanoPoint{0, 24}, NanoPoint{127, 63}}
         {
         m_port_menu = std::make_unique<LcdGfxMenu>(m_menu_items,
@@ -69,6 +76,12 @@ namespace midimagic {
         // nothing to do
     }
 
+    void port_view::preset_changed() {
+        // the port settings belong to the preset, show the new ones
+        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+        notify(a);
+    }
+
     void port_view::notify(const menu_action &a) {
         switch (a.m_kind) {
             case menu_action::kind::UPDATE :
@@ -79,8 +92,11 @@ namespace midimagic {
                 m_display.printFixed(0, 0, "Port:", STYLE_NORMAL);
                 m_display.setTextCursor(36, 0);
                 m_display.print(m_port_number + 1);
-                // show pitch/velocity setting
-                if (m_port->get_velocity_switch()) {
+                // show pitch/velocity setting, a running modulation source owns the DAC instead
+                if (m_port->get_modulated()) {
+                    m_display.printFixed(0, 8, "CV:", STYLE_NORMAL);
+                    m_display.printFixed(24, 8, modulation_type2name(m_inventory->get_group_dispatcher()->get_modulation().get_settings(m_port_number).type), STYLE_NORMAL);
+                } else if (m_port->get_velocity_switch()) {
                     m_display.printFixed(0, 8, "Output: Velocity", STYLE_NORMAL);
                 } else {
                     m_display.printFixed(0, 8, "Output: Note", STYLE_NORMAL);
@@ -101,6 +117,7 @@ namespace midimagic {
                 if        (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     if (m_port_menu->selection() == 0) {
                         m_port->set_velocity_switch();
+                        m_inventory->mark_config_changed();
                         // trigger display update
                         menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
                         m_menu_state->notify(a);
@@ -114,6 +131,18 @@ namespace midimagic {
                         // switch to config_port_clockmode_view
                         auto v = std::make_shared<config_port_clockmode_view>(m_port_number, m_display, m_menu_state, m_inventory);
                         m_menu_state->register_view(v);
+                    } else if (m_port_menu->selection() == 4) {
+                        // switch to config_port_modulation_view
+                        auto v = std::make_shared<config_port_modulation_view>(m_port_number, m_display, m_menu_state, m_inventory);
+                        m_menu_state->register_view(v);
+                    } else if (m_port_menu->selection() == 5) {
+                        // switch to config_port_quantizer_view
+                        auto v = std::make_shared<config_port_quantizer_view>(m_port_number, m_display, m_menu_state, m_inventory);
+                        m_menu_state->register_view(v);
+                    } else if (m_port_menu->selection() == 6) {
+                        // switch to config_port_velocity_view
+                        auto v = std::make_shared<config_port_velocity_view>(m_port_number, m_display, m_menu_state, m_inventory);
+                        m_menu_state->register_view(v);
                     }
 
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
@@ -250,6 +279,7 @@ namespace midimagic {
 
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     m_port->set_clock_rate(m_clock_rate);
+                    m_inventory->mark_config_changed();
                     // switch back to port_view
                     auto v = std::make_shared<port_view>(m_port_number, m_display, m_menu_state, m_inventory);
                     m_menu_state->register_view(v);
@@ -306,6 +336,7 @@ namespace midimagic {
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     // set output_port property
                     m_port->set_clock_mode(m_clock_mode);
+                    m_inventory->mark_config_changed();
                     // switch back to port_view
                     auto v = std::make_shared<port_view>(m_port_number, m_display, m_menu_state, m_inventory);
                     m_menu_state->register_view(v);
@@ -322,6 +353,522 @@ namespace midimagic {
         }
     }
 
+    config_port_modulation_view::config_port_modulation_view(u8 port_number,
+                                                             DisplaySSD1306_128x64_I2C &d,
+                                                             std::shared_ptr<menu_state> menu_state,
+                                                             std::shared_ptr<inventory> invent)
+        : port_view(port_number, d, menu_state, invent)
+        , k_item_names{"Source:",
+                       "Shape:",
+                       "Rate [Hz]:",
+                       "Sync:",
+                       "Attack [ms]:",
+                       "Decay [ms]:",
+                       "Sustain:",
+                       "Release [ms]:",
+                       "Depth:",
+                       "Trigger grp:"}
+        , m_settings(m_inventory->get_group_dispatcher()->get_modulation().get_settings(m_port_number))
+        , m_item(0)
+        , m_editing(false) {
+        // nothing to do
+    }
+
+    config_port_modulation_view::~config_port_modulation_view() {
+        // nothing to do
+    }
+
+    void config_port_modulation_view::preset_changed() {
+        // the modulation belongs to the preset, edit the new one
+        m_settings = m_inventory->get_group_dispatcher()->get_modulation().get_settings(m_port_number);
+        m_item = 0;
+        m_editing = false;
+        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+        notify(a);
+    }
+
+    void config_port_modulation_view::notify(const menu_action &a) {
+        u8 items[k_max_visible_items];
+        const u8 item_count = get_visible_items(items);
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(0, 0, "Port:", STYLE_NORMAL);
+                m_display.setTextCursor(36, 0);
+                m_display.print(m_port_number + 1);
+                m_display.printFixed(54, 0, "Modulation", STYLE_NORMAL);
+                for (u8 i = 0; i < item_count; i++) {
+                    draw_item(static_cast<modulation_item>(items[i]), 8 + 8 * i, i == m_item);
+                }
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    if (m_editing) {
+                        change_value(static_cast<modulation_item>(items[m_item]), 1);
+                    } else {
+                        m_item = (m_item + 1) % item_count;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_editing) {
+                        change_value(static_cast<modulation_item>(items[m_item]), -1);
+                    } else {
+                        m_item = (m_item + item_count - 1) % item_count;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    m_editing = !m_editing;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // switch back to port_view, changes are already applied
+                    auto v = std::make_shared<port_view>(m_port_number, m_display, m_menu_state, m_inventory);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
+    const u8 config_port_modulation_view::get_visible_items(u8 (&items)[k_max_visible_items]) const {
+        u8 count = 0;
+        items[count++] = modulation_item::TYPE;
+        switch (m_settings.type) {
+            case modulation_type::LFO :
+                items[count++] = modulation_item::SHAPE;
+                // only used while the LFO runs free
+                items[count++] = modulation_item::RATE;
+                items[count++] = modulation_item::SYNC;
+                items[count++] = modulation_item::DEPTH;
+                break;
+            case modulation_type::AD_ENVELOPE :
+                items[count++] = modulation_item::ATTACK;
+                items[count++] = modulation_item::DECAY;
+                items[count++] = modulation_item::DEPTH;
+                items[count++] = modulation_item::TRIGGER;
+                break;
+            case modulation_type::ADSR_ENVELOPE :
+                items[count++] = modulation_item::ATTACK;
+                items[count++] = modulation_item::DECAY;
+                items[count++] = modulation_item::SUSTAIN;
+                items[count++] = modulation_item::RELEASE;
+                items[count++] = modulation_item::DEPTH;
+                items[count++] = modulation_item::TRIGGER;
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+        return count;
+    }
+
+    void config_port_modulation_view::change_value(const modulation_item item, const i8 direction) {
+        switch (item) {
+            case modulation_item::TYPE :
+                m_settings.type = static_cast<modulation_type>((m_settings.type + modulation_type::_MODULATION_TYPE_COUNT_ + direction)
+                                                               % modulation_type::_MODULATION_TYPE_COUNT_);
+                break;
+            case modulation_item::SHAPE :
+                m_settings.shape = static_cast<lfo_shape>((m_settings.shape + lfo_shape::_LFO_SHAPE_COUNT_ + direction)
+                                                          % lfo_shape::_LFO_SHAPE_COUNT_);
+                break;
+            case modulation_item::RATE :
+                m_settings.rate = step_value(m_settings.rate, direction, 1, 255);
+                break;
+            case modulation_item::SYNC :
+                // free running or whole divisions of a bar, in clock ticks
+                m_settings.sync_ticks = step_value(m_settings.sync_ticks, 6 * direction, 0, 252);
+                break;
+            case modulation_item::ATTACK :
+                m_settings.attack = step_value(m_settings.attack, direction, 0, 255);
+                break;
+            case modulation_item::DECAY :
+                m_settings.decay = step_value(m_settings.decay, direction, 0, 255);
+                break;
+            case modulation_item::SUSTAIN :
+                m_settings.sustain = step_value(m_settings.sustain, direction, 0, 127);
+                break;
+            case modulation_item::RELEASE :
+                m_settings.release = step_value(m_settings.release, direction, 0, 255);
+                break;
+            case modulation_item::DEPTH :
+                m_settings.depth = step_value(m_settings.depth, direction, 0, 127);
+                break;
+            case modulation_item::TRIGGER : {
+                // step through the port groups of the active preset by their position, the engine takes the id
+                auto& port_groups = m_inventory->get_group_dispatcher()->get_port_groups();
+                const u8 position = step_value(get_trigger_position(), direction, 0, port_groups.size());
+                m_settings.trigger_group = position ? port_groups[position - 1]->get_id() : 0;
+                break;
+            }
+            default :
+                // nothing to do
+                break;
+        }
+        // the source follows every step, so the result can be heard while turning
+        m_inventory->get_group_dispatcher()->get_modulation().configure(m_port_number, m_settings);
+        m_inventory->mark_config_changed();
+    }
+
+    const u8 config_port_modulation_view::step_value(const u8 value, const i8 step, const u8 min, const u8 max) {
+        // stop at the ends
+        const int stepped = value + step;
+        if (stepped < min) {
+            return min;
+        } else if (stepped > max) {
+            return max;
+        }
+        return stepped;
+    }
+
+    void config_port_modulation_view::draw_item(const modulation_item item, const u8 y, const bool selected) const {
+        if (selected) {
+            m_display.printFixed(0, y, m_editing ? "*" : ">", STYLE_NORMAL);
+        }
+        m_display.printFixed(8, y, k_item_names[item], STYLE_NORMAL);
+        m_display.setTextCursor(90, y);
+        switch (item) {
+            case modulation_item::TYPE :
+                m_display.printFixed(54, y, modulation_type2name(m_settings.type), STYLE_NORMAL);
+                break;
+            case modulation_item::SHAPE :
+                m_display.printFixed(54, y, lfo_shape2name(m_settings.shape), STYLE_NORMAL);
+                break;
+            case modulation_item::RATE :
+                // 0.1 Hz steps
+                m_display.print(m_settings.rate / 10);
+                m_display.print(".");
+                m_display.print(m_settings.rate % 10);
+                break;
+            case modulation_item::SYNC :
+                if (!m_settings.sync_ticks) {
+                    m_display.printFixed(90, y, "free", STYLE_NORMAL);
+                } else {
+                    m_display.print(m_settings.sync_ticks);
+                }
+                break;
+            case modulation_item::ATTACK :
+                m_display.print(m_settings.attack * 10);
+                break;
+            case modulation_item::DECAY :
+                m_display.print(m_settings.decay * 10);
+                break;
+            case modulation_item::SUSTAIN :
+                m_display.print(m_settings.sustain);
+                break;
+            case modulation_item::RELEASE :
+                m_display.print(m_settings.release * 10);
+                break;
+            case modulation_item::DEPTH :
+                m_display.print(m_settings.depth);
+                break;
+            case modulation_item::TRIGGER :
+                if (!get_trigger_position()) {
+                    m_display.printFixed(90, y, "none", STYLE_NORMAL);
+                } else {
+                    m_display.print(get_trigger_position());
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    const u8 config_port_modulation_view::get_trigger_position() const {
+        auto& port_groups = m_inventory->get_group_dispatcher()->get_port_groups();
+        for (u8 position = 0; m_settings.trigger_group && position < port_groups.size(); position++) {
+            if (port_groups[position]->get_id() == m_settings.trigger_group) {
+                return position + 1;
+            }
+        }
+        return 0;
+    }
+
+    config_port_quantizer_view::config_port_quantizer_view(u8 port_number,
+                                                           DisplaySSD1306_128x64_I2C &d,
+                                                           std::shared_ptr<menu_state> menu_state,
+                                                           std::shared_ptr<inventory> invent)
+        : port_view(port_number, d, menu_state, invent)
+        , k_root_names{"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"}
+        , m_settings(m_port->get_quantizer())
+        , m_item(quantizer_item::SCALE)
+        , m_editing(false)
+        , m_degree(0) {
+        // nothing to do
+    }
+
+    config_port_quantizer_view::~config_port_quantizer_view() {
+        // nothing to do
+    }
+
+    void config_port_quantizer_view::preset_changed() {
+        // the quantizer belongs to the preset, edit the new one
+        m_settings = m_port->get_quantizer();
+        m_item = quantizer_item::SCALE;
+        m_editing = false;
+        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+        notify(a);
+    }
+
+    void config_port_quantizer_view::notify(const menu_action &a) {
+        const u8 item_count = get_item_count();
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(0, 0, "Port:", STYLE_NORMAL);
+                m_display.setTextCursor(36, 0);
+                m_display.print(m_port_number + 1);
+                m_display.printFixed(54, 0, "Quantizer", STYLE_NORMAL);
+                m_display.printFixed(0, 8 + 8 * m_item, m_editing ? "*" : ">", STYLE_NORMAL);
+                m_display.printFixed(8, 8, "Scale:", STYLE_NORMAL);
+                m_display.printFixed(54, 8, scale_type2name(m_settings.scale), STYLE_NORMAL);
+                m_display.printFixed(8, 16, "Root:", STYLE_NORMAL);
+                m_display.printFixed(54, 16, k_root_names[m_settings.root], STYLE_NORMAL);
+                m_display.printFixed(8, 24, "Trigger:", STYLE_NORMAL);
+                m_display.printFixed(54, 24, m_settings.trigger ? "on" : "off", STYLE_NORMAL);
+                if (item_count > quantizer_item::MASK) {
+                    m_display.printFixed(8, 32, "Notes:", STYLE_NORMAL);
+                    // one digit per degree from the root up
+                    for (u8 degree = 0; degree < 12; degree++) {
+                        m_display.printFixed(54 + 6 * degree, 32,
+                                             (m_settings.user_mask & (1 << degree)) ? "1" : "0", STYLE_NORMAL);
+                    }
+                    if (m_editing && m_item == quantizer_item::MASK) {
+                        m_display.printFixed(54 + 6 * m_degree, 40, "^", STYLE_NORMAL);
+                    }
+                }
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    if (m_editing) {
+                        change_value(1);
+                    } else {
+                        m_item = (m_item + 1) % item_count;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_editing) {
+                        change_value(-1);
+                    } else {
+                        m_item = (m_item + item_count - 1) % item_count;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    if (m_editing && m_item == quantizer_item::MASK) {
+                        // toggle the selected degree, a long press ends editing the notes
+                        m_settings.user_mask ^= 1 << m_degree;
+                        apply();
+                    } else {
+                        m_editing = !m_editing;
+                        m_degree = 0;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    if (m_editing && m_item == quantizer_item::MASK) {
+                        m_editing = false;
+                        // Trigger display update
+                        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                        m_menu_state->notify(a);
+                    } else {
+                        // switch back to port_view, changes are already applied
+                        auto v = std::make_shared<port_view>(m_port_number, m_display, m_menu_state, m_inventory);
+                        m_menu_state->register_view(v);
+                    }
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
+    const u8 config_port_quantizer_view::get_item_count() const {
+        return (m_settings.scale == scale_type::USER_SCALE) ? quantizer_item::_ITEM_COUNT_ : quantizer_item::MASK;
+    }
+
+    void config_port_quantizer_view::change_value(const i8 direction) {
+        switch (m_item) {
+            case quantizer_item::SCALE :
+                m_settings.scale = static_cast<scale_type>((m_settings.scale + scale_type::_SCALE_TYPE_COUNT_ + direction)
+                                                           % scale_type::_SCALE_TYPE_COUNT_);
+                break;
+            case quantizer_item::ROOT :
+                m_settings.root = (m_settings.root + 12 + direction) % 12;
+                break;
+            case quantizer_item::TRIGGER :
+                m_settings.trigger = !m_settings.trigger;
+                break;
+            case quantizer_item::MASK :
+                // only moves the selection, the button toggles
+                m_degree = (m_degree + 12 + direction) % 12;
+                return;
+            default :
+                // nothing to do
+                break;
+        }
+        apply();
+    }
+
+    void config_port_quantizer_view::apply() {
+        // the port follows every step, so the result can be heard while turning
+        m_port->set_quantizer(m_settings);
+        m_inventory->mark_config_changed();
+    }
+
+    config_port_velocity_view::config_port_velocity_view(u8 port_number,
+                                                         DisplaySSD1306_128x64_I2C &d,
+                                                         std::shared_ptr<menu_state> menu_state,
+                                                         std::shared_ptr<inventory> invent)
+        : port_view(port_number, d, menu_state, invent)
+        , m_settings(m_port->get_velocity_curve())
+        , m_item(velocity_item::CURVE)
+        , m_editing(false)
+        , m_point(0) {
+        // nothing to do
+    }
+
+    config_port_velocity_view::~config_port_velocity_view() {
+        // nothing to do
+    }
+
+    void config_port_velocity_view::preset_changed() {
+        // the curve belongs to the preset, edit the new one
+        m_settings = m_port->get_velocity_curve();
+        m_item = velocity_item::CURVE;
+        m_editing = false;
+        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+        notify(a);
+    }
+
+    void config_port_velocity_view::notify(const menu_action &a) {
+        const u8 item_count = get_item_count();
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(0, 0, "Port:", STYLE_NORMAL);
+                m_display.setTextCursor(36, 0);
+                m_display.print(m_port_number + 1);
+                m_display.printFixed(54, 0, "Velocity", STYLE_NORMAL);
+                m_display.printFixed(0, 8 + 8 * m_item, m_editing ? "*" : ">", STYLE_NORMAL);
+                m_display.printFixed(8, 8, "Curve:", STYLE_NORMAL);
+                m_display.printFixed(54, 8, curve_type2name(m_settings.curve), STYLE_NORMAL);
+                if (m_settings.curve == curve_type::FIXED_CURVE) {
+                    m_display.printFixed(8, 16, "Level:", STYLE_NORMAL);
+                    m_display.setTextCursor(54, 16);
+                    m_display.print(m_settings.fixed_level);
+                } else if (m_settings.curve == curve_type::USER_CURVE) {
+                    m_display.printFixed(8, 16, "Level:", STYLE_NORMAL);
+                    m_display.setTextCursor(54, 16);
+                    m_display.print(m_settings.user_points[m_point]);
+                    // points are named by the velocity they map
+                    m_display.printFixed(8, 24, "Point:", STYLE_NORMAL);
+                    m_display.setTextCursor(54, 24);
+                    m_display.print((m_point == k_user_curve_points - 1) ? 127 : m_point << 4);
+                }
+                draw_curve();
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    if (m_editing) {
+                        change_value(1);
+                    } else {
+                        m_item = (m_item + 1) % item_count;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_editing) {
+                        change_value(-1);
+                    } else {
+                        m_item = (m_item + item_count - 1) % item_count;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    m_editing = !m_editing;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // switch back to port_view, changes are already applied
+                    auto v = std::make_shared<port_view>(m_port_number, m_display, m_menu_state, m_inventory);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
+    const u8 config_port_velocity_view::get_item_count() const {
+        switch (m_settings.curve) {
+            case curve_type::FIXED_CURVE :
+                return velocity_item::POINT;
+            case curve_type::USER_CURVE :
+                return velocity_item::_ITEM_COUNT_;
+            default :
+                return velocity_item::LEVEL;
+        }
+    }
+
+    void config_port_velocity_view::change_value(const i8 direction) {
+        switch (m_item) {
+            case velocity_item::CURVE :
+                m_settings.curve = static_cast<curve_type>((m_settings.curve + curve_type::_CURVE_TYPE_COUNT_ + direction)
+                                                           % curve_type::_CURVE_TYPE_COUNT_);
+                break;
+            case velocity_item::LEVEL : {
+                u8& level = (m_settings.curve == curve_type::FIXED_CURVE) ? m_settings.fixed_level
+                                                                          : m_settings.user_points[m_point];
+                if (direction > 0) {
+                    level = (level < 127) ? level + 1 : 127;
+                } else {
+                    level = level ? level - 1 : 0;
+                }
+                break;
+            }
+            case velocity_item::POINT :
+                // only moves the selection
+                m_point = (m_point + k_user_curve_points + direction) % k_user_curve_points;
+                return;
+            default :
+                // nothing to do
+                break;
+        }
+        // the port follows every step, so the result can be heard while turning
+        m_port->set_velocity_curve(m_settings);
+        m_inventory->mark_config_changed();
+    }
+
+    void config_port_velocity_view::draw_curve() const {
+        // velocity from left to right, 0 V to +5 V on 32 lines from the bottom
+        velocity_curve curve;
+        curve.set_settings(m_settings);
+        for (u8 velocity = 0; velocity < 128; velocity++) {
+            m_display.putPixel(velocity, 63 - (curve.level(velocity) >> 10));
+        }
+    }
+
     over_view::over_view(DisplaySSD1306_128x64_I2C &d,
                          std::shared_ptr<menu_state> menu_state,
                          std::shared_ptr<inventory> invent)
@@ -440,24 +987,533 @@ namespace midimagic {
             yoffset = m_activity_yoffset + m_rowoffset;
         }
 
-        switch (activity_type) {
-            case menu_action::subkind::PORT_ACTIVE :
-                // draw activity dot
-                m_display.printFixed(xoffset+m_activitydot_xoffset, yoffset, "*", STYLE_NORMAL);
+        switch (activity_type) {
+            case menu_action::subkind::PORT_ACTIVE :
+                // draw activity dot
+                m_display.printFixed(xoffset+m_activitydot_xoffset, yoffset, "*", STYLE_NORMAL);
+
+                // draw port value
+                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "   ", STYLE_NORMAL);
+                m_display.setTextCursor(xoffset+m_port_value_xoffset, yoffset);
+                m_display.print(port_value);
+                break;
+            case menu_action::subkind::PORT_ACTIVE_CC :
+                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "   ", STYLE_NORMAL);
+                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "CC", STYLE_NORMAL);
+                break;
+            case menu_action::subkind::PORT_ACTIVE_CLK :
+                m_display.printFixed(xoffset+m_activitydot_xoffset, yoffset, "*", STYLE_NORMAL);
+                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "   ", STYLE_NORMAL);
+                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "CLK", STYLE_NORMAL);
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void over_view::draw_inactivity(const int port_number) const {
+        m_display.setFixedFont(ssd1306xled_font5x7);
+        // draw space over activity dot
+        if (port_number < 4) {
+            m_display.printFixed(port_number*32+m_activitydot_xoffset, m_activity_yoffset, " ", STYLE_NORMAL);
+        } else {
+            m_display.printFixed((port_number-4)*32+m_activitydot_xoffset, m_activity_yoffset+m_rowoffset, " ", STYLE_NORMAL);
+        }
+    }
+
+    setup_view::setup_view(DisplaySSD1306_128x64_I2C &d,
+                           std::shared_ptr<menu_state> menu_state,
+                           std::shared_ptr<inventory> invent)
+        : menu_view(d, menu_state, invent)
+        , m_menu_items{"Setup port groups",
+                       "Go to overview",
+                       "Load stored config",
+                       "Store setup",
+                       "Presets",
+                       "MIDI monitor",
+                       "Diagnostics"}
+        , m_setup_menu_dimensions{NanoPoint{0, 0}, NanoPoint{127, 63}}
+        {
+        setup_menu = std::make_unique<LcdGfxMenu>(m_menu_items,
+            sizeof(m_menu_items) / sizeof(char *), m_setup_menu_dimensions);
+    }
+
+    setup_view::~setup_view() {
+        // nothing to do
+    }
+
+    void setup_view::notify(const menu_action &a) {
+
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                setup_menu->show(m_display);
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                switch (a.m_subkind) {
+                    case menu_action::subkind::ROT_BUTTON :
+                        switch (setup_menu->selection()) {
+                            case 0 :
+                                if (!m_inventory->get_group_dispatcher()->get_port_groups().empty()) {
+                                    auto gd = m_inventory->get_group_dispatcher();
+                                    auto v = std::make_shared<portgroup_view>(m_display,
+                                                                              m_menu_state,
+                                                                              m_inventory,
+                                                                             (gd->get_port_groups()).begin());
+                                    m_menu_state->register_view(v);
+                                } else {
+                                    auto v = std::make_shared<add_portgroup_view>(m_display,
+                                                                                  m_menu_state,
+                                                                                  m_inventory);
+                                    m_menu_state->register_view(v);
+                                }
+                                break;
+                            case 1 :
+                                {
+                                auto v = std::make_shared<over_view>(m_display, m_menu_state, m_inventory);
+                                m_menu_state->register_view(v);
+                                break;
+                                }
+                            case 2 :
+                                {
+                                m_display.clear();
+                                auto return_code = m_inventory->load_config_from_eeprom();
+                                if (return_code == config_archive::operation_result::SUCCESS) {
+                                    m_display.printFixed(4, 8, "Config Loaded");
+                                } else {
+                                    m_display.printFixed(4, 8, "Error while loading");
+                                    m_display.printFixed(4, 24, "Error: ");
+                                    m_display.setTextCursor(46, 24);
+                                    m_display.print(return_code);
+                                }
+                                delay(3000);
+                                // refresh screen
+                                menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                                m_menu_state->notify(a);
+                                break;
+                                }
+                            case 3 :
+                                {
+                                // the save runs in the background, MIDI keeps flowing
+                                m_inventory->save_system_state();
+                                auto v = std::make_shared<save_view>(m_display, m_menu_state, m_inventory);
+                                m_menu_state->register_view(v);
+                                break;
+                                }
+                            case 4 :
+                                {
+                                auto v = std::make_shared<presets_view>(m_display, m_menu_state, m_inventory);
+                                m_menu_state->register_view(v);
+                                break;
+                                }
+                            case 5 :
+                                {
+                                auto v = std::make_shared<midi_monitor_view>(m_display, m_menu_state, m_inventory);
+                                m_menu_state->register_view(v);
+                                break;
+                                }
+                            case 6 :
+                                {
+                                auto v = std::make_shared<diagnostics_view>(m_display, m_menu_state, m_inventory);
+                                m_menu_state->register_view(v);
+                                break;
+                                }
+                            default :
+                                // nothing to do
+                                break;
+                        }
+                        break;
+                    case menu_action::subkind::ROT_RIGHT :
+                        setup_menu->down();
+                        setup_menu->show(m_display);
+                        break;
+                    case menu_action::subkind::ROT_LEFT :
+                        setup_menu->up();
+                        setup_menu->show(m_display);
+                        break;
+                    default :
+                        // nothing to do
+                        break;
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    diagnostics_view::diagnostics_view(DisplaySSD1306_128x64_I2C &d,
+                                       std::shared_ptr<menu_state> menu_state,
+                                       std::shared_ptr<inventory> invent)
+        : menu_view(d, menu_state, invent)
+        , m_page(diagnostics_page::HEAP) {
+        // nothing to do
+    }
+
+    diagnostics_view::~diagnostics_view() {
+        // nothing to do
+    }
+
+    void diagnostics_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                switch (m_page) {
+                    case diagnostics_page::HEAP :
+                        draw_heap_page();
+                        break;
+                    case diagnostics_page::STORAGE :
+                        draw_storage_page();
+                        break;
+                    case diagnostics_page::RECONFIG :
+                        draw_reconfig_page();
+                        break;
+                    case diagnostics_page::LOOPER :
+                        draw_looper_page();
+                        break;
+                    case diagnostics_page::MODULATION :
+                        draw_modulation_page();
+                        break;
+                    case diagnostics_page::WCET :
+                        draw_wcet_page();
+                        break;
+                    case diagnostics_page::MIDI_INPUT :
+                        draw_input_page();
+                        break;
+                    default :
+                        // nothing to do
+                        break;
+                }
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    m_page = (m_page + 1) % diagnostics_page::_PAGE_COUNT_;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    m_page = (m_page + diagnostics_page::_PAGE_COUNT_ - 1) % diagnostics_page::_PAGE_COUNT_;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    // Refresh the values
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to setup_view
+                    auto v = std::make_shared<setup_view>(m_display, m_menu_state, m_inventory);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void diagnostics_view::draw_heap_page() const {
+        const auto stats = heap_monitor::get_stats();
+        m_display.printFixed(0, 0, "Diagnostics: Heap", STYLE_NORMAL);
+        m_display.printFixed(0, 8, "Groups:", STYLE_NORMAL);
+        m_display.setTextCursor(72, 8);
+        m_display.print(static_cast<int>(m_inventory->get_group_dispatcher()->get_port_groups().size()));
+        m_display.printFixed(90, 8, "/", STYLE_NORMAL);
+        m_display.setTextCursor(96, 8);
+        m_display.print(static_cast<int>(k_max_port_groups));
+        draw_value(16, "High water:", stats.heap_high_water);
+        draw_value(24, "In use:", stats.heap_in_use);
+        draw_value(32, "Free:", stats.free_bytes);
+        draw_value(40, "Free blocks:", stats.free_blocks);
+        draw_value(48, "Allocs:", stats.allocations);
+        draw_value(56, "MIDI path:", stats.runtime_allocations);
+    }
+
+    void diagnostics_view::draw_storage_page() const {
+        const auto& stats = m_inventory->get_storage_stats();
+        m_display.printFixed(0, 0, "Diagnostics: Storage", STYLE_NORMAL);
+        m_display.printFixed(0, 8, "Last load", STYLE_NORMAL);
+        draw_value(16, "Time [us]:", stats.last_load_us);
+        draw_value(24, "Bytes:", stats.last_load_bytes);
+        draw_value(32, "Result:", stats.last_load_result);
+        m_display.printFixed(0, 40, "Last save", STYLE_NORMAL);
+        draw_value(48, "Time [us]:", stats.last_save_us);
+        m_display.printFixed(0, 56, "Wr/Skip:", STYLE_NORMAL);
+        m_display.setTextCursor(54, 56);
+        m_display.print(stats.last_save_written);
+        m_display.printFixed(78, 56, "/", STYLE_NORMAL);
+        m_display.setTextCursor(84, 56);
+        m_display.print(stats.last_save_skipped);
+    }
+
+    void diagnostics_view::draw_reconfig_page() const {
+        const auto& stats = m_inventory->get_reconfig_stats();
+        m_display.printFixed(0, 0, "Diagnostics: Reconfig", STYLE_NORMAL);
+        draw_value(8, "Time [us]:", stats.last_apply_us);
+        draw_value(16, "Kept:", stats.groups_kept);
+        draw_value(24, "Changed:", stats.groups_changed);
+        draw_value(32, "Created:", stats.groups_created);
+        draw_value(40, "Removed:", stats.groups_removed);
+        draw_value(48, "Ports:", stats.ports_changed);
+    }
+
+    void diagnostics_view::draw_looper_page() const {
+        m_display.printFixed(0, 0, "Diagnostics: Looper", STYLE_NORMAL);
+        draw_value(8, "In use:", m_inventory->get_group_dispatcher()->get_loopers_in_use());
+        draw_value(16, "Pool:", k_looper_pool_size);
+        draw_value(24, "Events each:", k_max_looper_events);
+        draw_value(32, "Bytes each:", sizeof(pattern_looper));
+        draw_value(40, "Bytes total:", k_looper_pool_size * sizeof(pattern_looper));
+    }
+
+    void diagnostics_view::draw_modulation_page() const {
+        const auto stats = m_inventory->get_group_dispatcher()->get_modulation().get_stats();
+        m_display.printFixed(0, 0, "Diagnostics: Mod", STYLE_NORMAL);
+        draw_value(8, "Rate [Hz]:", modulation_engine::k_control_rate);
+        draw_value(16, "Sources:", stats.active_sources);
+        draw_value(24, "Load [1/1000]:", stats.load_permille);
+        draw_value(32, "Source [ns]:", stats.source_ns);
+        draw_value(40, "Max [us]:", stats.max_render_us);
+    }
+
+    void diagnostics_view::draw_wcet_page() const {
+        const u8 k_rows = 6;
+        dispatch_profiler::worst_case offenders[k_rows];
+        const u8 count = m_inventory->get_group_dispatcher()->get_profiler().top_offenders(offenders, k_rows);
+        m_display.printFixed(0, 0, "Diagnostics: WCET", STYLE_NORMAL);
+        m_display.printFixed(0, 8, "Msg Ch Dat  us  Grp", STYLE_NORMAL);
+        for (u8 row = 0; row < count; row++) {
+            const dispatch_profiler::worst_case& offender = offenders[row];
+            const u8 y = 16 + 8 * row;
+            m_display.printFixed(0, y, midi_msgtype2shortname(offender.type), STYLE_NORMAL);
+            if (offender.type < midi_message::message_type::SYSTEM_MESSAGE) {
+                m_display.setTextCursor(24, y);
+                m_display.print(offender.channel);
+                m_display.setTextCursor(42, y);
+                m_display.print(offender.data0);
+            }
+            m_display.setTextCursor(66, y);
+            m_display.print(static_cast<int>(offender.cycles / (SystemCoreClock / 1000000)));
+            // port groups reached of all port groups
+            const u8 x = (offender.routed_groups > 9) ? 96 : 102;
+            m_display.setTextCursor(x, y);
+            m_display.print(offender.routed_groups);
+            m_display.printFixed(x + ((offender.routed_groups > 9) ? 12 : 6), y, "/", STYLE_NORMAL);
+            m_display.setTextCursor(x + ((offender.routed_groups > 9) ? 18 : 12), y);
+            m_display.print(offender.groups);
+        }
+    }
+
+    void diagnostics_view::draw_input_page() const {
+        const auto stats = midi_input_stats::get_stats();
+        m_display.printFixed(0, 0, "Diagnostics: MIDI In", STYLE_NORMAL);
+        draw_value(8, "Bytes/s:", stats.bytes_per_second);
+        draw_value(16, "Msgs/s:", stats.messages_per_second);
+        // share of 31.25 kbaud now and at most
+        m_display.printFixed(0, 24, "Load:", STYLE_NORMAL);
+        m_display.setTextCursor(54, 24);
+        m_display.print(stats.load_permille);
+        m_display.printFixed(78, 24, "/", STYLE_NORMAL);
+        m_display.setTextCursor(84, 24);
+        m_display.print(stats.peak_load_permille);
+        draw_value(32, "Errors/s:", stats.errors_per_second);
+        draw_value(40, "Overruns:", stats.overruns);
+        m_display.printFixed(0, 48, "FE/NE:", STYLE_NORMAL);
+        m_display.setTextCursor(54, 48);
+        m_display.print(static_cast<int>(stats.framing_errors));
+        m_display.printFixed(78, 48, "/", STYLE_NORMAL);
+        m_display.setTextCursor(84, 48);
+        m_display.print(static_cast<int>(stats.noise_errors));
+        // times found full and fill level high water
+        m_display.printFixed(0, 56, "Buffer:", STYLE_NORMAL);
+        m_display.setTextCursor(54, 56);
+        m_display.print(static_cast<int>(stats.buffer_overflows));
+        m_display.printFixed(78, 56, "/", STYLE_NORMAL);
+        m_display.setTextCursor(84, 56);
+        m_display.print(stats.buffer_high_water);
+    }
+
+    void diagnostics_view::draw_value(const u8 y, const char *label, const int value) const {
+        m_display.printFixed(0, y, label, STYLE_NORMAL);
+        m_display.setTextCursor(78, y);
+        m_display.print(value);
+    }
+
+    presets_view::presets_view(DisplaySSD1306_128x64_I2C &d,
+                               std::shared_ptr<menu_state> menu_state,
+                               std::shared_ptr<inventory> invent)
+        : menu_view(d, menu_state, invent)
+        , m_item(presets_item::ACTIVE)
+        , m_editing(false)
+        , m_copy_target((m_inventory->get_active_preset() + 1) % k_max_presets) {
+        // nothing to do
+    }
+
+    presets_view::~presets_view() {
+        // nothing to do
+    }
+
+    void presets_view::preset_changed() {
+        // switched by Program Change, show the new active preset
+        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+        notify(a);
+    }
+
+    void presets_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                {
+                const auto& stats = m_inventory->get_preset_stats();
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(0, 0, "Presets", STYLE_NORMAL);
+                draw_item(presets_item::ACTIVE, 8, "Active:");
+                draw_item(presets_item::CONTROL_CHANNEL, 16, "PC channel:");
+                draw_item(presets_item::COPY_TARGET, 24, "Copy to:");
+                m_display.printFixed(0, 40, "Switch [us]:", STYLE_NORMAL);
+                m_display.setTextCursor(78, 40);
+                m_display.print(static_cast<int>(stats.last_switch_us));
+                m_display.printFixed(0, 48, "Max [us]:", STYLE_NORMAL);
+                m_display.setTextCursor(78, 48);
+                m_display.print(static_cast<int>(stats.max_switch_us));
+                m_display.printFixed(0, 56, "Switches:", STYLE_NORMAL);
+                m_display.setTextCursor(78, 56);
+                m_display.print(stats.switch_count);
+                break;
+                }
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    if (m_editing) {
+                        change_value(1);
+                    } else {
+                        m_item = (m_item + 1) % presets_item::_ITEM_COUNT_;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_editing) {
+                        change_value(-1);
+                    } else {
+                        m_item = (m_item + presets_item::_ITEM_COUNT_ - 1) % presets_item::_ITEM_COUNT_;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    // the copy is done when leaving the edit mode
+                    if (m_editing && m_item == presets_item::COPY_TARGET) {
+                        m_inventory->copy_preset(m_copy_target);
+                    }
+                    m_editing = !m_editing;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to setup_view
+                    auto v = std::make_shared<setup_view>(m_display, m_menu_state, m_inventory);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void presets_view::change_value(const i8 direction) {
+        switch (m_item) {
+            case presets_item::ACTIVE :
+                // switches right away, the view follows through preset_changed
+                m_inventory->select_preset((m_inventory->get_active_preset() + k_max_presets + direction) % k_max_presets);
+                break;
+            case presets_item::CONTROL_CHANNEL :
+                // 0 is off, then channels 1...16
+                m_inventory->set_control_channel((m_inventory->get_control_channel() + 17 + direction) % 17);
+                break;
+            case presets_item::COPY_TARGET :
+                do {
+                    m_copy_target = (m_copy_target + k_max_presets + direction) % k_max_presets;
+                } while (m_copy_target == m_inventory->get_active_preset());
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void presets_view::draw_item(const u8 item, const u8 y, const char *label) const {
+        if (m_item == item) {
+            m_display.printFixed(0, y, m_editing ? "*" : ">", STYLE_NORMAL);
+        }
+        m_display.printFixed(8, y, label, STYLE_NORMAL);
+        int value;
+        switch (item) {
+            case presets_item::ACTIVE :
+                value = m_inventory->get_active_preset() + 1;
+                break;
+            case presets_item::CONTROL_CHANNEL :
+                if (!m_inventory->get_control_channel()) {
+                    m_display.printFixed(78, y, "off", STYLE_NORMAL);
+                    return;
+                }
+                value = m_inventory->get_control_channel();
+                break;
+            case presets_item::COPY_TARGET :
+                value = m_copy_target + 1;
+                break;
+            default :
+                return;
+        }
+        m_display.setTextCursor(78, y);
+        m_display.print(value);
+    }
+
+    save_view::save_view(DisplaySSD1306_128x64_I2C &d,
+                         std::shared_ptr<menu_state> menu_state,
+                         std::shared_ptr<inventory> invent)
+        : menu_view(d, menu_state, invent)
+        , m_menu_q(m_inventory->get_menu_queue())
+        , m_poll_queued(false)
+        , m_last_draw(millis()) {
+        // nothing to do
+    }
+
+    save_view::~save_view() {
+        // nothing to do
+    }
 
-                // draw port value
-                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "   ", STYLE_NORMAL);
-                m_display.setTextCursor(xoffset+m_port_value_xoffset, yoffset);
-                m_display.print(port_value);
-                break;
-            case menu_action::subkind::PORT_ACTIVE_CC :
-                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "   ", STYLE_NORMAL);
-                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "CC", STYLE_NORMAL);
+    void save_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                {
+                // m_data0 marks the polling updates queued by this view
+                if (a.m_data0 == k_poll_update) {
+                    m_poll_queued = false;
+                }
+                const u32 now = millis();
+                if (m_inventory->is_saving()) {
+                    if (a.m_data0 != k_poll_update || now - m_last_draw >= k_progress_refresh_ms) {
+                        draw_progress();
+                        m_last_draw = now;
+                    }
+                    poll();
+                } else {
+                    // the result stays until the view is left
+                    draw_result();
+                }
                 break;
-            case menu_action::subkind::PORT_ACTIVE_CLK :
-                m_display.printFixed(xoffset+m_activitydot_xoffset, yoffset, "*", STYLE_NORMAL);
-                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "   ", STYLE_NORMAL);
-                m_display.printFixed(xoffset+m_port_value_xoffset, yoffset, "CLK", STYLE_NORMAL);
+                }
+            case menu_action::kind::ROT_ACTIVITY :
+                if (a.m_subkind == menu_action::subkind::ROT_BUTTON
+                    || a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to setup_view, a running save goes on
+                    auto v = std::make_shared<setup_view>(m_display, m_menu_state, m_inventory);
+                    m_menu_state->register_view(v);
+                }
                 break;
             default :
                 // nothing to do
@@ -465,118 +1521,118 @@ namespace midimagic {
         }
     }
 
-    void over_view::draw_inactivity(const int port_number) const {
-        m_display.setFixedFont(ssd1306xled_font5x7);
-        // draw space over activity dot
-        if (port_number < 4) {
-            m_display.printFixed(port_number*32+m_activitydot_xoffset, m_activity_yoffset, " ", STYLE_NORMAL);
+    void save_view::poll() {
+        // keep exactly one polling update in the queue
+        if (!m_poll_queued) {
+            menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB, k_poll_update);
+            m_menu_q->add_menu_action(a);
+            m_poll_queued = true;
+        }
+    }
+
+    void save_view::draw_progress() const {
+        const u8 progress = m_inventory->get_save_progress();
+        m_display.clear();
+        m_display.setFixedFont(ssd1306xled_font6x8);
+        m_display.printFixed(4, 8, "Saving setup");
+        m_display.drawRect(4, 24, 123, 32);
+        m_display.fillRect(4, 24, 4 + (119 * progress) / 100, 32);
+        m_display.setTextCursor(4, 40);
+        m_display.print(progress);
+        m_display.printFixed(28, 40, "%");
+    }
+
+    void save_view::draw_result() const {
+        const auto& stats = m_inventory->get_storage_stats();
+        m_display.clear();
+        m_display.setFixedFont(ssd1306xled_font6x8);
+        if (stats.last_save_result == config_archive::operation_result::SUCCESS) {
+            m_display.printFixed(4, 8, "Setup Saved");
+            m_display.printFixed(4, 24, "Written: ");
+            m_display.setTextCursor(64, 24);
+            m_display.print(stats.last_save_written);
+            m_display.printFixed(4, 32, "Skipped: ");
+            m_display.setTextCursor(64, 32);
+            m_display.print(stats.last_save_skipped);
         } else {
-            m_display.printFixed((port_number-4)*32+m_activitydot_xoffset, m_activity_yoffset+m_rowoffset, " ", STYLE_NORMAL);
+            m_display.printFixed(4, 8, "Error while saving");
+            m_display.printFixed(4, 24, "Error: ");
+            m_display.setTextCursor(46, 24);
+            m_display.print(stats.last_save_result);
         }
     }
 
-    setup_view::setup_view(DisplaySSD1306_128x64_I2C &d,
-                           std::shared_ptr<menu_state> menu_state,
-                           std::shared_ptr<inventory> invent)
+    midi_monitor_view::midi_monitor_view(DisplaySSD1306_128x64_I2C &d,
+                                         std::shared_ptr<menu_state> menu_state,
+                                         std::shared_ptr<inventory> invent)
         : menu_view(d, menu_state, invent)
-        , m_menu_items{"Setup port groups",
-                       "Go to overview",
-                       "Load stored config",
-                       "Store setup"}
-        , m_setup_menu_dimensions{NanoPoint{0, 0}, NanoPoint{127, 63}}
-        {
-        setup_menu = std::make_unique<LcdGfxMenu>(m_menu_items, 4, m_setup_menu_dimensions);
+        , m_monitor(m_inventory->get_group_dispatcher()->get_monitor())
+        , m_menu_q(m_inventory->get_menu_queue())
+        , m_page(monitor_page::MESSAGES)
+        , m_paused(false)
+        , m_poll_queued(false)
+        , m_last_draw(millis())
+        , m_last_write_count(0)
+        , m_rate_time(millis())
+        , m_rates{} {
+        for (u8 slot = 0; slot < midi_monitor::k_channel_slots; slot++) {
+            m_last_counts[slot] = m_monitor.get_channel_count(slot);
+        }
     }
 
-    setup_view::~setup_view() {
+    midi_monitor_view::~midi_monitor_view() {
         // nothing to do
     }
 
-    void setup_view::notify(const menu_action &a) {
-
+    void midi_monitor_view::notify(const menu_action &a) {
         switch (a.m_kind) {
             case menu_action::kind::UPDATE :
-                m_display.clear();
-                m_display.setFixedFont(ssd1306xled_font6x8);
-                setup_menu->show(m_display);
+                {
+                // m_data0 marks the polling updates queued by this view
+                if (a.m_data0 == k_poll_update) {
+                    m_poll_queued = false;
+                }
+                const u32 now = millis();
+                if (a.m_data0 != k_poll_update || redraw_due(now)) {
+                    m_display.clear();
+                    m_display.setFixedFont(ssd1306xled_font6x8);
+                    switch (m_page) {
+                        case monitor_page::MESSAGES :
+                            draw_messages();
+                            break;
+                        case monitor_page::RATES :
+                            update_rates(now);
+                            draw_rates();
+                            break;
+                        default :
+                            // nothing to do
+                            break;
+                    }
+                    m_last_draw = now;
+                }
+                poll();
                 break;
+                }
             case menu_action::kind::ROT_ACTIVITY :
-                switch (a.m_subkind) {
-                    case menu_action::subkind::ROT_BUTTON :
-                        switch (setup_menu->selection()) {
-                            case 0 :
-                                if (!m_inventory->get_group_dispatcher()->get_port_groups().empty()) {
-                                    auto gd = m_inventory->get_group_dispatcher();
-                                    auto v = std::make_shared<portgroup_view>(m_display,
-                                                                              m_menu_state,
-                                                                              m_inventory,
-                                                                             (gd->get_port_groups()).begin());
-                                    m_menu_state->register_view(v);
-                                } else {
-                                    auto v = std::make_shared<add_portgroup_view>(m_display,
-                                                                                  m_menu_state,
-                                                                                  m_inventory);
-                                    m_menu_state->register_view(v);
-                                }
-                                break;
-                            case 1 :
-                                {
-                                auto v = std::make_shared<over_view>(m_display, m_menu_state, m_inventory);
-                                m_menu_state->register_view(v);
-                                break;
-                                }
-                            case 2 :
-                                {
-                                m_display.clear();
-                                auto return_code = m_inventory->load_config_from_eeprom();
-                                if (return_code == config_archive::operation_result::SUCCESS) {
-                                    m_display.printFixed(4, 8, "Config Loaded");
-                                } else {
-                                    m_display.printFixed(4, 8, "Error while loading");
-                                    m_display.printFixed(4, 24, "Error: ");
-                                    m_display.setTextCursor(46, 24);
-                                    m_display.print(return_code);
-                                }
-                                delay(3000);
-                                // refresh screen
-                                menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
-                                m_menu_state->notify(a);
-                                break;
-                                }
-                            case 3 :
-                                {
-                                m_display.clear();
-                                auto return_code = m_inventory->save_system_state();
-                                if (return_code == config_archive::operation_result::SUCCESS) {
-                                    m_display.printFixed(4, 8, "Setup Saved");
-                                } else {
-                                    m_display.printFixed(4, 8, "Error while saving");
-                                    m_display.printFixed(4, 24, "Error: ");
-                                    m_display.setTextCursor(46, 24);
-                                    m_display.print(return_code);
-                                }
-                                delay(3000);
-                                // refresh screen
-                                menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
-                                m_menu_state->notify(a);
-                                break;
-                                }
-                            default :
-                                // nothing to do
-                                break;
-                        }
-                        break;
-                    case menu_action::subkind::ROT_RIGHT :
-                        setup_menu->down();
-                        setup_menu->show(m_display);
-                        break;
-                    case menu_action::subkind::ROT_LEFT :
-                        setup_menu->up();
-                        setup_menu->show(m_display);
-                        break;
-                    default :
-                        // nothing to do
-                        break;
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    m_page = (m_page + 1) % monitor_page::_PAGE_COUNT_;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    m_page = (m_page + monitor_page::_PAGE_COUNT_ - 1) % monitor_page::_PAGE_COUNT_;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    // Freeze or resume the display, recording goes on
+                    m_paused = !m_paused;
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to setup_view
+                    auto v = std::make_shared<setup_view>(m_display, m_menu_state, m_inventory);
+                    m_menu_state->register_view(v);
                 }
                 break;
             default :
@@ -585,10 +1641,102 @@ namespace midimagic {
         }
     }
 
+    void midi_monitor_view::poll() {
+        // keep exactly one polling update in the queue
+        if (!m_poll_queued) {
+            menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB, k_poll_update);
+            m_menu_q->add_menu_action(a);
+            m_poll_queued = true;
+        }
+    }
+
+    const bool midi_monitor_view::redraw_due(const u32 now) const {
+        if (m_paused) {
+            return false;
+        }
+        switch (m_page) {
+            case monitor_page::MESSAGES :
+                return (now - m_last_draw >= k_message_refresh_ms)
+                    && (m_monitor.get_write_count() != m_last_write_count);
+            case monitor_page::RATES :
+                return now - m_last_draw >= k_rate_refresh_ms;
+            default :
+                return false;
+        }
+    }
+
+    void midi_monitor_view::update_rates(const u32 now) {
+        const u32 elapsed = now - m_rate_time;
+        // keep the last rates on early redraws, short windows are too noisy
+        if (elapsed < k_rate_refresh_ms) {
+            return;
+        }
+        for (u8 slot = 0; slot < midi_monitor::k_channel_slots; slot++) {
+            const u32 count = m_monitor.get_channel_count(slot);
+            m_rates[slot] = ((count - m_last_counts[slot]) * 1000) / elapsed;
+            m_last_counts[slot] = count;
+        }
+        m_rate_time = now;
+    }
+
+    void midi_monitor_view::draw_messages() {
+        midi_monitor::entry entries[k_message_rows];
+        m_last_write_count = m_monitor.get_write_count();
+        const u8 count = m_monitor.snapshot(entries, k_message_rows);
+
+        m_display.printFixed(0, 0, m_paused ? "Hold" : "Time", STYLE_NORMAL);
+        m_display.printFixed(36, 0, "Ch Type D0  D1", STYLE_NORMAL);
+        if (!count) {
+            m_display.printFixed(0, 24, "No messages yet", STYLE_NORMAL);
+            return;
+        }
+        for (u8 row = 0; row < count; row++) {
+            const auto& e = entries[row];
+            const u8 y = (row + 1) * 8;
+            // tenths of a second since boot
+            m_display.setTextCursor(0, y);
+            m_display.print(static_cast<int>((e.timestamp / 100) % 10000));
+            if (e.type > midi_message::message_type::SYSTEM_MESSAGE) {
+                m_display.printFixed(36, y, "--", STYLE_NORMAL);
+                m_display.printFixed(54, y, midi_msgtype2shortname(e.type), STYLE_NORMAL);
+            } else {
+                m_display.setTextCursor(36, y);
+                m_display.print(e.channel);
+                m_display.printFixed(54, y, midi_msgtype2shortname(e.type), STYLE_NORMAL);
+                m_display.setTextCursor(84, y);
+                m_display.print(e.data0);
+                m_display.setTextCursor(108, y);
+                m_display.print(e.data1);
+            }
+        }
+    }
+
+    void midi_monitor_view::draw_rates() const {
+        u32 total = 0;
+        m_display.printFixed(0, 0, m_paused ? "Rates [msg/s] Hold" : "Rates [msg/s]", STYLE_NORMAL);
+        for (u8 slot = 0; slot < midi_monitor::k_channel_slots; slot++) {
+            const u8 x = (slot / 6) * 42;
+            const u8 y = 8 + (slot % 6) * 8;
+            if (slot == midi_monitor::k_system_slot) {
+                m_display.printFixed(x, y, "Sy", STYLE_NORMAL);
+            } else {
+                m_display.setTextCursor(x, y);
+                m_display.print(slot + 1);
+            }
+            m_display.printFixed(x + 12, y, ":", STYLE_NORMAL);
+            m_display.setTextCursor(x + 18, y);
+            m_display.print(static_cast<int>(m_rates[slot]));
+            total += m_rates[slot];
+        }
+        m_display.printFixed(0, 56, "All:", STYLE_NORMAL);
+        m_display.setTextCursor(30, 56);
+        m_display.print(static_cast<int>(total));
+    }
+
     portgroup_view::portgroup_view(DisplaySSD1306_128x64_I2C &d,
                                    std::shared_ptr<menu_state> menu_state,
                                    std::shared_ptr<inventory> invent,
-                                   const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+                                   const port_group_list::const_iterator group_it)
         : menu_view(d, menu_state, invent)
         , m_group_dispatcher(*(m_inventory->get_group_dispatcher()))
         , m_cur_group_it(group_it)
@@ -602,6 +1750,12 @@ namespace midimagic {
         // nothing to do
     }
 
+    void portgroup_view::preset_changed() {
+        // the port group list changed underneath, switch to over_view
+        auto v = std::make_shared<over_view>(m_display, m_menu_state, m_inventory);
+        m_menu_state->register_view(v);
+    }
+
     void portgroup_view::notify(const menu_action &a) {
         switch (m_current_menu_layer) {
             case menu_layer::TOP :
@@ -753,6 +1907,9 @@ namespace midimagic {
         m_display.printFixed(0, 16, "Ch: ", STYLE_NORMAL);
         m_display.setTextCursor(28, 16);
         m_display.print(m_port_group.get_midi_channel());
+        if (m_port_group.get_mpe()) {
+            m_display.printFixed(42, 16, "M", STYLE_NORMAL);
+        }
 
         u8 i = 0;
         for (auto &msg_type: m_port_group.get_msg_types()) {
@@ -766,6 +1923,9 @@ namespace midimagic {
         m_display.printFixed(66, 16, "Demux: ", STYLE_NORMAL);
         demux_type type = (m_port_group.get_demux()).get_type();
         m_display.printFixed(100, 16, demux_type2name(type), STYLE_NORMAL);
+        if (m_port_group.get_arp_mode() != arpeggiator::arp_mode::OFF) {
+            m_display.printFixed(66, 56, "Arp", STYLE_NORMAL);
+        }
 
         auto& out_ports = (m_port_group.get_demux()).get_output();
         u8 row = 0, index = 0;
@@ -787,7 +1947,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it,
+        const port_group_list::const_iterator group_it,
         const menu_pane io_switch)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_io_switch(io_switch)
@@ -796,12 +1956,16 @@ namespace midimagic {
                                   "Remove MIDI input",
                                   "Delete this portgroup",
                                   "Set Controller",
-                                  "Learn MIDI input"}
+                                  "Learn MIDI input",
+                                  "MPE zone"}
         , m_outs_config_menu_items{"Set demuxer",
                                    "Add port",
                                    "Remove port",
                                    "Delete this portgroup",
-                                   "Set transpose"}
+                                   "Set transpose",
+                                   "Poly pressure to",
+                                   "Arpeggiator",
+                                   "Looper"}
         , m_config_menu_dimensions{NanoPoint{0, 8}, NanoPoint{127, 63}}
         {
         switch (m_io_switch) {
@@ -892,6 +2056,7 @@ namespace midimagic {
                         auto gd = m_inventory->get_group_dispatcher();
                         auto pg_id = m_port_group.get_id();
                         gd->remove_port_group(pg_id);
+                        m_inventory->mark_config_changed();
                         // Switch to portgroup_view
                         // check if there is at least 1 port group left
                         if (!gd->get_port_groups().empty()) {
@@ -920,6 +2085,13 @@ namespace midimagic {
                                                                                    m_inventory,
                                                                                    m_cur_group_it);
                         m_menu_state->register_view(v);
+                    } else if ((config_menu->selection() == 5) && (m_io_switch == menu_pane::OUTS_PANE)) {
+                        // Switch to config_portgroup_pressure_view
+                        auto v = std::make_shared<config_portgroup_pressure_view>(m_display,
+                                                                                  m_menu_state,
+                                                                                  m_inventory,
+                                                                                  m_cur_group_it);
+                        m_menu_state->register_view(v);
                     } else if ((config_menu->selection() == 5) && (m_io_switch == menu_pane::INS_PANE)) {
                         // Switch to config_portgroup_learn_msg_view
                         auto v = std::make_shared<config_portgroup_learn_msg_view>(m_display,
@@ -927,6 +2099,27 @@ namespace midimagic {
                                                                                    m_inventory,
                                                                                    m_cur_group_it);
                         m_menu_state->register_view(v);
+                    } else if ((config_menu->selection() == 6) && (m_io_switch == menu_pane::OUTS_PANE)) {
+                        // Switch to config_portgroup_arp_view
+                        auto v = std::make_shared<config_portgroup_arp_view>(m_display,
+                                                                             m_menu_state,
+                                                                             m_inventory,
+                                                                             m_cur_group_it);
+                        m_menu_state->register_view(v);
+                    } else if ((config_menu->selection() == 7) && (m_io_switch == menu_pane::OUTS_PANE)) {
+                        // Switch to config_portgroup_looper_view
+                        auto v = std::make_shared<config_portgroup_looper_view>(m_display,
+                                                                                m_menu_state,
+                                                                                m_inventory,
+                                                                                m_cur_group_it);
+                        m_menu_state->register_view(v);
+                    } else if ((config_menu->selection() == 6) && (m_io_switch == menu_pane::INS_PANE)) {
+                        // Switch to config_portgroup_mpe_view
+                        auto v = std::make_shared<config_portgroup_mpe_view>(m_display,
+                                                                             m_menu_state,
+                                                                             m_inventory,
+                                                                             m_cur_group_it);
+                        m_menu_state->register_view(v);
                     }
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
                     // Switch back to portgroup_view
@@ -947,7 +2140,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_channel(1) {
         // nothing to do
@@ -984,6 +2177,7 @@ namespace midimagic {
                     }
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     m_port_group.set_midi_channel(m_channel);
+                    m_inventory->mark_config_changed();
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1010,7 +2204,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_demux(demux_type::FIFO) {
         // nothing to do
@@ -1041,6 +2235,7 @@ namespace midimagic {
                     m_menu_state->notify(a);
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     m_port_group.set_demux(m_demux);
+                    m_inventory->mark_config_changed();
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1067,14 +2262,14 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , k_message_menu_dimensions{NanoPoint{0, 8}, NanoPoint{127, 63}}
         , m_msg_names(midi_message_type_long_names)
         {
         m_message_menu = std::make_unique<LcdGfxMenu>(m_msg_names,
             //FIXME adjust size if midi_message_type_long_names is changed
-            8,
+            9,
             k_message_menu_dimensions);
     }
 
@@ -1101,6 +2296,7 @@ namespace midimagic {
                     u8 sel_msg_code = m_message_menu->selection() + midi_message::message_type::NOTE_OFF;
                     if (sel_msg_code < 0xf) {
                         m_port_group.add_midi_input(static_cast<midi_message::message_type>(sel_msg_code));
+                        m_inventory->mark_config_changed();
                         if (static_cast<midi_message::message_type>(sel_msg_code) == midi_message::message_type::CONTROL_CHANGE) {
                             // Switch to config_portgroup_cc_msg_view
                             auto v = std::make_shared<config_portgroup_cc_msg_view>(m_display,
@@ -1112,6 +2308,17 @@ namespace midimagic {
                         }
                     } else if (m_message_menu->selection() == 7) {
                         m_port_group.add_midi_input(midi_message::message_type::CLOCK);
+                        m_inventory->mark_config_changed();
+                    } else if (m_message_menu->selection() == 8) {
+                        m_port_group.add_midi_input(midi_message::message_type::PARAMETER);
+                        m_inventory->mark_config_changed();
+                        // Switch to config_portgroup_nrpn_view
+                        auto v = std::make_shared<config_portgroup_nrpn_view>(m_display,
+                                                                              m_menu_state,
+                                                                              m_inventory,
+                                                                              m_cur_group_it);
+                        m_menu_state->register_view(v);
+                        return;
                     }
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
@@ -1135,53 +2342,132 @@ namespace midimagic {
         }
     }
 
-    config_portgroup_cc_msg_view::config_portgroup_cc_msg_view(
+    config_portgroup_cc_msg_view::config_portgroup_cc_msg_view(
+        DisplaySSD1306_128x64_I2C &d,
+        std::shared_ptr<menu_state> menu_state,
+        std::shared_ptr<inventory> invent,
+        const port_group_list::const_iterator group_it)
+        : portgroup_view(d, menu_state, invent, group_it)
+        , m_cc_number(m_port_group.get_cc()) {
+        // nothing to do
+    }
+
+    config_portgroup_cc_msg_view::~config_portgroup_cc_msg_view() {
+        // nothing to do
+    }
+
+    void config_portgroup_cc_msg_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(4, 0, "Select a controller:", STYLE_NORMAL);
+                m_display.setTextCursor(4, 20);
+                m_display.print(m_cc_number);
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    m_cc_number++;
+                    if (m_cc_number > 127) {
+                        m_cc_number = 0;
+                    } else if (m_cc_number == 32) {
+                        m_cc_number = 64;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_cc_number == 64) {
+                        m_cc_number = 31;
+                    } else if (m_cc_number > 0) {
+                        m_cc_number--;
+                    } else if (m_cc_number == 0) {
+                        m_cc_number = 127;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    m_port_group.set_cc(m_cc_number);
+                    m_inventory->mark_config_changed();
+                    // Switch to portgroup_view
+                    auto v = std::make_shared<portgroup_view>(m_display,
+                                                              m_menu_state,
+                                                              m_inventory,
+                                                              m_cur_group_it);
+                    m_menu_state->register_view(v);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch to portgroup_view
+                    auto v = std::make_shared<portgroup_view>(m_display,
+                                                              m_menu_state,
+                                                              m_inventory,
+                                                              m_cur_group_it);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    config_portgroup_nrpn_view::config_portgroup_nrpn_view(
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
-        , m_cc_number(m_port_group.get_cc()) {
+        , m_nrpn_msb(m_port_group.get_nrpn() >> 7)
+        , m_nrpn_lsb(m_port_group.get_nrpn() & 0x7f)
+        , m_editing_lsb(false) {
         // nothing to do
     }
 
-    config_portgroup_cc_msg_view::~config_portgroup_cc_msg_view() {
+    config_portgroup_nrpn_view::~config_portgroup_nrpn_view() {
         // nothing to do
     }
 
-    void config_portgroup_cc_msg_view::notify(const menu_action &a) {
+    void config_portgroup_nrpn_view::notify(const menu_action &a) {
         switch (a.m_kind) {
             case menu_action::kind::UPDATE :
                 m_display.clear();
                 m_display.setFixedFont(ssd1306xled_font6x8);
-                m_display.printFixed(4, 0, "Select a controller:", STYLE_NORMAL);
-                m_display.setTextCursor(4, 20);
-                m_display.print(m_cc_number);
+                m_display.printFixed(4, 0, "Select an NRPN:", STYLE_NORMAL);
+                m_display.printFixed(4, 20, "MSB:", STYLE_NORMAL);
+                m_display.setTextCursor(34, 20);
+                m_display.print(m_nrpn_msb);
+                m_display.printFixed(64, 20, "LSB:", STYLE_NORMAL);
+                m_display.setTextCursor(94, 20);
+                m_display.print(m_nrpn_lsb);
+                // mark the edited half
+                m_display.printFixed(m_editing_lsb ? 94 : 34, 28, "^", STYLE_NORMAL);
+                m_display.printFixed(4, 40, "Number:", STYLE_NORMAL);
+                m_display.setTextCursor(52, 40);
+                m_display.print((m_nrpn_msb << 7) | m_nrpn_lsb);
                 break;
             case menu_action::kind::ROT_ACTIVITY :
                 if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
-                    m_cc_number++;
-                    if (m_cc_number > 127) {
-                        m_cc_number = 0;
-                    } else if (m_cc_number == 32) {
-                        m_cc_number = 64;
-                    }
+                    u8& half = m_editing_lsb ? m_nrpn_lsb : m_nrpn_msb;
+                    half = (half + 1) & 0x7f;
                     // Trigger display update
                     menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
                     m_menu_state->notify(a);
                 } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
-                    if (m_cc_number == 64) {
-                        m_cc_number = 31;
-                    } else if (m_cc_number > 0) {
-                        m_cc_number--;
-                    } else if (m_cc_number == 0) {
-                        m_cc_number = 127;
-                    }
+                    u8& half = m_editing_lsb ? m_nrpn_lsb : m_nrpn_msb;
+                    half = (half - 1) & 0x7f;
                     // Trigger display update
                     menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
                     m_menu_state->notify(a);
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
-                    m_port_group.set_cc(m_cc_number);
+                    if (!m_editing_lsb) {
+                        m_editing_lsb = true;
+                        // Trigger display update
+                        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                        m_menu_state->notify(a);
+                        return;
+                    }
+                    m_port_group.set_nrpn((m_nrpn_msb << 7) | m_nrpn_lsb);
+                    m_inventory->mark_config_changed();
                     // Switch to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1207,7 +2493,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_control(0)
         , m_capture_msg(midi_message::message_type::NOTE_OFF, 1, 0, 0)
@@ -1271,6 +2557,7 @@ namespace midimagic {
 
                     } else if (m_control == 3 && learn_menu->selection() == 0) {
                         m_port_group.add_midi_input(m_capture_msg.type);
+                        m_inventory->mark_config_changed();
                         m_port_group.set_midi_channel(m_capture_msg.channel);
                         if (m_capture_msg.type == midi_message::message_type::CONTROL_CHANGE) {
                             m_port_group.set_cc(m_capture_msg.data0);
@@ -1326,7 +2613,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , k_message_menu_dimensions{NanoPoint{0, 8}, NanoPoint{127, 63}}
         , m_msg_types(m_port_group.get_msg_types())
@@ -1365,6 +2652,7 @@ namespace midimagic {
                     break;
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     m_port_group.remove_msg_type(m_msg_types.at(m_message_menu->selection()));
+                    m_inventory->mark_config_changed();
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1391,7 +2679,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_port_number(1) {
         // nothing to do
@@ -1429,6 +2717,7 @@ namespace midimagic {
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     auto out_port = m_inventory->get_output_port(m_port_number-1);
                     m_port_group.add_port(out_port);
+                    m_inventory->mark_config_changed();
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1455,7 +2744,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_port_selection(0) {
         const auto& out_ports = (m_port_group.get_demux()).get_output();
@@ -1496,6 +2785,7 @@ namespace midimagic {
                     }
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     m_port_group.remove_port(m_port_numbers.at(m_port_selection));
+                    m_inventory->mark_config_changed();
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1522,7 +2812,7 @@ namespace midimagic {
         DisplaySSD1306_128x64_I2C &d,
         std::shared_ptr<menu_state> menu_state,
         std::shared_ptr<inventory> invent,
-        const std::vector<std::unique_ptr<port_group>>::const_iterator group_it)
+        const port_group_list::const_iterator group_it)
         : portgroup_view(d, menu_state, invent, group_it)
         , m_transpose_offset(m_port_group.get_transpose()) {
         // nothing to do
@@ -1555,6 +2845,296 @@ namespace midimagic {
                     m_menu_state->notify(a);
                 } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
                     m_port_group.set_transpose(m_transpose_offset);
+                    m_inventory->mark_config_changed();
+                    // Switch back to portgroup_view
+                    auto v = std::make_shared<portgroup_view>(m_display,
+                                                              m_menu_state,
+                                                              m_inventory,
+                                                              m_cur_group_it);
+                    m_menu_state->register_view(v);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to config output menu
+                    auto v = std::make_shared<config_portgroup_view>(m_display,
+                                                                     m_menu_state,
+                                                                     m_inventory,
+                                                                     m_cur_group_it,
+                                                                     menu_pane::OUTS_PANE);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
+    config_portgroup_mpe_view::config_portgroup_mpe_view(
+        DisplaySSD1306_128x64_I2C &d,
+        std::shared_ptr<menu_state> menu_state,
+        std::shared_ptr<inventory> invent,
+        const port_group_list::const_iterator group_it)
+        : portgroup_view(d, menu_state, invent, group_it)
+        , m_item(mpe_item::MPE_OFF)
+        , m_members(m_port_group.get_mpe_members())
+        , m_editing_members(false)
+        , m_timbre(m_port_group.get_mpe_timbre())
+        , m_editing_timbre(false) {
+        if (m_port_group.get_mpe()) {
+            m_item = (m_port_group.get_midi_channel() < 9) ? mpe_item::LOWER_ZONE : mpe_item::UPPER_ZONE;
+        }
+    }
+
+    config_portgroup_mpe_view::~config_portgroup_mpe_view() {
+        // nothing to do
+    }
+
+    void config_portgroup_mpe_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(4, 0, "MPE zone:", STYLE_NORMAL);
+                switch (m_item) {
+                    case mpe_item::MPE_OFF :
+                        m_display.printFixed(4, 20, "Off", STYLE_NORMAL);
+                        break;
+                    case mpe_item::LOWER_ZONE :
+                        m_display.printFixed(4, 20, "Lower zone", STYLE_NORMAL);
+                        m_display.printFixed(4, 36, "Master ch 1", STYLE_NORMAL);
+                        m_display.printFixed(4, 44, "Members ch 2-", STYLE_NORMAL);
+                        m_display.setTextCursor(82, 44);
+                        m_display.print(1 + m_members);
+                        break;
+                    case mpe_item::UPPER_ZONE :
+                        m_display.printFixed(4, 20, "Upper zone", STYLE_NORMAL);
+                        m_display.printFixed(4, 36, "Master ch 16", STYLE_NORMAL);
+                        m_display.printFixed(4, 44, "Members ch", STYLE_NORMAL);
+                        m_display.setTextCursor(70, 44);
+                        m_display.print(16 - m_members);
+                        m_display.print("-15");
+                        break;
+                    default :
+                        // nothing to do
+                        break;
+                }
+                if (m_item != mpe_item::MPE_OFF) {
+                    m_display.printFixed(4, 52, "Timbre", STYLE_NORMAL);
+                    if (m_timbre) {
+                        m_display.printFixed(46, 52, "port +", STYLE_NORMAL);
+                        m_display.setTextCursor(82, 52);
+                        m_display.print(m_timbre);
+                    } else {
+                        m_display.printFixed(46, 52, "off", STYLE_NORMAL);
+                    }
+                }
+                if (m_editing_members) {
+                    m_display.printFixed(116, 44, "*", STYLE_NORMAL);
+                } else if (m_editing_timbre) {
+                    m_display.printFixed(116, 52, "*", STYLE_NORMAL);
+                }
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    if (m_editing_members) {
+                        m_members = (m_members < 15) ? m_members + 1 : 15;
+                    } else if (m_editing_timbre) {
+                        // offset 4 is the companion taking the pressure
+                        m_timbre = (m_timbre == 3) ? 5 : (m_timbre < 7) ? m_timbre + 1 : 7;
+                    } else {
+                        m_item = (m_item + 1) % mpe_item::_ITEM_COUNT_;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_editing_members) {
+                        m_members = (m_members > 1) ? m_members - 1 : 1;
+                    } else if (m_editing_timbre) {
+                        m_timbre = (m_timbre == 5) ? 3 : (m_timbre > 0) ? m_timbre - 1 : 0;
+                    } else {
+                        m_item = (m_item + mpe_item::_ITEM_COUNT_ - 1) % mpe_item::_ITEM_COUNT_;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    if (m_item != mpe_item::MPE_OFF && !m_editing_members && !m_editing_timbre) {
+                        // zone chosen, the member count comes next
+                        m_editing_members = true;
+                        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                        m_menu_state->notify(a);
+                        break;
+                    } else if (m_editing_members) {
+                        // then the timbre port
+                        m_editing_members = false;
+                        m_editing_timbre = true;
+                        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                        m_menu_state->notify(a);
+                        break;
+                    }
+                    if (m_item == mpe_item::MPE_OFF) {
+                        m_port_group.set_mpe(false);
+                    } else {
+                        // notes of the old channel setup must not hang
+                        m_port_group.release_notes();
+                        m_port_group.set_midi_channel((m_item == mpe_item::LOWER_ZONE) ? 1 : 16);
+                        m_port_group.set_mpe(true);
+                        m_port_group.set_mpe_members(m_members);
+                        m_port_group.set_mpe_timbre(m_timbre);
+                    }
+                    m_inventory->mark_config_changed();
+                    // Switch back to portgroup_view
+                    auto v = std::make_shared<portgroup_view>(m_display,
+                                                              m_menu_state,
+                                                              m_inventory,
+                                                              m_cur_group_it);
+                    m_menu_state->register_view(v);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to config input menu
+                    auto v = std::make_shared<config_portgroup_view>(m_display,
+                                                                     m_menu_state,
+                                                                     m_inventory,
+                                                                     m_cur_group_it,
+                                                                     menu_pane::INS_PANE);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
+    config_portgroup_pressure_view::config_portgroup_pressure_view(
+        DisplaySSD1306_128x64_I2C &d,
+        std::shared_ptr<menu_state> menu_state,
+        std::shared_ptr<inventory> invent,
+        const port_group_list::const_iterator group_it)
+        : portgroup_view(d, menu_state, invent, group_it)
+        , m_to_companion(m_port_group.get_pressure_to_companion()) {
+        // nothing to do
+    }
+
+    config_portgroup_pressure_view::~config_portgroup_pressure_view() {
+        // nothing to do
+    }
+
+    void config_portgroup_pressure_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(4, 0, "Poly pressure to:", STYLE_NORMAL);
+                if (m_to_companion) {
+                    m_display.printFixed(4, 20, "Companion port", STYLE_NORMAL);
+                    m_display.printFixed(4, 36, "(1<>5, 2<>6, ...)", STYLE_NORMAL);
+                    if (m_port_group.get_mpe()) {
+                        // the voice ports carry the pitch of the zone
+                        m_display.printFixed(4, 52, "Fixed in MPE zone", STYLE_NORMAL);
+                    }
+                } else {
+                    m_display.printFixed(4, 20, "Voice port", STYLE_NORMAL);
+                }
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        ((a.m_subkind == menu_action::subkind::ROT_RIGHT)
+                        || (a.m_subkind == menu_action::subkind::ROT_LEFT)) {
+                    m_to_companion = !m_to_companion || m_port_group.get_mpe();
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    m_port_group.set_pressure_to_companion(m_to_companion);
+                    m_inventory->mark_config_changed();
+                    // Switch back to portgroup_view
+                    auto v = std::make_shared<portgroup_view>(m_display,
+                                                              m_menu_state,
+                                                              m_inventory,
+                                                              m_cur_group_it);
+                    m_menu_state->register_view(v);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to config output menu
+                    auto v = std::make_shared<config_portgroup_view>(m_display,
+                                                                     m_menu_state,
+                                                                     m_inventory,
+                                                                     m_cur_group_it,
+                                                                     menu_pane::OUTS_PANE);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
+    config_portgroup_arp_view::config_portgroup_arp_view(
+        DisplaySSD1306_128x64_I2C &d,
+        std::shared_ptr<menu_state> menu_state,
+        std::shared_ptr<inventory> invent,
+        const port_group_list::const_iterator group_it)
+        : portgroup_view(d, menu_state, invent, group_it)
+        , k_divisions{3, 6, 8, 12, 16, 24, 48, 96}
+        , k_division_names{"1/32", "1/16", "1/16T", "1/8", "1/8T", "1/4", "1/2", "1/1"}
+        , m_mode(m_port_group.get_arp_mode())
+        , m_division_index(1)
+        , m_editing_division(false) {
+        // show the closest note value for divisions set elsewhere
+        while ((m_division_index > 0) && (k_divisions[m_division_index] > m_port_group.get_arp_division())) {
+            m_division_index--;
+        }
+        while ((m_division_index < k_division_count - 1) && (k_divisions[m_division_index] < m_port_group.get_arp_division())) {
+            m_division_index++;
+        }
+    }
+
+    config_portgroup_arp_view::~config_portgroup_arp_view() {
+        // nothing to do
+    }
+
+    void config_portgroup_arp_view::notify(const menu_action &a) {
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(4, 0, "Arpeggiator:", STYLE_NORMAL);
+                m_display.printFixed(4, 20, "Mode:", STYLE_NORMAL);
+                m_display.printFixed(40, 20, arp_mode2name((arpeggiator::arp_mode) m_mode), STYLE_NORMAL);
+                m_display.printFixed(4, 36, "Step:", STYLE_NORMAL);
+                m_display.printFixed(40, 36, k_division_names[m_division_index], STYLE_NORMAL);
+                // mark the edited value
+                m_display.printFixed(28, m_editing_division ? 36 : 20, ">", STYLE_NORMAL);
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    if (m_editing_division) {
+                        m_division_index = (m_division_index + 1) % k_division_count;
+                    } else {
+                        m_mode = (m_mode + 1) % arpeggiator::arp_mode::_MODE_COUNT_;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    if (m_editing_division) {
+                        m_division_index = (m_division_index + k_division_count - 1) % k_division_count;
+                    } else {
+                        m_mode = (m_mode + arpeggiator::arp_mode::_MODE_COUNT_ - 1) % arpeggiator::arp_mode::_MODE_COUNT_;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    if (!m_editing_division && (m_mode != arpeggiator::arp_mode::OFF)) {
+                        m_editing_division = true;
+                        // Trigger display update
+                        menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                        m_menu_state->notify(a);
+                        return;
+                    }
+                    m_port_group.set_arp_mode((arpeggiator::arp_mode) m_mode);
+                    m_port_group.set_arp_division(k_divisions[m_division_index]);
+                    m_inventory->mark_config_changed();
                     // Switch back to portgroup_view
                     auto v = std::make_shared<portgroup_view>(m_display,
                                                               m_menu_state,
@@ -1577,6 +3157,122 @@ namespace midimagic {
         }
     }
 
+    config_portgroup_looper_view::config_portgroup_looper_view(
+        DisplaySSD1306_128x64_I2C &d,
+        std::shared_ptr<menu_state> menu_state,
+        std::shared_ptr<inventory> invent,
+        const port_group_list::const_iterator group_it)
+        : portgroup_view(d, menu_state, invent, group_it)
+        , k_item_names{"Record", "Play", "Stop", "Quantize", "Remove looper"}
+        , k_state_names{"Empty", "Armed", "Recording", "Playing", "Stopped"}
+        , m_item(looper_item::RECORD)
+        , m_quantize(m_port_group.get_looper() ? m_port_group.get_looper()->get_quantize() : 6)
+        , m_pool_empty(false) {
+        // nothing to do
+    }
+
+    config_portgroup_looper_view::~config_portgroup_looper_view() {
+        // nothing to do
+    }
+
+    void config_portgroup_looper_view::notify(const menu_action &a) {
+        pattern_looper* looper = m_port_group.get_looper();
+        switch (a.m_kind) {
+            case menu_action::kind::UPDATE :
+                m_display.clear();
+                m_display.setFixedFont(ssd1306xled_font6x8);
+                m_display.printFixed(4, 0, "Looper:", STYLE_NORMAL);
+                if (m_pool_empty) {
+                    m_display.printFixed(52, 0, "none free", STYLE_NORMAL);
+                } else if (looper) {
+                    m_display.printFixed(52, 0, k_state_names[looper->get_state()], STYLE_NORMAL);
+                    // the pattern memory is fixed, show how much of it is used
+                    m_display.printFixed(4, 16, "Events:", STYLE_NORMAL);
+                    m_display.setTextCursor(52, 16);
+                    m_display.print(looper->get_event_count());
+                    m_display.printFixed(76, 16, "/", STYLE_NORMAL);
+                    m_display.setTextCursor(82, 16);
+                    m_display.print(k_max_looper_events);
+                    m_display.printFixed(4, 24, "Beats:", STYLE_NORMAL);
+                    m_display.setTextCursor(52, 24);
+                    m_display.print(looper->get_length() / 24);
+                    m_display.printFixed(4, 32, "Bytes:", STYLE_NORMAL);
+                    m_display.setTextCursor(52, 32);
+                    m_display.print(static_cast<int>(sizeof(pattern_looper)));
+                } else {
+                    m_display.printFixed(52, 0, "off", STYLE_NORMAL);
+                }
+                m_display.printFixed(4, 48, ">", STYLE_NORMAL);
+                m_display.printFixed(16, 48, k_item_names[m_item], STYLE_NORMAL);
+                if (m_item == looper_item::QUANTIZE) {
+                    m_display.setTextCursor(76, 48);
+                    m_display.print(m_quantize);
+                }
+                break;
+            case menu_action::kind::ROT_ACTIVITY :
+                if        (a.m_subkind == menu_action::subkind::ROT_RIGHT) {
+                    m_item = (m_item + 1) % looper_item::_ITEM_COUNT_;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_LEFT) {
+                    m_item = (m_item + looper_item::_ITEM_COUNT_ - 1) % looper_item::_ITEM_COUNT_;
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON) {
+                    auto& dispatcher = *(m_inventory->get_group_dispatcher());
+                    switch (m_item) {
+                        case looper_item::RECORD :
+                            m_pool_empty = !dispatcher.attach_looper(m_port_group);
+                            if (!m_pool_empty) {
+                                m_port_group.end_looper_notes();
+                                m_port_group.get_looper()->set_quantize(m_quantize);
+                                m_port_group.get_looper()->arm();
+                            }
+                            break;
+                        case looper_item::PLAY :
+                            if (looper) {
+                                looper->play();
+                            }
+                            break;
+                        case looper_item::STOP :
+                            if (looper) {
+                                looper->stop();
+                                m_port_group.end_looper_notes();
+                            }
+                            break;
+                        case looper_item::QUANTIZE :
+                            // 1/32, 1/16, 1/8, 1/4 or off
+                            m_quantize = (m_quantize >= 24) ? 1 : ((m_quantize == 1) ? 3 : m_quantize * 2);
+                            break;
+                        case looper_item::REMOVE :
+                            dispatcher.detach_looper(m_port_group);
+                            m_pool_empty = false;
+                            break;
+                        default :
+                            // nothing to do
+                            break;
+                    }
+                    // Trigger display update
+                    menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                    m_menu_state->notify(a);
+                } else if (a.m_subkind == menu_action::subkind::ROT_BUTTON_LONGPRESS) {
+                    // Switch back to config output menu
+                    auto v = std::make_shared<config_portgroup_view>(m_display,
+                                                                     m_menu_state,
+                                                                     m_inventory,
+                                                                     m_cur_group_it,
+                                                                     menu_pane::OUTS_PANE);
+                    m_menu_state->register_view(v);
+                }
+                break;
+            default:
+                // nothing to do
+                break;
+        }
+    }
+
     add_portgroup_view::add_portgroup_view(DisplaySSD1306_128x64_I2C &d,
                                            std::shared_ptr<menu_state> menu_state,
                                            std::shared_ptr<inventory> invent)
@@ -1592,6 +3288,12 @@ namespace midimagic {
         // nothing to do
     }
 
+    void add_portgroup_view::preset_changed() {
+        // the port group list changed underneath, switch to over_view
+        auto v = std::make_shared<over_view>(m_display, m_menu_state, m_inventory);
+        m_menu_state->register_view(v);
+    }
+
     void add_portgroup_view::notify(const menu_action &a) {
         switch (a.m_kind) {
             case menu_action::kind::UPDATE :
@@ -1649,7 +3351,17 @@ namespace midimagic {
                         m_menu_state->notify(a);
                     } else {
                         // create new port group and display it
-                        m_group_dispatcher.add_port_group(m_demux, m_channel);
+                        m_inventory->mark_config_changed();
+                        if (!m_group_dispatcher.add_port_group(m_demux, m_channel)) {
+                            m_display.clear();
+                            m_display.printFixed(4, 8, "Port group limit");
+                            m_display.printFixed(4, 16, "reached");
+                            delay(3000);
+                            // refresh screen
+                            menu_action a(menu_action::kind::UPDATE, menu_action::subkind::NO_SUB);
+                            m_menu_state->notify(a);
+                            return;
+                        }
                         auto new_pg_it = std::prev(m_group_dispatcher.get_port_groups().end());
                         auto v = std::make_shared<portgroup_view>(m_display,
                                                                   m_menu_state,
@@ -1709,6 +3421,10 @@ namespace midimagic {
     }
 
     void menu_state::notify(const menu_action &a) {
+        if (a.m_kind == menu_action::kind::PRESET_CHANGE) {
+            m_view->preset_changed();
+            return;
+        }
         m_view->notify(a);
     }
 }
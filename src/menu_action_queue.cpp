@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021 Adrian Krause                                               *
+ * Copyright 2021, 2026 Adrian Krause                                        *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -20,25 +20,50 @@
  ******************************************************************************/
 
 #include "menu_action_queue.h"
+#include <new>
+#include "event_trace.h"
 
 namespace midimagic {
     menu_action_queue::menu_action_queue(std::shared_ptr<menu_interface> mi)
-        : m_menu(mi) {
+        : m_head(0)
+        , m_tail(0)
+        , m_count(0)
+        , m_menu(mi) {
         // nothing to do
     }
 
     menu_action_queue::~menu_action_queue() {
-        // nothing to do
+        while (m_count) {
+            reinterpret_cast<menu_action*>(&m_action_queue[m_head])->~menu_action();
+            m_head = (m_head + 1) % k_queue_size;
+            m_count--;
+        }
     }
 
     void menu_action_queue::add_menu_action(const menu_action& a) {
-        m_action_queue.push(a);
+        // producers run in ISR and main context
+        noInterrupts();
+        if (m_count < k_queue_size) {
+            new (&m_action_queue[m_tail]) menu_action(a);
+            m_tail = (m_tail + 1) % k_queue_size;
+            m_count++;
+        }
+        interrupts();
     }
 
     void menu_action_queue::exec_next_action() {
-        if (!m_action_queue.empty()) {
-            m_menu->notify(m_action_queue.front());
-            m_action_queue.pop();
+        if (!m_count) {
+            return;
         }
+        // copy out before notifying, views may queue new actions
+        noInterrupts();
+        menu_action* queued = reinterpret_cast<menu_action*>(&m_action_queue[m_head]);
+        menu_action a(*queued);
+        queued->~menu_action();
+        m_head = (m_head + 1) % k_queue_size;
+        m_count--;
+        interrupts();
+        event_trace::record(event_trace::event::MENU_ACTION, (a.m_kind << 4) | (a.m_subkind & 0x0f), a.m_data0);
+        m_menu->notify(a);
     }
 } // namespace midimagic
\ No newline at end of file
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022, 2024 Adrian Krause                                         *
+ * Copyright 2022, 2024, 2026 Adrian Krause                                  *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -20,22 +20,24 @@
  ******************************************************************************/
 
 #include "microwire_eeprom.h"
+#include "event_trace.h"
 
 namespace midimagic {
     microwire_eeprom::microwire_eeprom(const u8 mosi, const u8 miso, const u8 clk, const u8 cs, const eeprom_size size)
-        : k_mosi(mosi)
-        , k_miso(miso)
-        , k_clk(clk)
-        , k_cs(cs)
+        : k_mosi(make_pin(mosi))
+        , k_miso(make_pin(miso))
+        , k_clk(make_pin(clk))
+        , k_cs(make_pin(cs))
         , k_eeprom_size(size)
-        , m_write_enabled(false) {
-        pinMode(k_mosi, OUTPUT);
-        pinMode(k_miso, INPUT_PULLDOWN);
-        pinMode(k_clk, OUTPUT);
-        pinMode(k_cs, OUTPUT);
-        digitalWrite(k_mosi, LOW);
-        digitalWrite(k_clk, LOW);
-        digitalWrite(k_cs, LOW);
+        , m_write_enabled(false)
+        , m_write_pending(false) {
+        pinMode(mosi, OUTPUT);
+        pinMode(miso, INPUT_PULLDOWN);
+        pinMode(clk, OUTPUT);
+        pinMode(cs, OUTPUT);
+        set_pin(k_mosi, LOW);
+        set_pin(k_clk, LOW);
+        set_pin(k_cs, LOW);
 
         switch (k_eeprom_size) {
             case eeprom_size::S1Kb :
@@ -60,17 +62,22 @@ namespace midimagic {
     }
 
     void microwire_eeprom::write(const u16 addr, const u8 data) {
+        start_write(addr, data);
+        while (!write_ready()) {
+            // do nothing
+        }
+    }
+
+    void microwire_eeprom::start_write(const u16 addr, const u8 data) {
         if ((!m_write_enabled) || (addr >= k_eeprom_size)) {
             return;
         }
+        event_trace::record(event_trace::event::EEPROM_WRITE, data, addr);
 
         send_preamble();
 
         // send opcode 01
-        digitalWrite(k_mosi, LOW);
-        cycle_clock();
-        digitalWrite(k_mosi, HIGH);
-        cycle_clock();
+        send_opcode(0x1);
 
         // send address
         if (!send_address(addr)) {
@@ -80,84 +87,96 @@ namespace midimagic {
         // send data
         u8 mangle_data = data;
         for (u8 i = 0; i < 8; i++) {
-            if (mangle_data & 0x80) {
-                digitalWrite(k_mosi, HIGH);
-            } else {
-                digitalWrite(k_mosi, LOW);
-            }
+            set_pin(k_mosi, mangle_data & 0x80);
             cycle_clock();
             mangle_data <<= 1;
         }
-        digitalWrite(k_mosi, LOW);
+        set_pin(k_mosi, LOW);
 
-        digitalWrite(k_cs, LOW);
-        delayMicroseconds(1);
-        digitalWrite(k_cs, HIGH);
-        wait_for_ready();
-        clear_ready();
+        // the falling chip select starts the program cycle
+        set_pin(k_cs, LOW);
+        half_period();
+        set_pin(k_cs, HIGH);
+        m_write_pending = true;
         return;
     }
 
+    const bool microwire_eeprom::write_ready() {
+        if (!m_write_pending) {
+            return true;
+        }
+        // DO is held low while the device is busy
+        if (!get_pin(k_miso)) {
+            return false;
+        }
+        clear_ready();
+        m_write_pending = false;
+        return true;
+    }
+
     void microwire_eeprom::write_2byte(const u16 addr, const u16 data) {
         write(addr, (u8) ((data >> 8) & 0xff));
         write(addr + 1, (u8) (data & 0xff));
     }
 
     const u8 microwire_eeprom::read(const u16 addr) const {
+        u8 data = 0;
+        read_sequence(addr, &data, 1);
+        return data;
+    }
+
+    const u16 microwire_eeprom::read_2byte(const u16 addr) const {
+        u8 data[2] = {0, 0};
+        read_sequence(addr, data, 2);
+        return (data[0] << 8) + data[1];
+    }
+
+    const u16 microwire_eeprom::read_sequence(const u16 addr, u8* buffer, const u16 length) const {
         if (addr >= k_eeprom_size) {
             return 0;
         }
+        // the address counter wraps around at the end of the device
+        const u16 read_length = (length > k_eeprom_size - addr) ? (k_eeprom_size - addr) : length;
+        event_trace::record(event_trace::event::EEPROM_READ, (read_length > 0xff) ? 0xff : read_length, addr);
 
         send_preamble();
 
         // send opcode 10
-        digitalWrite(k_mosi, HIGH);
-        cycle_clock();
-        digitalWrite(k_mosi, LOW);
-        cycle_clock();
+        send_opcode(0x2);
 
         // send address
         if (!send_address(addr)) {
             return 0;
         }
 
-        // receive data
-        u8 data = 0;
-        for (u8 i = 0; i < 8; i++) {
-            data <<= 1;
-            cycle_clock();
-            data |= digitalRead(k_miso);
+        // receive data, the device keeps shifting out consecutive bytes
+        // as long as chip select stays high
+        for (u16 i = 0; i < read_length; i++) {
+            buffer[i] = receive_byte();
         }
 
-        digitalWrite(k_cs, LOW);
-        return data;
-    }
-
-    const u16 microwire_eeprom::read_2byte(const u16 addr) const {
-        u16 data = read(addr) << 8;
-        return data + read(addr + 1);
+        set_pin(k_cs, LOW);
+        return read_length;
     }
 
     void microwire_eeprom::enable_write() {
         send_preamble();
 
         // send opcode 00
-        digitalWrite(k_mosi, LOW);
-        cycle_clock();
-        cycle_clock();
+        send_opcode(0x0);
 
         // send enable code 11
-        digitalWrite(k_mosi, HIGH);
+        set_pin(k_mosi, HIGH);
         cycle_clock();
         cycle_clock();
 
         // send dummy bits according to address lenght minus 2 code bits
-        digitalWrite(k_mosi, LOW);
+        set_pin(k_mosi, LOW);
         for (u8 i = 0; i < (k_address_lenght - 2); i++) {
             cycle_clock();
         }
 
-        digitalWrite(k_cs, LOW);
+        set_pin(k_cs, LOW);
 
         m_write_enabled = true;
         return;
@@ -167,71 +186,107 @@ namespace midimagic {
         send_preamble();
 
         // send opcode 00, disable code 00 and dummy bits according to address lenght
-        digitalWrite(k_mosi, LOW);
+        set_pin(k_mosi, LOW);
         for (u8 i = 0; i < (k_address_lenght + 2); i++) {
             cycle_clock();
         }
 
-        digitalWrite(k_cs, LOW);
+        set_pin(k_cs, LOW);
         m_write_enabled = false;
         return;
     }
 
-    const microwire_eeprom::eeprom_size microwire_eeprom::get_size() const {
+    const u16 microwire_eeprom::get_size() const {
         return k_eeprom_size;
     }
 
-    void microwire_eeprom::wait_for_ready() const {
-        while (!digitalRead(k_miso)) {
-            // do nothing
+    const microwire_eeprom::gpio_pin microwire_eeprom::make_pin(const u8 pin) {
+        const gpio_pin gp {
+            .port {digitalPinToPort(pin)},
+            .mask {digitalPinToBitMask(pin)}
+        };
+        return gp;
+    }
+
+    inline void microwire_eeprom::set_pin(const gpio_pin& pin, const bool level) {
+        if (level) {
+            pin.port->BSRR = pin.mask;
+        } else {
+            pin.port->BRR = pin.mask;
+        }
+    }
+
+    inline const bool microwire_eeprom::get_pin(const gpio_pin& pin) {
+        return pin.port->IDR & pin.mask;
+    }
+
+    inline void microwire_eeprom::half_period() {
+        for (u8 i = 0; i < MIDIMAGIC_EEPROM_HALF_PERIOD_LOOPS; i++) {
+            __asm__ volatile ("nop");
         }
-        return;
     }
 
     void microwire_eeprom::clear_ready() const {
         send_startbit();
-        digitalWrite(k_cs, LOW);
+        set_pin(k_cs, LOW);
         return;
     }
 
     void microwire_eeprom::send_preamble() const {
-        digitalWrite(k_mosi, LOW);
-        digitalWrite(k_cs, HIGH);
+        set_pin(k_mosi, LOW);
+        set_pin(k_cs, HIGH);
         send_startbit();
     }
 
     void microwire_eeprom::send_startbit() const {
-        digitalWrite(k_mosi, HIGH);
+        set_pin(k_mosi, HIGH);
         cycle_clock();
-        digitalWrite(k_mosi, LOW);
+        set_pin(k_mosi, LOW);
+    }
+
+    void microwire_eeprom::send_opcode(const u8 opcode) const {
+        // 2 bit opcode, MSB first
+        set_pin(k_mosi, opcode & 0x2);
+        cycle_clock();
+        set_pin(k_mosi, opcode & 0x1);
+        cycle_clock();
+        set_pin(k_mosi, LOW);
     }
 
     bool microwire_eeprom::send_address(const u16 addr) const {
         if (!k_address_lenght) {
             // something is wrong, reset chip to safe state
-            digitalWrite(k_cs, LOW);
+            set_pin(k_cs, LOW);
             return false;
         }
 
         u16 mangled_addr = addr << (16 - k_address_lenght);
         for (u8 i = 0; i < k_address_lenght; i++) {
-            if (mangled_addr & 0x8000) {
-                digitalWrite(k_mosi, HIGH);
-            } else {
-                digitalWrite(k_mosi, LOW);
-            }
+            set_pin(k_mosi, mangled_addr & 0x8000);
             cycle_clock();
             mangled_addr <<= 1;
         }
+        set_pin(k_mosi, LOW);
         return true;
     }
 
+    const u8 microwire_eeprom::receive_byte() const {
+        // data is shifted out on the rising edge, sample after the full cycle
+        u8 data = 0;
+        for (u8 i = 0; i < 8; i++) {
+            data <<= 1;
+            cycle_clock();
+            data |= get_pin(k_miso);
+        }
+        return data;
+    }
+
     void microwire_eeprom::cycle_clock() const {
-        digitalWrite(k_clk, HIGH);
+        set_pin(k_clk, HIGH);
         // minimum 250 ns settling time needed
-        delayMicroseconds(1);
-        digitalWrite(k_clk, LOW);
-        delayMicroseconds(1);
+        half_period();
+        set_pin(k_clk, LOW);
+        half_period();
         return;
     }
 } // namespace midimagic
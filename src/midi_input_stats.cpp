@@ -0,0 +1,146 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "midi_input_stats.h"
+#include "event_trace.h"
+#include "irq_guard.h"
+
+namespace midimagic {
+    volatile u32 midi_input_stats::s_bytes = 0;
+    volatile u32 midi_input_stats::s_messages = 0;
+    volatile u32 midi_input_stats::s_overruns = 0;
+    volatile u32 midi_input_stats::s_framing_errors = 0;
+    volatile u32 midi_input_stats::s_noise_errors = 0;
+    u32 midi_input_stats::s_buffer_overflows = 0;
+    u16 midi_input_stats::s_buffer_high_water = 0;
+    bool midi_input_stats::s_buffer_full = false;
+    u32 midi_input_stats::s_window_start_ms = 0;
+    u32 midi_input_stats::s_window_bytes = 0;
+    u32 midi_input_stats::s_window_messages = 0;
+    u32 midi_input_stats::s_window_errors = 0;
+    u16 midi_input_stats::s_bytes_per_second = 0;
+    u16 midi_input_stats::s_messages_per_second = 0;
+    u16 midi_input_stats::s_errors_per_second = 0;
+    u16 midi_input_stats::s_peak_bytes_per_second = 0;
+    alignas(midi_input_stats::k_vector_count * 4) u32 midi_input_stats::s_ram_vectors[k_vector_count];
+    void (*midi_input_stats::s_core_uart_handler)() = nullptr;
+
+    void midi_input_stats::count_byte() {
+        s_bytes++;
+    }
+
+    void midi_input_stats::check_buffer(const u16 available) {
+        if (available > s_buffer_high_water) {
+            s_buffer_high_water = available;
+        }
+        // the ring buffer keeps one slot free, count every time it fills up once
+        const bool full = available >= k_rx_buffer_size - 1;
+        if (full && !s_buffer_full) {
+            s_buffer_overflows++;
+            event_trace::trigger(event_trace::trigger_reason::BUFFER_OVERFLOW, available);
+        }
+        s_buffer_full = full;
+    }
+
+    void midi_input_stats::count_message() {
+        s_messages++;
+    }
+
+    void midi_input_stats::count_uart_error(const u32 status) {
+        event_trace::trigger(event_trace::trigger_reason::UART_ERROR, status);
+        if (status & USART_SR_ORE) {
+            s_overruns++;
+        }
+        if (status & USART_SR_FE) {
+            s_framing_errors++;
+        }
+        if (status & USART_SR_NE) {
+            s_noise_errors++;
+        }
+    }
+
+    void midi_input_stats::hook_uart_interrupt() {
+        irq_guard guard;
+        const u32* flash_vectors = reinterpret_cast<const u32*>(SCB->VTOR);
+        for (u16 i = 0; i < k_vector_count; i++) {
+            s_ram_vectors[i] = flash_vectors[i];
+        }
+        // the first 16 entries belong to the system exceptions
+        s_core_uart_handler = reinterpret_cast<void (*)()>(s_ram_vectors[16 + USART1_IRQn]);
+        s_ram_vectors[16 + USART1_IRQn] = reinterpret_cast<uintptr_t>(&uart_interrupt);
+        SCB->VTOR = reinterpret_cast<uintptr_t>(s_ram_vectors);
+        __DSB();
+    }
+
+    void midi_input_stats::uart_interrupt() {
+        // the core's handler clears the flags by reading the data register, look first
+        const u32 status = USART1->SR;
+        if (status & (USART_SR_ORE | USART_SR_FE | USART_SR_NE)) {
+            count_uart_error(status);
+        }
+        s_core_uart_handler();
+    }
+
+    void midi_input_stats::update(const u32 now_ms) {
+        const u32 elapsed = now_ms - s_window_start_ms;
+        if (elapsed < 1000) {
+            return;
+        }
+        // a slow pass stretches the window, scale back to one second
+        const u32 bytes = s_bytes;
+        const u32 messages = s_messages;
+        const u32 errors = get_error_count() + s_buffer_overflows;
+        s_bytes_per_second = (bytes - s_window_bytes) * 1000 / elapsed;
+        s_messages_per_second = (messages - s_window_messages) * 1000 / elapsed;
+        s_errors_per_second = (errors - s_window_errors) * 1000 / elapsed;
+        if (s_bytes_per_second > s_peak_bytes_per_second) {
+            s_peak_bytes_per_second = s_bytes_per_second;
+        }
+        s_window_start_ms = now_ms;
+        s_window_bytes = bytes;
+        s_window_messages = messages;
+        s_window_errors = errors;
+    }
+
+    const midi_input_stats::input_stats midi_input_stats::get_stats() {
+        const input_stats stats {
+            .bytes {s_bytes},
+            .messages {s_messages},
+            .overruns {s_overruns},
+            .framing_errors {s_framing_errors},
+            .noise_errors {s_noise_errors},
+            .buffer_overflows {s_buffer_overflows},
+            .buffer_high_water {s_buffer_high_water},
+            .bytes_per_second {s_bytes_per_second},
+            .messages_per_second {s_messages_per_second},
+            .errors_per_second {s_errors_per_second},
+            .peak_bytes_per_second {s_peak_bytes_per_second},
+            .load_permille {static_cast<u16>(u32(s_bytes_per_second) * 1000 / k_max_bytes_per_second)},
+            .peak_load_permille {static_cast<u16>(u32(s_peak_bytes_per_second) * 1000 / k_max_bytes_per_second)}
+        };
+        return stats;
+    }
+
+    const u32 midi_input_stats::get_error_count() {
+        return s_overruns + s_framing_errors + s_noise_errors;
+    }
+} // namespace midimagic
+
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "midi_monitor.h"
+#include <Arduino.h>
+
+namespace midimagic {
+    midi_monitor::midi_monitor()
+        : m_ring{}
+        , m_write_count(0)
+        , m_channel_counts{} {
+        // nothing to do
+    }
+
+    midi_monitor::~midi_monitor() {
+        // nothing to do
+    }
+
+    void midi_monitor::record(const midi_message& m) {
+        const u8 slot = (m.type > midi_message::message_type::SYSTEM_MESSAGE) ? k_system_slot : ((m.channel - 1) & 0x0f);
+        m_channel_counts[slot]++;
+        // clock ticks are only counted, they would flush the ring within a second
+        if (m.type == midi_message::message_type::CLOCK) {
+            return;
+        }
+        const u32 index = m_write_count;
+        entry& e = m_ring[index & (k_size - 1)];
+        e.timestamp = millis();
+        e.type = m.type;
+        e.channel = m.channel;
+        e.data0 = m.data0;
+        e.data1 = m.data1;
+        // publish the entry with a single store
+        m_write_count = index + 1;
+    }
+
+    const u8 midi_monitor::snapshot(entry* out, const u8 max_count) const {
+        const u32 end = m_write_count;
+        u8 count = max_count;
+        if (count > k_size) {
+            count = k_size;
+        }
+        if (count > end) {
+            count = end;
+        }
+        for (u8 i = 0; i < count; i++) {
+            out[i] = m_ring[(end - 1 - i) & (k_size - 1)];
+        }
+        // drop the entries the writer overwrote while copying,
+        // keep one slot of margin for an entry in flight
+        const u32 overwritten = m_write_count - end;
+        if (overwritten >= k_size - 1u) {
+            return 0;
+        }
+        if (count > k_size - 1u - overwritten) {
+            count = k_size - 1u - overwritten;
+        }
+        return count;
+    }
+
+    const u32 midi_monitor::get_channel_count(const u8 slot) const {
+        if (slot >= k_channel_slots) {
+            return 0;
+        }
+        return m_channel_counts[slot];
+    }
+
+    const u32 midi_monitor::get_write_count() const {
+        return m_write_count;
+    }
+} // namespace midimagic
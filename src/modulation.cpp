@@ -0,0 +1,392 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "modulation.h"
+#include "output.h"
+#include "irq_guard.h"
+
+namespace midimagic {
+    // one sine period in 256 steps plus the wrap-around entry for interpolation
+    const i16 sine_table[257] = {
+        0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+        6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+        12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+        18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+        23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+        27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+        30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+        32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+        32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285,
+        32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571,
+        30273, 29956, 29621, 29268, 28898, 28510, 28105, 27683,
+        27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+        23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868,
+        18204, 17530, 16846, 16151, 15446, 14732, 14010, 13279,
+        12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179,
+        6393, 5602, 4808, 4011, 3212, 2410, 1608, 804,
+        0, -804, -1608, -2410, -3212, -4011, -4808, -5602,
+        -6393, -7179, -7962, -8739, -9512, -10278, -11039, -11793,
+        -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+        -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+        -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+        -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+        -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+        -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+        -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+        -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+        -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+        -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+        -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+        -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+        -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179,
+        -6393, -5602, -4808, -4011, -3212, -2410, -1608, -804,
+        0,
+    };
+
+    const char *modulation_type_names[] = {
+        "None",
+        "LFO",
+        "AD envelope",
+        "ADSR envelope"
+    };
+
+    const char *lfo_shape_names[] = {
+        "Sine",
+        "Triangle",
+        "Saw",
+        "Square",
+        "S&H"
+    };
+
+    const bool operator==(const modulation_settings& a, const modulation_settings& b) {
+        return (a.type == b.type)
+            && (a.shape == b.shape)
+            && (a.rate == b.rate)
+            && (a.sync_ticks == b.sync_ticks)
+            && (a.depth == b.depth)
+            && (a.attack == b.attack)
+            && (a.decay == b.decay)
+            && (a.sustain == b.sustain)
+            && (a.release == b.release)
+            && (a.trigger_group == b.trigger_group);
+    }
+
+    const bool operator!=(const modulation_settings& a, const modulation_settings& b) {
+        return !(a == b);
+    }
+
+    const char* modulation_type2name(const modulation_type type) {
+        return modulation_type_names[type];
+    }
+
+    const char* lfo_shape2name(const lfo_shape shape) {
+        return lfo_shape_names[shape];
+    }
+
+    modulation_engine::modulation_engine()
+        : m_settings{}
+        , m_states{}
+        , m_ports{}
+        , m_held_notes{}
+        , m_random(0x1234567)
+        , m_clock_samples(0)
+        , m_clock_period(0)
+        , m_clock_ticks(0)
+        , m_busy_us(0)
+        , m_render_count(0)
+        , m_source_renders(0)
+        , m_stats{} {
+        // nothing to do
+    }
+
+    modulation_engine::~modulation_engine() {
+        // nothing to do
+    }
+
+    void modulation_engine::bind_port(const u8 port_number, output_port* port) {
+        if (port_number >= k_max_output_ports) {
+            return;
+        }
+        irq_guard guard;
+        m_ports[port_number] = port;
+        if (port) {
+            port->set_modulated(m_settings[port_number].type != modulation_type::NO_MODULATION);
+        }
+    }
+
+    output_port* modulation_engine::get_port(const u8 port_number) const {
+        return m_ports[port_number % k_max_output_ports];
+    }
+
+    void modulation_engine::configure(const u8 port_number, const modulation_settings& settings) {
+        if (port_number >= k_max_output_ports) {
+            return;
+        }
+        modulation_settings checked = settings;
+        if (checked.type >= modulation_type::_MODULATION_TYPE_COUNT_) {
+            checked.type = modulation_type::NO_MODULATION;
+        }
+        if (checked.shape >= lfo_shape::_LFO_SHAPE_COUNT_) {
+            checked.shape = lfo_shape::SINE;
+        }
+        if (checked.sustain > 127) {
+            checked.sustain = 127;
+        }
+        irq_guard guard;
+        source_state& state = m_states[port_number];
+        if (m_settings[port_number].type != checked.type) {
+            state = source_state{};
+            state.last_output = INT16_MIN; // force the first DAC write
+        }
+        if (m_settings[port_number].trigger_group != checked.trigger_group) {
+            // the notes of the old group are none of the new one's business
+            m_held_notes[port_number] = 0;
+        }
+        m_settings[port_number] = checked;
+        if (m_ports[port_number]) {
+            m_ports[port_number]->set_modulated(checked.type != modulation_type::NO_MODULATION);
+        }
+        state.attack_step = envelope_step(checked.attack);
+        state.decay_step = envelope_step(checked.decay);
+        state.release_step = envelope_step(checked.release);
+        state.sustain_level = (k_envelope_max / 127) * checked.sustain;
+        update_increment(port_number);
+    }
+
+    const modulation_settings& modulation_engine::get_settings(const u8 port_number) const {
+        return m_settings[port_number % k_max_output_ports];
+    }
+
+    void modulation_engine::note_on(const u8 group_id) {
+        irq_guard guard;
+        for (u8 i = 0; i < k_max_output_ports; i++) {
+            if (triggered_by(i, group_id)) {
+                if (m_held_notes[i] < 255) {
+                    m_held_notes[i]++;
+                }
+                // retrigger from the current level, no click
+                m_states[i].stage = envelope_stage::ATTACK;
+            }
+        }
+    }
+
+    void modulation_engine::note_off(const u8 group_id) {
+        irq_guard guard;
+        for (u8 i = 0; i < k_max_output_ports; i++) {
+            // legato, keep the envelope going while a note is held
+            if (triggered_by(i, group_id) && m_held_notes[i] && !--m_held_notes[i]) {
+                release_envelope(i);
+            }
+        }
+    }
+
+    void modulation_engine::release_group(const u8 group_id) {
+        irq_guard guard;
+        for (u8 i = 0; i < k_max_output_ports; i++) {
+            if (triggered_by(i, group_id) && m_held_notes[i]) {
+                m_held_notes[i] = 0;
+                release_envelope(i);
+            }
+        }
+    }
+
+    void modulation_engine::clock() {
+        irq_guard guard;
+        m_clock_period = m_clock_samples;
+        m_clock_samples = 0;
+        m_clock_ticks++;
+        for (u8 i = 0; i < k_max_output_ports; i++) {
+            const modulation_settings& settings = m_settings[i];
+            if ((settings.type == modulation_type::LFO) && settings.sync_ticks) {
+                update_increment(i);
+                // lock the phase to the clock, the increment interpolates up to the next tick
+                m_states[i].phase = (m_clock_ticks % settings.sync_ticks) * (0xffffffff / settings.sync_ticks);
+            }
+        }
+    }
+
+    void modulation_engine::start() {
+        irq_guard guard;
+        m_clock_samples = 0;
+        m_clock_ticks = 0;
+        for (u8 i = 0; i < k_max_output_ports; i++) {
+            if ((m_settings[i].type == modulation_type::LFO) && m_settings[i].sync_ticks) {
+                m_states[i].phase = 0;
+            }
+        }
+    }
+
+    void modulation_engine::render() {
+        const u32 render_start = micros();
+        u8 active = 0;
+        if (m_clock_samples < UINT16_MAX) {
+            m_clock_samples++;
+        }
+        for (u8 i = 0; i < k_max_output_ports; i++) {
+            const modulation_settings& settings = m_settings[i];
+            if (!m_ports[i]) {
+                continue;
+            }
+            // the gate pulses of the scale quantizer are timed by the control rate
+            m_ports[i]->run_trigger();
+            if (settings.type == modulation_type::NO_MODULATION) {
+                continue;
+            }
+            active++;
+            source_state& state = m_states[i];
+            const i16 level = (settings.type == modulation_type::LFO) ?
+                render_lfo(state, settings) : render_envelope(state, settings);
+            // spare the SPI bus while the level holds still
+            if (level != state.last_output) {
+                state.last_output = level;
+                m_ports[i]->set_level(level);
+            }
+        }
+        const u32 render_us = micros() - render_start;
+        if (render_us > m_stats.max_render_us) {
+            m_stats.max_render_us = (render_us > UINT16_MAX) ? UINT16_MAX : render_us;
+        }
+        m_busy_us += render_us;
+        m_source_renders += active;
+        if (++m_render_count >= k_control_rate) {
+            // one second of control periods, the busy time in us is the load in per mille
+            m_stats.active_sources = active;
+            m_stats.load_permille = m_busy_us / 1000;
+            m_stats.source_ns = m_source_renders ? (m_busy_us * 1000) / m_source_renders : 0;
+            m_busy_us = 0;
+            m_source_renders = 0;
+            m_render_count = 0;
+        }
+    }
+
+    const modulation_engine::load_stats modulation_engine::get_stats() const {
+        irq_guard guard;
+        return m_stats;
+    }
+
+    const i16 modulation_engine::render_lfo(source_state& state, const modulation_settings& settings) {
+        const u32 previous_phase = state.phase;
+        state.phase += state.increment;
+        i32 wave;
+        switch (settings.shape) {
+            case lfo_shape::SINE : {
+                // table index from the top 8 bits, interpolation over the next 8
+                const u8 index = state.phase >> 24;
+                const i32 fraction = (state.phase >> 16) & 0xff;
+                const i32 a = sine_table[index];
+                wave = a + (((sine_table[index + 1] - a) * fraction) >> 8);
+                break;
+            }
+            case lfo_shape::TRIANGLE :
+                // rising over the first half, falling over the second one
+                wave = (state.phase & 0x80000000) ? (0x1ffff - (state.phase >> 15)) : (state.phase >> 15);
+                wave -= 0x8000;
+                break;
+            case lfo_shape::SAW :
+                wave = (i32) (state.phase >> 16) - 0x8000;
+                break;
+            case lfo_shape::SQUARE :
+                wave = (state.phase & 0x80000000) ? -32767 : 32767;
+                break;
+            case lfo_shape::SAMPLE_HOLD :
+                if (state.phase < previous_phase) {
+                    // new random value once per cycle, xorshift32
+                    m_random ^= m_random << 13;
+                    m_random ^= m_random >> 17;
+                    m_random ^= m_random << 5;
+                    state.sample = (i16) (m_random >> 16);
+                }
+                wave = state.sample;
+                break;
+            default :
+                wave = 0;
+                break;
+        }
+        return (wave * settings.depth) >> 7;
+    }
+
+    const i16 modulation_engine::render_envelope(source_state& state, const modulation_settings& settings) {
+        switch (state.stage) {
+            case envelope_stage::ATTACK :
+                if (state.level >= k_envelope_max - state.attack_step) {
+                    state.level = k_envelope_max;
+                    state.stage = envelope_stage::DECAY;
+                } else {
+                    state.level += state.attack_step;
+                }
+                break;
+            case envelope_stage::DECAY : {
+                // the AD envelope decays to zero
+                const u32 floor = (settings.type == modulation_type::ADSR_ENVELOPE) ? state.sustain_level : 0;
+                if (state.level <= floor + state.decay_step) {
+                    state.level = floor;
+                    state.stage = floor ? envelope_stage::SUSTAIN : envelope_stage::IDLE;
+                } else {
+                    state.level -= state.decay_step;
+                }
+                break;
+            }
+            case envelope_stage::RELEASE :
+                if (state.level <= state.release_step) {
+                    state.level = 0;
+                    state.stage = envelope_stage::IDLE;
+                } else {
+                    state.level -= state.release_step;
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+        return ((state.level >> 16) * settings.depth) >> 7;
+    }
+
+    const u32 modulation_engine::envelope_step(const u8 time_10ms) {
+        const u32 periods = (u32) time_10ms * ((k_control_rate >= 100) ? k_control_rate / 100 : 1);
+        return periods ? k_envelope_max / periods : k_envelope_max;
+    }
+
+    const bool modulation_engine::triggered_by(const u8 port_number, const u8 group_id) const {
+        const modulation_settings& settings = m_settings[port_number];
+        return (settings.type == modulation_type::AD_ENVELOPE || settings.type == modulation_type::ADSR_ENVELOPE)
+            && settings.trigger_group && (settings.trigger_group == group_id);
+    }
+
+    void modulation_engine::release_envelope(const u8 port_number) {
+        // the AD envelope always runs through
+        if ((m_settings[port_number].type == modulation_type::ADSR_ENVELOPE)
+            && (m_states[port_number].stage != envelope_stage::IDLE)) {
+            m_states[port_number].stage = envelope_stage::RELEASE;
+        }
+    }
+
+    void modulation_engine::update_increment(const u8 port_number) {
+        const modulation_settings& settings = m_settings[port_number];
+        source_state& state = m_states[port_number];
+        if (settings.sync_ticks) {
+            // one cycle over sync_ticks clock ticks of the measured length
+            const u32 periods = (u32) settings.sync_ticks * m_clock_period;
+            state.increment = periods ? 0xffffffff / periods : 0;
+        } else {
+            state.increment = (((uint64_t) settings.rate) << 32) / (10 * (u32) k_control_rate);
+        }
+    }
+} // namespace midimagic
@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2021-2024 Lukas Jünger and Adrian Krause                         *
+ * Copyright 2021-2024, 2026 Lukas Jünger and Adrian Krause                   *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -22,7 +22,7 @@
 #include "output.h"
 #include "midi_types.h"
 #include "ad57x4.h"
-#include "menu.h"
+#include "event_trace.h"
 #include <cstdlib>
 
 namespace midimagic {
@@ -58,12 +58,17 @@ namespace midimagic {
         , m_dac_channel(dac_channel)
         , m_dac(dac)
         , m_current_note(255)
+        , m_note_level(0)
         , m_clock_count(0)
         , m_clock_rate(24)
         , m_output_velocity(false)
         , m_clock_mode(clock_mode::SYNC)
         , m_menu(menu)
-        , m_port_number(port_number) {
+        , m_port_number(port_number)
+        , m_companion(nullptr)
+        , m_quantized_note(255)
+        , m_trigger_count(0)
+        , m_modulated(false) {
         pinMode(m_digital_pin, OUTPUT);
     }
 
@@ -77,28 +82,32 @@ namespace midimagic {
 
     void output_port::set_note(midi_message &msg) {
         i8 delta = 0;
-        i16 steps = 0, PB_value, PB_offset;
+        i16 steps = 0, PB_offset;
         u8 digital_pin_control = HIGH;
         u16 cc_value;
+        u8 continuous_value = 0;
         bool inhibit_dac_update = false, inhibit_digital_pin = false, inhibit_menu_action = false;
+        bool continuous = false;
         menu_action::subkind port_status = menu_action::subkind::PORT_ACTIVE;
         switch (msg.type) {
             case midi_message::message_type::NOTE_ON :
                 m_current_note = msg.data0;
+                // assume c1 tuning
+                delta = msg.data0 - 60;
+                m_note_level = delta * 136;
                 if (!m_output_velocity) {
-                    // assume c1 tuning
-                    delta = msg.data0 - 60;
                     // calculate dac level
-                    steps = delta * 136 << 2;
+                    steps = m_note_level << 2;
                 } else {
-                    //FIXME adjust voltage scaling
-                    steps = msg.data1 << 3;
+                    steps = m_velocity_curve.level(msg.data1);
                 }
                 break;
             case midi_message::message_type::POLY_KEY_PRESSURE :
                 // output unipolar representation of the value
                 steps = msg.data1 << 3;
                 inhibit_digital_pin = true;
+                continuous_value = msg.data1;
+                continuous = true;
                 break;
             case midi_message::message_type::CONTROL_CHANGE :
                 // reassemble 14 bit value
@@ -109,27 +118,28 @@ namespace midimagic {
                     digital_pin_control = LOW;
                 }
                 port_status = menu_action::subkind::PORT_ACTIVE_CC;
+                // the quantizer works on the MSB
+                continuous_value = msg.data0;
+                continuous = true;
                 break;
             case midi_message::message_type::CHANNEL_PRESSURE :
                 // output unipolar representation of the value
                 steps = msg.data0 << 3;
                 inhibit_digital_pin = true;
+                continuous_value = msg.data0;
+                continuous = true;
                 break;
             case midi_message::message_type::PITCH_BEND :
                 inhibit_digital_pin = true;
-                // reassemble signed integer
-                PB_value = (i16) (msg.data0 << 8);
-                PB_value = PB_value | msg.data1;
-                // calculate offset in halftone steps
-                PB_offset = (static_cast<float>(272) / 8192) * PB_value;
-                // add offset to the current note if not cleared
-                if (m_current_note != 255) {
-                    delta = m_current_note - 60;
-                    steps = (delta * 136 + PB_offset) << 2;
-                } else {
-                    // output raw value
-                    steps = PB_offset << 2;
-                }
+                // reassemble the offset the port group scaled with the channel's bend range
+                PB_offset = (i16) ((msg.data0 << 8) | msg.data1);
+                steps = bend_level(PB_offset);
+                break;
+            case midi_message::message_type::PARAMETER :
+                // 14 bit NRPN value, unipolar like a controller but without gate
+                steps = ((msg.data0 << 7) | msg.data1) << 1;
+                inhibit_digital_pin = true;
+                port_status = menu_action::subkind::PORT_ACTIVE_CC;
                 break;
             case midi_message::message_type::STOP :
                 // If we are set to trigger mode with 'stop' turn port "on".
@@ -203,10 +213,27 @@ namespace midimagic {
                 // nothing to do
                 break;
         }
-        if (!inhibit_dac_update) {
+        if (continuous && m_quantizer.is_active()) {
+            // pitch of the nearest scale note like a Note On, nothing to do while it stays
+            const u8 note = m_quantizer.quantize(continuous_value);
+            if (note == m_quantized_note) {
+                return;
+            }
+            m_quantized_note = note;
+            steps = ((note - 60) * 136) << 2;
+            if (m_quantizer.get_settings().trigger) {
+                // run_trigger() lowers the pin again
+                m_trigger_count = k_trigger_periods;
+                digital_pin_control = HIGH;
+                inhibit_digital_pin = false;
+            }
+        }
+        if (!inhibit_dac_update && !m_modulated) {
+            event_trace::record(event_trace::event::DAC_WRITE, m_port_number, steps);
             m_dac.set_level(steps, m_dac_channel);
         }
         if (!inhibit_digital_pin) {
+            event_trace::record(event_trace::event::GATE, m_port_number, digital_pin_control);
             digitalWrite(m_digital_pin, digital_pin_control);
         }
         if (!inhibit_menu_action) {
@@ -220,8 +247,75 @@ namespace midimagic {
         return m_current_note;
     }
 
+    void output_port::set_bend(const i16 offset) {
+        if (!m_modulated) {
+            const i16 level = bend_level(offset);
+            event_trace::record(event_trace::event::DAC_WRITE, m_port_number, level);
+            m_dac.set_level(level, m_dac_channel);
+        }
+        // send port activity info to current view
+        menu_action a(menu_action::kind::PORT_ACTIVITY, menu_action::subkind::PORT_ACTIVE, m_port_number, m_current_note);
+        m_menu->add_menu_action(a);
+    }
+
+    void output_port::set_level(const i16 level) {
+        // no menu action, the queue is no place for a thousand updates per second
+        event_trace::record(event_trace::event::DAC_WRITE, m_port_number, level);
+        m_dac.set_level(level, m_dac_channel);
+    }
+
+    void output_port::set_modulated(const bool modulated) {
+        m_modulated = modulated;
+    }
+
+    const bool output_port::get_modulated() const {
+        return m_modulated;
+    }
+
+    void output_port::run_trigger() {
+        if (m_trigger_count && !--m_trigger_count) {
+            event_trace::record(event_trace::event::GATE, m_port_number, LOW);
+            digitalWrite(m_digital_pin, LOW);
+        }
+    }
+
+    void output_port::set_quantizer(const quantizer_settings& settings) {
+        m_quantizer.set_settings(settings);
+        // the next value is put out even if it quantizes to the last note
+        m_quantized_note = 255;
+    }
+
+    const quantizer_settings& output_port::get_quantizer() const {
+        return m_quantizer.get_settings();
+    }
+
+    void output_port::set_velocity_curve(const velocity_settings& settings) {
+        m_velocity_curve.set_settings(settings);
+    }
+
+    const velocity_settings& output_port::get_velocity_curve() const {
+        return m_velocity_curve.get_settings();
+    }
+
+    const i16 output_port::bend_level(const i16 offset) const {
+        i32 level = offset;
+        // add offset to the current note if not cleared, otherwise output raw value
+        if (m_current_note != 255) {
+            level += m_note_level;
+        }
+        level <<= 2;
+        // wide MPE bends must not wrap around the DAC range
+        if (level > INT16_MAX) {
+            return INT16_MAX;
+        } else if (level < INT16_MIN) {
+            return INT16_MIN;
+        }
+        return level;
+    }
+
     void output_port::end_note() {
         m_current_note = 255;
+        event_trace::record(event_trace::event::GATE, m_port_number, LOW);
         digitalWrite(m_digital_pin, LOW);
         // send port activity info to current view
         menu_action a(menu_action::kind::PORT_ACTIVITY, menu_action::subkind::PORT_NACTIVE, m_port_number);
@@ -269,9 +363,21 @@ namespace midimagic {
         return m_clock_mode;
     }
 
+    void output_port::set_companion(output_port* companion) {
+        m_companion = companion;
+    }
+
+    output_port* output_port::get_companion() const {
+        return m_companion;
+    }
+
     output_demux::output_demux(const demux_type type)
-        : m_type(type) {
-        // nothing to do
+        : m_assigned_mask(0)
+        , m_type(type) {
+        for (auto &slot: m_note_index) {
+            slot.note = 255;
+            slot.port_mask = 0;
+        }
     }
 
     output_demux::~output_demux() {
@@ -284,10 +390,14 @@ namespace midimagic {
                 return;
             }
         }
+        // a note held from before, e.g. when the demux type changed, still has to end on its Note Off
+        if (p->get_note() != 255) {
+            index_note(p->get_note(), m_ports.size());
+        }
         m_ports.push_back(std::move(p));
     }
 
-    const std::vector<std::shared_ptr<output_port>>& output_demux::get_output() const {
+    const output_port_list& output_demux::get_output() const {
         return m_ports;
     }
 
@@ -298,7 +408,8 @@ namespace midimagic {
     void output_demux::remove_output(u8 port_number) {
         for (auto it = m_ports.begin(); it != m_ports.end(); ) {
             if ((*it)->get_port_number() == port_number) {
-                it = m_ports.erase(it);
+                m_ports.erase(it);
+                rebuild_note_index();
                 return;
             } else {
                 ++it;
@@ -307,10 +418,16 @@ namespace midimagic {
     }
 
     void output_demux::remove_note(midi_message &msg) {
-        for(auto &port: m_ports) {
-            if (port->is_note(msg)) {
-                port->end_note();
+        const u8 slot = find_note_slot(msg.data0);
+        if (slot != k_note_index_size) {
+            u8 port_mask = m_note_index[slot].port_mask;
+            for (u8 position = 0; port_mask; position++, port_mask >>= 1) {
+                // another port group may have taken the port over meanwhile
+                if ((port_mask & 1) && m_ports[position]->is_note(msg)) {
+                    m_ports[position]->end_note();
+                }
             }
+            clear_note_slot(slot);
         }
         for(auto it = m_msgs.begin(); it != m_msgs.end();) {
             if((*it).is_same_note(msg))
@@ -320,12 +437,91 @@ namespace midimagic {
         }
     }
 
+    void output_demux::release_notes() {
+        for (auto &port: m_ports) {
+            if (port->get_note() != 255 || port->is_active()) {
+                port->end_note();
+            }
+        }
+        m_msgs.clear();
+        for (auto &slot: m_note_index) {
+            slot.note = 255;
+            slot.port_mask = 0;
+        }
+    }
+
+    void output_demux::set_pressure(midi_message &msg, const bool to_companion) {
+        const u8 slot = find_note_slot(msg.data0);
+        if (slot == k_note_index_size) {
+            return;
+        }
+        u8 port_mask = m_note_index[slot].port_mask;
+        for (u8 position = 0; port_mask; position++, port_mask >>= 1) {
+            if (!(port_mask & 1) || !m_ports[position]->is_note(msg)) {
+                continue;
+            }
+            if (!to_companion) {
+                m_ports[position]->set_note(msg);
+            } else if (m_ports[position]->get_companion()) {
+                m_ports[position]->get_companion()->set_note(msg);
+            }
+        }
+    }
+
+    const u8 output_demux::start_voice(midi_message &msg) {
+        m_assigned_mask = 0;
+        add_note(msg);
+        return m_assigned_mask;
+    }
+
+    void output_demux::end_voice(const u8 port_mask, midi_message &msg) {
+        u8 ports = port_mask;
+        for (u8 position = 0; ports; position++, ports >>= 1) {
+            if ((ports & 1) && m_ports[position]->is_note(msg)) {
+                unindex_note(msg.data0, position);
+                m_ports[position]->end_note();
+            }
+        }
+        // the same note may still sound on another channel, forget only one of them
+        for (auto it = m_msgs.begin(); it != m_msgs.end(); ++it) {
+            if ((*it).is_same_note(msg)) {
+                m_msgs.erase(it);
+                break;
+            }
+        }
+    }
+
+    void output_demux::set_voice_bend(const u8 port_mask, const i16 offset) {
+        u8 ports = port_mask;
+        for (u8 position = 0; ports; position++, ports >>= 1) {
+            if (ports & 1) {
+                m_ports[position]->set_bend(offset);
+            }
+        }
+    }
+
+    void output_demux::set_voice_expression(const u8 port_mask, const u8 value, const bool to_companion) {
+        // poly pressure form, unipolar level without touching the gate
+        midi_message msg(midi_message::message_type::POLY_KEY_PRESSURE, 0, 0, value);
+        u8 ports = port_mask;
+        for (u8 position = 0; ports; position++, ports >>= 1) {
+            if (!(ports & 1)) {
+                continue;
+            }
+            if (!to_companion) {
+                m_ports[position]->set_note(msg);
+            } else if (m_ports[position]->get_companion()) {
+                m_ports[position]->get_companion()->set_note(msg);
+            }
+        }
+    }
+
     bool output_demux::set_note(midi_message &msg) {
         if (m_msgs.size() == m_ports.size())
             return false;
-        for (auto &port: m_ports) {
-            if (!port->is_active()) {
-                port->set_note(msg);
+        for (u8 position = 0; position < m_ports.size(); position++) {
+            if (!m_ports[position]->is_active()) {
+                assign_note(position, msg);
                 m_msgs.push_back(msg);
                 return true;
             }
@@ -333,6 +529,86 @@ namespace midimagic {
         return false;
     }
 
+    void output_demux::assign_note(const u8 position, midi_message &msg) {
+        if (msg.type == midi_message::message_type::NOTE_ON) {
+            const u8 old_note = m_ports[position]->get_note();
+            if (old_note != 255) {
+                unindex_note(old_note, position);
+            }
+            index_note(msg.data0, position);
+            m_assigned_mask |= 1 << position;
+        }
+        m_ports[position]->set_note(msg);
+    }
+
+    const u8 output_demux::find_note_slot(const u8 note) const {
+        u8 slot = note & (k_note_index_size - 1);
+        for (u8 probe = 0; probe < k_note_index_size; probe++) {
+            if (m_note_index[slot].note == note) {
+                return slot;
+            } else if (m_note_index[slot].note == 255) {
+                break;
+            }
+            slot = (slot + 1) & (k_note_index_size - 1);
+        }
+        return k_note_index_size;
+    }
+
+    void output_demux::index_note(const u8 note, const u8 position) {
+        u8 slot = note & (k_note_index_size - 1);
+        for (u8 probe = 0; probe < k_note_index_size; probe++) {
+            if (m_note_index[slot].note == note || m_note_index[slot].note == 255) {
+                m_note_index[slot].note = note;
+                m_note_index[slot].port_mask |= 1 << position;
+                return;
+            }
+            slot = (slot + 1) & (k_note_index_size - 1);
+        }
+        // table full of notes whose Note Off got lost, pressure for this note is dropped
+    }
+
+    void output_demux::unindex_note(const u8 note, const u8 position) {
+        const u8 slot = find_note_slot(note);
+        if (slot == k_note_index_size) {
+            return;
+        }
+        m_note_index[slot].port_mask &= ~(1 << position);
+        if (!m_note_index[slot].port_mask) {
+            clear_note_slot(slot);
+        }
+    }
+
+    void output_demux::clear_note_slot(u8 slot) {
+        const u8 mask = k_note_index_size - 1;
+        m_note_index[slot].note = 255;
+        m_note_index[slot].port_mask = 0;
+        // move entries up whose probe run passes the emptied slot, no tombstones needed
+        for (u8 next = (slot + 1) & mask; m_note_index[next].note != 255; next = (next + 1) & mask) {
+            const u8 home = m_note_index[next].note & mask;
+            const u8 distance_next = (next - home) & mask;
+            const u8 distance_slot = (slot - home) & mask;
+            if (distance_slot < distance_next) {
+                m_note_index[slot] = m_note_index[next];
+                m_note_index[next].note = 255;
+                m_note_index[next].port_mask = 0;
+                slot = next;
+            }
+        }
+    }
+
+    void output_demux::rebuild_note_index() {
+        for (auto &slot: m_note_index) {
+            slot.note = 255;
+            slot.port_mask = 0;
+        }
+        for (u8 position = 0; position < m_ports.size(); position++) {
+            const u8 note = m_ports[position]->get_note();
+            if (note != 255) {
+                index_note(note, position);
+            }
+        }
+    }
+
     random_output_demux::random_output_demux(const demux_type type)
         : output_demux(type) {
         // nothing to do
@@ -344,20 +620,25 @@ namespace midimagic {
 
     void random_output_demux::add_note(midi_message &msg) {
         if(!set_note(msg)) {
+            if (m_msgs.empty()) {
+                // the ports play notes of other port groups, none to steal
+                return;
+            }
             int rand = std::rand() % m_msgs.size();
             midi_message tmp = m_msgs[rand];
-            for (auto &port: m_ports) {
-                if (port->is_note(tmp)) {
-                    port->set_note(msg);
-                    m_msgs.push_back(msg);
-                }
-            }
+            // release the stolen note first, m_msgs has no spare capacity
             for(auto it = m_msgs.begin(); it != m_msgs.end(); ) {
                 if((*it).is_same_note(tmp))
                     it = m_msgs.erase(it);
                 else
                     ++it;
             }
+            for (u8 position = 0; position < m_ports.size(); position++) {
+                if (m_ports[position]->is_note(tmp)) {
+                    assign_note(position, msg);
+                    m_msgs.push_back(msg);
+                }
+            }
         }
     }
 
@@ -371,8 +652,8 @@ namespace midimagic {
     }
 
     void identic_output_demux::add_note(midi_message &msg) {
-        for (auto &port: m_ports) {
-            port->set_note(msg);
+        for (u8 position = 0; position < m_ports.size(); position++) {
+            assign_note(position, msg);
         }
     }
 
@@ -387,19 +668,24 @@ namespace midimagic {
 
     void fifo_output_demux::add_note(midi_message &msg) {
         if (!set_note(msg)) {
-            midi_message tmp = m_msgs.front();
-            for (auto &port: m_ports) {
-                if (port->is_note(tmp)) {
-                    port->set_note(msg);
-                    m_msgs.push_back(msg);
-                }
+            if (m_msgs.empty()) {
+                // the ports play notes of other port groups, none to steal
+                return;
             }
+            midi_message tmp = m_msgs.front();
+            // release the stolen note first, m_msgs has no spare capacity
             for(auto it = m_msgs.begin(); it != m_msgs.end();) {
                 if((*it).is_same_note(tmp))
                     it = m_msgs.erase(it);
                 else
                     ++it;
             }
+            for (u8 position = 0; position < m_ports.size(); position++) {
+                if (m_ports[position]->is_note(tmp)) {
+                    assign_note(position, msg);
+                    m_msgs.push_back(msg);
+                }
+            }
         }
     }
 } // namespace midimagic
@@ -0,0 +1,165 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "parameter_decoder.h"
+
+namespace midimagic {
+    const u8 parameter_decoder::k_controller_roles[128] = {
+        // 0...15
+        PASS, PASS, PASS, PASS, PASS, PASS, DATA_MSB, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 16...31
+        PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 32...47
+        PASS, PASS, PASS, PASS, PASS, PASS, DATA_LSB, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 48...63
+        PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 64...79
+        PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 80...95
+        PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 96...111
+        DATA_INCREMENT, DATA_DECREMENT, NRPN_LSB, NRPN_MSB, RPN_LSB, RPN_MSB, PASS, PASS,
+        PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS,
+        // 112...127
+        PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS, PASS
+    };
+
+    parameter_decoder::parameter_decoder()
+        : m_channels{}
+        , m_bend_range_set(0) {
+        for (auto &range: m_bend_ranges) {
+            range = k_default_bend_range;
+        }
+    }
+
+    parameter_decoder::~parameter_decoder() {
+        // nothing to do
+    }
+
+    const bool parameter_decoder::decode(const midi_message& m, parameter_event& event) {
+        const u8 role = k_controller_roles[m.data0 & 0x7f];
+        if (role == controller_role::PASS) {
+            return false;
+        }
+        const u8 ch_index = (m.channel - 1) & 0xf;
+        channel_state& state = m_channels[ch_index];
+        switch (role) {
+            case controller_role::NRPN_MSB :
+                // selecting one kind of parameter drops the other one's number
+                if (state.kind != parameter_kind::NRPN) {
+                    state.number_lsb = 0x7f;
+                }
+                state.kind = parameter_kind::NRPN;
+                state.number_msb = m.data1;
+                return false;
+            case controller_role::NRPN_LSB :
+                if (state.kind != parameter_kind::NRPN) {
+                    state.number_msb = 0x7f;
+                }
+                state.kind = parameter_kind::NRPN;
+                state.number_lsb = m.data1;
+                return false;
+            case controller_role::RPN_MSB :
+                if (state.kind != parameter_kind::RPN) {
+                    state.number_lsb = 0x7f;
+                }
+                state.kind = parameter_kind::RPN;
+                state.number_msb = m.data1;
+                return false;
+            case controller_role::RPN_LSB :
+                if (state.kind != parameter_kind::RPN) {
+                    state.number_msb = 0x7f;
+                }
+                state.kind = parameter_kind::RPN;
+                state.number_lsb = m.data1;
+                return false;
+            default :
+                break;
+        }
+
+        // data entry, plain controllers while no parameter is selected
+        if (state.kind == parameter_kind::NONE) {
+            return false;
+        }
+        u16 value = (state.value_msb << 7) | state.value_lsb;
+        switch (role) {
+            case controller_role::DATA_MSB :
+                // a new MSB starts a new value, the LSB may follow
+                state.value_msb = m.data1;
+                state.value_lsb = 0;
+                break;
+            case controller_role::DATA_LSB :
+                state.value_lsb = m.data1;
+                break;
+            case controller_role::DATA_INCREMENT :
+                if (value < 0x3fff) {
+                    value++;
+                }
+                state.value_msb = value >> 7;
+                state.value_lsb = value & 0x7f;
+                break;
+            case controller_role::DATA_DECREMENT :
+                if (value > 0) {
+                    value--;
+                }
+                state.value_msb = value >> 7;
+                state.value_lsb = value & 0x7f;
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+        return complete(ch_index, event);
+    }
+
+    const bool parameter_decoder::complete(const u8 ch_index, parameter_event& event) {
+        const channel_state& state = m_channels[ch_index];
+        const u16 number = (state.number_msb << 7) | state.number_lsb;
+        if (number == k_null_parameter) {
+            return false;
+        }
+        if (state.kind == parameter_kind::NRPN) {
+            event.channel = ch_index + 1;
+            event.number = number;
+            event.value = (state.value_msb << 7) | state.value_lsb;
+            return true;
+        }
+        // RPN 0 pitch bend sensitivity, MSB halftones and LSB cents
+        if (number == 0) {
+            m_bend_ranges[ch_index] = state.value_msb * 136 + (state.value_lsb * 136) / 100;
+            m_bend_range_set |= 1 << ch_index;
+        }
+        return false;
+    }
+
+    const u16 parameter_decoder::get_bend_range(const u8 channel, const u16 default_range) const {
+        const u8 ch_index = (channel - 1) & 0xf;
+        if (m_bend_range_set & (1 << ch_index)) {
+            return m_bend_ranges[ch_index];
+        }
+        return default_range;
+    }
+
+    const i16 parameter_decoder::scale_bend(const i16 bend_value, const u16 bend_range) {
+        // full deflection of 8192 reaches the range
+        return ((i32) bend_value * bend_range) >> 13;
+    }
+} // namespace midimagic
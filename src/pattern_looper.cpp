@@ -0,0 +1,259 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "pattern_looper.h"
+
+namespace midimagic {
+    pattern_looper::pattern_looper()
+        : m_events{}
+        , m_event_count(0)
+        , m_cursor(0)
+        , m_tick(0)
+        , m_length(0)
+        , m_state(looper_state::EMPTY)
+        , m_quantize(6)
+        , m_recording_held_count(0)
+        , m_recording_held{}
+        , m_sounding{} {
+        // nothing to do
+    }
+
+    pattern_looper::~pattern_looper() {
+        // nothing to do
+    }
+
+    void pattern_looper::arm() {
+        clear();
+        m_state = looper_state::ARMED;
+    }
+
+    void pattern_looper::play() {
+        switch (m_state) {
+            case looper_state::ARMED :
+                m_state = looper_state::EMPTY;
+                break;
+            case looper_state::RECORDING :
+                close_recording();
+                if (!m_event_count) {
+                    m_state = looper_state::EMPTY;
+                    break;
+                }
+                // keep the beat, the pattern continues where the recording ended
+                m_tick = (m_tick + 1) % m_length;
+                m_cursor = 0;
+                while ((m_cursor < m_event_count) && (m_events[m_cursor].tick < m_tick)) {
+                    m_cursor++;
+                }
+                m_state = looper_state::PLAYING;
+                break;
+            case looper_state::STOPPED :
+                m_tick = 0;
+                m_cursor = 0;
+                m_state = looper_state::PLAYING;
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void pattern_looper::stop() {
+        switch (m_state) {
+            case looper_state::ARMED :
+                m_state = looper_state::EMPTY;
+                break;
+            case looper_state::RECORDING :
+                close_recording();
+                m_state = m_event_count ? looper_state::STOPPED : looper_state::EMPTY;
+                break;
+            case looper_state::PLAYING :
+                m_state = looper_state::STOPPED;
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void pattern_looper::clear() {
+        m_event_count = 0;
+        m_cursor = 0;
+        m_tick = 0;
+        m_length = 0;
+        m_recording_held_count = 0;
+        for (auto &word: m_recording_held) {
+            word = 0;
+        }
+        m_state = looper_state::EMPTY;
+    }
+
+    const pattern_looper::looper_state pattern_looper::get_state() const {
+        return m_state;
+    }
+
+    void pattern_looper::set_quantize(const u8 quantize) {
+        m_quantize = (quantize < 1) ? 1 : ((quantize > 24) ? 24 : quantize);
+    }
+
+    const u8 pattern_looper::get_quantize() const {
+        return m_quantize;
+    }
+
+    const u8 pattern_looper::get_event_count() const {
+        return m_event_count;
+    }
+
+    const u16 pattern_looper::get_length() const {
+        return m_length;
+    }
+
+    void pattern_looper::record(const u8 note, const u8 velocity) {
+        if (m_state != looper_state::RECORDING) {
+            return;
+        }
+        const u8 n = note & 0x7f;
+        const u16 last_tick = m_event_count ? m_events[m_event_count - 1].tick : 0;
+        u16 tick;
+        if (velocity) {
+            // keep room for the Note Off of every held note
+            if (get_bit(m_recording_held, n)
+                || (m_event_count + m_recording_held_count + 2 > k_max_looper_events)) {
+                return;
+            }
+            set_bit(m_recording_held, n, true);
+            m_recording_held_count++;
+            tick = ((m_tick + (m_quantize >> 1)) / m_quantize) * m_quantize;
+        } else {
+            if (!get_bit(m_recording_held, n)) {
+                // the Note On was dropped or played before the recording
+                return;
+            }
+            set_bit(m_recording_held, n, false);
+            m_recording_held_count--;
+            tick = m_tick;
+            // a quantised note lasts at least one tick
+            for (u8 i = m_event_count; i > 0; i--) {
+                if (m_events[i - 1].note == n) {
+                    if (tick <= m_events[i - 1].tick) {
+                        tick = m_events[i - 1].tick + 1;
+                    }
+                    break;
+                }
+            }
+        }
+        // events stay sorted by tick
+        m_events[m_event_count++] = event {(tick < last_tick) ? last_tick : tick, n, velocity};
+    }
+
+    void pattern_looper::tick(const event*& first, const event*& last) {
+        first = m_events;
+        last = m_events;
+        switch (m_state) {
+            case looper_state::ARMED :
+                m_tick = 0;
+                m_state = looper_state::RECORDING;
+                break;
+            case looper_state::RECORDING :
+                if (m_tick + 1 >= k_max_ticks) {
+                    play();
+                } else {
+                    m_tick++;
+                }
+                break;
+            case looper_state::PLAYING :
+                first = &m_events[m_cursor];
+                while ((m_cursor < m_event_count) && (m_events[m_cursor].tick == m_tick)) {
+                    set_bit(m_sounding, m_events[m_cursor].note, m_events[m_cursor].velocity);
+                    m_cursor++;
+                }
+                last = &m_events[m_cursor];
+                if (++m_tick >= m_length) {
+                    m_tick = 0;
+                    m_cursor = 0;
+                }
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void pattern_looper::restart() {
+        if ((m_state == looper_state::PLAYING) || (m_state == looper_state::STOPPED)) {
+            m_tick = 0;
+            m_cursor = 0;
+        }
+    }
+
+    const bool pattern_looper::pop_sounding(u8& note) {
+        for (u8 word = 0; word < 4; word++) {
+            if (m_sounding[word]) {
+                const u8 bit = __builtin_ctz(m_sounding[word]);
+                m_sounding[word] &= ~(1u << bit);
+                note = (word << 5) + bit;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void pattern_looper::set_bit(u32 (&bitmap)[4], const u8 note, const bool value) {
+        if (value) {
+            bitmap[(note >> 5) & 0x3] |= 1u << (note & 31);
+        } else {
+            bitmap[(note >> 5) & 0x3] &= ~(1u << (note & 31));
+        }
+    }
+
+    const bool pattern_looper::get_bit(const u32 (&bitmap)[4], const u8 note) const {
+        return bitmap[(note >> 5) & 0x3] & (1u << (note & 31));
+    }
+
+    void pattern_looper::close_recording() {
+        m_length = ((m_tick + 24) / 24) * 24;
+        if (m_length > k_max_ticks) {
+            m_length = k_max_ticks;
+        }
+        // held notes end with the pattern, record() kept room for them
+        for (u8 n = 0; m_recording_held_count && (n < 128); n++) {
+            if (get_bit(m_recording_held, n)) {
+                set_bit(m_recording_held, n, false);
+                m_recording_held_count--;
+                m_events[m_event_count++] = event {(u16) (m_length - 1), n, 0};
+            }
+        }
+        // events quantised to the pattern end belong to its start, insertion sort keeps the recorded order per tick
+        for (u8 i = 0; i < m_event_count; i++) {
+            if (m_events[i].tick >= m_length) {
+                m_events[i].tick -= m_length;
+            }
+        }
+        for (u8 i = 1; i < m_event_count; i++) {
+            const event e = m_events[i];
+            u8 j = i;
+            while ((j > 0) && (m_events[j - 1].tick > e.tick)) {
+                m_events[j] = m_events[j - 1];
+                j--;
+            }
+            m_events[j] = e;
+        }
+    }
+} // namespace midimagic
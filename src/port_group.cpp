@@ -1,6 +1,6 @@
 /******************************************************************************
  *                                                                            *
- * Copyright 2022,2024 Adrian Krause                                          *
+ * Copyright 2022,2024, 2026 Adrian Krause                                   *
  *                                                                            *
  * This file is part of Midimagic.                                            *
  *                                                                            *
@@ -23,7 +23,8 @@
 
 namespace midimagic {
     group_dispatcher::group_dispatcher()
-        : m_last_group_id(0)
+        : m_active_preset(0)
+        , m_last_group_id(0)
         , m_capture_mode(false)
         , m_capture_ready(false)
         , m_captured_message(midi_message::message_type::NOTE_OFF, 1, 0, 0) {
@@ -31,17 +32,27 @@ namespace midimagic {
     }
 
     group_dispatcher::~group_dispatcher() {
-        // nothing to do
+        remove_all_port_groups();
     }
 
-    void group_dispatcher::add_port_group(const demux_type dt, const u8 channel) {
-        m_port_groups.emplace_back(
-            std::make_unique<port_group>(get_next_id(), dt, channel));
+    const bool group_dispatcher::add_port_group(const demux_type dt, const u8 channel) {
+        if (m_port_groups.full()) {
+            return false;
+        }
+        port_group* new_pg = m_port_group_pool.create(get_next_id(), dt, channel, m_parameters, m_modulation);
+        if (!new_pg) {
+            return false;
+        }
+        m_port_groups.push_back(new_pg);
+        return true;
     }
 
     void group_dispatcher::remove_port_group(const u8 id) {
         for (auto it = m_port_groups.begin(); it != m_port_groups.end(); ) {
             if ((*it)->get_id() == id) {
+                detach_looper(**it);
+                m_modulation.release_group(id);
+                m_port_group_pool.destroy(*it);
                 it = m_port_groups.erase(it);
                 return;
             } else {
@@ -50,11 +61,94 @@ namespace midimagic {
         }
     }
 
-    const std::vector<std::unique_ptr<port_group>>& group_dispatcher::get_port_groups() const {
+    const port_group_list& group_dispatcher::get_port_groups() const {
         return m_port_groups;
     }
 
+    void group_dispatcher::select_preset(const u8 preset) {
+        if (preset >= k_max_presets || preset == m_active_preset) {
+            return;
+        }
+        // park the active groups, at most k_max_port_groups pointers are copied
+        m_parked_port_groups[m_active_preset] = m_port_groups;
+        m_port_groups = m_parked_port_groups[preset];
+        m_parked_port_groups[preset].clear();
+        m_active_preset = preset;
+    }
+
+    const u8 group_dispatcher::get_active_preset() const {
+        return m_active_preset;
+    }
+
+    const port_group_list& group_dispatcher::get_preset_port_groups(const u8 preset) const {
+        if (preset == m_active_preset || preset >= k_max_presets) {
+            return m_port_groups;
+        }
+        return m_parked_port_groups[preset];
+    }
+
+    void group_dispatcher::release_notes() {
+        for (auto &port_group: m_port_groups) {
+            port_group->release_notes();
+        }
+    }
+
+    void group_dispatcher::remove_all_port_groups() {
+        for (auto &port_group: m_port_groups) {
+            detach_looper(*port_group);
+            m_modulation.release_group(port_group->get_id());
+            m_port_group_pool.destroy(port_group);
+        }
+        m_port_groups.clear();
+        for (auto &parked_groups: m_parked_port_groups) {
+            for (auto &port_group: parked_groups) {
+                detach_looper(*port_group);
+                m_modulation.release_group(port_group->get_id());
+                m_port_group_pool.destroy(port_group);
+            }
+            parked_groups.clear();
+        }
+    }
+
+    const bool group_dispatcher::attach_looper(port_group& pg) {
+        if (pg.get_looper()) {
+            return true;
+        }
+        pattern_looper* looper = m_looper_pool.create();
+        if (!looper) {
+            return false;
+        }
+        pg.set_looper(looper);
+        return true;
+    }
+
+    void group_dispatcher::detach_looper(port_group& pg) {
+        pattern_looper* looper = pg.get_looper();
+        if (looper) {
+            pg.end_looper_notes();
+            pg.set_looper(nullptr);
+            m_looper_pool.destroy(looper);
+        }
+    }
+
+    const u8 group_dispatcher::get_loopers_in_use() const {
+        return m_looper_pool.in_use();
+    }
+
     void group_dispatcher::add_message(midi_message& m) {
+        event_trace::record_message(m);
+        const u32 start = dispatch_profiler::now();
+        dispatch(m);
+        const u32 cycles = dispatch_profiler::now() - start;
+        event_trace::check_dispatch(cycles);
+        if (m_profiler.record(m, cycles)) {
+            // only a new worst case pays for looking at the port groups
+            m_profiler.set_shape(m.type, m_port_groups.size(), count_routed_groups(m));
+        }
+    }
+
+    void group_dispatcher::dispatch(midi_message& m) {
+        m_monitor.record(m);
         // catch program change messages, as these are supposed to control the device
         if (m.type == midi_message::message_type::PROGRAM_CHANGE) {
             return;
@@ -65,6 +159,14 @@ namespace midimagic {
             m_capture_mode = false;
             return;
         }
+        feed_modulation(m);
+        if (m.type == midi_message::message_type::CONTROL_CHANGE) {
+            // the controllers still reach port groups listening to them
+            parameter_decoder::parameter_event event;
+            if (m_parameters.decode(m, event)) {
+                sieve_parameter(event);
+            }
+        }
         sieve(m);
     }
 
@@ -81,6 +183,32 @@ namespace midimagic {
         return m_captured_message;
     }
 
+    const midi_monitor& group_dispatcher::get_monitor() const {
+        return m_monitor;
+    }
+
+    modulation_engine& group_dispatcher::get_modulation() {
+        return m_modulation;
+    }
+
+    dispatch_profiler& group_dispatcher::get_profiler() {
+        return m_profiler;
+    }
+
+    void group_dispatcher::feed_modulation(midi_message& m) {
+        switch (m.type) {
+            case midi_message::message_type::CLOCK :
+                m_modulation.clock();
+                break;
+            case midi_message::message_type::START :
+                m_modulation.start();
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
     void group_dispatcher::sieve(midi_message& m) {
         // system common and real time messages are channel independent and to be send to all receivers
         if (m.type > midi_message::message_type::SYSTEM_MESSAGE) {
@@ -93,7 +221,8 @@ namespace midimagic {
                     case midi_message::message_type::STOP :
                         // just slide through
                     case midi_message::message_type::CLOCK :
-                        if (port_group->has_msg_type(midi_message::message_type::CLOCK)) {
+                        if (port_group->wants_clock()) {
+                            event_trace::record(event_trace::event::ROUTE, port_group->get_id(), m.type);
                             port_group->send_input(m);
                         }
                         break;
@@ -104,56 +233,108 @@ namespace midimagic {
             }
         } else {
             for (auto &port_group: m_port_groups) {
-                if (m.channel == port_group->get_midi_channel()
+                if (port_group->listens_on(m.channel)
                     && port_group->has_msg_type(m.type)) {
+                    event_trace::record(event_trace::event::ROUTE, port_group->get_id(), m.type);
                     port_group->send_input(m);
                 }
             }
         }
     }
 
+    const u8 group_dispatcher::count_routed_groups(const midi_message& m) const {
+        if (m.type == midi_message::message_type::PROGRAM_CHANGE) {
+            return 0;
+        }
+        u8 routed = 0;
+        for (auto &port_group: m_port_groups) {
+            if (m.type > midi_message::message_type::SYSTEM_MESSAGE) {
+                routed += port_group->wants_clock();
+            } else {
+                routed += port_group->listens_on(m.channel) && port_group->has_msg_type(m.type);
+            }
+        }
+        return routed;
+    }
+
+    void group_dispatcher::sieve_parameter(const parameter_decoder::parameter_event& event) {
+        midi_message m(midi_message::message_type::PARAMETER, event.channel, event.value >> 7, event.value & 0x7f);
+        for (auto &port_group: m_port_groups) {
+            if (port_group->listens_on(m.channel)
+                && port_group->has_msg_type(m.type)
+                && port_group->get_nrpn() == event.number) {
+                port_group->send_input(m);
+            }
+        }
+    }
+
     const u8 group_dispatcher::get_next_id() {
-        return ++m_last_group_id;
+        // 0 stands for no port group, e.g. as envelope trigger
+        if (!++m_last_group_id) {
+            m_last_group_id = 1;
+        }
+        return m_last_group_id;
     }
 
-    port_group::port_group(const u8 id, const demux_type dt, const u8 channel)
-        : k_id(id)
+    port_group::port_group(const u8 id, const demux_type dt, const u8 channel,
+                           const parameter_decoder& parameters, modulation_engine& modulation)
+        : m_demux(nullptr)
         , m_input_channel(channel)
         , m_cc_number(0)
         , m_cc_MSB_value(0)
-        , m_transpose_offset(0) {
+        , m_transpose_offset(0)
+        , m_pressure_to_companion(false)
+        , m_nrpn_number(0)
+        , m_parameters(parameters)
+        , m_modulation(modulation)
+        , m_mpe(false)
+        , m_mpe_members(15)
+        , m_mpe_timbre(0)
+        , m_looper(nullptr)
+        , k_id(id) {
+        clear_mpe_voices();
         set_demux(dt);
     }
 
     port_group::~port_group() {
-        // nothing to do
+        if (m_demux) {
+            m_demux->~output_demux();
+        }
     }
 
     void port_group::set_demux(const demux_type type) {
-        std::unique_ptr<output_demux> new_demux;
+        // keep the assigned ports while the old demux is torn down
+        output_port_list ports;
+        if (m_demux) {
+            ports = m_demux->get_output();
+            m_demux->~output_demux();
+            m_demux = nullptr;
+        }
         switch (type) {
             case demux_type::FIFO:
-                new_demux = std::make_unique<fifo_output_demux>(type);
+                m_demux = new (&m_demux_storage) fifo_output_demux(type);
                 break;
             case demux_type::IDENTIC:
-                new_demux = std::make_unique<identic_output_demux>(type);
+                m_demux = new (&m_demux_storage) identic_output_demux(type);
                 break;
             case demux_type::RANDOM:
-                new_demux = std::make_unique<random_output_demux>(type);
+                m_demux = new (&m_demux_storage) random_output_demux(type);
                 break;
             default:
                 __builtin_trap();
                 break;
         }
-        if (m_demux) {
-            for (auto& port: m_demux->get_output()) {
-                new_demux->add_output(std::move(port));
-            }
+        for (auto& port: ports) {
+            m_demux->add_output(port);
         }
-        m_demux = std::move(new_demux);
     }
 
     void port_group::set_midi_channel(const u8 ch) {
+        if (m_mpe && !is_mpe_master(ch)) {
+            // no zone around this channel
+            release_notes();
+            m_mpe = false;
+        }
         m_input_channel = ch;
     }
 
@@ -178,7 +359,7 @@ namespace midimagic {
         }
     }
 
-    const std::vector<midi_message::message_type>& port_group::get_msg_types() const {
+    const input_type_list& port_group::get_msg_types() const {
         return m_input_types;
     }
 
@@ -195,11 +376,74 @@ namespace midimagic {
         return m_input_channel;
     }
 
+    void port_group::set_mpe(const bool mpe) {
+        const bool zone = mpe && is_mpe_master(m_input_channel);
+        if (zone != m_mpe) {
+            release_notes();
+            m_mpe = zone;
+        }
+        if (m_mpe) {
+            // the voice ports carry the pitch, pressure must not replace it
+            m_pressure_to_companion = true;
+        }
+    }
+
+    const bool port_group::get_mpe() const {
+        return m_mpe;
+    }
+
+    const bool port_group::is_mpe_master(const u8 channel) {
+        return channel == 1 || channel == 16;
+    }
+
+    void port_group::set_mpe_members(const u8 members) {
+        const u8 checked = (members < 1) ? 1 : (members > 15) ? 15 : members;
+        if (checked != m_mpe_members) {
+            if (m_mpe) {
+                // voices on channels leaving the zone would never see their Note Off
+                release_notes();
+            }
+            m_mpe_members = checked;
+        }
+    }
+
+    const u8 port_group::get_mpe_members() const {
+        return m_mpe_members;
+    }
+
+    void port_group::set_mpe_timbre(const u8 offset) {
+        if (is_mpe_timbre(offset)) {
+            m_mpe_timbre = offset;
+        }
+    }
+
+    const u8 port_group::get_mpe_timbre() const {
+        return m_mpe_timbre;
+    }
+
+    const bool port_group::is_mpe_timbre(const u8 offset) {
+        return (offset < k_max_output_ports) && (offset != 4);
+    }
+
+    const bool port_group::listens_on(const u8 channel) const {
+        if (!m_mpe) {
+            return channel == m_input_channel;
+        } else if (m_input_channel == 1) {
+            return channel <= 1 + m_mpe_members;
+        } else {
+            return channel >= 16 - m_mpe_members;
+        }
+    }
+
     void port_group::add_port(std::shared_ptr<output_port> port) {
         m_demux->add_output(port);
     }
 
     void port_group::remove_port(u8 port_number) {
+        if (m_mpe) {
+            // the voice table holds positions of the ports
+            release_notes();
+        }
         m_demux->remove_output(port_number);
     }
 
@@ -208,10 +452,14 @@ namespace midimagic {
     }
 
     void port_group::set_cc(const u8 cc_number) {
+        m_cc_number = normalise_cc(cc_number);
+    }
+
+    const u8 port_group::normalise_cc(const u8 cc_number) {
         if ((cc_number > 31) && (cc_number < 64)) {
-            m_cc_number = cc_number - 32;
+            return cc_number - 32;
         } else {
-            m_cc_number = cc_number;
+            return cc_number;
         }
     }
 
@@ -227,31 +475,317 @@ namespace midimagic {
         return m_transpose_offset;
     }
 
+    void port_group::set_pressure_to_companion(const bool to_companion) {
+        m_pressure_to_companion = to_companion || m_mpe;
+    }
+
+    const bool port_group::get_pressure_to_companion() const {
+        return m_pressure_to_companion;
+    }
+
+    void port_group::set_nrpn(const u16 nrpn_number) {
+        m_nrpn_number = nrpn_number & 0x3fff;
+    }
+
+    const u16 port_group::get_nrpn() const {
+        return m_nrpn_number;
+    }
+
+    void port_group::set_arp_mode(const arpeggiator::arp_mode mode) {
+        if (mode != m_arp.get_mode()) {
+            release_notes();
+            m_arp.set_mode(mode);
+        }
+    }
+
+    const arpeggiator::arp_mode port_group::get_arp_mode() const {
+        return m_arp.get_mode();
+    }
+
+    void port_group::set_arp_division(const u8 division) {
+        m_arp.set_division(division);
+    }
+
+    const u8 port_group::get_arp_division() const {
+        return m_arp.get_division();
+    }
+
+    void port_group::set_looper(pattern_looper* looper) {
+        m_looper = looper;
+    }
+
+    pattern_looper* port_group::get_looper() const {
+        return m_looper;
+    }
+
+    void port_group::end_looper_notes() {
+        u8 note;
+        while (m_looper && m_looper->pop_sounding(note)) {
+            midi_message note_msg(midi_message::message_type::NOTE_OFF, m_input_channel, note, 0);
+            end_note(note_msg);
+        }
+    }
+
+    const bool port_group::wants_clock() const {
+        return has_msg_type(midi_message::message_type::CLOCK)
+            || (!m_mpe && (m_arp.get_mode() != arpeggiator::arp_mode::OFF || m_looper));
+    }
+
     void port_group::send_input(midi_message& m) {
-        if (m.type == midi_message::message_type::NOTE_OFF) {
+        if (m_looper && !m_mpe) {
+            send_looper_input(m);
+        }
+        if (m_mpe) {
+            send_mpe_input(m);
+        } else if (m_arp.get_mode() != arpeggiator::arp_mode::OFF
+                   && (m.type == midi_message::message_type::NOTE_ON
+                       || m.type == midi_message::message_type::NOTE_OFF
+                       || m.type > midi_message::message_type::SYSTEM_MESSAGE)) {
+            send_arp_input(m);
+        } else if (m.type > midi_message::message_type::SYSTEM_MESSAGE
+                   && !has_msg_type(midi_message::message_type::CLOCK)) {
+            // clock only drives the looper
+        } else if (m.type == midi_message::message_type::NOTE_OFF) {
             if (m_transpose_offset == 0) {
-                m_demux->remove_note(m);
+                end_note(m);
             } else {
                 midi_message transposed_msg = m;
                 transposed_msg.data0 += m_transpose_offset;
-                m_demux->remove_note(transposed_msg);
+                end_note(transposed_msg);
             }
+        } else if (m.type == midi_message::message_type::POLY_KEY_PRESSURE) {
+            // pressure belongs to a held key, never starts a note
+            midi_message transposed_msg = m;
+            transposed_msg.data0 += m_transpose_offset;
+            m_demux->set_pressure(transposed_msg, m_pressure_to_companion);
         } else if (m.type == midi_message::message_type::CONTROL_CHANGE) {
             if (m_cc_number == m.data0 || m_cc_number == m.data0 - 32) {
                 auto cc_msg = parse_cc(m);
                 m_demux->add_note(cc_msg);
             }
+        } else if (m.type == midi_message::message_type::PITCH_BEND) {
+            auto bend_msg = parse_pitch_bend(m);
+            m_demux->add_note(bend_msg);
         } else {
             if ((m.type == midi_message::message_type::NOTE_ON) && (m_transpose_offset != 0)) {
                 midi_message transposed_msg = m;
                 transposed_msg.data0 += m_transpose_offset;
-                m_demux->add_note(transposed_msg);
+                start_note(transposed_msg);
+            } else if (m.type == midi_message::message_type::NOTE_ON) {
+                start_note(m);
             } else {
                 m_demux->add_note(m);
             }
         }
     }
 
+    void port_group::release_notes() {
+        m_demux->release_notes();
+        m_modulation.release_group(k_id);
+        clear_mpe_voices();
+        m_arp.clear();
+        // the demux ended them already
+        u8 note;
+        while (m_looper && m_looper->pop_sounding(note)) {
+            // nothing to do
+        }
+    }
+
+    void port_group::send_looper_input(midi_message& m) {
+        switch (m.type) {
+            case midi_message::message_type::NOTE_ON :
+                m_looper->record(m.data0 + m_transpose_offset, m.data1);
+                break;
+            case midi_message::message_type::NOTE_OFF :
+                m_looper->record(m.data0 + m_transpose_offset, 0);
+                break;
+            case midi_message::message_type::CLOCK : {
+                const pattern_looper::event* first;
+                const pattern_looper::event* last;
+                m_looper->tick(first, last);
+                for (; first != last; ++first) {
+                    midi_message note_msg(first->velocity ? midi_message::message_type::NOTE_ON : midi_message::message_type::NOTE_OFF,
+                                          m_input_channel, first->note, first->velocity);
+                    if (first->velocity) {
+                        start_note(note_msg);
+                    } else {
+                        end_note(note_msg);
+                    }
+                }
+                break;
+            }
+            case midi_message::message_type::START :
+                end_looper_notes();
+                m_looper->restart();
+                break;
+            case midi_message::message_type::STOP :
+                end_looper_notes();
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    void port_group::send_arp_input(midi_message& m) {
+        switch (m.type) {
+            case midi_message::message_type::NOTE_ON :
+                m_arp.note_on(m.data0 + m_transpose_offset, m.data1);
+                return;
+            case midi_message::message_type::NOTE_OFF :
+                m_arp.note_off(m.data0 + m_transpose_offset);
+                return;
+            case midi_message::message_type::CLOCK : {
+                u8 ending_note, starting_note;
+                m_arp.tick(ending_note, starting_note);
+                end_arp_note(ending_note);
+                if (starting_note != 255) {
+                    midi_message note_msg(midi_message::message_type::NOTE_ON, m_input_channel, starting_note, m_arp.get_velocity());
+                    start_note(note_msg);
+                }
+                break;
+            }
+            case midi_message::message_type::START :
+                end_arp_note(m_arp.restart());
+                break;
+            case midi_message::message_type::STOP :
+                end_arp_note(m_arp.restart());
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+        // clock outputs keep working next to the arpeggiator
+        if (has_msg_type(midi_message::message_type::CLOCK)) {
+            m_demux->add_note(m);
+        }
+    }
+
+    void port_group::end_arp_note(const u8 note) {
+        if (note != 255) {
+            midi_message note_msg(midi_message::message_type::NOTE_OFF, m_input_channel, note, 0);
+            end_note(note_msg);
+        }
+    }
+
+    void port_group::start_note(midi_message& m) {
+        m_demux->add_note(m);
+        m_modulation.note_on(k_id);
+    }
+
+    void port_group::end_note(midi_message& m) {
+        m_demux->remove_note(m);
+        m_modulation.note_off(k_id);
+    }
+
+    void port_group::send_mpe_input(midi_message& m) {
+        const u8 ch_index = (m.channel - 1) & 0xf;
+        midi_message transposed_msg = m;
+        switch (m.type) {
+            case midi_message::message_type::NOTE_ON :
+                transposed_msg.data0 += m_transpose_offset;
+                // one note per member channel
+                if (m_mpe_voice_ports[ch_index]) {
+                    m_demux->end_voice(m_mpe_voice_ports[ch_index], transposed_msg);
+                    m_modulation.note_off(k_id);
+                }
+                m_mpe_voice_ports[ch_index] = m_demux->start_voice(transposed_msg);
+                m_modulation.note_on(k_id);
+                // a stolen voice belongs to this channel now
+                for (u8 ch = 0; ch < 16; ch++) {
+                    if (ch != ch_index) {
+                        m_mpe_voice_ports[ch] &= ~m_mpe_voice_ports[ch_index];
+                    }
+                }
+                // bend sent ahead of the note applies right away
+                if (mpe_bend_offset(ch_index)) {
+                    m_demux->set_voice_bend(m_mpe_voice_ports[ch_index], mpe_bend_offset(ch_index));
+                }
+                break;
+            case midi_message::message_type::NOTE_OFF :
+                transposed_msg.data0 += m_transpose_offset;
+                if (m_mpe_voice_ports[ch_index]) {
+                    m_modulation.note_off(k_id);
+                }
+                m_demux->end_voice(m_mpe_voice_ports[ch_index], transposed_msg);
+                m_mpe_voice_ports[ch_index] = 0;
+                break;
+            case midi_message::message_type::PITCH_BEND :
+                // 14 bit signed, data0 holds MSB, data1 holds LSB
+                m_mpe_bend[ch_index] = (i16) ((m.data0 << 8) | m.data1);
+                if (m.channel == m_input_channel) {
+                    // master bend moves the whole zone
+                    for (u8 ch = 0; ch < 16; ch++) {
+                        if (m_mpe_voice_ports[ch]) {
+                            m_demux->set_voice_bend(m_mpe_voice_ports[ch], mpe_bend_offset(ch));
+                        }
+                    }
+                } else if (m_mpe_voice_ports[ch_index]) {
+                    m_demux->set_voice_bend(m_mpe_voice_ports[ch_index], mpe_bend_offset(ch_index));
+                }
+                break;
+            case midi_message::message_type::CHANNEL_PRESSURE :
+                if (m_mpe_voice_ports[ch_index]) {
+                    m_demux->set_voice_expression(m_mpe_voice_ports[ch_index], m.data0, true);
+                }
+                break;
+            case midi_message::message_type::CONTROL_CHANGE :
+                // the configured controller, usually 74 for timbre, follows the voice of its channel
+                if (m.data0 == m_cc_number && m_mpe_voice_ports[ch_index]) {
+                    set_mpe_voice_timbre(m_mpe_voice_ports[ch_index], m.data1);
+                }
+                break;
+            case midi_message::message_type::POLY_KEY_PRESSURE :
+                transposed_msg.data0 += m_transpose_offset;
+                m_demux->set_pressure(transposed_msg, true);
+                break;
+            case midi_message::message_type::PARAMETER :
+                m_demux->add_note(m);
+                break;
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    const i16 port_group::mpe_bend_offset(const u8 channel) const {
+        // MPE default bend ranges are 48 halftones on member channels and 2 on the master channel, RPN 0 overrides them
+        const u8 master_index = (m_input_channel - 1) & 0xf;
+        i32 offset = parameter_decoder::scale_bend(m_mpe_bend[master_index],
+                                                   m_parameters.get_bend_range(master_index + 1, parameter_decoder::k_default_bend_range));
+        if (channel != master_index) {
+            offset += parameter_decoder::scale_bend(m_mpe_bend[channel],
+                                                    m_parameters.get_bend_range(channel + 1, 48 * 136));
+        }
+        return offset;
+    }
+
+    void port_group::clear_mpe_voices() {
+        for (u8 ch = 0; ch < 16; ch++) {
+            m_mpe_voice_ports[ch] = 0;
+            m_mpe_bend[ch] = 0;
+        }
+    }
+
+    void port_group::set_mpe_voice_timbre(const u8 port_mask, const u8 value) {
+        if (!m_mpe_timbre) {
+            return;
+        }
+        // poly pressure form like set_voice_expression(), the timbre port is outside the group
+        midi_message msg(midi_message::message_type::POLY_KEY_PRESSURE, 0, 0, value);
+        const output_port_list& ports = m_demux->get_output();
+        u8 mask = port_mask;
+        for (u8 position = 0; mask; position++, mask >>= 1) {
+            if (!(mask & 1)) {
+                continue;
+            }
+            output_port* timbre_port = m_modulation.get_port(ports[position]->get_port_number() + m_mpe_timbre);
+            if (timbre_port) {
+                timbre_port->set_note(msg);
+            }
+        }
+    }
+
     midi_message port_group::parse_cc(midi_message& m) {
         // parse controller value and return midi_message with format:
         // type::CONTROL_CHANGE, channel, value MSB, value LSB
@@ -264,4 +798,13 @@ namespace midimagic {
         midi_message out_msg(m.type, m.channel, m_cc_MSB_value, cc_LSB_value);
         return out_msg;
     }
+
+    midi_message port_group::parse_pitch_bend(midi_message& m) const {
+        // 14 bit signed, data0 holds MSB, data1 holds LSB
+        const i16 bend_value = (i16) ((m.data0 << 8) | m.data1);
+        const u16 offset = parameter_decoder::scale_bend(bend_value,
+                                                         m_parameters.get_bend_range(m.channel, parameter_decoder::k_default_bend_range));
+        midi_message out_msg(m.type, m.channel, offset >> 8, offset & 0xff);
+        return out_msg;
+    }
 } // namespace midimagic
\ No newline at end of file
@@ -0,0 +1,122 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "quantizer.h"
+
+namespace midimagic {
+    const char *scale_type_names[] = {
+        "Off",
+        "Chromatic",
+        "Major",
+        "Minor",
+        "Pentatonic",
+        "User"
+    };
+
+    const bool operator==(const quantizer_settings& a, const quantizer_settings& b) {
+        return (a.scale == b.scale)
+            && (a.root == b.root)
+            && (a.user_mask == b.user_mask)
+            && (a.trigger == b.trigger);
+    }
+
+    const bool operator!=(const quantizer_settings& a, const quantizer_settings& b) {
+        return !(a == b);
+    }
+
+    const char* scale_type2name(const scale_type scale) {
+        return scale_type_names[scale];
+    }
+
+    scale_quantizer::scale_quantizer()
+        : m_settings{} {
+        build_table();
+    }
+
+    scale_quantizer::~scale_quantizer() {
+        // nothing to do
+    }
+
+    void scale_quantizer::set_settings(const quantizer_settings& settings) {
+        m_settings = settings;
+        if (m_settings.scale >= scale_type::_SCALE_TYPE_COUNT_) {
+            m_settings.scale = scale_type::NO_SCALE;
+        }
+        m_settings.root %= 12;
+        m_settings.user_mask &= 0xfff;
+        build_table();
+    }
+
+    const quantizer_settings& scale_quantizer::get_settings() const {
+        return m_settings;
+    }
+
+    const bool scale_quantizer::is_active() const {
+        return m_settings.scale != scale_type::NO_SCALE;
+    }
+
+    const u8 scale_quantizer::quantize(const u8 value) const {
+        return m_table[value & 0x7f];
+    }
+
+    const u16 scale_quantizer::scale_mask(const scale_type scale, const u16 user_mask) {
+        switch (scale) {
+            case scale_type::MAJOR :
+                // 0, 2, 4, 5, 7, 9, 11
+                return 0xab5;
+            case scale_type::MINOR :
+                // natural minor, 0, 2, 3, 5, 7, 8, 10
+                return 0x5ad;
+            case scale_type::PENTATONIC :
+                // major pentatonic, 0, 2, 4, 7, 9
+                return 0x295;
+            case scale_type::USER_SCALE :
+                return user_mask & 0xfff;
+            default :
+                return 0xfff;
+        }
+    }
+
+    void scale_quantizer::build_table() {
+        u16 mask = scale_mask(m_settings.scale, m_settings.user_mask);
+        if (!mask) {
+            // an empty scale would leave nothing to snap to
+            mask = 0xfff;
+        }
+        for (u8 value = 0; value < 128; value++) {
+            // nearest allowed note, the lower one on a tie
+            u8 note = value;
+            for (u8 distance = 0; distance < 12; distance++) {
+                const i16 below = value - distance;
+                const i16 above = value + distance;
+                if (below >= 0 && (mask & (1 << ((below - m_settings.root + 12) % 12)))) {
+                    note = below;
+                    break;
+                }
+                if (above < 128 && (mask & (1 << ((above - m_settings.root + 12) % 12)))) {
+                    note = above;
+                    break;
+                }
+            }
+            m_table[value] = note;
+        }
+    }
+} // namespace midimagic
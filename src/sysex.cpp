@@ -0,0 +1,461 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "sysex.h"
+
+namespace midimagic {
+    sysex_transfer::sysex_transfer(std::shared_ptr<inventory> invent, eeprom_device& eeprom, sysex_sender sender)
+        : m_inventory(invent)
+        , m_eeprom(eeprom)
+        , m_sender(sender)
+        , m_state(IDLE)
+        , m_request_length(0)
+        , m_chunk_length(0)
+        , m_chunk_pending(false)
+        , m_next_chunk(0)
+        , m_last_message(0) {
+        // nothing to do
+    }
+
+    sysex_transfer::~sysex_transfer() {
+        // nothing to do
+    }
+
+    void sysex_transfer::handle_message(const u8* data, const u16 length) {
+        // the host waits for the answer, a message arriving before the last one was handled is dropped
+        if (m_request_length || length > k_max_message || length <= FRAME_ARGUMENTS
+            || data[FRAME_MANUFACTURER] != k_manufacturer_id || data[FRAME_MODEL] != k_model_id) {
+            return;
+        }
+        for (u16 i = 0; i < length; i++) {
+            m_request[i] = data[i];
+        }
+        m_request_length = length;
+    }
+
+    void sysex_transfer::run_step() {
+        if (m_request_length) {
+            process_request();
+            m_request_length = 0;
+        }
+
+        switch (m_state) {
+            case DUMPING :
+                if (m_next_chunk < get_chunk_count()) {
+                    send_chunk(m_next_chunk++);
+                } else {
+                    send_message(command::DUMP_END, nullptr, 0);
+                    end_transfer();
+                }
+                break;
+            case RESTORING :
+                if (m_chunk_pending) {
+                    auto result = m_archive->restore_step(m_chunk, m_next_chunk * k_chunk_size, m_chunk_length);
+                    if (result == config_archive::operation_result::SUCCESS) {
+                        m_chunk_pending = false;
+                        send_reply(command::ACK, command::RESTORE_CHUNK, m_next_chunk++);
+                    } else if (result != config_archive::operation_result::WRITE_IN_PROGRESS) {
+                        send_reply(command::NAK, command::RESTORE_CHUNK, m_next_chunk, result);
+                        end_transfer();
+                    }
+                } else if (millis() - m_last_message > k_restore_timeout_ms) {
+                    // host gone, the old slot stays the newest valid one
+                    end_transfer();
+                }
+                break;
+            case TRACING :
+                if (m_next_chunk < get_trace_chunk_count()) {
+                    send_trace_chunk(m_next_chunk++);
+                } else {
+                    send_message(command::TRACE_END, nullptr, 0);
+                    // the trace stays frozen until TRACE_RELEASE
+                    m_state = IDLE;
+                }
+                break;
+            case COMMITTING : {
+                auto result = m_archive->writeout_step();
+                if (result == config_archive::operation_result::WRITE_IN_PROGRESS) {
+                    break;
+                }
+                end_transfer();
+                if (result == config_archive::operation_result::SUCCESS) {
+                    result = m_inventory->load_config_from_eeprom();
+                    // views may refer to port groups of the old setup
+                    menu_action a(menu_action::kind::PRESET_CHANGE, menu_action::subkind::NO_SUB, m_inventory->get_active_preset());
+                    m_inventory->get_menu_queue()->add_menu_action(a);
+                }
+                if (result == config_archive::operation_result::SUCCESS) {
+                    send_reply(command::ACK, command::RESTORE_END, m_next_chunk);
+                } else {
+                    send_reply(command::NAK, command::RESTORE_END, m_next_chunk, result);
+                }
+                break;
+            }
+            case IDLE :
+            default :
+                break;
+        }
+    }
+
+    const bool sysex_transfer::is_active() const {
+        return m_state != IDLE;
+    }
+
+    void sysex_transfer::process_request() {
+        const u8 device = m_request[FRAME_DEVICE];
+        if (device != k_all_devices && device != get_device_id()) {
+            return;
+        }
+        m_last_message = millis();
+
+        // arguments up to the F7
+        const u8* arguments = m_request + FRAME_ARGUMENTS;
+        const u16 argument_length = m_request_length - FRAME_ARGUMENTS - 1;
+        switch (m_request[FRAME_COMMAND]) {
+            case command::DUMP_REQUEST :
+                if (argument_length >= 2) {
+                    start_dump(true, (arguments[0] << 7) | arguments[1]);
+                } else {
+                    start_dump(false, 0);
+                }
+                break;
+            case command::RESTORE_BEGIN :
+                if (argument_length < 3) {
+                    send_reply(command::NAK, command::RESTORE_BEGIN, 0, config_archive::operation_result::SIZE_MISMATCH);
+                    break;
+                }
+                start_restore((arguments[0] << 14) | (arguments[1] << 7) | arguments[2]);
+                break;
+            case command::RESTORE_CHUNK : {
+                if (argument_length < 3) {
+                    send_reply(command::NAK, command::RESTORE_CHUNK, 0, nak_reason::BAD_CHUNK);
+                    break;
+                }
+                // chunk number, data and checksum add up to 0
+                u8 sum = 0;
+                for (u16 i = 0; i < argument_length; i++) {
+                    sum += arguments[i];
+                }
+                const u16 chunk = (arguments[0] << 7) | arguments[1];
+                if (sum & 0x7f) {
+                    send_reply(command::NAK, command::RESTORE_CHUNK, chunk, nak_reason::BAD_CHECKSUM);
+                    break;
+                }
+                receive_chunk(chunk, arguments + 2, argument_length - 3);
+                break;
+            }
+            case command::RESTORE_END :
+                finish_restore();
+                break;
+            case command::STATS_REQUEST :
+                // leaves a running transfer alone
+                send_input_stats();
+                break;
+            case command::TRACE_REQUEST :
+                start_trace_dump();
+                break;
+            case command::TRACE_RELEASE :
+                event_trace::release();
+                send_reply(command::ACK, command::TRACE_RELEASE, 0);
+                break;
+            default :
+                // answers of other units on the same cable
+                break;
+        }
+    }
+
+    void sysex_transfer::start_dump(const bool single_chunk, const u16 chunk) {
+        if (m_state != IDLE || !m_inventory->lock_storage()) {
+            send_reply(command::NAK, command::DUMP_REQUEST, chunk, nak_reason::BUSY);
+            return;
+        }
+        m_archive = std::make_unique<config_archive>(m_eeprom);
+        auto result = m_archive->begin_dump();
+        if (result != config_archive::operation_result::SUCCESS) {
+            send_reply(command::NAK, command::DUMP_REQUEST, chunk, result);
+            end_transfer();
+            return;
+        }
+
+        if (single_chunk) {
+            // repeat a chunk the host got damaged
+            if (chunk < get_chunk_count()) {
+                send_chunk(chunk);
+            } else {
+                send_reply(command::NAK, command::DUMP_REQUEST, chunk, nak_reason::BAD_CHUNK);
+            }
+            end_transfer();
+            return;
+        }
+
+        const u16 size = m_archive->get_archive_size();
+        const u16 chunk_count = get_chunk_count();
+        const u8 arguments[] = {
+            (u8) ((size >> 14) & 0x7f), (u8) ((size >> 7) & 0x7f), (u8) (size & 0x7f),
+            (u8) ((chunk_count >> 7) & 0x7f), (u8) (chunk_count & 0x7f)
+        };
+        send_message(command::DUMP_BEGIN, arguments, sizeof(arguments));
+        // one chunk per run_step(), MIDI input is handled in between
+        m_next_chunk = 0;
+        m_state = DUMPING;
+    }
+
+    void sysex_transfer::start_restore(const u16 size) {
+        if (m_state == RESTORING) {
+            // a new restore replaces the unfinished one
+            end_transfer();
+        }
+        if (m_state != IDLE) {
+            send_reply(command::NAK, command::RESTORE_BEGIN, 0, nak_reason::BUSY);
+            return;
+        }
+        // the restored setup replaces the one being saved anyway
+        m_inventory->cancel_save();
+        if (!m_inventory->lock_storage()) {
+            send_reply(command::NAK, command::RESTORE_BEGIN, 0, nak_reason::BUSY);
+            return;
+        }
+        m_archive = std::make_unique<config_archive>(m_eeprom);
+        auto result = m_archive->begin_restore(size);
+        if (result != config_archive::operation_result::SUCCESS) {
+            send_reply(command::NAK, command::RESTORE_BEGIN, 0, result);
+            end_transfer();
+            return;
+        }
+        m_next_chunk = 0;
+        m_chunk_pending = false;
+        m_state = RESTORING;
+        send_reply(command::ACK, command::RESTORE_BEGIN, 0);
+    }
+
+    void sysex_transfer::receive_chunk(const u16 chunk, const u8* data, const u16 length) {
+        if (m_state != RESTORING) {
+            send_reply(command::NAK, command::RESTORE_CHUNK, chunk, nak_reason::NOT_RESTORING);
+            return;
+        }
+        if (m_chunk_pending) {
+            send_reply(command::NAK, command::RESTORE_CHUNK, chunk, nak_reason::BUSY);
+            return;
+        }
+        if (chunk + 1 == m_next_chunk) {
+            // our ACK got lost, the chunk is programmed already
+            send_reply(command::ACK, command::RESTORE_CHUNK, chunk);
+            return;
+        }
+
+        if (chunk != m_next_chunk || chunk >= get_chunk_count()) {
+            send_reply(command::NAK, command::RESTORE_CHUNK, chunk, nak_reason::BAD_CHUNK);
+            return;
+        }
+        const u16 offset = chunk * k_chunk_size;
+        const u16 size = m_archive->get_archive_size();
+        const u16 expected_length = (size - offset > k_chunk_size) ? k_chunk_size : size - offset;
+        if (decode(data, length, m_chunk, k_chunk_size) != expected_length
+            || get_encoded_size(expected_length) != length) {
+            send_reply(command::NAK, command::RESTORE_CHUNK, chunk, nak_reason::BAD_CHUNK);
+            return;
+        }
+        // programmed by run_step(), acknowledged when done
+        m_chunk_length = expected_length;
+        m_chunk_pending = true;
+    }
+
+    void sysex_transfer::finish_restore() {
+        if (m_state != RESTORING || m_chunk_pending) {
+            send_reply(command::NAK, command::RESTORE_END, m_next_chunk, nak_reason::NOT_RESTORING);
+            return;
+        }
+        auto result = m_archive->finish_restore();
+        if (result != config_archive::operation_result::WRITE_IN_PROGRESS) {
+            // the slot header was not touched, the old setup stays
+            send_reply(command::NAK, command::RESTORE_END, m_next_chunk, result);
+            end_transfer();
+            return;
+        }
+        m_state = COMMITTING;
+    }
+
+    void sysex_transfer::start_trace_dump() {
+        if (!event_trace::k_enabled) {
+            send_reply(command::NAK, command::TRACE_REQUEST, 0, nak_reason::NO_TRACE);
+            return;
+        }
+        if (m_state != IDLE) {
+            send_reply(command::NAK, command::TRACE_REQUEST, 0, nak_reason::BUSY);
+            return;
+        }
+        // keep the ring as it is while it is sent
+        event_trace::freeze();
+        const u16 count = event_trace::get_record_count();
+        const u16 cycles_per_us = event_trace::get_cycles_per_us();
+        const u8 arguments[] = {
+            (u8) ((count >> 7) & 0x7f), (u8) (count & 0x7f),
+            (u8) ((cycles_per_us >> 7) & 0x7f), (u8) (cycles_per_us & 0x7f)
+        };
+        send_message(command::TRACE_BEGIN, arguments, sizeof(arguments));
+        m_next_chunk = 0;
+        m_state = TRACING;
+    }
+
+    void sysex_transfer::send_trace_chunk(const u16 chunk) {
+        const u16 k_chunk_records = k_chunk_size / sizeof(event_trace::trace_record);
+        const u16 count = event_trace::get_record_count();
+        u8 data[k_chunk_size];
+        u16 length = 0;
+        for (u16 index = chunk * k_chunk_records; index < count && length < k_chunk_size; index++) {
+            const auto record = event_trace::read(index);
+            data[length++] = record.time & 0xff;
+            data[length++] = (record.time >> 8) & 0xff;
+            data[length++] = (record.time >> 16) & 0xff;
+            data[length++] = (record.time >> 24) & 0xff;
+            data[length++] = record.id;
+            data[length++] = record.arg;
+            data[length++] = record.value & 0xff;
+            data[length++] = (record.value >> 8) & 0xff;
+        }
+        send_data(command::TRACE_CHUNK, chunk, data, length);
+    }
+
+    void sysex_transfer::send_chunk(const u16 chunk) {
+        u8 data[k_chunk_size];
+        const u16 length = m_archive->read_dump(chunk * k_chunk_size, data, k_chunk_size);
+        send_data(command::DUMP_CHUNK, chunk, data, length);
+    }
+
+    void sysex_transfer::send_data(const command cmd, const u16 chunk, const u8* data, const u16 length) {
+        u8 arguments[k_max_message];
+        u16 position = 0;
+        arguments[position++] = (chunk >> 7) & 0x7f;
+        arguments[position++] = chunk & 0x7f;
+        position += encode(data, length, arguments + position);
+        u8 sum = 0;
+        for (u16 i = 0; i < position; i++) {
+            sum += arguments[i];
+        }
+        arguments[position++] = (0x80 - (sum & 0x7f)) & 0x7f;
+        send_message(cmd, arguments, position);
+    }
+
+    void sysex_transfer::send_input_stats() {
+        const auto stats = midi_input_stats::get_stats();
+        const u32 counters[] = {
+            stats.bytes, stats.messages, stats.overruns, stats.framing_errors,
+            stats.noise_errors, stats.buffer_overflows
+        };
+        const u16 values[] = {
+            stats.buffer_high_water, stats.bytes_per_second, stats.messages_per_second,
+            stats.errors_per_second, stats.peak_bytes_per_second, stats.load_permille,
+            stats.peak_load_permille
+        };
+        u8 arguments[k_stats_size];
+        u16 position = 0;
+        for (const u32 counter: counters) {
+            // 32 bit in five groups, the first holds the top 4 bits
+            for (i8 shift = 28; shift >= 0; shift -= 7) {
+                arguments[position++] = (counter >> shift) & 0x7f;
+            }
+        }
+        for (const u16 value: values) {
+            // at most 14 bit
+            arguments[position++] = (value >> 7) & 0x7f;
+            arguments[position++] = value & 0x7f;
+        }
+        send_message(command::STATS_REPLY, arguments, position);
+    }
+
+    void sysex_transfer::send_reply(const command cmd, const command answered, const u16 chunk, const u8 reason) {
+        const u8 arguments[] = {
+            answered, (u8) ((chunk >> 7) & 0x7f), (u8) (chunk & 0x7f), (u8) (reason & 0x7f)
+        };
+        // only a NAK carries a reason
+        send_message(cmd, arguments, (cmd == command::NAK) ? sizeof(arguments) : sizeof(arguments) - 1);
+    }
+
+    void sysex_transfer::send_message(const command cmd, const u8* arguments, const u16 length) {
+        u8 message[k_max_message];
+        message[FRAME_MANUFACTURER - 1] = k_manufacturer_id;
+        message[FRAME_MODEL - 1] = k_model_id;
+        message[FRAME_DEVICE - 1] = get_device_id();
+        message[FRAME_COMMAND - 1] = cmd;
+        // the sender adds F0 and F7
+        for (u16 i = 0; i < length; i++) {
+            message[FRAME_ARGUMENTS - 1 + i] = arguments[i];
+        }
+        m_sender(message, FRAME_ARGUMENTS - 1 + length);
+    }
+
+    void sysex_transfer::end_transfer() {
+        if (m_archive) {
+            while (!m_archive->abort_writeout()) {
+                // at most one program cycle
+            }
+            m_archive.reset();
+        }
+        m_chunk_pending = false;
+        m_state = IDLE;
+        m_inventory->unlock_storage();
+    }
+
+    const u8 sysex_transfer::get_device_id() const {
+        const u8 control_channel = m_inventory->get_control_channel();
+        return control_channel ? control_channel - 1 : 0;
+    }
+
+    const u16 sysex_transfer::get_chunk_count() const {
+        return (m_archive->get_archive_size() + k_chunk_size - 1) / k_chunk_size;
+    }
+
+    const u16 sysex_transfer::get_trace_chunk_count() const {
+        const u16 size = event_trace::get_record_count() * sizeof(event_trace::trace_record);
+        return (size + k_chunk_size - 1) / k_chunk_size;
+    }
+
+    const u16 sysex_transfer::encode(const u8* data, const u16 length, u8* out) {
+        u16 out_length = 0;
+        for (u16 group = 0; group < length; group += 7) {
+            u8& msbs = out[out_length++];
+            msbs = 0;
+            for (u16 i = 0; i < 7 && group + i < length; i++) {
+                msbs |= (data[group + i] >> 7) << i;
+                out[out_length++] = data[group + i] & 0x7f;
+            }
+        }
+        return out_length;
+    }
+
+    const u16 sysex_transfer::decode(const u8* data, const u16 length, u8* out, const u16 max_length) {
+        u16 out_length = 0;
+        for (u16 group = 0; group < length; group += 8) {
+            const u8 msbs = data[group];
+            for (u16 i = 1; i < 8 && group + i < length; i++) {
+                if (out_length >= max_length) {
+                    return 0;
+                }
+                out[out_length++] = data[group + i] | (((msbs >> (i - 1)) & 0x1) << 7);
+            }
+        }
+        return out_length;
+    }
+
+    const u16 sysex_transfer::get_encoded_size(const u16 length) {
+        return length + (length + 6) / 7;
+    }
+} // namespace midimagic
@@ -0,0 +1,155 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "velocity_curve.h"
+
+namespace midimagic {
+    // DAC levels for velocity 0...127, 32767 is +5 V in the range set by
+    // the ad57x4 constructor. Exponential and logarithmic curves are
+    // (2^(4v) - 1) / 15 and log2(1 + 15v) / 4 with v = velocity / 127.
+    const u16 velocity_tables[3][128] = {
+        {
+            0, 258, 516, 774, 1032, 1290, 1548, 1806,
+            2064, 2322, 2580, 2838, 3096, 3354, 3612, 3870,
+            4128, 4386, 4644, 4902, 5160, 5418, 5676, 5934,
+            6192, 6450, 6708, 6966, 7224, 7482, 7740, 7998,
+            8256, 8514, 8772, 9030, 9288, 9546, 9804, 10062,
+            10320, 10578, 10836, 11094, 11352, 11610, 11868, 12126,
+            12384, 12642, 12900, 13158, 13416, 13674, 13932, 14190,
+            14448, 14706, 14964, 15222, 15480, 15738, 15996, 16254,
+            16513, 16771, 17029, 17287, 17545, 17803, 18061, 18319,
+            18577, 18835, 19093, 19351, 19609, 19867, 20125, 20383,
+            20641, 20899, 21157, 21415, 21673, 21931, 22189, 22447,
+            22705, 22963, 23221, 23479, 23737, 23995, 24253, 24511,
+            24769, 25027, 25285, 25543, 25801, 26059, 26317, 26575,
+            26833, 27091, 27349, 27607, 27865, 28123, 28381, 28639,
+            28897, 29155, 29413, 29671, 29929, 30187, 30445, 30703,
+            30961, 31219, 31477, 31735, 31993, 32251, 32509, 32767
+        }, {
+            0, 48, 97, 148, 199, 252, 306, 361,
+            417, 474, 533, 593, 654, 717, 781, 846,
+            913, 982, 1052, 1123, 1196, 1271, 1347, 1425,
+            1504, 1586, 1669, 1754, 1841, 1930, 2021, 2114,
+            2208, 2305, 2404, 2506, 2609, 2715, 2823, 2934,
+            3047, 3162, 3280, 3401, 3524, 3650, 3779, 3910,
+            4045, 4182, 4323, 4467, 4613, 4763, 4917, 5073,
+            5234, 5397, 5565, 5736, 5911, 6089, 6272, 6459,
+            6649, 6844, 7044, 7247, 7455, 7668, 7886, 8108,
+            8335, 8567, 8805, 9047, 9295, 9548, 9807, 10072,
+            10343, 10619, 10902, 11190, 11486, 11787, 12096, 12411,
+            12733, 13062, 13399, 13743, 14094, 14454, 14821, 15196,
+            15580, 15972, 16373, 16782, 17201, 17629, 18066, 18513,
+            18970, 19437, 19914, 20402, 20900, 21410, 21930, 22463,
+            23007, 23563, 24131, 24712, 25305, 25912, 26532, 27166,
+            27814, 28476, 29153, 29844, 30551, 31274, 32012, 32767
+        }, {
+            0, 1319, 2506, 3585, 4573, 5485, 6331, 7121,
+            7861, 8558, 9216, 9839, 10431, 10995, 11533, 12048,
+            12541, 13015, 13470, 13908, 14331, 14739, 15133, 15515,
+            15885, 16243, 16591, 16929, 17258, 17577, 17889, 18192,
+            18488, 18776, 19058, 19333, 19602, 19865, 20122, 20373,
+            20620, 20861, 21098, 21329, 21557, 21780, 21999, 22214,
+            22425, 22633, 22837, 23037, 23234, 23428, 23619, 23806,
+            23991, 24173, 24352, 24529, 24703, 24874, 25043, 25209,
+            25374, 25536, 25695, 25853, 26009, 26162, 26314, 26463,
+            26611, 26757, 26901, 27044, 27184, 27324, 27461, 27597,
+            27731, 27864, 27995, 28125, 28254, 28381, 28507, 28631,
+            28754, 28876, 28997, 29116, 29235, 29352, 29468, 29582,
+            29696, 29809, 29920, 30031, 30140, 30248, 30356, 30462,
+            30568, 30673, 30776, 30879, 30981, 31082, 31182, 31282,
+            31380, 31478, 31575, 31671, 31766, 31861, 31955, 32048,
+            32140, 32232, 32323, 32413, 32502, 32591, 32679, 32767
+        }
+    };
+
+    const char *curve_type_names[] = {
+        "Linear",
+        "Exponential",
+        "Logarithmic",
+        "Fixed",
+        "User"
+    };
+
+    const bool operator==(const velocity_settings& a, const velocity_settings& b) {
+        if ((a.curve != b.curve) || (a.fixed_level != b.fixed_level)) {
+            return false;
+        }
+        for (u8 i = 0; i < k_user_curve_points; i++) {
+            if (a.user_points[i] != b.user_points[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const bool operator!=(const velocity_settings& a, const velocity_settings& b) {
+        return !(a == b);
+    }
+
+    const char* curve_type2name(const curve_type curve) {
+        return curve_type_names[curve];
+    }
+
+    velocity_curve::velocity_curve()
+        : m_settings{}
+        , m_table(velocity_tables[curve_type::LINEAR_CURVE]) {
+        // nothing to do
+    }
+
+    velocity_curve::~velocity_curve() {
+        // nothing to do
+    }
+
+    void velocity_curve::set_settings(const velocity_settings& settings) {
+        m_settings = settings;
+        if (m_settings.curve >= curve_type::_CURVE_TYPE_COUNT_) {
+            m_settings.curve = curve_type::LINEAR_CURVE;
+        }
+        m_settings.fixed_level &= 0x7f;
+        for (auto &point: m_settings.user_points) {
+            point &= 0x7f;
+        }
+        // the fixed level is looked up in the linear table
+        m_table = (m_settings.curve < curve_type::FIXED_CURVE) ?
+            velocity_tables[m_settings.curve] :
+            (m_settings.curve == curve_type::FIXED_CURVE) ? velocity_tables[curve_type::LINEAR_CURVE] : nullptr;
+    }
+
+    const velocity_settings& velocity_curve::get_settings() const {
+        return m_settings;
+    }
+
+    const i16 velocity_curve::level(const u8 velocity) const {
+        const u8 v = velocity & 0x7f;
+        if (m_table) {
+            return m_table[(m_settings.curve == curve_type::FIXED_CURVE) ? m_settings.fixed_level : v];
+        }
+        // the last segment spans 112...127, one step short of the others
+        const u8 segment = (v >> 4);
+        const u8 segment_start = segment << 4;
+        const u8 segment_width = (segment == k_user_curve_points - 2) ? 15 : 16;
+        const i32 from = m_settings.user_points[segment];
+        const i32 to = m_settings.user_points[segment + 1];
+        const i32 point_level = from * segment_width + (to - from) * (v - segment_start);
+        // 0...127 * width to the DAC level of the linear table
+        return (point_level * 32767) / (127 * segment_width);
+    }
+} // namespace midimagic
@@ -0,0 +1,72 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+// Minimal Arduino stand-in for the host tools, only what the archive code
+// and the headers it pulls in need. Pin access does nothing on the host
+// unless HOST_VIRTUAL_HARDWARE is defined, then pins and time are provided
+// by virtual_hardware.cpp for the replay tool.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+typedef uint8_t byte;
+
+// pin names of the Blue Pill as used in hardware_config.h
+enum {
+    PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7, PA8, PA9, PA10, PA11, PA12, PA13, PA14, PA15,
+    PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7, PB8, PB9, PB10, PB11, PB12, PB13, PB14, PB15
+};
+
+typedef struct {
+    volatile uint32_t CRL, CRH, IDR, ODR, BSRR, BRR, LCKR;
+} GPIO_TypeDef;
+
+#ifdef HOST_VIRTUAL_HARDWARE
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+unsigned long millis();
+unsigned long micros();
+#else
+inline void pinMode(uint32_t, uint32_t) {}
+inline void digitalWrite(uint32_t, uint32_t) {}
+inline int digitalRead(uint32_t) { return LOW; }
+inline unsigned long millis() { return 0; }
+inline unsigned long micros() { return 0; }
+#endif
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// the host has no interrupts to mask
+inline uint32_t __get_PRIMASK() { return 0; }
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+
+#endif //HOST_ARDUINO_H
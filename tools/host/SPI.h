@@ -0,0 +1,39 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+// SPI stand-in for the host tools, ad57x4 is replaced as a whole on the
+// host, so the bus only has to exist.
+#include <stdint.h>
+
+#define SPI_CONTINUE 0
+#define SPI_LAST 1
+
+class SPIClass {
+public:
+    SPIClass(uint32_t, uint32_t, uint32_t) {}
+    void begin(uint8_t) {}
+    uint8_t transfer(uint8_t, uint8_t, int = SPI_LAST) { return 0; }
+    uint16_t transfer16(uint8_t, uint16_t, int = SPI_LAST) { return 0; }
+};
+
+#endif //HOST_SPI_H
@@ -0,0 +1,115 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+// Fuzz target throwing mutated EEPROM images at config_archive::loadon().
+//
+// libFuzzer, as one command line:
+//   clang++ -std=gnu++17 -g -fsanitize=fuzzer,address,undefined -Iinclude -Itools/host
+//       tools/host/archive_fuzz.cpp tools/host/memory_eeprom.cpp src/config_archive.cpp src/crc16.cpp
+// AFL (image on stdin), add -D ARCHIVE_FUZZ_STDIN and build with afl-clang-fast++.
+//
+// Besides the sanitizers every input is checked for reads beyond the
+// EEPROM, a parsed config exceeding its fixed capacities and a time limit.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "config_archive.h"
+#include "hardware_config.h"
+#include "memory_eeprom.h"
+
+using namespace midimagic;
+
+namespace {
+    // a full load of the largest image takes well below a millisecond
+    const auto k_time_limit = std::chrono::milliseconds(50);
+
+    void fail(const char* reason) {
+        std::fprintf(stderr, "archive_fuzz: %s\n", reason);
+        std::abort();
+    }
+
+    void check_presets(const struct preset_config& presets) {
+        if (presets.presets.size() > k_max_presets) {
+            fail("too many presets");
+        }
+        if (presets.active_preset >= presets.presets.size()) {
+            fail("active preset out of range");
+        }
+        if (presets.control_channel > 16) {
+            fail("control channel out of range");
+        }
+        for (auto& config: presets.presets) {
+            if (config.system_ports.size() > k_max_output_ports
+                || config.system_port_groups.size() > k_max_port_groups) {
+                fail("config exceeds capacity");
+            }
+            for (auto& pg: config.system_port_groups) {
+                if (pg.input_types.size() > k_max_input_types
+                    || pg.output_port_numbers.size() > k_max_output_ports) {
+                    fail("port group exceeds capacity");
+                }
+                for (auto& port_number: pg.output_port_numbers) {
+                    if (port_number >= k_max_output_ports) {
+                        fail("output port number out of range");
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static memory_eeprom archive_eeprom(hw_setup.eeprom.size);
+    archive_eeprom.load(std::vector<u8>(data, data + size));
+    archive_eeprom.reset_counters();
+
+    auto archive = std::make_unique<config_archive>(archive_eeprom);
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = archive->loadon();
+    if (std::chrono::steady_clock::now() - start > k_time_limit) {
+        fail("loadon exceeded the time limit");
+    }
+
+    // the image is read once per slot candidate, more hints at a loop
+    if (archive_eeprom.get_byte_reads() > 4u * archive_eeprom.get_size()) {
+        fail("loadon read the eeprom too often");
+    }
+    if (archive_eeprom.get_out_of_range_reads()) {
+        fail("loadon read beyond the eeprom");
+    }
+    if (result == config_archive::operation_result::SUCCESS) {
+        check_presets(archive->spellout());
+    }
+    return 0;
+}
+
+#ifdef ARCHIVE_FUZZ_STDIN
+int main() {
+    std::vector<uint8_t> image;
+    int c;
+    while ((c = std::getchar()) != EOF) {
+        image.push_back(c);
+    }
+    return LLVMFuzzerTestOneInput(image.data(), image.size());
+}
+#endif
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+// Host tool to inspect and generate EEPROM images, built from the same
+// config_archive sources as the firmware against memory_eeprom:
+//
+//   archive_tool encode <config.txt> <image.bin>   text presets to EEPROM image
+//   archive_tool decode <image.bin>                EEPROM image to text on stdout
+//
+// The image covers the whole EEPROM as read out by a programmer, the text
+// form is described in config_text.h.
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "config_archive.h"
+#include "hardware_config.h"
+#include "memory_eeprom.h"
+#include "config_text.h"
+
+using namespace midimagic;
+
+namespace {
+    int usage() {
+        std::cerr << "usage: archive_tool encode <config.txt> <image.bin>\n"
+                  << "       archive_tool decode <image.bin>\n";
+        return 2;
+    }
+
+    int encode(const char* text_path, const char* image_path) {
+        std::ifstream text(text_path);
+        if (!text) {
+            std::cerr << "can't open " << text_path << "\n";
+            return 1;
+        }
+        // the whole preset set is too big for the stack of some hosts as well
+        auto archive_eeprom = std::make_unique<memory_eeprom>(hw_setup.eeprom.size);
+        auto archive = std::make_unique<config_archive>(*archive_eeprom);
+        std::string error;
+        if (!parse_config_text(text, archive->get_presets(), error)) {
+            std::cerr << text_path << ": " << error << "\n";
+            return 1;
+        }
+
+        const auto result = archive->writeout();
+        if (result != config_archive::operation_result::SUCCESS) {
+            std::cerr << "writeout failed with error " << result << "\n";
+            return 1;
+        }
+
+        std::ofstream image(image_path, std::ios::binary);
+        const auto& cells = archive_eeprom->contents();
+        image.write(reinterpret_cast<const char*>(cells.data()), cells.size());
+        if (!image) {
+            std::cerr << "can't write " << image_path << "\n";
+            return 1;
+        }
+        std::cerr << "archive " << archive->get_archive_size() << " bytes, image "
+                  << cells.size() << " bytes\n";
+        return 0;
+    }
+
+    int decode(const char* image_path) {
+        std::ifstream image(image_path, std::ios::binary);
+        if (!image) {
+            std::cerr << "can't open " << image_path << "\n";
+            return 1;
+        }
+        const std::vector<u8> cells((std::istreambuf_iterator<char>(image)), std::istreambuf_iterator<char>());
+        if (cells.size() > hw_setup.eeprom.size) {
+            std::cerr << "image bigger than the EEPROM (" << hw_setup.eeprom.size << " bytes)\n";
+            return 1;
+        }
+
+        auto archive_eeprom = std::make_unique<memory_eeprom>(hw_setup.eeprom.size);
+        archive_eeprom->load(cells);
+        auto archive = std::make_unique<config_archive>(*archive_eeprom);
+        const auto result = archive->loadon();
+        if (result != config_archive::operation_result::SUCCESS) {
+            // same codes as shown on the display, see misc/doc/gui.md
+            std::cerr << "loadon failed with error " << result << "\n";
+            return 1;
+        }
+        format_config_text(archive->spellout(), std::cout);
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "encode") {
+        return encode(argv[2], argv[3]);
+    }
+    if (argc == 3 && std::string(argv[1]) == "decode") {
+        return decode(argv[2]);
+    }
+    return usage();
+}
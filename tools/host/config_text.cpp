@@ -0,0 +1,580 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include <sstream>
+#include <cstdlib>
+#include "config_text.h"
+
+namespace midimagic {
+    namespace {
+        struct named_value {
+            const char* name;
+            u8 value;
+        };
+
+        const named_value demux_names[] = {
+            {"random", demux_type::RANDOM},
+            {"identic", demux_type::IDENTIC},
+            {"fifo", demux_type::FIFO}
+        };
+
+        const named_value clock_mode_names[] = {
+            {"sync", output_port::clock_mode::SYNC},
+            {"gate", output_port::clock_mode::SIGNAL_GATE},
+            {"trigger_start", output_port::clock_mode::SIGNAL_TRIGGER_START},
+            {"trigger_cont", output_port::clock_mode::SIGNAL_TRIGGER_CONT},
+            {"trigger_stop", output_port::clock_mode::SIGNAL_TRIGGER_STOP}
+        };
+
+        const named_value pressure_names[] = {
+            {"voice", false},
+            {"companion", true}
+        };
+
+        const named_value arp_mode_names[] = {
+            {"off", arpeggiator::arp_mode::OFF},
+            {"up", arpeggiator::arp_mode::UP},
+            {"down", arpeggiator::arp_mode::DOWN},
+            {"updown", arpeggiator::arp_mode::UP_DOWN},
+            {"random", arpeggiator::arp_mode::RANDOM},
+            {"played", arpeggiator::arp_mode::AS_PLAYED}
+        };
+
+        const named_value modulation_names[] = {
+            {"none", modulation_type::NO_MODULATION},
+            {"lfo", modulation_type::LFO},
+            {"ad", modulation_type::AD_ENVELOPE},
+            {"adsr", modulation_type::ADSR_ENVELOPE}
+        };
+
+        const named_value shape_names[] = {
+            {"sine", lfo_shape::SINE},
+            {"tri", lfo_shape::TRIANGLE},
+            {"saw", lfo_shape::SAW},
+            {"square", lfo_shape::SQUARE},
+            {"sh", lfo_shape::SAMPLE_HOLD}
+        };
+
+        const named_value scale_names[] = {
+            {"off", scale_type::NO_SCALE},
+            {"chromatic", scale_type::CHROMATIC},
+            {"major", scale_type::MAJOR},
+            {"minor", scale_type::MINOR},
+            {"pentatonic", scale_type::PENTATONIC},
+            {"user", scale_type::USER_SCALE}
+        };
+
+        const named_value curve_names[] = {
+            {"linear", curve_type::LINEAR_CURVE},
+            {"exp", curve_type::EXPONENTIAL_CURVE},
+            {"log", curve_type::LOGARITHMIC_CURVE},
+            {"fixed", curve_type::FIXED_CURVE},
+            {"user", curve_type::USER_CURVE}
+        };
+
+        const named_value input_type_names[] = {
+            {"note_off", midi_message::NOTE_OFF},
+            {"note_on", midi_message::NOTE_ON},
+            {"poly_pressure", midi_message::POLY_KEY_PRESSURE},
+            {"cc", midi_message::CONTROL_CHANGE},
+            {"program_change", midi_message::PROGRAM_CHANGE},
+            {"channel_pressure", midi_message::CHANNEL_PRESSURE},
+            {"pitch_bend", midi_message::PITCH_BEND},
+            {"nrpn", midi_message::PARAMETER},
+            {"clock", midi_message::CLOCK},
+            {"start", midi_message::START},
+            {"continue", midi_message::CONTINUE},
+            {"stop", midi_message::STOP}
+        };
+
+        template<size_t N>
+        const bool lookup_value(const named_value (&table)[N], const std::string& name, u8& value) {
+            for (auto& entry: table) {
+                if (name == entry.name) {
+                    value = entry.value;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template<size_t N>
+        const char* lookup_name(const named_value (&table)[N], const u8 value) {
+            for (auto& entry: table) {
+                if (entry.value == value) {
+                    return entry.name;
+                }
+            }
+            return "?";
+        }
+
+        // decimal number in range min...max
+        const bool parse_number(const std::string& text, const long min, const long max, long& value) {
+            if (text.empty()) {
+                return false;
+            }
+            char* end;
+            value = std::strtol(text.c_str(), &end, 10);
+            return (*end == '\0') && (value >= min) && (value <= max);
+        }
+
+        // comma separated list, each element handed to parse_element
+        template<typename F>
+        const bool parse_list(const std::string& text, F parse_element) {
+            if (text.empty()) {
+                // empty list
+                return true;
+            }
+            std::istringstream elements(text);
+            std::string element;
+            while (std::getline(elements, element, ',')) {
+                if (!parse_element(element)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const bool split_key_value(const std::string& token, std::string& key, std::string& value) {
+            const auto separator = token.find('=');
+            if (separator == std::string::npos) {
+                return false;
+            }
+            key = token.substr(0, separator);
+            value = token.substr(separator + 1);
+            return true;
+        }
+
+        const bool parse_port(std::istringstream& tokens, struct output_port_config& port, std::string& error) {
+            std::string token;
+            long number;
+            if (!(tokens >> token) || !parse_number(token, 0, k_max_output_ports - 1, number)) {
+                error = "port number missing or out of range";
+                return false;
+            }
+            port.port_number = number;
+
+            std::string key, value;
+            while (tokens >> token) {
+                if (!split_key_value(token, key, value)) {
+                    error = "expected key=value, got '" + token + "'";
+                    return false;
+                }
+                if (key == "rate") {
+                    if (!parse_number(value, 1, 255, number)) {
+                        error = "clock rate out of range";
+                        return false;
+                    }
+                    port.clock_rate = number;
+                } else if (key == "velocity") {
+                    if (value != "on" && value != "off") {
+                        error = "velocity must be on or off";
+                        return false;
+                    }
+                    port.velocity_output = (value == "on");
+                } else if (key == "mode") {
+                    u8 mode;
+                    if (!lookup_value(clock_mode_names, value, mode)) {
+                        error = "unknown clock mode '" + value + "'";
+                        return false;
+                    }
+                    port.clock_mode = static_cast<output_port::clock_mode>(mode);
+                } else if (key == "mod") {
+                    u8 type;
+                    if (!lookup_value(modulation_names, value, type)) {
+                        error = "unknown modulation source '" + value + "'";
+                        return false;
+                    }
+                    port.modulation.type = static_cast<modulation_type>(type);
+                } else if (key == "shape") {
+                    u8 shape;
+                    if (!lookup_value(shape_names, value, shape)) {
+                        error = "unknown LFO shape '" + value + "'";
+                        return false;
+                    }
+                    port.modulation.shape = static_cast<lfo_shape>(shape);
+                } else if (key == "lfo_rate" || key == "sync" || key == "attack" || key == "decay" || key == "release") {
+                    if (!parse_number(value, 0, 255, number)) {
+                        error = key + " out of range";
+                        return false;
+                    }
+                    u8& field = (key == "lfo_rate") ? port.modulation.rate
+                              : (key == "sync") ? port.modulation.sync_ticks
+                              : (key == "attack") ? port.modulation.attack
+                              : (key == "decay") ? port.modulation.decay : port.modulation.release;
+                    field = number;
+                } else if (key == "depth" || key == "sustain") {
+                    if (!parse_number(value, 0, 127, number)) {
+                        error = key + " out of range";
+                        return false;
+                    }
+                    ((key == "depth") ? port.modulation.depth : port.modulation.sustain) = number;
+                } else if (key == "trigger") {
+                    // portgroups of a preset are numbered from 1 in the order of their lines, the ids they get
+                    if (!parse_number(value, 0, k_max_port_groups, number)) {
+                        error = "trigger portgroup out of range";
+                        return false;
+                    }
+                    port.modulation.trigger_group = number;
+                } else if (key == "scale") {
+                    u8 scale;
+                    if (!lookup_value(scale_names, value, scale)) {
+                        error = "unknown scale '" + value + "'";
+                        return false;
+                    }
+                    port.quantizer.scale = static_cast<scale_type>(scale);
+                } else if (key == "root") {
+                    // halftones above C
+                    if (!parse_number(value, 0, 11, number)) {
+                        error = "scale root out of range";
+                        return false;
+                    }
+                    port.quantizer.root = number;
+                } else if (key == "scale_mask") {
+                    // one digit per degree, the root first
+                    if (value.size() != 12 || value.find_first_not_of("01") != std::string::npos) {
+                        error = "scale mask must be 12 digits of 0 and 1";
+                        return false;
+                    }
+                    port.quantizer.user_mask = 0;
+                    for (u8 degree = 0; degree < 12; degree++) {
+                        if (value[degree] == '1') {
+                            port.quantizer.user_mask |= 1 << degree;
+                        }
+                    }
+                } else if (key == "scale_trigger") {
+                    if (value != "on" && value != "off") {
+                        error = "scale trigger must be on or off";
+                        return false;
+                    }
+                    port.quantizer.trigger = (value == "on");
+                } else if (key == "curve") {
+                    u8 curve;
+                    if (!lookup_value(curve_names, value, curve)) {
+                        error = "unknown velocity curve '" + value + "'";
+                        return false;
+                    }
+                    port.velocity_curve.curve = static_cast<curve_type>(curve);
+                } else if (key == "fixed_level") {
+                    if (!parse_number(value, 0, 127, number)) {
+                        error = "fixed velocity level out of range";
+                        return false;
+                    }
+                    port.velocity_curve.fixed_level = number;
+                } else if (key == "curve_points") {
+                    std::istringstream points(value);
+                    std::string point;
+                    u8 count = 0;
+                    while (std::getline(points, point, ',')) {
+                        if (count == k_user_curve_points || !parse_number(point, 0, 127, number)) {
+                            error = "curve points must be 9 levels of 0..127";
+                            return false;
+                        }
+                        port.velocity_curve.user_points[count++] = number;
+                    }
+                    if (count != k_user_curve_points) {
+                        error = "curve points must be 9 levels of 0..127";
+                        return false;
+                    }
+                } else {
+                    error = "unknown port key '" + key + "'";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const bool parse_portgroup(std::istringstream& tokens, struct port_group_config& pg, std::string& error) {
+            std::string token, key, value;
+            long number;
+            while (tokens >> token) {
+                if (!split_key_value(token, key, value)) {
+                    error = "expected key=value, got '" + token + "'";
+                    return false;
+                }
+                if (key == "channel") {
+                    if (!parse_number(value, 1, 16, number)) {
+                        error = "MIDI channel out of range";
+                        return false;
+                    }
+                    pg.midi_channel = number;
+                } else if (key == "demux") {
+                    u8 demux;
+                    if (!lookup_value(demux_names, value, demux)) {
+                        error = "unknown demux type '" + value + "'";
+                        return false;
+                    }
+                    pg.demux = static_cast<demux_type>(demux);
+                } else if (key == "cc") {
+                    if (!parse_number(value, 0, 127, number)) {
+                        error = "CC number out of range";
+                        return false;
+                    }
+                    pg.cont_controller_number = number;
+                } else if (key == "transpose") {
+                    if (!parse_number(value, -128, 127, number)) {
+                        error = "transpose out of range";
+                        return false;
+                    }
+                    pg.transpose_offset = number;
+                } else if (key == "pressure") {
+                    u8 to_companion;
+                    if (!lookup_value(pressure_names, value, to_companion)) {
+                        error = "unknown pressure target '" + value + "'";
+                        return false;
+                    }
+                    pg.pressure_to_companion = to_companion;
+                } else if (key == "nrpn") {
+                    if (!parse_number(value, 0, 16383, number)) {
+                        error = "NRPN number out of range";
+                        return false;
+                    }
+                    pg.nrpn_number = number;
+                } else if (key == "mpe") {
+                    if (value != "on" && value != "off") {
+                        error = "mpe must be on or off";
+                        return false;
+                    }
+                    pg.mpe = (value == "on");
+                } else if (key == "mpe_members") {
+                    if (!parse_number(value, 1, 15, number)) {
+                        error = "MPE member channel count out of range";
+                        return false;
+                    }
+                    pg.mpe_members = number;
+                } else if (key == "mpe_timbre") {
+                    if (!parse_number(value, 0, k_max_output_ports - 1, number) || number == 4) {
+                        error = "MPE timbre port offset out of range or 4";
+                        return false;
+                    }
+                    pg.mpe_timbre = number;
+                } else if (key == "arp") {
+                    u8 mode;
+                    if (!lookup_value(arp_mode_names, value, mode)) {
+                        error = "unknown arpeggiator mode '" + value + "'";
+                        return false;
+                    }
+                    pg.arp_mode = static_cast<arpeggiator::arp_mode>(mode);
+                } else if (key == "arp_division") {
+                    if (!parse_number(value, 2, 255, number)) {
+                        error = "arpeggiator division out of range";
+                        return false;
+                    }
+                    pg.arp_division = number;
+                } else if (key == "inputs") {
+                    pg.input_types.clear();
+                    const bool ok = parse_list(value, [&pg](const std::string& name) {
+                        u8 input_type;
+                        return lookup_value(input_type_names, name, input_type)
+                            && pg.input_types.push_back(static_cast<midi_message::message_type>(input_type));
+                    });
+                    if (!ok) {
+                        error = "unknown input type or too many in '" + value + "'";
+                        return false;
+                    }
+                } else if (key == "ports") {
+                    pg.output_port_numbers.clear();
+                    const bool ok = parse_list(value, [&pg](const std::string& port) {
+                        long port_number;
+                        return parse_number(port, 0, k_max_output_ports - 1, port_number)
+                            && pg.output_port_numbers.push_back(port_number);
+                    });
+                    if (!ok) {
+                        error = "port number out of range in '" + value + "'";
+                        return false;
+                    }
+                } else {
+                    error = "unknown portgroup key '" + key + "'";
+                    return false;
+                }
+            }
+            if (!pg.midi_channel) {
+                error = "portgroup without channel";
+                return false;
+            }
+            if (pg.mpe && pg.midi_channel != 1 && pg.midi_channel != 16) {
+                error = "MPE zone needs master channel 1 or 16";
+                return false;
+            }
+            if (pg.mpe && !pg.pressure_to_companion) {
+                error = "MPE zone sends pressure to the companion ports, pressure=voice not allowed";
+                return false;
+            }
+            return true;
+        }
+    } // namespace
+
+    const bool parse_config_text(std::istream& in, struct preset_config& presets, std::string& error) {
+        presets = preset_config();
+        std::string line;
+        u16 line_number = 0;
+        long number;
+        u8 pg_id = 1;
+
+        while (std::getline(in, line)) {
+            line_number++;
+            const auto comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            std::istringstream tokens(line);
+            std::string keyword;
+            if (!(tokens >> keyword)) {
+                // empty line
+                continue;
+            }
+
+            std::string reason;
+            if (keyword == "control_channel") {
+                std::string token;
+                if (!(tokens >> token) || !parse_number(token, 0, 16, number)) {
+                    reason = "control channel out of range (0 = off)";
+                } else {
+                    presets.control_channel = number;
+                }
+            } else if (keyword == "active_preset") {
+                std::string token;
+                if (!(tokens >> token) || !parse_number(token, 0, k_max_presets - 1, number)) {
+                    reason = "active preset out of range";
+                } else {
+                    presets.active_preset = number;
+                }
+            } else if (keyword == "preset") {
+                if (!presets.presets.emplace_back()) {
+                    reason = "too many presets";
+                }
+                pg_id = 1;
+            } else if (keyword == "port" || keyword == "portgroup") {
+                if (presets.presets.empty()) {
+                    presets.presets.emplace_back();
+                }
+                auto& config = presets.presets.back();
+                if (keyword == "port") {
+                    struct output_port_config port {};
+                    if (parse_port(tokens, port, reason) && !config.system_ports.push_back(port)) {
+                        reason = "too many ports";
+                    }
+                } else {
+                    struct port_group_config pg {};
+                    pg.id = pg_id++;
+                    if (parse_portgroup(tokens, pg, reason) && !config.system_port_groups.push_back(pg)) {
+                        reason = "too many portgroups";
+                    }
+                }
+            } else {
+                reason = "unknown keyword '" + keyword + "'";
+            }
+
+            if (!reason.empty()) {
+                error = "line " + std::to_string(line_number) + ": " + reason;
+                return false;
+            }
+        }
+
+        if (presets.presets.empty()) {
+            error = "no configuration found";
+            return false;
+        }
+        if (presets.active_preset >= presets.presets.size()) {
+            error = "active preset does not exist";
+            return false;
+        }
+        return true;
+    }
+
+    void format_config_text(const struct preset_config& presets, std::ostream& out) {
+        out << "control_channel " << (int) presets.control_channel << "\n";
+        out << "active_preset " << (int) presets.active_preset << "\n";
+
+        for (auto& config: presets.presets) {
+            out << "preset\n";
+            for (auto& port: config.system_ports) {
+                out << "port " << (int) port.port_number
+                    << " rate=" << (int) port.clock_rate
+                    << " velocity=" << (port.velocity_output ? "on" : "off")
+                    << " mode=" << lookup_name(clock_mode_names, port.clock_mode);
+                const modulation_settings& mod = port.modulation;
+                if (mod.type != modulation_type::NO_MODULATION) {
+                    // the trigger is written as the position of the portgroup in the preset
+                    u8 trigger_position = 0;
+                    for (u8 position = 0; mod.trigger_group && position < config.system_port_groups.size(); position++) {
+                        if (config.system_port_groups[position].id == mod.trigger_group) {
+                            trigger_position = position + 1;
+                            break;
+                        }
+                    }
+                    out << " mod=" << lookup_name(modulation_names, mod.type)
+                        << " shape=" << lookup_name(shape_names, mod.shape)
+                        << " lfo_rate=" << (int) mod.rate
+                        << " sync=" << (int) mod.sync_ticks
+                        << " depth=" << (int) mod.depth
+                        << " attack=" << (int) mod.attack
+                        << " decay=" << (int) mod.decay
+                        << " sustain=" << (int) mod.sustain
+                        << " release=" << (int) mod.release
+                        << " trigger=" << (int) trigger_position;
+                }
+                const quantizer_settings& quant = port.quantizer;
+                if (quant.scale != scale_type::NO_SCALE) {
+                    out << " scale=" << lookup_name(scale_names, quant.scale)
+                        << " root=" << (int) quant.root
+                        << " scale_mask=";
+                    for (u8 degree = 0; degree < 12; degree++) {
+                        out << ((quant.user_mask & (1 << degree)) ? '1' : '0');
+                    }
+                    out << " scale_trigger=" << (quant.trigger ? "on" : "off");
+                }
+                const velocity_settings& vel = port.velocity_curve;
+                if (vel.curve != curve_type::LINEAR_CURVE) {
+                    out << " curve=" << lookup_name(curve_names, vel.curve)
+                        << " fixed_level=" << (int) vel.fixed_level
+                        << " curve_points=";
+                    for (u8 point = 0; point < k_user_curve_points; point++) {
+                        out << (point ? "," : "") << (int) vel.user_points[point];
+                    }
+                }
+                out << "\n";
+            }
+            for (auto& pg: config.system_port_groups) {
+                out << "portgroup channel=" << (int) pg.midi_channel
+                    << " demux=" << lookup_name(demux_names, pg.demux)
+                    << " cc=" << (int) pg.cont_controller_number
+                    << " transpose=" << (int) pg.transpose_offset
+                    << " pressure=" << lookup_name(pressure_names, pg.pressure_to_companion)
+                    << " mpe=" << (pg.mpe ? "on" : "off")
+                    << " mpe_members=" << (int) pg.mpe_members
+                    << " mpe_timbre=" << (int) pg.mpe_timbre
+                    << " nrpn=" << (int) pg.nrpn_number
+                    << " arp=" << lookup_name(arp_mode_names, pg.arp_mode)
+                    << " arp_division=" << (int) pg.arp_division
+                    << " inputs=";
+                for (auto it = pg.input_types.begin(); it != pg.input_types.end(); ++it) {
+                    out << ((it == pg.input_types.begin()) ? "" : ",") << lookup_name(input_type_names, *it);
+                }
+                out << " ports=";
+                for (auto it = pg.output_port_numbers.begin(); it != pg.output_port_numbers.end(); ++it) {
+                    out << ((it == pg.output_port_numbers.begin()) ? "" : ",") << (int) *it;
+                }
+                out << "\n";
+            }
+        }
+    }
+} // namespace midimagic
@@ -0,0 +1,66 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_CONFIG_TEXT_H
+#define MIDIMAGIC_CONFIG_TEXT_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include "system_config.h"
+
+namespace midimagic {
+    // Line based text form of the presets for the host tools, one record
+    // per line, '#' starts a comment:
+    //
+    //   control_channel 0
+    //   active_preset 0
+    //   preset
+    //   port 0 rate=24 velocity=on mode=sync
+    //   portgroup channel=1 demux=random cc=0 transpose=-12 pressure=voice mpe=off mpe_members=15 mpe_timbre=0 nrpn=0 arp=off arp_division=6 inputs=note_on,note_off ports=0,7
+    //
+    // Every "preset" line starts a new preset, records before the first
+    // one go to the first preset. Omitted keys keep the struct defaults.
+    // Portgroups take arp=off|up|down|updown|random|played for the
+    // arpeggiator mode and arp_division=2..255 for its step length in
+    // MIDI clocks. mpe=on needs channel=1 (lower zone) or channel=16
+    // (upper zone) and takes mpe_members=1..15 for its member channels.
+    // An MPE zone puts the channel pressure on the companion ports, so it
+    // needs pressure=companion. mpe_timbre=1..7 puts the timbre controller
+    // that many ports above each voice port, 4 is the companion and not
+    // allowed, 0 drops the timbre.
+    // Ports take the optional keys mod=none|lfo|ad|adsr shape= lfo_rate=
+    // sync= depth= attack= decay= sustain= release= trigger= of the
+    // modulation source and scale=off|chromatic|major|minor|pentatonic|user
+    // root=0..11 scale_mask=100000010000 scale_trigger=on|off of the
+    // quantizer and curve=linear|exp|log|fixed|user fixed_level=0..127
+    // curve_points=0,16,32,48,64,80,96,112,127 of the velocity curve,
+    // printed only when they are in use.
+    // trigger= numbers the portgroup of the preset whose notes start the
+    // envelope, counted from 1 in line order, 0 for none.
+
+    // parse text into presets, on failure error holds line number and reason
+    const bool parse_config_text(std::istream& in, struct preset_config& presets, std::string& error);
+    // print presets in the form read by parse_config_text()
+    void format_config_text(const struct preset_config& presets, std::ostream& out);
+} // namespace midimagic
+
+#endif // MIDIMAGIC_CONFIG_TEXT_H
@@ -0,0 +1,302 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+// Host benchmark of the MIDI hot path: group_dispatcher::add_message(),
+// which sieves every message through the port groups, and the three
+// output_demux implementations. Synthetic configs are built for every
+// combination of
+//
+//   groups      1, 2, 4, 8, 16 and 32 port groups on the channels 1 to 4,
+//               so several groups listen to every message
+//   types       1, 4 or 8 input types per group
+//   polyphony   1, 4 or 8 notes held at once
+//   demux       random, identic or fifo
+//   mix         notes, cc, clock or a mix of the three
+//
+// and each is fed a prebuilt message stream, once to warm up and once
+// timed message by message. One CSV line per config goes to stdout (or -o),
+// times in nanoseconds, allocations counted by the replaced operator new:
+//
+//   groups,types,polyphony,demux,mix,messages,ns_per_msg,p99_ns,max_ns,allocs_per_msg
+//
+// so runs of different commits can be diffed or plotted. -n sets the
+// messages per config (default 4096). Worst case times on a desktop host
+// include its scheduling noise, compare them between runs on one machine.
+//
+// Build with "pio run -e dispatch_bench", which raises the port group limit
+// to 32, or, as one command line,
+//   g++ -std=gnu++17 -O2 -D HOST_VIRTUAL_HARDWARE -D MIDIMAGIC_MAX_PORT_GROUPS=32
+//       -D MIDIMAGIC_PORT_GROUP_POOL_SIZE=40 -Iinclude -Itools/host tools/host/dispatch_bench.cpp
+//       tools/host/{virtual_hardware,memory_eeprom}.cpp
+//       src/{inventory,port_group,dispatch_profiler,output,midi_monitor,menu_action_queue,config_archive,crc16}.cpp
+//       src/{parameter_decoder,arpeggiator,pattern_looper,modulation,quantizer,velocity_curve}.cpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <vector>
+#include "inventory.h"
+#include "hardware_config.h"
+#include "memory_eeprom.h"
+
+using namespace midimagic;
+
+namespace {
+    // allocations are only counted while a config is timed
+    bool s_count_allocations = false;
+    u32 s_allocations = 0;
+} // namespace
+
+void* operator new(size_t size) {
+    if (s_count_allocations) {
+        s_allocations++;
+    }
+    void* block = std::malloc(size ? size : 1);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+namespace {
+    enum message_mix {
+        NOTES = 0,
+        CC,
+        CLOCK,
+        MIXED,
+        _MIX_COUNT_
+    };
+
+    const char* message_mix_names[] = {"notes", "cc", "clock", "mixed"};
+    const char* demux_names[] = {"random", "identic", "fifo"};
+
+    // note messages first, so every group gets its notes
+    const midi_message::message_type k_input_types[] = {
+        midi_message::NOTE_ON,
+        midi_message::NOTE_OFF,
+        midi_message::CONTROL_CHANGE,
+        midi_message::CLOCK,
+        midi_message::CHANNEL_PRESSURE,
+        midi_message::PITCH_BEND,
+        midi_message::POLY_KEY_PRESSURE,
+        midi_message::PROGRAM_CHANGE
+    };
+    const u8 k_channels = 4;
+
+    struct bench_case {
+        u8 groups;
+        u8 types;
+        u8 polyphony;
+        demux_type demux;
+        message_mix mix;
+    };
+
+    class null_menu : public menu_interface {
+    public:
+        virtual void notify(const menu_action &a) override {
+            // nothing to do
+        }
+    };
+
+    const system_config build_config(const bench_case& c) {
+        system_config config;
+        for (u8 port = 0; port < k_max_output_ports; port++) {
+            output_port_config port_config;
+            port_config.port_number = port;
+            config.system_ports.push_back(port_config);
+        }
+        for (u8 group = 0; group < c.groups; group++) {
+            port_group_config pg;
+            pg.id = group + 1;
+            pg.demux = c.demux;
+            pg.midi_channel = (group % k_channels) + 1;
+            pg.cont_controller_number = 1;
+            for (u8 type = 0; type < c.types; type++) {
+                pg.input_types.push_back(k_input_types[type]);
+            }
+            // four ports each, neighbouring groups share ports
+            for (u8 port = 0; port < 4; port++) {
+                pg.output_port_numbers.push_back((group + port) % k_max_output_ports);
+            }
+            config.system_port_groups.push_back(pg);
+        }
+        return config;
+    }
+
+    void add_notes(std::vector<midi_message>& stream, const u8 polyphony, u8& next_note, std::vector<u8>& held) {
+        const u8 channel = (next_note % k_channels) + 1;
+        stream.push_back(midi_message(midi_message::NOTE_ON, channel, next_note, 100));
+        held.push_back(next_note);
+        if (held.size() > polyphony) {
+            stream.push_back(midi_message(midi_message::NOTE_OFF, (held.front() % k_channels) + 1, held.front(), 0));
+            held.erase(held.begin());
+        }
+        next_note = (next_note < 96) ? next_note + 1 : 36;
+    }
+
+    const std::vector<midi_message> build_stream(const bench_case& c, const u32 messages) {
+        std::vector<midi_message> stream;
+        std::vector<u8> held;
+        u8 next_note = 36;
+        u32 step = 0;
+        if (c.mix == message_mix::CLOCK || c.mix == message_mix::MIXED) {
+            stream.push_back(midi_message(midi_message::START, 0, 0, 0));
+        }
+        while (stream.size() < messages) {
+            switch (c.mix) {
+                case message_mix::NOTES :
+                    add_notes(stream, c.polyphony, next_note, held);
+                    break;
+                case message_mix::CC :
+                    stream.push_back(midi_message(midi_message::CONTROL_CHANGE, (step % k_channels) + 1, 1, step & 0x7f));
+                    break;
+                case message_mix::CLOCK :
+                    stream.push_back(midi_message(midi_message::CLOCK, 0, 0, 0));
+                    break;
+                default :
+                    // a played line over a moving controller, clock in the background
+                    if (step % 4 == 0) {
+                        add_notes(stream, c.polyphony, next_note, held);
+                    } else if (step % 4 == 2) {
+                        stream.push_back(midi_message(midi_message::CONTROL_CHANGE, (step % k_channels) + 1, 1, step & 0x7f));
+                    } else {
+                        stream.push_back(midi_message(midi_message::CLOCK, 0, 0, 0));
+                    }
+                    break;
+            }
+            step++;
+        }
+        stream.erase(stream.begin() + messages, stream.end());
+        return stream;
+    }
+
+    void run_case(const bench_case& c, const u32 messages, std::ostream& out) {
+        auto eeprom = std::make_unique<memory_eeprom>(hw_setup.eeprom.size);
+        SPIClass spi(hw_setup.dac.mosi, hw_setup.dac.miso, hw_setup.dac.clk);
+        ad57x4 dac0(spi, hw_setup.dac.cs0);
+        ad57x4 dac1(spi, hw_setup.dac.cs1);
+        auto port_master = std::make_shared<group_dispatcher>();
+        auto action_queue = std::make_shared<menu_action_queue>(std::make_shared<null_menu>());
+        auto invent = std::make_unique<inventory>(port_master, action_queue, dac0, dac1, *eeprom);
+        invent->apply_config(build_config(c));
+
+        const std::vector<midi_message> stream = build_stream(c, messages);
+        std::vector<u32> times;
+        times.reserve(messages);
+
+        // the first pass brings the groups into their steady state
+        for (auto m: stream) {
+            port_master->add_message(m);
+            action_queue->exec_next_action();
+        }
+        s_allocations = 0;
+        s_count_allocations = true;
+        for (auto m: stream) {
+            const auto start = std::chrono::steady_clock::now();
+            port_master->add_message(m);
+            const auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            action_queue->exec_next_action();
+        }
+        s_count_allocations = false;
+
+        uint64_t total = 0;
+        for (auto t: times) {
+            total += t;
+        }
+        std::sort(times.begin(), times.end());
+        out << (int) c.groups << "," << (int) c.types << "," << (int) c.polyphony << ","
+            << demux_names[c.demux] << "," << message_mix_names[c.mix] << ","
+            << messages << "," << total / messages << ","
+            << times[(messages * 99) / 100] << "," << times.back() << ","
+            << (double) s_allocations / messages << "\n";
+    }
+
+    int usage() {
+        std::cerr << "usage: dispatch_bench [-n messages] [-o results.csv]\n";
+        return 2;
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    u32 messages = 4096;
+    const char* out_path = nullptr;
+    for (int arg = 1; arg < argc; arg += 2) {
+        if (arg + 1 >= argc) {
+            return usage();
+        }
+        if (!std::strcmp(argv[arg], "-n")) {
+            messages = std::strtoul(argv[arg + 1], nullptr, 10);
+        } else if (!std::strcmp(argv[arg], "-o")) {
+            out_path = argv[arg + 1];
+        } else {
+            return usage();
+        }
+    }
+    if (!messages) {
+        return usage();
+    }
+    std::ofstream out_file;
+    if (out_path) {
+        out_file.open(out_path);
+        if (!out_file) {
+            std::cerr << "can't write " << out_path << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = out_path ? out_file : std::cout;
+
+    const u8 group_counts[] = {1, 2, 4, 8, 16, 32};
+    const u8 type_counts[] = {1, 4, 8};
+    const u8 polyphonies[] = {1, 4, 8};
+    out << "groups,types,polyphony,demux,mix,messages,ns_per_msg,p99_ns,max_ns,allocs_per_msg\n";
+    for (auto groups: group_counts) {
+        if (groups > k_max_port_groups) {
+            std::cerr << "skipping " << (int) groups << " groups, the build allows " << (int) k_max_port_groups << "\n";
+            continue;
+        }
+        for (auto types: type_counts) {
+            for (auto polyphony: polyphonies) {
+                for (u8 demux = demux_type::RANDOM; demux <= demux_type::FIFO; demux++) {
+                    for (u8 mix = message_mix::NOTES; mix < message_mix::_MIX_COUNT_; mix++) {
+                        const bench_case c{groups, types, polyphony,
+                                           static_cast<demux_type>(demux), static_cast<message_mix>(mix)};
+                        run_case(c, messages, out);
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
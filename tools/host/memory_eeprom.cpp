@@ -0,0 +1,143 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "memory_eeprom.h"
+
+namespace midimagic {
+    memory_eeprom::memory_eeprom(const u16 size)
+        : m_cells(size, 0xff)
+        , m_write_enabled(false)
+        , m_busy_polls(0)
+        , m_busy_remaining(0)
+        , m_byte_writes(0)
+        , m_byte_reads(0)
+        , m_out_of_range_reads(0)
+        , m_transactions(0) {
+        // nothing to do
+    }
+
+    memory_eeprom::~memory_eeprom() {
+        // nothing to do
+    }
+
+    void memory_eeprom::write(const u16 addr, const u8 data) {
+        if ((!m_write_enabled) || (addr >= m_cells.size())) {
+            return;
+        }
+        m_cells[addr] = data;
+        m_byte_writes++;
+        m_transactions++;
+    }
+
+    void memory_eeprom::start_write(const u16 addr, const u8 data) {
+        write(addr, data);
+        m_busy_remaining = m_busy_polls;
+    }
+
+    const bool memory_eeprom::write_ready() {
+        if (m_busy_remaining) {
+            m_busy_remaining--;
+            return false;
+        }
+        return true;
+    }
+
+    void memory_eeprom::write_2byte(const u16 addr, const u16 data) {
+        write(addr, (u8) ((data >> 8) & 0xff));
+        write(addr + 1, (u8) (data & 0xff));
+    }
+
+    const u8 memory_eeprom::read(const u16 addr) const {
+        u8 data = 0;
+        read_sequence(addr, &data, 1);
+        return data;
+    }
+
+    const u16 memory_eeprom::read_2byte(const u16 addr) const {
+        u8 data[2] = {0, 0};
+        read_sequence(addr, data, 2);
+        return (data[0] << 8) + data[1];
+    }
+
+    const u16 memory_eeprom::read_sequence(const u16 addr, u8* buffer, const u16 length) const {
+        if (addr >= m_cells.size()) {
+            m_out_of_range_reads += length;
+            return 0;
+        }
+        const u16 read_length = (length > m_cells.size() - addr) ? (m_cells.size() - addr) : length;
+        m_out_of_range_reads += length - read_length;
+        for (u16 i = 0; i < read_length; i++) {
+            buffer[i] = m_cells[addr + i];
+        }
+        m_byte_reads += read_length;
+        m_transactions++;
+        return read_length;
+    }
+
+    void memory_eeprom::enable_write() {
+        m_write_enabled = true;
+    }
+
+    void memory_eeprom::disable_write() {
+        m_write_enabled = false;
+    }
+
+    const u16 memory_eeprom::get_size() const {
+        return m_cells.size();
+    }
+
+    void memory_eeprom::load(const std::vector<u8>& data) {
+        for (size_t addr = 0; addr < m_cells.size(); addr++) {
+            m_cells[addr] = (addr < data.size()) ? data[addr] : 0xff;
+        }
+    }
+
+    const std::vector<u8>& memory_eeprom::contents() const {
+        return m_cells;
+    }
+
+    void memory_eeprom::set_busy_polls(const u16 polls) {
+        m_busy_polls = polls;
+    }
+
+    const u32 memory_eeprom::get_byte_writes() const {
+        return m_byte_writes;
+    }
+
+    const u32 memory_eeprom::get_byte_reads() const {
+        return m_byte_reads;
+    }
+
+    const u32 memory_eeprom::get_out_of_range_reads() const {
+        return m_out_of_range_reads;
+    }
+
+    const u32 memory_eeprom::get_transactions() const {
+        return m_transactions;
+    }
+
+    void memory_eeprom::reset_counters() {
+        m_byte_writes = 0;
+        m_byte_reads = 0;
+        m_out_of_range_reads = 0;
+        m_transactions = 0;
+    }
+} // namespace midimagic
@@ -0,0 +1,77 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_MEMORY_EEPROM_H
+#define MIDIMAGIC_MEMORY_EEPROM_H
+
+#include <vector>
+#include "eeprom_device.h"
+
+namespace midimagic {
+    // Host stand-in for the microwire EEPROM, keeps the contents in memory
+    // so config_archive and the parsers run without hardware
+    class memory_eeprom : public eeprom_device {
+    public:
+        // erased cells read 0xff like on the real device
+        explicit memory_eeprom(const u16 size);
+        memory_eeprom() = delete;
+        memory_eeprom(const memory_eeprom&) = delete;
+        virtual ~memory_eeprom();
+
+        virtual void write(const u16 addr, const u8 data) override;
+        // programs right away, write_ready() reports busy for the configured number of polls
+        virtual void start_write(const u16 addr, const u8 data) override;
+        virtual const bool write_ready() override;
+        virtual void write_2byte(const u16 addr, const u16 data) override;
+        virtual const u8 read(const u16 addr) const override;
+        virtual const u16 read_2byte(const u16 addr) const override;
+        virtual const u16 read_sequence(const u16 addr, u8* buffer, const u16 length) const override;
+        virtual void enable_write() override;
+        virtual void disable_write() override;
+        virtual const u16 get_size() const override;
+
+        // replace the contents, cells beyond data stay erased
+        void load(const std::vector<u8>& data);
+        const std::vector<u8>& contents() const;
+        // polls of write_ready() answered busy after every start_write()
+        void set_busy_polls(const u16 polls);
+
+        // access counters for benchmarks
+        const u32 get_byte_writes() const;
+        const u32 get_byte_reads() const;
+        // bytes requested beyond the end of the device
+        const u32 get_out_of_range_reads() const;
+        const u32 get_transactions() const;
+        void reset_counters();
+
+    private:
+        std::vector<u8> m_cells;
+        bool m_write_enabled;
+        u16 m_busy_polls;
+        u16 m_busy_remaining;
+        u32 m_byte_writes;
+        mutable u32 m_byte_reads;
+        mutable u32 m_out_of_range_reads;
+        mutable u32 m_transactions;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_MEMORY_EEPROM_H
@@ -0,0 +1,289 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include <algorithm>
+#include "midi_capture.h"
+
+namespace midimagic {
+    namespace {
+        // ten bits per byte at 31250 baud
+        const u32 k_wire_byte_us = 320;
+        // 120 bpm until the first tempo event
+        const u32 k_default_tempo = 500000;
+
+        // number of data bytes following a channel message status
+        const u8 data_length(const u8 status) {
+            const u8 type = status & 0xf0;
+            return (type == 0xc0 || type == 0xd0) ? 1 : 2;
+        }
+
+        const bool is_realtime(const u8 status) {
+            return status >= 0xf8;
+        }
+
+        class chunk_reader {
+        public:
+            chunk_reader(const std::vector<u8>& data, const size_t begin, const size_t end)
+                : m_data(data)
+                , m_pos(begin)
+                , m_end(end) {
+                // nothing to do
+            }
+
+            const bool at_end() const {
+                return m_pos >= m_end;
+            }
+
+            const bool read(u8& byte) {
+                if (at_end()) {
+                    return false;
+                }
+                byte = m_data[m_pos++];
+                return true;
+            }
+
+            const bool read_varint(u32& value) {
+                value = 0;
+                for (u8 i = 0; i < 4; i++) {
+                    u8 byte;
+                    if (!read(byte)) {
+                        return false;
+                    }
+                    value = (value << 7) | (byte & 0x7f);
+                    if (!(byte & 0x80)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            const bool skip(const u32 count) {
+                if (count > m_end - m_pos) {
+                    return false;
+                }
+                m_pos += count;
+                return true;
+            }
+
+        private:
+            const std::vector<u8>& m_data;
+            size_t m_pos;
+            const size_t m_end;
+        };
+
+        const u32 read_be(const std::vector<u8>& data, const size_t pos, const u8 length) {
+            u32 value = 0;
+            for (u8 i = 0; i < length; i++) {
+                value = (value << 8) | data[pos + i];
+            }
+            return value;
+        }
+
+        // an event of the merged tracks before the tick to time conversion
+        struct smf_event {
+            u32 tick;
+            u32 order; // keeps the file order of events on the same tick
+            u32 tempo; // 0 for MIDI events
+            capture_event event;
+        };
+
+        const bool read_track(chunk_reader& track, std::vector<smf_event>& events, std::string& error) {
+            u32 tick = 0;
+            u8 running_status = 0;
+            while (!track.at_end()) {
+                u32 delta;
+                u8 byte;
+                if (!track.read_varint(delta) || !track.read(byte)) {
+                    error = "truncated track event";
+                    return false;
+                }
+                tick += delta;
+                if (byte == 0xff) {
+                    u8 type;
+                    u32 length;
+                    if (!track.read(type) || !track.read_varint(length)) {
+                        error = "truncated meta event";
+                        return false;
+                    }
+                    if (type == 0x2f) {
+                        // end of track
+                        return true;
+                    }
+                    if (type == 0x51 && length == 3) {
+                        u8 tempo[3];
+                        track.read(tempo[0]);
+                        track.read(tempo[1]);
+                        if (!track.read(tempo[2])) {
+                            error = "truncated tempo event";
+                            return false;
+                        }
+                        const u32 us_per_beat = (tempo[0] << 16) | (tempo[1] << 8) | tempo[2];
+                        events.push_back(smf_event{tick, (u32) events.size(), us_per_beat ? us_per_beat : 1, {}});
+                        continue;
+                    }
+                    if (!track.skip(length)) {
+                        error = "truncated meta event";
+                        return false;
+                    }
+                    continue;
+                }
+                if (byte == 0xf0 || byte == 0xf7) {
+                    u32 length;
+                    if (!track.read_varint(length) || !track.skip(length)) {
+                        error = "truncated SysEx event";
+                        return false;
+                    }
+                    running_status = 0;
+                    continue;
+                }
+
+                capture_event event{0, running_status, 0, 0};
+                if (byte & 0x80) {
+                    event.status = byte;
+                    running_status = byte;
+                } else if (running_status) {
+                    event.data0 = byte;
+                } else {
+                    error = "data byte without status";
+                    return false;
+                }
+                if (event.status < 0x80 || event.status >= 0xf0) {
+                    error = "unexpected status in track";
+                    return false;
+                }
+                const u8 length = data_length(event.status);
+                if ((byte & 0x80) && !track.read(event.data0)) {
+                    error = "truncated MIDI event";
+                    return false;
+                }
+                if (length == 2 && !track.read(event.data1)) {
+                    error = "truncated MIDI event";
+                    return false;
+                }
+                events.push_back(smf_event{tick, (u32) events.size(), 0, event});
+            }
+            return true;
+        }
+
+        const bool read_smf(const std::vector<u8>& data, std::vector<capture_event>& events, std::string& error) {
+            if (data.size() < 14 || read_be(data, 4, 4) < 6) {
+                error = "truncated MThd chunk";
+                return false;
+            }
+            const u16 format = read_be(data, 8, 2);
+            const u16 division = read_be(data, 12, 2);
+            if (format > 1) {
+                error = "only SMF format 0 and 1 are supported";
+                return false;
+            }
+            if (!division) {
+                error = "division of 0 ticks";
+                return false;
+            }
+
+            std::vector<smf_event> merged;
+            size_t pos = 8 + read_be(data, 4, 4);
+            while (pos + 8 <= data.size()) {
+                const u32 length = read_be(data, pos + 4, 4);
+                const size_t begin = pos + 8;
+                if (length > data.size() - begin) {
+                    error = "truncated chunk";
+                    return false;
+                }
+                // chunks other than MTrk are skipped as the standard asks
+                if (std::equal(data.begin() + pos, data.begin() + pos + 4, "MTrk")) {
+                    chunk_reader track(data, begin, begin + length);
+                    if (!read_track(track, merged, error)) {
+                        return false;
+                    }
+                }
+                pos = begin + length;
+            }
+            std::stable_sort(merged.begin(), merged.end(), [](const smf_event& a, const smf_event& b) {
+                return a.tick < b.tick;
+            });
+
+            // ticks to time, either by tempo or by SMPTE frames
+            uint64_t base_us = 0;
+            u32 base_tick = 0;
+            u32 tempo = k_default_tempo;
+            const bool smpte = division & 0x8000;
+            const uint64_t ticks_per_second = smpte ? (uint64_t) (256 - (division >> 8)) * (division & 0xff) : 0;
+            for (auto &e: merged) {
+                uint64_t time_us;
+                if (smpte) {
+                    time_us = ((uint64_t) e.tick * 1000000) / ticks_per_second;
+                } else {
+                    time_us = base_us + ((uint64_t) (e.tick - base_tick) * tempo) / division;
+                }
+                if (e.tempo) {
+                    base_us = time_us;
+                    base_tick = e.tick;
+                    tempo = e.tempo;
+                    continue;
+                }
+                e.event.time_us = (time_us > 0xffffffff) ? 0xffffffff : (u32) time_us;
+                events.push_back(e.event);
+            }
+            return true;
+        }
+
+        const bool read_raw(const std::vector<u8>& data, std::vector<capture_event>& events) {
+            u8 running_status = 0;
+            u8 bytes[2];
+            u8 count = 0;
+            bool sysex = false;
+            for (size_t pos = 0; pos < data.size(); pos++) {
+                const u8 byte = data[pos];
+                const u32 time_us = (pos + 1) * k_wire_byte_us;
+                if (is_realtime(byte)) {
+                    // may come in between the bytes of any other message
+                    events.push_back(capture_event{time_us, byte, 0, 0});
+                    continue;
+                }
+                if (byte & 0x80) {
+                    sysex = (byte == 0xf0);
+                    // system common messages cancel the running status
+                    running_status = (byte < 0xf0) ? byte : 0;
+                    count = 0;
+                    continue;
+                }
+                if (sysex || !running_status) {
+                    continue;
+                }
+                bytes[count++] = byte;
+                if (count == data_length(running_status)) {
+                    events.push_back(capture_event{time_us, running_status, bytes[0], (count == 2) ? bytes[1] : (u8) 0});
+                    count = 0;
+                }
+            }
+            return true;
+        }
+    } // namespace
+
+    const bool read_midi_capture(const std::vector<u8>& data, std::vector<capture_event>& events, std::string& error) {
+        events.clear();
+        if (data.size() >= 4 && std::equal(data.begin(), data.begin() + 4, "MThd")) {
+            return read_smf(data, events, error);
+        }
+        return read_raw(data, events);
+    }
+} // namespace midimagic
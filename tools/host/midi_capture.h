@@ -0,0 +1,45 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_MIDI_CAPTURE_H
+#define MIDIMAGIC_MIDI_CAPTURE_H
+
+#include <string>
+#include <vector>
+#include "common.h"
+
+namespace midimagic {
+    // a channel or realtime message of a capture as it arrives on the MIDI input
+    struct capture_event {
+        u32 time_us; // from the start of the capture
+        u8 status;
+        u8 data0;
+        u8 data1;
+    };
+
+    // Reads a Standard MIDI File (format 0 or 1, tracks merged) or, if data
+    // doesn't start with an MThd chunk, a raw capture of the MIDI input.
+    // Raw captures carry no timing, their bytes are spaced at the 31250 baud
+    // wire rate. SysEx, meta events and system common messages are skipped.
+    const bool read_midi_capture(const std::vector<u8>& data, std::vector<capture_event>& events, std::string& error);
+} // namespace midimagic
+
+#endif // MIDIMAGIC_MIDI_CAPTURE_H
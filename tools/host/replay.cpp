@@ -0,0 +1,284 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+// Host tool replaying recorded MIDI through the dispatch code of the
+// firmware (group_dispatcher, port_group, output_demux, output_port and the
+// modulation engine) against virtual_hardware, to check routing changes
+// off-device:
+//
+//   replay [-o trace.txt] [-g golden.txt] [-t tail_ms] <config.txt> <capture>
+//
+// The config is the text form of config_text.h, the capture a Standard MIDI
+// File or a raw byte capture of the MIDI input, see midi_capture.h. Time is
+// virtual, the control rate interrupt runs at its place between the
+// messages. The trace of every DAC code and gate edge goes to stdout or -o,
+// -g compares it to a golden trace and fails on the first difference. After
+// the last message the outputs run on for tail_ms (default 100) so triggers
+// and envelopes finish. A summary with the events per second of the replay
+// is printed to stderr.
+//
+// Build with "pio run -e replay" or, as one command line,
+//   g++ -std=gnu++17 -D HOST_VIRTUAL_HARDWARE -Iinclude -Itools/host tools/host/replay.cpp
+//       tools/host/{virtual_hardware,midi_capture,config_text,memory_eeprom}.cpp
+//       src/{inventory,port_group,dispatch_profiler,output,midi_monitor,menu_action_queue,config_archive,crc16}.cpp
+//       src/{parameter_decoder,arpeggiator,pattern_looper,modulation,quantizer,velocity_curve}.cpp
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "inventory.h"
+#include "hardware_config.h"
+#include "memory_eeprom.h"
+#include "config_text.h"
+#include "midi_capture.h"
+#include "virtual_hardware.h"
+
+using namespace midimagic;
+
+namespace {
+    const u32 k_control_period_us = 1000000 / modulation_engine::k_control_rate;
+
+    // takes the place of the menu, port activity is not part of the trace
+    class replay_menu : public menu_interface {
+    public:
+        virtual void notify(const menu_action &a) override {
+            // nothing to do
+        }
+    };
+
+    int usage() {
+        std::cerr << "usage: replay [-o trace.txt] [-g golden.txt] [-t tail_ms] <config.txt> <capture>\n";
+        return 2;
+    }
+
+    // feeds an event to the dispatcher like the MIDI callbacks in main.cpp
+    void dispatch(const capture_event& e, group_dispatcher& gd, inventory& invent) {
+        const u8 channel = (e.status & 0x0f) + 1;
+        switch (e.status & 0xf0) {
+            case 0x80 : {
+                midi_message msg(midi_message::NOTE_OFF, channel, e.data0, e.data1);
+                gd.add_message(msg);
+                break;
+            }
+            case 0x90 : {
+                // the MIDI library turns Note On with velocity 0 into Note Off
+                midi_message msg(e.data1 ? midi_message::NOTE_ON : midi_message::NOTE_OFF, channel, e.data0, e.data1);
+                gd.add_message(msg);
+                break;
+            }
+            case 0xa0 : {
+                midi_message msg(midi_message::POLY_KEY_PRESSURE, channel, e.data0, e.data1);
+                gd.add_message(msg);
+                break;
+            }
+            case 0xb0 : {
+                midi_message msg(midi_message::CONTROL_CHANGE, channel, e.data0, e.data1);
+                gd.add_message(msg);
+                break;
+            }
+            case 0xc0 : {
+                midi_message msg(midi_message::PROGRAM_CHANGE, channel, e.data0, 0);
+                gd.add_message(msg);
+                invent.handle_program_change(channel, e.data0);
+                break;
+            }
+            case 0xd0 : {
+                midi_message msg(midi_message::CHANNEL_PRESSURE, channel, e.data0, 0);
+                gd.add_message(msg);
+                break;
+            }
+            case 0xe0 : {
+                // signed offset from the center, MSB in data0 as in handlePitchBend()
+                const u16 offset = (u16) (((e.data1 << 7) | e.data0) - 8192);
+                midi_message msg(midi_message::PITCH_BEND, channel, (u8) (offset >> 8), (u8) (offset & 0xff));
+                gd.add_message(msg);
+                break;
+            }
+            case 0xf0 : {
+                midi_message::message_type type;
+                switch (e.status) {
+                    case 0xf8 :
+                        type = midi_message::CLOCK;
+                        break;
+                    case 0xfa :
+                        type = midi_message::START;
+                        break;
+                    case 0xfb :
+                        type = midi_message::CONTINUE;
+                        break;
+                    case 0xfc :
+                        type = midi_message::STOP;
+                        break;
+                    default :
+                        // active sensing and reset are not handled by the firmware
+                        return;
+                }
+                midi_message msg(type, 0, 0, 0);
+                gd.add_message(msg);
+                break;
+            }
+            default :
+                // nothing to do
+                break;
+        }
+    }
+
+    const bool read_file(const char* path, std::vector<u8>& data) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // returns 0 if trace and golden trace are equal
+    int compare_golden(const std::string& trace, const char* golden_path) {
+        std::ifstream golden(golden_path);
+        if (!golden) {
+            std::cerr << "can't open " << golden_path << "\n";
+            return 1;
+        }
+        std::istringstream lines(trace);
+        std::string expected, got;
+        for (u32 line = 1; ; line++) {
+            const bool has_expected = static_cast<bool>(std::getline(golden, expected));
+            const bool has_got = static_cast<bool>(std::getline(lines, got));
+            if (!has_expected && !has_got) {
+                std::cerr << "trace matches " << golden_path << "\n";
+                return 0;
+            }
+            if (has_expected != has_got || expected != got) {
+                std::cerr << "trace differs from " << golden_path << " at line " << line << "\n"
+                          << "  expected: " << (has_expected ? expected : "<end of trace>") << "\n"
+                          << "  got:      " << (has_got ? got : "<end of trace>") << "\n";
+                return 1;
+            }
+        }
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* trace_path = nullptr;
+    const char* golden_path = nullptr;
+    u32 tail_ms = 100;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (!std::strcmp(argv[arg], "-o")) {
+            trace_path = argv[arg + 1];
+        } else if (!std::strcmp(argv[arg], "-g")) {
+            golden_path = argv[arg + 1];
+        } else if (!std::strcmp(argv[arg], "-t")) {
+            tail_ms = std::strtoul(argv[arg + 1], nullptr, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (argc - arg != 2) {
+        return usage();
+    }
+    const char* config_path = argv[arg];
+    const char* capture_path = argv[arg + 1];
+
+    std::ifstream text(config_path);
+    if (!text) {
+        std::cerr << "can't open " << config_path << "\n";
+        return 1;
+    }
+    // the whole preset set is too big for the stack of some hosts
+    auto presets = std::make_unique<preset_config>();
+    std::string error;
+    if (!parse_config_text(text, *presets, error)) {
+        std::cerr << config_path << ": " << error << "\n";
+        return 1;
+    }
+
+    std::vector<u8> capture;
+    if (!read_file(capture_path, capture)) {
+        std::cerr << "can't open " << capture_path << "\n";
+        return 1;
+    }
+    std::vector<capture_event> events;
+    if (!read_midi_capture(capture, events, error)) {
+        std::cerr << capture_path << ": " << error << "\n";
+        return 1;
+    }
+
+    // same setup as main.cpp, with the virtual hardware in place of the real one
+    virtual_hardware& hardware = virtual_hardware::get();
+    std::ostringstream trace;
+    hardware.set_trace(&trace);
+    SPIClass spi(hw_setup.dac.mosi, hw_setup.dac.miso, hw_setup.dac.clk);
+    ad57x4 dac0(spi, hw_setup.dac.cs0);
+    ad57x4 dac1(spi, hw_setup.dac.cs1);
+    auto eeprom = std::make_unique<memory_eeprom>(hw_setup.eeprom.size);
+    auto port_master = std::make_shared<group_dispatcher>();
+    auto action_queue = std::make_shared<menu_action_queue>(std::make_shared<replay_menu>());
+    auto invent = std::make_shared<inventory>(port_master, action_queue, dac0, dac1, *eeprom);
+    invent->apply_presets(*presets);
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t next_render_us = k_control_period_us;
+    auto run_until = [&](const u32 time_us) {
+        // the control rate interrupt comes first when it is due at the same time
+        while (next_render_us <= time_us) {
+            hardware.set_time(next_render_us);
+            port_master->get_modulation().render();
+            next_render_us += k_control_period_us;
+        }
+        hardware.set_time(time_us);
+    };
+    for (auto& e: events) {
+        run_until(e.time_us);
+        dispatch(e, *port_master, *invent);
+        action_queue->exec_next_action();
+    }
+    const uint64_t end_us = (events.empty() ? 0 : events.back().time_us) + (uint64_t) tail_ms * 1000;
+    run_until(end_us > 0xffffffff ? 0xffffffff : (u32) end_us);
+    const double host_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (trace_path) {
+        std::ofstream out(trace_path);
+        out << trace.str();
+        if (!out) {
+            std::cerr << "can't write " << trace_path << "\n";
+            return 1;
+        }
+    } else if (!golden_path) {
+        std::cout << trace.str();
+    }
+
+    std::cerr << "replayed " << events.size() << " events over " << end_us / 1000 << " ms in "
+              << host_s * 1000 << " ms host time, " << (u32) (host_s > 0 ? events.size() / host_s : 0)
+              << " events/s, " << hardware.get_dac_writes() << " DAC writes, "
+              << hardware.get_gate_edges() << " gate edges\n";
+
+    if (golden_path) {
+        return compare_golden(trace.str(), golden_path);
+    }
+    return 0;
+}
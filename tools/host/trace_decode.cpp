@@ -0,0 +1,240 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+// Host tool printing the event trace of a unit built with
+// -D MIDIMAGIC_EVENT_TRACE as a timeline:
+//
+//   trace_decode <trace.syx>
+//
+// The input is the answer to a TRACE_REQUEST as saved by a SysEx librarian,
+// the raw F0 ... F7 messages one after the other (see sysex.h). Other
+// messages in the file are skipped. Times are in microseconds from the
+// oldest record; the cycle counter wraps around after about a minute, a
+// longer gap between two records can't be told from a shorter one.
+//
+// Build with "pio run -e trace_decode" or
+//   g++ -std=gnu++17 -Iinclude -Itools/host tools/host/trace_decode.cpp
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "event_trace.h"
+#include "midi_types.h"
+#include "sysex.h"
+
+using namespace midimagic;
+
+namespace {
+    const char* menu_kind_names[] = {
+        "update",
+        "port activity",
+        "rotary",
+        "preset change"
+    };
+
+    const char* trigger_names[] = {
+        "UART error, code",
+        "receive buffer full, bytes",
+        "allocation on the MIDI path",
+        "slow dispatch, us"
+    };
+
+    int usage() {
+        std::cerr << "usage: trace_decode <trace.syx>\n";
+        return 2;
+    }
+
+    // 7 to 8 bit unpacking like sysex_transfer::decode()
+    void unpack(const u8* data, const u16 length, std::vector<u8>& out) {
+        for (u16 group = 0; group < length; group += 8) {
+            const u8 msbs = data[group];
+            for (u16 i = 1; i < 8 && group + i < length; i++) {
+                out.push_back(data[group + i] | (((msbs >> (i - 1)) & 0x01) << 7));
+            }
+        }
+    }
+
+    void print_event(const event_trace::trace_record& r) {
+        switch (r.id) {
+            case event_trace::event::MIDI_IN : {
+                const auto type = static_cast<midi_message::message_type>((r.arg >= midi_message::message_type::SYSTEM_MESSAGE) ? r.arg : r.arg >> 4);
+                std::printf("midi in  %-4s", midi_msgtype2shortname(type));
+                if (type < midi_message::message_type::SYSTEM_MESSAGE) {
+                    std::printf(" ch %2d %3d %3d", (r.arg & 0x0f) + 1, r.value >> 8, r.value & 0xff);
+                }
+                break;
+            }
+            case event_trace::event::ROUTE :
+                std::printf("route    %-4s to port group %d", midi_msgtype2shortname(static_cast<midi_message::message_type>(r.value)), r.arg);
+                break;
+            case event_trace::event::DAC_WRITE :
+                // 0 V at 0, +5 V at 32767
+                std::printf("dac      port %d level %6d  %+.3f V", r.arg, static_cast<i16>(r.value), static_cast<i16>(r.value) * 5.0 / 32767);
+                break;
+            case event_trace::event::GATE :
+                std::printf("gate     port %d %s", r.arg, r.value ? "high" : "low");
+                break;
+            case event_trace::event::MENU_ACTION :
+                if ((r.arg >> 4) < sizeof(menu_kind_names) / sizeof(menu_kind_names[0])) {
+                    std::printf("menu     %s %d data %d", menu_kind_names[r.arg >> 4], r.arg & 0x0f, static_cast<i16>(r.value));
+                } else {
+                    std::printf("menu     kind %d %d data %d", r.arg >> 4, r.arg & 0x0f, static_cast<i16>(r.value));
+                }
+                break;
+            case event_trace::event::EEPROM_READ :
+                std::printf("eeprom   read %d bytes at 0x%03x", r.arg, r.value);
+                break;
+            case event_trace::event::EEPROM_WRITE :
+                std::printf("eeprom   write 0x%02x at 0x%03x", r.arg, r.value);
+                break;
+            case event_trace::event::TRIGGER :
+                if (r.arg < sizeof(trigger_names) / sizeof(trigger_names[0])) {
+                    std::printf("TRIGGER  %s %d", trigger_names[r.arg], r.value);
+                } else {
+                    std::printf("TRIGGER  reason %d %d", r.arg, r.value);
+                }
+                break;
+            default :
+                std::printf("unknown event %d arg %d value %d", r.id, r.arg, r.value);
+                break;
+        }
+        std::printf("\n");
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        return usage();
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        std::cerr << "can't open " << argv[1] << "\n";
+        return 1;
+    }
+    const std::vector<u8> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // frame: F0 7D 4D device command arguments F7
+    const size_t k_arguments = 5;
+    u16 record_count = 0;
+    u16 cycles_per_us = 0;
+    bool begin_seen = false;
+    bool end_seen = false;
+    u16 next_chunk = 0;
+    std::vector<u8> data;
+    for (size_t start = 0; start < bytes.size(); start++) {
+        if (bytes[start] != 0xf0) {
+            continue;
+        }
+        size_t end = start + 1;
+        while (end < bytes.size() && bytes[end] != 0xf7) {
+            end++;
+        }
+        if (end == bytes.size()) {
+            std::cerr << "message at byte " << start << " not terminated\n";
+            return 1;
+        }
+        const u8* message = bytes.data() + start;
+        const size_t length = end - start;
+        start = end;
+        if (length < k_arguments || message[1] != sysex_transfer::k_manufacturer_id
+            || message[2] != sysex_transfer::k_model_id) {
+            continue;
+        }
+        const u8* arguments = message + k_arguments;
+        const size_t argument_length = length - k_arguments;
+        switch (message[4]) {
+            case sysex_transfer::command::TRACE_BEGIN :
+                if (argument_length < 4) {
+                    std::cerr << "short TRACE_BEGIN\n";
+                    return 1;
+                }
+                record_count = (arguments[0] << 7) | arguments[1];
+                cycles_per_us = (arguments[2] << 7) | arguments[3];
+                begin_seen = true;
+                break;
+            case sysex_transfer::command::TRACE_CHUNK : {
+                if (!begin_seen || argument_length < 3) {
+                    std::cerr << "TRACE_CHUNK without TRACE_BEGIN\n";
+                    return 1;
+                }
+                const u16 chunk = (arguments[0] << 7) | arguments[1];
+                u8 sum = 0;
+                for (size_t i = 0; i < argument_length; i++) {
+                    sum += arguments[i];
+                }
+                if (sum & 0x7f) {
+                    std::cerr << "bad checksum in chunk " << chunk << "\n";
+                    return 1;
+                }
+                if (chunk != next_chunk++) {
+                    std::cerr << "chunk " << chunk << " out of order\n";
+                    return 1;
+                }
+                unpack(arguments + 2, argument_length - 3, data);
+                break;
+            }
+            case sysex_transfer::command::TRACE_END :
+                end_seen = true;
+                break;
+            case sysex_transfer::command::NAK :
+                if (argument_length >= 4 && arguments[0] == sysex_transfer::command::TRACE_REQUEST) {
+                    std::cerr << ((arguments[3] == sysex_transfer::nak_reason::NO_TRACE) ? "firmware built without event trace\n"
+                                                                                         : "trace request refused, unit busy\n");
+                    return 1;
+                }
+                break;
+            default :
+                // other messages on the same cable
+                break;
+        }
+    }
+    if (!begin_seen || !end_seen) {
+        std::cerr << "no complete trace in " << argv[1] << "\n";
+        return 1;
+    }
+    if (data.size() != record_count * sizeof(event_trace::trace_record) || !cycles_per_us) {
+        std::cerr << "trace holds " << data.size() << " bytes, expected " << record_count << " records\n";
+        return 1;
+    }
+
+    std::printf("%14s %10s  event\n", "time [us]", "+[us]");
+    uint64_t time = 0;
+    u32 last_cycles = 0;
+    for (u16 i = 0; i < record_count; i++) {
+        const u8* bytes = data.data() + i * sizeof(event_trace::trace_record);
+        const event_trace::trace_record r {
+            static_cast<u32>(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<u32>(bytes[3]) << 24)),
+            static_cast<event_trace::event>(bytes[4]),
+            bytes[5],
+            static_cast<u16>(bytes[6] | (bytes[7] << 8))
+        };
+        // the counter difference is right across one wrap around
+        const u32 delta = i ? r.time - last_cycles : 0;
+        time += delta;
+        last_cycles = r.time;
+        std::printf("%14.2f %10.2f  ", static_cast<double>(time) / cycles_per_us, static_cast<double>(delta) / cycles_per_us);
+        print_event(r);
+    }
+    return 0;
+}
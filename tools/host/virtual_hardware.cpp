@@ -0,0 +1,166 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "virtual_hardware.h"
+#include "ad57x4.h"
+#include "hardware_config.h"
+#include "menu_interface.h"
+
+namespace midimagic {
+    virtual_hardware& virtual_hardware::get() {
+        static virtual_hardware hardware;
+        return hardware;
+    }
+
+    virtual_hardware::virtual_hardware()
+        : m_time_us(0)
+        , m_trace(nullptr)
+        , m_pins{}
+        , m_dac_writes(0)
+        , m_gate_edges(0) {
+        const u8 gate_pins[] = {
+            hw_setup.ports.dpin_port0,
+            hw_setup.ports.dpin_port1,
+            hw_setup.ports.dpin_port2,
+            hw_setup.ports.dpin_port3,
+            hw_setup.ports.dpin_port4,
+            hw_setup.ports.dpin_port5,
+            hw_setup.ports.dpin_port6,
+            hw_setup.ports.dpin_port7
+        };
+        for (auto &port: m_gate_port) {
+            port = 255;
+        }
+        for (u8 port = 0; port < sizeof(gate_pins); port++) {
+            m_gate_port[gate_pins[port]] = port;
+        }
+    }
+
+    virtual_hardware::~virtual_hardware() {
+        // nothing to do
+    }
+
+    void virtual_hardware::set_time(const u32 time_us) {
+        if (time_us > m_time_us) {
+            m_time_us = time_us;
+        }
+    }
+
+    const u32 virtual_hardware::get_time() const {
+        return m_time_us;
+    }
+
+    void virtual_hardware::set_trace(std::ostream* trace) {
+        m_trace = trace;
+    }
+
+    void virtual_hardware::write_dac(const u8 port_number, const i16 level) {
+        m_dac_writes++;
+        if (m_trace) {
+            *m_trace << m_time_us << " dac " << (int) port_number << " " << level << "\n";
+        }
+    }
+
+    void virtual_hardware::write_pin(const u32 pin, const u32 value) {
+        if (pin >= k_pin_count) {
+            return;
+        }
+        const u8 level = value ? HIGH : LOW;
+        if (m_pins[pin] == level) {
+            return;
+        }
+        m_pins[pin] = level;
+        if (m_gate_port[pin] == 255) {
+            return;
+        }
+        m_gate_edges++;
+        if (m_trace) {
+            *m_trace << m_time_us << " gate " << (int) m_gate_port[pin] << " " << (int) level << "\n";
+        }
+    }
+
+    const int virtual_hardware::read_pin(const u32 pin) const {
+        return (pin < k_pin_count) ? m_pins[pin] : LOW;
+    }
+
+    const u32 virtual_hardware::get_dac_writes() const {
+        return m_dac_writes;
+    }
+
+    const u32 virtual_hardware::get_gate_edges() const {
+        return m_gate_edges;
+    }
+
+    // the DAC goes straight to the trace, nothing is sent over the bus
+    ad57x4::ad57x4(SPIClass &spi, u8 sync)
+        : m_spi(spi)
+        , m_sync(sync) {
+        // nothing to do
+    }
+
+    ad57x4::~ad57x4() {
+        // nothing to do
+    }
+
+    void ad57x4::set_level(u16 level, u8 channel) {
+        const u8 first_port = (m_sync == hw_setup.dac.cs1) ? 4 : 0;
+        if (channel == ALL_CHANNELS) {
+            for (u8 dac_channel = CHANNEL_A; dac_channel < ALL_CHANNELS; dac_channel++) {
+                virtual_hardware::get().write_dac(first_port + dac_channel, (i16) level);
+            }
+        } else {
+            virtual_hardware::get().write_dac(first_port + channel, (i16) level);
+        }
+    }
+
+    // defined next to the views in menu.cpp, which needs the display
+    menu_action::menu_action(kind k, subkind sk, int d0, int d1)
+        : m_kind(k)
+        , m_subkind(sk)
+        , m_data0(d0)
+        , m_data1(d1) {
+        // nothing to do
+    }
+
+    menu_action::~menu_action() {
+        // nothing to do
+    }
+} // namespace midimagic
+
+void pinMode(uint32_t pin, uint32_t mode) {
+    // nothing to do
+}
+
+void digitalWrite(uint32_t pin, uint32_t value) {
+    midimagic::virtual_hardware::get().write_pin(pin, value);
+}
+
+int digitalRead(uint32_t pin) {
+    return midimagic::virtual_hardware::get().read_pin(pin);
+}
+
+unsigned long millis() {
+    return midimagic::virtual_hardware::get().get_time() / 1000;
+}
+
+unsigned long micros() {
+    return midimagic::virtual_hardware::get().get_time();
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ *                                                                            *
+ * Copyright 2026 Adrian Krause                                               *
+ *                                                                            *
+ * This file is part of Midimagic.                                            *
+ *                                                                            *
+ * This program is free software: you can redistribute it and/or modify it    *
+ * under the terms of the GNU Lesser General Public License as published by   *
+ * the Free Software Foundation, either version 3 of the License,             *
+ * or (at your option) any later version.                                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.                       *
+ * See the GNU Lesser General Public License for more details.                *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.      *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef MIDIMAGIC_VIRTUAL_HARDWARE_H
+#define MIDIMAGIC_VIRTUAL_HARDWARE_H
+
+#include <ostream>
+#include "common.h"
+
+namespace midimagic {
+    // Host stand-in for the outputs of the module, built with
+    // HOST_VIRTUAL_HARDWARE. Keeps the virtual time returned by millis() and
+    // micros() and writes every DAC code and gate edge with its time to the
+    // trace, one line each:
+    //
+    //   <time in us> dac <port> <level>    level as passed to output_port, 0 is 0 V
+    //   <time in us> gate <port> <0|1>
+    //
+    // ad57x4 is replaced as a whole, the DAC with the cs1 chip select drives
+    // ports 4 to 7. Other pins than the gate outputs are not traced.
+    class virtual_hardware {
+    public:
+        static virtual_hardware& get();
+
+        virtual_hardware(const virtual_hardware&) = delete;
+        ~virtual_hardware();
+
+        // time only moves forward
+        void set_time(const u32 time_us);
+        const u32 get_time() const;
+        // nullptr stops tracing
+        void set_trace(std::ostream* trace);
+
+        void write_dac(const u8 port_number, const i16 level);
+        void write_pin(const u32 pin, const u32 value);
+        const int read_pin(const u32 pin) const;
+
+        const u32 get_dac_writes() const;
+        const u32 get_gate_edges() const;
+
+    private:
+        static const u8 k_pin_count = 32;
+
+        virtual_hardware();
+
+        u32 m_time_us;
+        std::ostream* m_trace;
+        u8 m_pins[k_pin_count];
+        // port number of the gate output on each pin, 255 for other pins
+        u8 m_gate_port[k_pin_count];
+        u32 m_dac_writes;
+        u32 m_gate_edges;
+    };
+} // namespace midimagic
+
+#endif // MIDIMAGIC_VIRTUAL_HARDWARE_H